@@ -147,6 +147,10 @@ void _new_thread(char *pStackMem, unsigned stackSize, _thread_entry_t pEntry,
 	tcs->custom_data = NULL;
 #endif
 
+#ifdef CONFIG_THREAD_CPU_ACCOUNTING
+	tcs->cpu_cycles = 0;
+#endif
+
 	/*
 	 * intlock_key is constructed based on ARCv2 ISA Programmer's
 	 * Reference Manual CLRI instruction description:
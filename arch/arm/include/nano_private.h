@@ -128,6 +128,9 @@ struct tcs {
 #ifdef CONFIG_ERRNO
 	int errno_var;
 #endif
+#ifdef CONFIG_THREAD_CPU_ACCOUNTING
+	uint64_t cpu_cycles;   /* cycles spent running the thread */
+#endif
 };
 
 struct s_NANO {
@@ -37,6 +37,7 @@
 #include <zephyr.h>
 #include <misc/kernel_event_logger.h>
 #include <arch/cpu.h>
+#include <nano_private.h>
 
 #ifdef CONFIG_BOOT_TIME_MEASUREMENT
 extern uint64_t __idle_tsc;  /* timestamp when CPU went idle */
@@ -57,6 +58,7 @@ void nano_cpu_idle(void)
 {
 	_int_latency_stop();
 	_sys_k_event_logger_enter_sleep();
+	_sys_cpu_accounting_enter_sleep();
 #if defined(CONFIG_BOOT_TIME_MEASUREMENT)
 	__idle_tsc = _NanoTscRead();
 #endif
@@ -92,6 +94,7 @@ void nano_cpu_atomic_idle(unsigned int imask)
 {
 	_int_latency_stop();
 	_sys_k_event_logger_enter_sleep();
+	_sys_cpu_accounting_enter_sleep();
 
 	__asm__ volatile (
 	    "sti\n\t"
@@ -56,6 +56,8 @@ void _execute_handler(int_handler_t function, int context)
 
 	_sys_k_event_logger_exit_sleep();
 
+	_sys_cpu_accounting_isr_enter();
+
 #ifdef CONFIG_NESTED_INTERRUPTS
 	if (!_nanokernel.nested)
 #endif
@@ -86,6 +88,7 @@ void _execute_handler(int_handler_t function, int context)
 	_loapic_eoi();
 
 	disable_nested_interrupts();
+	_sys_cpu_accounting_isr_exit();
 	_nanokernel.nested--;
 
 	/* Are we returning to a task or fiber context? If so we need
@@ -43,6 +43,8 @@ unsigned int _Swap(unsigned int eflags)
 
 	_sys_k_event_logger_context_switch();
 
+	_sys_cpu_accounting_switch();
+
 	/* find the next context to run */
 	if (_nanokernel.fiber) {
 		next = _nanokernel.fiber;
@@ -88,6 +88,10 @@ void _new_thread(char *stack_memory, unsigned stack_size,
 	tcs->custom_data = NULL;
 #endif
 
+#ifdef CONFIG_THREAD_CPU_ACCOUNTING
+	tcs->cpu_cycles = 0;
+#endif
+
 	/* carve the thread entry struct from the "base" of the stack */
 
 	thread_context =
@@ -666,6 +666,9 @@ struct tcs {
 #ifdef CONFIG_ERRNO
 	int errno_var;
 #endif
+#ifdef CONFIG_THREAD_CPU_ACCOUNTING
+	uint64_t cpu_cycles;   /* cycles spent running the thread */
+#endif
 
 	/*
 	 * The location of all floating point related structures/fields MUST be
@@ -44,9 +44,12 @@
 #endif
 
 static BT_STACK_NOINIT(tx_stack, 256);
-static BT_STACK_NOINIT(rx_stack, 256);
-static BT_STACK_NOINIT(ack_stack, 256);
-static BT_STACK_NOINIT(retx_stack, 256);
+
+#define H5_TX_BUF_SIZE		CONFIG_BLUETOOTH_H5_TX_BUF_SIZE
+
+#if (H5_TX_BUF_SIZE & (H5_TX_BUF_SIZE - 1))
+#error "CONFIG_BLUETOOTH_H5_TX_BUF_SIZE must be a power of two"
+#endif
 
 #define HCI_3WIRE_ACK_PKT	0x00
 #define HCI_COMMAND_PKT		0x01
@@ -79,6 +82,7 @@ static bool reliable_packet(uint8_t type)
 
 #define H5_RX_ESC	1
 #define H5_TX_ACK_PEND	2
+#define H5_TX_FULL	3
 
 #define H5_HDR_SEQ(hdr)		((hdr)[0] & 0x07)
 #define H5_HDR_ACK(hdr)		(((hdr)[0] >> 3) & 0x07)
@@ -102,7 +106,10 @@ static struct h5 {
 	struct nano_fifo	rx_queue;
 	struct nano_fifo	unack_queue;
 
-	struct nano_sem		active_state;
+	/* Wakes up the TX fiber: new packets, acks and link packets */
+	struct nano_sem		tx_sem;
+	/* Given by the UART ISR once there is room in the TX buffer */
+	struct nano_sem		tx_space;
 
 	uint8_t			tx_win;
 	uint8_t			tx_ack;
@@ -110,10 +117,10 @@ static struct h5 {
 
 	uint8_t			rx_ack;
 
-	/* delayed rx ack fiber */
-	nano_thread_id_t  ack_to;
-	/* delayed retransmit fiber */
-	nano_thread_id_t  retx_to;
+	/* Tick at which a pure ack is sent if nothing was sent since */
+	uint32_t		ack_deadline;
+	/* Tick at which unacked packets are retransmitted */
+	uint32_t		retx_deadline;
 
 	enum {
 		UNINIT,
@@ -131,6 +138,15 @@ static struct h5 {
 
 static uint8_t unack_queue_len;
 
+/* SLIP encoded bytes waiting for the UART. The indexes run freely, the
+ * head is only moved by the TX fiber and the tail by the UART ISR.
+ */
+static struct {
+	uint8_t			data[H5_TX_BUF_SIZE];
+	volatile uint16_t	head;
+	volatile uint16_t	tail;
+} tx_buf;
+
 static const uint8_t sync_req[] = { 0x01, 0x7e };
 static const uint8_t sync_rsp[] = { 0x02, 0x7d };
 /* Third byte may change */
@@ -200,7 +216,7 @@ static void process_unack(void)
 	BT_DBG("rx_ack %u tx_ack %u tx_seq %u unack_queue_len %u",
 	       h5.rx_ack, h5.tx_ack, h5.tx_seq, unack_queue_len);
 
-	while (unack_queue_len > 0) {
+	while (number_removed > 0) {
 		if (next_seq == h5.rx_ack) {
 			/* Next sequence number is the same as last received
 			 * ack number
@@ -220,6 +236,11 @@ static void process_unack(void)
 
 	BT_DBG("Need to remove %u packet from the queue", number_removed);
 
+	/* The peer is making progress, give it time for the rest */
+	if (number_removed) {
+		h5.retx_deadline = sys_tick_get_32() + H5_TX_ACK_TIMEOUT;
+	}
+
 	while (number_removed) {
 		struct net_buf *buf = nano_fifo_get(&h5.unack_queue, TICKS_NONE);
 
@@ -286,24 +307,71 @@ static void hexdump(const char *str, const uint8_t *packet, size_t length)
 #define hexdump(str, packet, length)
 #endif
 
-static uint8_t h5_slip_byte(uint8_t byte)
+static void h5_tx_put(uint8_t byte)
+{
+	while ((uint16_t)(tx_buf.head - tx_buf.tail) == H5_TX_BUF_SIZE) {
+		/* Recheck after setting the flag, the ISR may have drained
+		 * the buffer in between.
+		 */
+		atomic_set_bit(&h5.flags, H5_TX_FULL);
+		uart_irq_tx_enable(h5_dev);
+
+		if ((uint16_t)(tx_buf.head - tx_buf.tail) == H5_TX_BUF_SIZE) {
+			nano_fiber_sem_take(&h5.tx_space, TICKS_UNLIMITED);
+		}
+	}
+
+	tx_buf.data[tx_buf.head & (H5_TX_BUF_SIZE - 1)] = byte;
+	tx_buf.head++;
+}
+
+static void h5_slip_byte(uint8_t byte)
 {
 	switch (byte) {
 	case SLIP_DELIMITER:
-		uart_poll_out(h5_dev, SLIP_ESC);
-		uart_poll_out(h5_dev, SLIP_ESC_DELIM);
-		return 2;
+		h5_tx_put(SLIP_ESC);
+		h5_tx_put(SLIP_ESC_DELIM);
+		break;
 	case SLIP_ESC:
-		uart_poll_out(h5_dev, SLIP_ESC);
-		uart_poll_out(h5_dev, SLIP_ESC_ESC);
-		return 2;
+		h5_tx_put(SLIP_ESC);
+		h5_tx_put(SLIP_ESC_ESC);
+		break;
 	default:
-		uart_poll_out(h5_dev, byte);
-		return 1;
+		h5_tx_put(byte);
+		break;
 	}
 }
 
-static void h5_send(const uint8_t *payload, uint8_t type, int len)
+/* Called from the UART ISR */
+static void h5_tx_drain(void)
+{
+	while (tx_buf.tail != tx_buf.head) {
+		uint16_t off = tx_buf.tail & (H5_TX_BUF_SIZE - 1);
+		int len, sent;
+
+		len = min((uint16_t)(tx_buf.head - tx_buf.tail),
+			  H5_TX_BUF_SIZE - off);
+
+		sent = uart_fifo_fill(h5_dev, &tx_buf.data[off], len);
+		if (!sent) {
+			break;
+		}
+
+		tx_buf.tail += sent;
+	}
+
+	if (tx_buf.tail == tx_buf.head) {
+		uart_irq_tx_disable(h5_dev);
+	}
+
+	if (atomic_test_and_clear_bit(&h5.flags, H5_TX_FULL)) {
+		nano_isr_sem_give(&h5.tx_space);
+	}
+}
+
+/* Only reliable packets use the sequence number */
+static void h5_send_seq(const uint8_t *payload, uint8_t type, int len,
+			uint8_t seq)
 {
 	uint8_t hdr[4];
 	int i;
@@ -312,18 +380,16 @@ static void h5_send(const uint8_t *payload, uint8_t type, int len)
 
 	memset(hdr, 0, sizeof(hdr));
 
-	/* Set ACK for outgoing packet and stop delayed fiber */
+	/* Every packet acks what was received so far, clear the flag
+	 * before reading tx_ack so that a packet received meanwhile gets
+	 * acked later on.
+	 */
+	atomic_clear_bit(&h5.flags, H5_TX_ACK_PEND);
 	H5_SET_ACK(hdr, h5.tx_ack);
-	if (h5.ack_to) {
-		BT_DBG("Cancel delayed ack fiber");
-		fiber_delayed_start_cancel(h5.ack_to);
-		h5.ack_to = NULL;
-	}
 
 	if (reliable_packet(type)) {
 		H5_SET_RELIABLE(hdr);
-		H5_SET_SEQ(hdr, h5.tx_seq);
-		h5.tx_seq = (h5.tx_seq + 1) % 8;
+		H5_SET_SEQ(hdr, seq);
 	}
 
 	H5_SET_TYPE(hdr, type);
@@ -334,7 +400,7 @@ static void h5_send(const uint8_t *payload, uint8_t type, int len)
 
 	h5_print_header(hdr, "TX: <");
 
-	uart_poll_out(h5_dev, SLIP_DELIMITER);
+	h5_tx_put(SLIP_DELIMITER);
 
 	for (i = 0; i < 4; i++) {
 		h5_slip_byte(hdr[i]);
@@ -344,65 +410,57 @@ static void h5_send(const uint8_t *payload, uint8_t type, int len)
 		h5_slip_byte(payload[i]);
 	}
 
-	uart_poll_out(h5_dev, SLIP_DELIMITER);
+	h5_tx_put(SLIP_DELIMITER);
+
+	uart_irq_tx_enable(h5_dev);
 }
 
-/* Delayed fiber taking care about retransmitting packets */
-static void retx_fiber(int arg1, int arg2)
+static void h5_send(const uint8_t *payload, uint8_t type, int len)
 {
-	ARG_UNUSED(arg1);
-	ARG_UNUSED(arg2);
-
-	BT_DBG("unack_queue_len %u", unack_queue_len);
+	h5_send_seq(payload, type, len, 0);
+}
 
-	h5.retx_to = NULL;
+static int32_t h5_ticks_left(uint32_t deadline)
+{
+	int32_t left = deadline - sys_tick_get_32();
 
-	if (unack_queue_len) {
-		struct nano_fifo tmp_queue;
-		struct net_buf *buf;
+	return left > 0 ? left : 0;
+}
 
-		nano_fifo_init(&tmp_queue);
+/* Go back to the oldest unacked packet, resending all of them */
+static void h5_retransmit(void)
+{
+	struct nano_fifo tmp_queue;
+	struct net_buf *buf;
+	unsigned int key;
 
-		/* Queue to temperary queue */
-		while ((buf = nano_fifo_get(&h5.tx_queue, TICKS_NONE))) {
-			nano_fifo_put(&tmp_queue, buf);
-		}
+	BT_DBG("unack_queue_len %u", unack_queue_len);
 
-		/* Queue unack packets to the beginning of the queue */
-		while ((buf = nano_fifo_get(&h5.unack_queue, TICKS_NONE))) {
-			/* include also packet type */
-			net_buf_push(buf, sizeof(uint8_t));
-			nano_fifo_put(&h5.tx_queue, buf);
-			h5.tx_seq = (h5.tx_seq - 1) & 0x07;
-			unack_queue_len--;
-		}
+	nano_fifo_init(&tmp_queue);
 
-		/* Queue saved packets from temp queue */
-		while ((buf = nano_fifo_get(&tmp_queue, TICKS_NONE))) {
-			nano_fifo_put(&h5.tx_queue, buf);
-		}
+	/* Acks are processed by the ISR */
+	key = irq_lock();
 
-		/* Analyze stack */
-		stack_analyze("retx_stack", retx_stack, sizeof(retx_stack));
+	/* Queue to temperary queue */
+	while ((buf = nano_fifo_get(&h5.tx_queue, TICKS_NONE))) {
+		nano_fifo_put(&tmp_queue, buf);
 	}
-}
-
-static void ack_fiber(int arg1, int arg2)
-{
-	ARG_UNUSED(arg1);
-	ARG_UNUSED(arg2);
-
-	BT_DBG("");
 
-	h5.ack_to = NULL;
+	/* Queue unack packets to the beginning of the queue */
+	while ((buf = nano_fifo_get(&h5.unack_queue, TICKS_NONE))) {
+		/* include also packet type */
+		net_buf_push(buf, sizeof(uint8_t));
+		nano_fifo_put(&h5.tx_queue, buf);
+		h5.tx_seq = (h5.tx_seq - 1) & 0x07;
+		unack_queue_len--;
+	}
 
-	h5_send(NULL, HCI_3WIRE_ACK_PKT, 0);
+	/* Queue saved packets from temp queue */
+	while ((buf = nano_fifo_get(&tmp_queue, TICKS_NONE))) {
+		nano_fifo_put(&h5.tx_queue, buf);
+	}
 
-	/* Analyze stacks */
-	stack_analyze("ack_stack", ack_stack, sizeof(ack_stack));
-	stack_analyze("tx_stack", tx_stack, sizeof(tx_stack));
-	stack_analyze("rx_stack", rx_stack, sizeof(rx_stack));
-	stack_analyze("retx_stack", retx_stack, sizeof(retx_stack));
+	irq_unlock(key);
 }
 
 static void h5_process_complete_packet(uint8_t *hdr)
@@ -417,10 +475,15 @@ static void h5_process_complete_packet(uint8_t *hdr)
 	if (reliable_packet(H5_HDR_PKT_TYPE(hdr))) {
 		/* For reliable packet increment next transmit ack number */
 		h5.tx_ack = (h5.tx_ack + 1) % 8;
-		/* Start delayed fiber to ack the packet */
-		h5.ack_to = fiber_delayed_start(ack_stack, sizeof(ack_stack),
-						ack_fiber, 0, 0, 7, 0,
-						H5_RX_ACK_TIMEOUT);
+
+		/* Ack with the next packet sent, or with a pure ack packet
+		 * if there is none before the deadline.
+		 */
+		if (!atomic_test_bit(&h5.flags, H5_TX_ACK_PEND)) {
+			h5.ack_deadline = sys_tick_get_32() +
+					  H5_RX_ACK_TIMEOUT;
+			atomic_set_bit(&h5.flags, H5_TX_ACK_PEND);
+		}
 	}
 
 	h5_print_header(hdr, "RX: >");
@@ -443,6 +506,9 @@ static void h5_process_complete_packet(uint8_t *hdr)
 		bt_recv(buf);
 		break;
 	}
+
+	/* Acks may have opened the window */
+	nano_isr_sem_give(&h5.tx_sem);
 }
 
 static void bt_uart_isr(struct device *unused)
@@ -457,12 +523,11 @@ static void bt_uart_isr(struct device *unused)
 	while (uart_irq_update(h5_dev) &&
 	       uart_irq_is_pending(h5_dev)) {
 
+		if (uart_irq_tx_ready(h5_dev)) {
+			h5_tx_drain();
+		}
+
 		if (!uart_irq_rx_ready(h5_dev)) {
-			if (uart_irq_tx_ready(h5_dev)) {
-				BT_DBG("transmit ready");
-			} else {
-				BT_DBG("spurious interrupt");
-			}
 			continue;
 		}
 
@@ -608,112 +673,145 @@ static int h5_queue(enum bt_buf_type buf_type, struct net_buf *buf)
 	memcpy(net_buf_push(buf, sizeof(type)), &type, sizeof(type));
 
 	nano_fifo_put(&h5.tx_queue, buf);
+	nano_sem_give(&h5.tx_sem);
 
 	return 0;
 }
 
-static void tx_fiber(void)
+static void h5_set_txwin(uint8_t *conf)
 {
-	BT_DBG("");
-
-	/* FIXME: make periodic sending */
-	h5_send(sync_req, HCI_3WIRE_LINK_PKT, sizeof(sync_req));
-
-	while (true) {
-		struct net_buf *buf;
-		uint8_t type;
+	conf[2] = h5.tx_win & 0x07;
+}
 
-		BT_DBG("link_state %u", h5.link_state);
+static void h5_process_link(struct net_buf *buf)
+{
+	hexdump("=> ", buf->data, buf->len);
 
-		switch (h5.link_state) {
-		case UNINIT:
-			/* FIXME: send sync */
-			fiber_sleep(10);
-			break;
-		case INIT:
-			/* FIXME: send conf */
-			fiber_sleep(10);
-			break;
-		case ACTIVE:
-			buf = nano_fifo_get(&h5.tx_queue, TICKS_UNLIMITED);
-			type = h5_get_type(buf);
+	if (!memcmp(buf->data, sync_req, sizeof(sync_req))) {
+		if (h5.link_state == ACTIVE) {
+			/* TODO Reset H5 */
+		}
 
-			h5_send(buf->data, type, buf->len);
+		h5_send(sync_rsp, HCI_3WIRE_LINK_PKT, sizeof(sync_rsp));
+	} else if (!memcmp(buf->data, sync_rsp, sizeof(sync_rsp))) {
+		if (h5.link_state == ACTIVE) {
+			/* TODO Reset H5 */
+		}
 
-			/* buf is dequeued from tx_queue and queued to unack
-			 * queue.
-			 */
-			nano_fifo_put(&h5.unack_queue, buf);
-			unack_queue_len++;
+		h5.link_state = INIT;
+		h5_set_txwin(conf_req);
+		h5_send(conf_req, HCI_3WIRE_LINK_PKT, sizeof(conf_req));
+	} else if (!memcmp(buf->data, conf_req, 2)) {
+		/*
+		 * The Host sends Config Response messages without a
+		 * Configuration Field.
+		 */
+		h5_send(conf_rsp, HCI_3WIRE_LINK_PKT, sizeof(conf_rsp));
+
+		/* Then send Config Request with Configuration Field */
+		h5_set_txwin(conf_req);
+		h5_send(conf_req, HCI_3WIRE_LINK_PKT, sizeof(conf_req));
+	} else if (!memcmp(buf->data, conf_rsp, 2)) {
+		h5.link_state = ACTIVE;
+		if (buf->len > 2) {
+			/* Configuration field present */
+			h5.tx_win = (buf->data[2] & 0x07);
+		}
 
-			if (h5.retx_to) {
-				fiber_delayed_start_cancel(h5.retx_to);
-			}
+		BT_DBG("Finished H5 configuration, tx_win %u",
+		       h5.tx_win);
 
-			h5.retx_to = fiber_delayed_start(retx_stack,
-							 sizeof(retx_stack),
-							 retx_fiber, 0, 0, 7, 0,
-							 H5_TX_ACK_TIMEOUT);
-			break;
-		}
+		stack_analyze("tx_stack", tx_stack, sizeof(tx_stack));
+	} else {
+		BT_ERR("Not handled yet %x %x",
+		       buf->data[0], buf->data[1]);
 	}
 }
 
-static void h5_set_txwin(uint8_t *conf)
+static void h5_send_reliable(struct net_buf *buf)
 {
-	conf[2] = h5.tx_win & 0x07;
+	unsigned int key;
+	uint8_t type, seq;
+
+	type = h5_get_type(buf);
+
+	/* Acks are processed by the ISR, which expects the packet in the
+	 * unack queue as soon as its sequence number is taken. Keep a
+	 * reference since it may get acked before we are done with it.
+	 */
+	key = irq_lock();
+
+	seq = h5.tx_seq;
+	h5.tx_seq = (h5.tx_seq + 1) % 8;
+
+	nano_fifo_put(&h5.unack_queue, net_buf_ref(buf));
+	unack_queue_len++;
+
+	h5.retx_deadline = sys_tick_get_32() + H5_TX_ACK_TIMEOUT;
+
+	irq_unlock(key);
+
+	h5_send_seq(buf->data, type, buf->len, seq);
+
+	net_buf_unref(buf);
 }
 
-static void rx_fiber(void)
+/*
+ * Sends link packets, acks and up to tx_win unacked reliable packets.
+ * Instead of separate fibers for delayed acks and retransmissions the
+ * fiber sleeps until the closest deadline or until it is given more
+ * work.
+ */
+static void tx_fiber(void)
 {
 	BT_DBG("");
 
+	/* FIXME: make periodic sending */
+	h5_send(sync_req, HCI_3WIRE_LINK_PKT, sizeof(sync_req));
+
 	while (true) {
+		int32_t timeout = TICKS_UNLIMITED;
 		struct net_buf *buf;
 
-		buf = nano_fifo_get(&h5.rx_queue, TICKS_UNLIMITED);
+		BT_DBG("link_state %u", h5.link_state);
 
-		hexdump("=> ", buf->data, buf->len);
+		while ((buf = nano_fifo_get(&h5.rx_queue, TICKS_NONE))) {
+			h5_process_link(buf);
+			net_buf_unref(buf);
+		}
 
-		if (!memcmp(buf->data, sync_req, sizeof(sync_req))) {
-			if (h5.link_state == ACTIVE) {
-				/* TODO Reset H5 */
+		if (h5.link_state == ACTIVE) {
+			if (unack_queue_len &&
+			    !h5_ticks_left(h5.retx_deadline)) {
+				h5_retransmit();
 			}
 
-			h5_send(sync_rsp, HCI_3WIRE_LINK_PKT, sizeof(sync_rsp));
-		} else if (!memcmp(buf->data, sync_rsp, sizeof(sync_rsp))) {
-			if (h5.link_state == ACTIVE) {
-				/* TODO Reset H5 */
+			while (unack_queue_len < h5.tx_win) {
+				buf = nano_fifo_get(&h5.tx_queue, TICKS_NONE);
+				if (!buf) {
+					break;
+				}
+
+				h5_send_reliable(buf);
 			}
 
-			h5.link_state = INIT;
-			h5_set_txwin(conf_req);
-			h5_send(conf_req, HCI_3WIRE_LINK_PKT, sizeof(conf_req));
-		} else if (!memcmp(buf->data, conf_req, 2)) {
-			/*
-			 * The Host sends Config Response messages without a
-			 * Configuration Field.
-			 */
-			h5_send(conf_rsp, HCI_3WIRE_LINK_PKT, sizeof(conf_rsp));
-
-			/* Then send Config Request with Configuration Field */
-			h5_set_txwin(conf_req);
-			h5_send(conf_req, HCI_3WIRE_LINK_PKT, sizeof(conf_req));
-		} else if (!memcmp(buf->data, conf_rsp, 2)) {
-			h5.link_state = ACTIVE;
-			if (buf->len > 2) {
-				/* Configuration field present */
-				h5.tx_win = (buf->data[2] & 0x07);
+			if (unack_queue_len) {
+				timeout = h5_ticks_left(h5.retx_deadline);
 			}
+		}
+
+		if (atomic_test_bit(&h5.flags, H5_TX_ACK_PEND)) {
+			int32_t left = h5_ticks_left(h5.ack_deadline);
 
-			BT_DBG("Finished H5 configuration, tx_win %u",
-			       h5.tx_win);
-		} else {
-			BT_ERR("Not handled yet %x %x",
-			       buf->data[0], buf->data[1]);
+			if (!left) {
+				h5_send(NULL, HCI_3WIRE_ACK_PKT, 0);
+			} else if (timeout == TICKS_UNLIMITED ||
+				   left < timeout) {
+				timeout = left;
+			}
 		}
 
-		net_buf_unref(buf);
+		nano_fiber_sem_take(&h5.tx_sem, timeout);
 	}
 }
 
@@ -725,20 +823,17 @@ static void h5_init(void)
 	h5.rx_state = START;
 	h5.tx_win = 4;
 
-	/* TX fiber */
-	nano_fifo_init(&h5.tx_queue);
-	fiber_start(tx_stack, sizeof(tx_stack), (nano_fiber_entry_t)tx_fiber,
-		    0, 0, 7, 0);
-
-	/* RX fiber */
 	net_buf_pool_init(signal_pool);
 
+	nano_fifo_init(&h5.tx_queue);
 	nano_fifo_init(&h5.rx_queue);
-	fiber_start(rx_stack, sizeof(rx_stack), (nano_fiber_entry_t)rx_fiber,
-		    0, 0, 7, 0);
-
-	/* Unack queue */
 	nano_fifo_init(&h5.unack_queue);
+	nano_sem_init(&h5.tx_sem);
+	nano_sem_init(&h5.tx_space);
+
+	/* TX fiber, which also handles link packets */
+	fiber_start(tx_stack, sizeof(tx_stack), (nano_fiber_entry_t)tx_fiber,
+		    0, 0, 7, 0);
 }
 
 static int h5_open(void)
@@ -0,0 +1,1089 @@
+/* virtual.c - Virtual Bluetooth LE controller */
+
+/*
+ * Copyright (c) 2016 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Emulates a minimal LE controller in software so that the host stack can
+ * be run and measured without a radio, e.g. in QEMU. The host connects to
+ * itself: while it is advertising, its scans report the advertising from
+ * a second virtual device, and a connection created to that device shows
+ * up both as a master connection and as a slave connection. ACL data sent
+ * on one end of such a link is received on the other end.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <nanokernel.h>
+#include <arch/cpu.h>
+#include <toolchain.h>
+#include <sections.h>
+#include <init.h>
+#include <misc/util.h>
+#include <misc/byteorder.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/log.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/driver.h>
+
+#if !defined(CONFIG_BLUETOOTH_DEBUG_DRIVER)
+#undef BT_DBG
+#define BT_DBG(fmt, ...)
+#endif
+
+#define VIRTUAL_LINKS		((CONFIG_BLUETOOTH_MAX_CONN + 1) / 2)
+
+/* Both ends of a link get a handle, the lowest bit is the role */
+#define LINK_HANDLE_BASE	0x0100
+#define LINK_HANDLE(i, role)	(LINK_HANDLE_BASE + ((i) << 1) + (role))
+#define HANDLE_LINK(h)		(((h) - LINK_HANDLE_BASE) >> 1)
+#define HANDLE_ROLE(h)		((h) & 0x01)
+
+#define ADV_RSSI		(-40)
+
+static BT_STACK_NOINIT(ctlr_stack, 512);
+
+/* Controller public address and the addresses of the virtual peers, the
+ * advertiser reported to the scanner and the initiator reported to the
+ * advertiser. Both peers are static random addresses.
+ */
+static const bt_addr_t public_addr = {
+	{ 0x00, 0x53, 0x00, 0x5e, 0x00, 0x00 } };
+static const bt_addr_le_t adv_addr = {
+	BT_ADDR_LE_RANDOM, { 0x01, 0x00, 0x00, 0x00, 0x00, 0xc0 } };
+static const bt_addr_le_t init_addr = {
+	BT_ADDR_LE_RANDOM, { 0x02, 0x00, 0x00, 0x00, 0x00, 0xc0 } };
+
+struct vconn {
+	/* ACL data from the host */
+	struct nano_fifo	tx_queue;
+	/* ACL packet waiting for the next connection event or for host
+	 * buffers.
+	 */
+	struct net_buf		*tx_buf;
+	/* Packets sent since the last Number of Completed Packets */
+	uint16_t		completed;
+};
+
+struct vlink {
+	bool			connected;
+	uint16_t		interval;
+	uint16_t		latency;
+	uint16_t		timeout;
+	uint32_t		next_event;
+	struct vconn		conn[2];
+};
+
+static struct {
+	struct nano_fifo	cmd_queue;
+	struct nano_sem		wake;
+
+	/* Controller to host flow control */
+	bool			host_flow;
+	uint16_t		host_credits;
+
+	bool			adv_enabled;
+	uint8_t			adv_type;
+	uint16_t		adv_interval;
+	uint32_t		next_adv;
+	uint8_t			adv_data_len;
+	uint8_t			adv_data[31];
+
+	bool			scan_enabled;
+
+	bool			initiating;
+	bt_addr_le_t		init_peer;
+	uint16_t		init_interval;
+	uint16_t		init_latency;
+	uint16_t		init_timeout;
+
+	uint32_t		rand;
+
+	struct vlink		link[VIRTUAL_LINKS];
+} vc;
+
+/* Connection interval is in 1.25 ms units */
+static uint32_t interval_ticks(uint16_t interval)
+{
+	uint32_t ticks = interval * 5 * sys_clock_ticks_per_sec / 4000;
+
+	return ticks ? ticks : 1;
+}
+
+/* Advertising interval is in 0.625 ms units */
+static uint32_t adv_ticks(uint16_t interval)
+{
+	uint32_t ticks = interval * 5 * sys_clock_ticks_per_sec / 8000;
+
+	return ticks ? ticks : 1;
+}
+
+static void set_timeout(int32_t *timeout, uint32_t deadline, uint32_t now)
+{
+	int32_t ticks = deadline - now;
+
+	if (ticks < 1) {
+		ticks = 1;
+	}
+
+	if (*timeout == TICKS_UNLIMITED || ticks < *timeout) {
+		*timeout = ticks;
+	}
+}
+
+static struct vlink *link_lookup(uint16_t handle)
+{
+	uint16_t i = HANDLE_LINK(handle);
+
+	if (handle < LINK_HANDLE_BASE || i >= VIRTUAL_LINKS ||
+	    !vc.link[i].connected) {
+		return NULL;
+	}
+
+	return &vc.link[i];
+}
+
+static struct net_buf *evt_create(uint8_t evt, uint8_t len)
+{
+	struct bt_hci_evt_hdr *hdr;
+	struct net_buf *buf;
+
+	buf = bt_buf_get_evt();
+	if (!buf) {
+		BT_ERR("Unable to allocate event buffer");
+		return NULL;
+	}
+
+	hdr = net_buf_add(buf, sizeof(*hdr));
+	hdr->evt = evt;
+	hdr->len = len;
+
+	return buf;
+}
+
+static struct net_buf *cmd_complete(uint16_t opcode, uint8_t plen)
+{
+	struct hci_evt_cmd_complete *cc;
+	struct net_buf *buf;
+
+	buf = evt_create(BT_HCI_EVT_CMD_COMPLETE, sizeof(*cc) + plen);
+	if (!buf) {
+		return NULL;
+	}
+
+	cc = net_buf_add(buf, sizeof(*cc));
+	cc->ncmd = 1;
+	cc->opcode = sys_cpu_to_le16(opcode);
+
+	return buf;
+}
+
+static void cmd_complete_status(uint16_t opcode, uint8_t status)
+{
+	struct net_buf *buf;
+
+	buf = cmd_complete(opcode, sizeof(status));
+	if (!buf) {
+		return;
+	}
+
+	net_buf_add_u8(buf, status);
+	bt_recv(buf);
+}
+
+static void cmd_status(uint16_t opcode, uint8_t status)
+{
+	struct bt_hci_evt_cmd_status *cs;
+	struct net_buf *buf;
+
+	buf = evt_create(BT_HCI_EVT_CMD_STATUS, sizeof(*cs));
+	if (!buf) {
+		return;
+	}
+
+	cs = net_buf_add(buf, sizeof(*cs));
+	cs->status = status;
+	cs->ncmd = 1;
+	cs->opcode = sys_cpu_to_le16(opcode);
+
+	bt_recv(buf);
+}
+
+static struct net_buf *le_meta_evt(uint8_t subevent, uint8_t len)
+{
+	struct bt_hci_evt_le_meta_event *me;
+	struct net_buf *buf;
+
+	buf = evt_create(BT_HCI_EVT_LE_META_EVENT, sizeof(*me) + len);
+	if (!buf) {
+		return NULL;
+	}
+
+	me = net_buf_add(buf, sizeof(*me));
+	me->subevent = subevent;
+
+	return buf;
+}
+
+static void le_conn_complete(uint8_t status, uint16_t handle, uint8_t role,
+			     const bt_addr_le_t *peer, struct vlink *link)
+{
+	struct bt_hci_evt_le_conn_complete *evt;
+	struct net_buf *buf;
+
+	buf = le_meta_evt(BT_HCI_EVT_LE_CONN_COMPLETE, sizeof(*evt));
+	if (!buf) {
+		return;
+	}
+
+	evt = net_buf_add(buf, sizeof(*evt));
+	memset(evt, 0, sizeof(*evt));
+	evt->status = status;
+	evt->handle = sys_cpu_to_le16(handle);
+	evt->role = role;
+	bt_addr_le_copy(&evt->peer_addr, peer);
+
+	if (link) {
+		evt->interval = sys_cpu_to_le16(link->interval);
+		evt->latency = sys_cpu_to_le16(link->latency);
+		evt->supv_timeout = sys_cpu_to_le16(link->timeout);
+	}
+
+	bt_recv(buf);
+}
+
+static void disconn_complete(uint16_t handle, uint8_t reason)
+{
+	struct bt_hci_evt_disconn_complete *evt;
+	struct net_buf *buf;
+
+	buf = evt_create(BT_HCI_EVT_DISCONN_COMPLETE, sizeof(*evt));
+	if (!buf) {
+		return;
+	}
+
+	evt = net_buf_add(buf, sizeof(*evt));
+	evt->status = 0;
+	evt->handle = sys_cpu_to_le16(handle);
+	evt->reason = reason;
+
+	bt_recv(buf);
+}
+
+static void vconn_flush(struct vconn *conn)
+{
+	struct net_buf *buf;
+
+	if (conn->tx_buf) {
+		net_buf_unref(conn->tx_buf);
+		conn->tx_buf = NULL;
+	}
+
+	while ((buf = nano_fifo_get(&conn->tx_queue, TICKS_NONE))) {
+		net_buf_unref(buf);
+	}
+
+	conn->completed = 0;
+}
+
+/* The host gives back the buffers of packets not acknowledged when the
+ * disconnection completes, so queued packets are dropped silently.
+ */
+static void link_disconnect(struct vlink *link)
+{
+	link->connected = false;
+
+	vconn_flush(&link->conn[BT_HCI_ROLE_MASTER]);
+	vconn_flush(&link->conn[BT_HCI_ROLE_SLAVE]);
+}
+
+static void reset(void)
+{
+	int i;
+
+	for (i = 0; i < VIRTUAL_LINKS; i++) {
+		link_disconnect(&vc.link[i]);
+	}
+
+	vc.host_flow = false;
+	vc.host_credits = 0;
+	vc.adv_enabled = false;
+	vc.adv_type = BT_LE_ADV_IND;
+	vc.adv_interval = 0x0800;
+	vc.adv_data_len = 0;
+	vc.scan_enabled = false;
+	vc.initiating = false;
+
+	vc.rand = sys_cycle_get_32() | 1;
+}
+
+static void read_local_features(uint16_t opcode)
+{
+	struct bt_hci_rp_read_local_features *rp;
+	struct net_buf *buf;
+
+	buf = cmd_complete(opcode, sizeof(*rp));
+	if (!buf) {
+		return;
+	}
+
+	rp = net_buf_add(buf, sizeof(*rp));
+	memset(rp, 0, sizeof(*rp));
+	rp->features[4] = BT_LMP_LE | BT_LMP_NO_BREDR;
+
+	bt_recv(buf);
+}
+
+static void read_local_version_info(uint16_t opcode)
+{
+	struct bt_hci_rp_read_local_version_info *rp;
+	struct net_buf *buf;
+
+	buf = cmd_complete(opcode, sizeof(*rp));
+	if (!buf) {
+		return;
+	}
+
+	rp = net_buf_add(buf, sizeof(*rp));
+	memset(rp, 0, sizeof(*rp));
+	/* Bluetooth 4.0, no manufacturer */
+	rp->hci_version = 0x06;
+	rp->lmp_version = 0x06;
+	rp->manufacturer = sys_cpu_to_le16(0xffff);
+
+	bt_recv(buf);
+}
+
+static void read_supported_commands(uint16_t opcode)
+{
+	struct bt_hci_rp_read_supported_commands *rp;
+	struct net_buf *buf;
+
+	buf = cmd_complete(opcode, sizeof(*rp));
+	if (!buf) {
+		return;
+	}
+
+	rp = net_buf_add(buf, sizeof(*rp));
+	memset(rp, 0, sizeof(*rp));
+
+	bt_recv(buf);
+}
+
+static void read_bd_addr(uint16_t opcode)
+{
+	struct bt_hci_rp_read_bd_addr *rp;
+	struct net_buf *buf;
+
+	buf = cmd_complete(opcode, sizeof(*rp));
+	if (!buf) {
+		return;
+	}
+
+	rp = net_buf_add(buf, sizeof(*rp));
+	rp->status = 0;
+	bt_addr_copy(&rp->bdaddr, &public_addr);
+
+	bt_recv(buf);
+}
+
+static void host_buffer_size(struct net_buf *buf)
+{
+	struct bt_hci_cp_host_buffer_size *cp = (void *)buf->data;
+
+	vc.host_credits = sys_le16_to_cpu(cp->acl_pkts);
+}
+
+static void host_num_completed_packets(struct net_buf *buf)
+{
+	struct bt_hci_cp_host_num_completed_packets *cp = (void *)buf->data;
+	int i;
+
+	for (i = 0; i < cp->num_handles; i++) {
+		vc.host_credits += sys_le16_to_cpu(cp->h[i].count);
+	}
+}
+
+static void le_read_local_features(uint16_t opcode)
+{
+	struct bt_hci_rp_le_read_local_features *rp;
+	struct net_buf *buf;
+
+	buf = cmd_complete(opcode, sizeof(*rp));
+	if (!buf) {
+		return;
+	}
+
+	rp = net_buf_add(buf, sizeof(*rp));
+	memset(rp, 0, sizeof(*rp));
+
+	bt_recv(buf);
+}
+
+static void le_read_buffer_size(uint16_t opcode)
+{
+	struct bt_hci_rp_le_read_buffer_size *rp;
+	struct net_buf *buf;
+
+	buf = cmd_complete(opcode, sizeof(*rp));
+	if (!buf) {
+		return;
+	}
+
+	rp = net_buf_add(buf, sizeof(*rp));
+	rp->status = 0;
+	rp->le_max_len = sys_cpu_to_le16(CONFIG_BLUETOOTH_VIRTUAL_ACL_LEN);
+	rp->le_max_num = CONFIG_BLUETOOTH_VIRTUAL_ACL_COUNT;
+
+	bt_recv(buf);
+}
+
+/* Not meant to be secure, only to give the host some entropy */
+static void le_rand(uint16_t opcode)
+{
+	struct bt_hci_rp_le_rand *rp;
+	struct net_buf *buf;
+	int i;
+
+	buf = cmd_complete(opcode, sizeof(*rp));
+	if (!buf) {
+		return;
+	}
+
+	rp = net_buf_add(buf, sizeof(*rp));
+	rp->status = 0;
+
+	for (i = 0; i < sizeof(rp->rand); i++) {
+		vc.rand ^= vc.rand << 13;
+		vc.rand ^= vc.rand >> 17;
+		vc.rand ^= vc.rand << 5;
+		rp->rand[i] = vc.rand;
+	}
+
+	bt_recv(buf);
+}
+
+static void le_set_adv_parameters(struct net_buf *buf)
+{
+	struct bt_hci_cp_le_set_adv_parameters *cp = (void *)buf->data;
+
+	vc.adv_type = cp->type;
+	vc.adv_interval = sys_le16_to_cpu(cp->min_interval);
+}
+
+static void le_set_adv_data(struct net_buf *buf)
+{
+	struct bt_hci_cp_le_set_adv_data *cp = (void *)buf->data;
+
+	vc.adv_data_len = min(cp->len, sizeof(vc.adv_data));
+	memcpy(vc.adv_data, cp->data, vc.adv_data_len);
+}
+
+static void le_set_adv_enable(struct net_buf *buf)
+{
+	vc.adv_enabled = (buf->data[0] == BT_HCI_LE_ADV_ENABLE);
+	vc.next_adv = sys_tick_get_32();
+}
+
+static void le_set_scan_enable(struct net_buf *buf)
+{
+	struct bt_hci_cp_le_set_scan_enable *cp = (void *)buf->data;
+
+	vc.scan_enabled = (cp->enable == BT_HCI_LE_SCAN_ENABLE);
+}
+
+static struct vlink *link_alloc(void)
+{
+	int i;
+
+	for (i = 0; i < VIRTUAL_LINKS; i++) {
+		if (!vc.link[i].connected) {
+			return &vc.link[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void le_create_conn(uint16_t opcode, struct net_buf *buf)
+{
+	struct bt_hci_cp_le_create_conn *cp = (void *)buf->data;
+
+	if (vc.initiating) {
+		cmd_status(opcode, BT_HCI_ERR_CMD_DISALLOWED);
+		return;
+	}
+
+	if (!link_alloc()) {
+		cmd_status(opcode, BT_HCI_ERR_CONN_LIMIT_EXCEEDED);
+		return;
+	}
+
+	vc.initiating = true;
+	bt_addr_le_copy(&vc.init_peer, &cp->peer_addr);
+	vc.init_interval = sys_le16_to_cpu(cp->conn_interval_min);
+	vc.init_latency = sys_le16_to_cpu(cp->conn_latency);
+	vc.init_timeout = sys_le16_to_cpu(cp->supervision_timeout);
+
+	cmd_status(opcode, 0);
+}
+
+static void le_create_conn_cancel(uint16_t opcode)
+{
+	if (!vc.initiating) {
+		cmd_complete_status(opcode, BT_HCI_ERR_CMD_DISALLOWED);
+		return;
+	}
+
+	vc.initiating = false;
+
+	cmd_complete_status(opcode, 0);
+	le_conn_complete(BT_HCI_ERR_UNKNOWN_CONN_ID, 0, BT_HCI_ROLE_MASTER,
+			 &vc.init_peer, NULL);
+}
+
+static void le_conn_update(uint16_t opcode, struct net_buf *buf)
+{
+	struct hci_cp_le_conn_update *cp = (void *)buf->data;
+	uint16_t handle = sys_le16_to_cpu(cp->handle);
+	struct bt_hci_evt_le_conn_update_complete *evt;
+	struct vlink *link;
+	uint8_t role;
+
+	link = link_lookup(handle);
+	if (!link) {
+		cmd_status(opcode, BT_HCI_ERR_UNKNOWN_CONN_ID);
+		return;
+	}
+
+	cmd_status(opcode, 0);
+
+	link->interval = sys_le16_to_cpu(cp->conn_interval_min);
+	link->latency = sys_le16_to_cpu(cp->conn_latency);
+	link->timeout = sys_le16_to_cpu(cp->supervision_timeout);
+
+	/* Both ends of the link see the new parameters */
+	for (role = BT_HCI_ROLE_MASTER; role <= BT_HCI_ROLE_SLAVE; role++) {
+		buf = le_meta_evt(BT_HCI_EVT_LE_CONN_UPDATE_COMPLETE,
+				  sizeof(*evt));
+		if (!buf) {
+			return;
+		}
+
+		evt = net_buf_add(buf, sizeof(*evt));
+		evt->status = 0;
+		evt->handle = sys_cpu_to_le16(LINK_HANDLE(link - vc.link,
+							  role));
+		evt->interval = sys_cpu_to_le16(link->interval);
+		evt->latency = sys_cpu_to_le16(link->latency);
+		evt->supv_timeout = sys_cpu_to_le16(link->timeout);
+
+		bt_recv(buf);
+	}
+}
+
+static void le_read_remote_features(uint16_t opcode, struct net_buf *buf)
+{
+	struct bt_hci_cp_le_read_remote_features *cp = (void *)buf->data;
+	uint16_t handle = sys_le16_to_cpu(cp->handle);
+	struct bt_hci_ev_le_remote_feat_complete *evt;
+
+	if (!link_lookup(handle)) {
+		cmd_status(opcode, BT_HCI_ERR_UNKNOWN_CONN_ID);
+		return;
+	}
+
+	cmd_status(opcode, 0);
+
+	buf = le_meta_evt(BT_HCI_EV_LE_REMOTE_FEAT_COMPLETE, sizeof(*evt));
+	if (!buf) {
+		return;
+	}
+
+	evt = net_buf_add(buf, sizeof(*evt));
+	memset(evt, 0, sizeof(*evt));
+	evt->handle = sys_cpu_to_le16(handle);
+
+	bt_recv(buf);
+}
+
+static void disconnect(uint16_t opcode, struct net_buf *buf)
+{
+	struct bt_hci_cp_disconnect *cp = (void *)buf->data;
+	uint16_t handle = sys_le16_to_cpu(cp->handle);
+	struct vlink *link;
+
+	link = link_lookup(handle);
+	if (!link) {
+		cmd_status(opcode, BT_HCI_ERR_UNKNOWN_CONN_ID);
+		return;
+	}
+
+	cmd_status(opcode, 0);
+
+	link_disconnect(link);
+
+	disconn_complete(handle, BT_HCI_ERR_LOCALHOST_TERM_CONN);
+	disconn_complete(handle ^ 0x01, cp->reason);
+}
+
+static void process_cmd(struct net_buf *buf)
+{
+	struct bt_hci_cmd_hdr *hdr = (void *)buf->data;
+	uint16_t opcode = sys_le16_to_cpu(hdr->opcode);
+
+	BT_DBG("opcode 0x%04x len %u", opcode, hdr->param_len);
+
+	net_buf_pull(buf, sizeof(*hdr));
+
+	switch (opcode) {
+	case BT_HCI_OP_RESET:
+		reset();
+		cmd_complete_status(opcode, 0);
+		break;
+	case BT_HCI_OP_READ_LOCAL_FEATURES:
+		read_local_features(opcode);
+		break;
+	case BT_HCI_OP_READ_LOCAL_VERSION_INFO:
+		read_local_version_info(opcode);
+		break;
+	case BT_HCI_OP_READ_SUPPORTED_COMMANDS:
+		read_supported_commands(opcode);
+		break;
+	case BT_HCI_OP_READ_BD_ADDR:
+		read_bd_addr(opcode);
+		break;
+	case BT_HCI_OP_HOST_BUFFER_SIZE:
+		host_buffer_size(buf);
+		cmd_complete_status(opcode, 0);
+		break;
+	case BT_HCI_OP_SET_CTL_TO_HOST_FLOW:
+		vc.host_flow = (buf->data[0] & BT_HCI_CTL_TO_HOST_FLOW_ENABLE);
+		cmd_complete_status(opcode, 0);
+		break;
+	case BT_HCI_OP_HOST_NUM_COMPLETED_PACKETS:
+		/* No event is generated for this command */
+		host_num_completed_packets(buf);
+		break;
+	case BT_HCI_OP_LE_READ_LOCAL_FEATURES:
+		le_read_local_features(opcode);
+		break;
+	case BT_HCI_OP_LE_READ_BUFFER_SIZE:
+		le_read_buffer_size(opcode);
+		break;
+	case BT_HCI_OP_LE_RAND:
+		le_rand(opcode);
+		break;
+	case BT_HCI_OP_LE_SET_ADV_PARAMETERS:
+		le_set_adv_parameters(buf);
+		cmd_complete_status(opcode, 0);
+		break;
+	case BT_HCI_OP_LE_SET_ADV_DATA:
+		le_set_adv_data(buf);
+		cmd_complete_status(opcode, 0);
+		break;
+	case BT_HCI_OP_LE_SET_ADV_ENABLE:
+		le_set_adv_enable(buf);
+		cmd_complete_status(opcode, 0);
+		break;
+	case BT_HCI_OP_LE_SET_SCAN_ENABLE:
+		le_set_scan_enable(buf);
+		cmd_complete_status(opcode, 0);
+		break;
+	case BT_HCI_OP_SET_EVENT_MASK:
+	case BT_HCI_OP_LE_SET_EVENT_MASK:
+	case BT_HCI_OP_LE_SET_RANDOM_ADDRESS:
+	case BT_HCI_OP_LE_SET_SCAN_RSP_DATA:
+	case BT_HCI_OP_LE_SET_SCAN_PARAMS:
+		cmd_complete_status(opcode, 0);
+		break;
+	case BT_HCI_OP_LE_CREATE_CONN:
+		le_create_conn(opcode, buf);
+		break;
+	case BT_HCI_OP_LE_CREATE_CONN_CANCEL:
+		le_create_conn_cancel(opcode);
+		break;
+	case BT_HCI_OP_LE_CONN_UPDATE:
+		le_conn_update(opcode, buf);
+		break;
+	case BT_HCI_OP_LE_READ_REMOTE_FEATURES:
+		le_read_remote_features(opcode, buf);
+		break;
+	case BT_HCI_OP_DISCONNECT:
+		disconnect(opcode, buf);
+		break;
+	default:
+		BT_DBG("Unknown opcode 0x%04x", opcode);
+		cmd_complete_status(opcode, BT_HCI_ERR_UNKNOWN_CMD);
+		break;
+	}
+}
+
+static void adv_report(void)
+{
+	struct bt_hci_ev_le_advertising_info *info;
+	struct net_buf *buf;
+	uint8_t type;
+
+	/* Directed advertising is reported with the same event type
+	 * regardless of the duty cycle.
+	 */
+	type = vc.adv_type;
+	if (type == BT_LE_ADV_DIRECT_IND_LOW_DUTY) {
+		type = BT_LE_ADV_DIRECT_IND;
+	}
+
+	buf = le_meta_evt(BT_HCI_EVT_LE_ADVERTISING_REPORT,
+			  1 + sizeof(*info) + vc.adv_data_len + 1);
+	if (!buf) {
+		return;
+	}
+
+	net_buf_add_u8(buf, 1);
+
+	info = net_buf_add(buf, sizeof(*info));
+	info->evt_type = type;
+	bt_addr_le_copy(&info->addr, &adv_addr);
+	info->length = vc.adv_data_len;
+
+	memcpy(net_buf_add(buf, vc.adv_data_len), vc.adv_data,
+	       vc.adv_data_len);
+	net_buf_add_u8(buf, ADV_RSSI);
+
+	bt_recv(buf);
+}
+
+static bool adv_connectable(void)
+{
+	return vc.adv_type == BT_LE_ADV_IND ||
+	       vc.adv_type == BT_LE_ADV_DIRECT_IND ||
+	       vc.adv_type == BT_LE_ADV_DIRECT_IND_LOW_DUTY;
+}
+
+static void conn_establish(void)
+{
+	struct vlink *link;
+	int i;
+
+	link = link_alloc();
+	if (!link) {
+		return;
+	}
+
+	i = link - vc.link;
+
+	vc.initiating = false;
+	/* The advertiser stops advertising once connected */
+	vc.adv_enabled = false;
+
+	link->connected = true;
+	link->interval = vc.init_interval;
+	link->latency = vc.init_latency;
+	link->timeout = vc.init_timeout;
+	link->next_event = sys_tick_get_32();
+
+	BT_DBG("link %d interval %u", i, link->interval);
+
+	le_conn_complete(0, LINK_HANDLE(i, BT_HCI_ROLE_MASTER),
+			 BT_HCI_ROLE_MASTER, &adv_addr, link);
+	le_conn_complete(0, LINK_HANDLE(i, BT_HCI_ROLE_SLAVE),
+			 BT_HCI_ROLE_SLAVE, &init_addr, link);
+}
+
+/* Runs the advertiser of the virtual peer, it mirrors the advertising of
+ * the host.
+ */
+static void adv_process(uint32_t now, int32_t *timeout)
+{
+	if (!vc.adv_enabled) {
+		return;
+	}
+
+	if (vc.initiating && adv_connectable() &&
+	    !bt_addr_le_cmp(&vc.init_peer, &adv_addr)) {
+		conn_establish();
+		return;
+	}
+
+	if (!vc.scan_enabled) {
+		return;
+	}
+
+	if ((int32_t)(now - vc.next_adv) >= 0) {
+		adv_report();
+		vc.next_adv = now + adv_ticks(vc.adv_interval);
+	}
+
+	set_timeout(timeout, vc.next_adv, now);
+}
+
+static void acl_deliver(struct vlink *link, uint8_t role)
+{
+	struct vconn *conn = &link->conn[role];
+	struct bt_hci_acl_hdr *hdr = (void *)conn->tx_buf->data;
+	uint16_t handle = sys_le16_to_cpu(hdr->handle);
+	uint8_t flags = bt_acl_flags(handle);
+	struct net_buf *buf;
+
+	buf = bt_buf_get_acl();
+	if (!buf) {
+		BT_ERR("Unable to allocate ACL buffer");
+		return;
+	}
+
+	if (net_buf_tailroom(buf) < conn->tx_buf->len) {
+		BT_ERR("ACL packet of %u bytes does not fit host buffers",
+		       conn->tx_buf->len);
+		net_buf_unref(buf);
+		goto done;
+	}
+
+	/* Controllers report the first fragment as flushable */
+	if (flags == BT_ACL_START_NO_FLUSH) {
+		flags = BT_ACL_START;
+	}
+
+	memcpy(net_buf_add(buf, conn->tx_buf->len), conn->tx_buf->data,
+	       conn->tx_buf->len);
+
+	/* Received on the other end of the link */
+	hdr = (void *)buf->data;
+	hdr->handle = sys_cpu_to_le16(bt_acl_handle_pack(
+				LINK_HANDLE(link - vc.link, role ^ 0x01),
+				flags));
+
+	if (vc.host_flow) {
+		vc.host_credits--;
+	}
+
+	bt_recv(buf);
+
+done:
+	net_buf_unref(conn->tx_buf);
+	conn->tx_buf = NULL;
+	conn->completed++;
+}
+
+static bool vconn_pending(struct vconn *conn)
+{
+	if (!conn->tx_buf) {
+		conn->tx_buf = nano_fifo_get(&conn->tx_queue, TICKS_NONE);
+	}
+
+	return conn->tx_buf != NULL;
+}
+
+static bool link_pending(struct vlink *link)
+{
+	return vconn_pending(&link->conn[BT_HCI_ROLE_MASTER]) ||
+	       vconn_pending(&link->conn[BT_HCI_ROLE_SLAVE]);
+}
+
+/* Moves ACL data between both ends of a link. With
+ * CONFIG_BLUETOOTH_VIRTUAL_PKTS_PER_EVENT data is only exchanged during
+ * connection events, every connection interval.
+ */
+static void link_process(struct vlink *link, uint32_t now, int32_t *timeout)
+{
+	int budget = CONFIG_BLUETOOTH_VIRTUAL_PKTS_PER_EVENT;
+	uint8_t role;
+	int i;
+
+	if (!link->connected || !link_pending(link)) {
+		return;
+	}
+
+	if (budget) {
+		uint32_t iv = interval_ticks(link->interval);
+
+		if ((int32_t)(now - link->next_event) < 0) {
+			set_timeout(timeout, link->next_event, now);
+			return;
+		}
+
+		/* Stay on the anchor points of the connection */
+		link->next_event += ((now - link->next_event) / iv + 1) * iv;
+	}
+
+	for (role = BT_HCI_ROLE_MASTER; role <= BT_HCI_ROLE_SLAVE; role++) {
+		for (i = 0; !budget || i < budget; i++) {
+			if (!vconn_pending(&link->conn[role])) {
+				break;
+			}
+
+			/* Wait for the host to release buffers */
+			if (vc.host_flow && !vc.host_credits) {
+				return;
+			}
+
+			acl_deliver(link, role);
+		}
+	}
+
+	if (budget && link_pending(link)) {
+		set_timeout(timeout, link->next_event, now);
+	}
+}
+
+static void num_completed_packets(void)
+{
+	struct bt_hci_evt_num_completed_packets *evt;
+	struct bt_hci_handle_count *hc;
+	struct net_buf *buf;
+	uint8_t num_handles = 0;
+	int i, role;
+
+	for (i = 0; i < VIRTUAL_LINKS; i++) {
+		for (role = 0; role < 2; role++) {
+			if (vc.link[i].conn[role].completed) {
+				num_handles++;
+			}
+		}
+	}
+
+	if (!num_handles) {
+		return;
+	}
+
+	buf = evt_create(BT_HCI_EVT_NUM_COMPLETED_PACKETS,
+			 sizeof(*evt) + num_handles * sizeof(*hc));
+	if (!buf) {
+		return;
+	}
+
+	evt = net_buf_add(buf, sizeof(*evt));
+	evt->num_handles = num_handles;
+
+	for (i = 0; i < VIRTUAL_LINKS; i++) {
+		for (role = 0; role < 2; role++) {
+			struct vconn *conn = &vc.link[i].conn[role];
+
+			if (!conn->completed) {
+				continue;
+			}
+
+			hc = net_buf_add(buf, sizeof(*hc));
+			hc->handle = sys_cpu_to_le16(LINK_HANDLE(i, role));
+			hc->count = sys_cpu_to_le16(conn->completed);
+			conn->completed = 0;
+		}
+	}
+
+	bt_recv(buf);
+}
+
+static void ctlr_fiber(void)
+{
+	int32_t timeout = TICKS_UNLIMITED;
+
+	while (1) {
+		struct net_buf *buf;
+		uint32_t now;
+		int i;
+
+		nano_fiber_sem_take(&vc.wake, timeout);
+
+		while ((buf = nano_fiber_fifo_get(&vc.cmd_queue, TICKS_NONE))) {
+			process_cmd(buf);
+			net_buf_unref(buf);
+		}
+
+		now = sys_tick_get_32();
+		timeout = TICKS_UNLIMITED;
+
+		adv_process(now, &timeout);
+
+		for (i = 0; i < VIRTUAL_LINKS; i++) {
+			link_process(&vc.link[i], now, &timeout);
+		}
+
+		num_completed_packets();
+	}
+}
+
+static int virtual_send(enum bt_buf_type buf_type, struct net_buf *buf)
+{
+	struct bt_hci_acl_hdr *hdr;
+	struct vlink *link;
+	uint16_t handle;
+
+	BT_DBG("buf %p type %u len %u", buf, buf_type, buf->len);
+
+	switch (buf_type) {
+	case BT_CMD:
+		nano_fifo_put(&vc.cmd_queue, buf);
+		break;
+	case BT_ACL_OUT:
+		hdr = (void *)buf->data;
+		handle = bt_acl_handle(sys_le16_to_cpu(hdr->handle));
+
+		link = link_lookup(handle);
+		if (!link) {
+			return -ENOTCONN;
+		}
+
+		nano_fifo_put(&link->conn[HANDLE_ROLE(handle)].tx_queue, buf);
+		break;
+	default:
+		BT_ERR("Unknown buffer type %u", buf_type);
+		return -EINVAL;
+	}
+
+	nano_sem_give(&vc.wake);
+
+	return 0;
+}
+
+static int virtual_open(void)
+{
+	int i;
+
+	BT_DBG("");
+
+	nano_fifo_init(&vc.cmd_queue);
+	nano_sem_init(&vc.wake);
+
+	for (i = 0; i < VIRTUAL_LINKS; i++) {
+		nano_fifo_init(&vc.link[i].conn[BT_HCI_ROLE_MASTER].tx_queue);
+		nano_fifo_init(&vc.link[i].conn[BT_HCI_ROLE_SLAVE].tx_queue);
+	}
+
+	reset();
+
+	fiber_start(ctlr_stack, sizeof(ctlr_stack),
+		    (nano_fiber_entry_t)ctlr_fiber, 0, 0, 7, 0);
+
+	return 0;
+}
+
+static struct bt_driver drv = {
+	.open		= virtual_open,
+	.send		= virtual_send,
+};
+
+static int _bt_virtual_init(struct device *unused)
+{
+	ARG_UNUSED(unused);
+
+	bt_driver_register(&drv);
+
+	return DEV_OK;
+}
+
+SYS_INIT(_bt_virtual_init, NANOKERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEVICE);
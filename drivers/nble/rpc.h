@@ -30,25 +30,30 @@ enum {
 };
 
 /**
- * RPC memory allocation function, must be implemented by the user of the RPC.
- *
- * This function is called by the RPC mechanism to allocate a buffer for
- * transmission of a serialized function.  The function should not fail.
- *
- * @param length Length of the buffer to allocate
- *
- * @return Pointer to the allocated buffer, the allocation shall not fail,
- * error must be handled internally
+ * Headroom of received buffers, placing the structure parameter of a call
+ * after the signature type, function index and structure length on a word
+ * boundary so that it can be handed to the handler in place.
  */
-struct net_buf *rpc_alloc_cb(uint16_t length);
+#define RPC_RX_RESERVE		1
+
+/** Part of a serialized function */
+struct rpc_iov {
+	const void *base;
+	uint16_t len;
+};
 
 /**
  * RPC transmission function, must be implemented by the user of the RPC.
  *
- * @param buf Pointer to the buffer allocated for transmission
- * by @ref rpc_alloc_cb
+ * The serialized function is made of the parts in @a iov, in order. They
+ * reference the parameters of the call where the caller keeps them and
+ * are only valid until this function returns.
+ *
+ * @param iov Parts of the serialized function
+ * @param iovcnt Number of parts
+ * @param len Total length of the serialized function
  */
-void rpc_transmit_cb(struct net_buf *buf);
+void rpc_transmit_cb(const struct rpc_iov *iov, uint8_t iovcnt, uint16_t len);
 
 /**
  * RPC serialization function to serialize a function that does not require any
@@ -156,7 +161,10 @@ void rpc_serialize_s_b_b_p(uint8_t fn_index, const void *struct_data,
  * RPC deserialization function, shall be invoked when a buffer is received
  * over the transport interface.
  *
- * @param p_buf Pointer to the received buffer
- * @param length Length of the received buffer
+ * Structures and buffers are passed to the called function as pointers into
+ * @a buf if they are word aligned, so they are only valid as long as the
+ * buffer is. Buffers should reserve @ref RPC_RX_RESERVE bytes of headroom.
+ *
+ * @param buf Received buffer
  */
 void rpc_deserialize(struct net_buf *buf);
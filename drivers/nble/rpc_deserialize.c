@@ -116,6 +116,33 @@ static uint8_t m_size_s_b_b_p[] = { LIST_FN_SIG_S_B_B_P };
 #undef FN_SIG_S_B_P
 #undef FN_SIG_S_B_B_P
 
+/* 1b - define the buffer alignment arrays, buffers are passed in place when
+ * suitably aligned for their type.
+ */
+#define FN_SIG_NONE(__fn)
+#define FN_SIG_S(__fn, __s)
+#define FN_SIG_P(__fn, __type)
+#define FN_SIG_S_B(__fn, __s, __type, __length)	__alignof__(*((__type)0)),
+#define FN_SIG_B_B_P(__fn, __type1, __length1, __type2, __length2,	\
+		     __type3)
+#define FN_SIG_S_P(__fn, __s, __type)
+#define FN_SIG_S_B_P(__fn, __s, __type, __length, __type_ptr)		\
+						__alignof__(*((__type)0)),
+#define FN_SIG_S_B_B_P(__fn, __s, __type1, __length1, __type2,		\
+		       __length2, __type3)
+
+static uint8_t m_align_s_b[] = { LIST_FN_SIG_S_B };
+static uint8_t m_align_s_b_p[] = { LIST_FN_SIG_S_B_P };
+
+#undef FN_SIG_NONE
+#undef FN_SIG_S
+#undef FN_SIG_P
+#undef FN_SIG_S_B
+#undef FN_SIG_B_B_P
+#undef FN_SIG_S_P
+#undef FN_SIG_S_B_P
+#undef FN_SIG_S_B_B_P
+
 /* 2- build the enumerations list */
 #define FN_SIG_NONE(__fn)				fn_index_##__fn,
 #define FN_SIG_S(__fn, __s)				FN_SIG_NONE(__fn)
@@ -224,6 +251,21 @@ static void panic(int err)
 	}
 }
 
+/* Parameters are handed over in place when aligned, which received buffers
+ * arrange for the structure, and copied to @a copy otherwise.
+ */
+static void *param_ptr(const uint8_t *data, uint16_t len, uint8_t align,
+		       uintptr_t *copy)
+{
+	if (!((uintptr_t)data & (align - 1))) {
+		return (void *)data;
+	}
+
+	memcpy(copy, data, len);
+
+	return copy;
+}
+
 static void deserialize_struct(struct net_buf *buf, const uint8_t **struct_ptr,
 			       uint8_t *struct_length)
 {
@@ -279,13 +321,15 @@ static void deserialize_s(uint8_t fn_index, struct net_buf *buf)
 	if (struct_length != m_size_s[fn_index]) {
 		panic(-1);
 	} else {
-		/* Always align structures on word boundary */
+		/* Copies of unaligned parameters */
 		uintptr_t struct_data[(struct_length +
 				(sizeof(uintptr_t) - 1))/(sizeof(uintptr_t))];
+		void *s;
 
-		memcpy(struct_data, struct_ptr, struct_length);
+		s = param_ptr(struct_ptr, struct_length,
+			      sizeof(uintptr_t), struct_data);
 
-		m_fct_s[fn_index](struct_data);
+		m_fct_s[fn_index](s);
 	}
 }
 
@@ -315,21 +359,23 @@ static void deserialize_s_b(uint8_t fn_index, struct net_buf *buf)
 	if (struct_length != m_size_s_b[fn_index]) {
 		panic(-1);
 	} else {
-		/* Always align structures on word boundary */
+		/* Copies of unaligned parameters */
 		uintptr_t struct_data[(struct_length +
 				(sizeof(uintptr_t) - 1))/(sizeof(uintptr_t))];
 		uintptr_t vbuf[(vbuf_length +
 				(sizeof(uintptr_t) - 1))/(sizeof(uintptr_t))];
 		void *buf = NULL;
+		void *s;
 
-		memcpy(struct_data, p_struct_data, struct_length);
+		s = param_ptr(p_struct_data, struct_length,
+			      sizeof(uintptr_t), struct_data);
 
 		if (vbuf_length) {
-			memcpy(vbuf, p_vbuf, vbuf_length);
-			buf = vbuf;
+			buf = param_ptr(p_vbuf, vbuf_length,
+					m_align_s_b[fn_index], vbuf);
 		}
 
-		m_fct_s_b[fn_index](struct_data, buf, vbuf_length);
+		m_fct_s_b[fn_index](s, buf, vbuf_length);
 	}
 }
 
@@ -346,7 +392,7 @@ static void deserialize_b_b_p(uint8_t fn_index, struct net_buf *buf)
 	deserialize_ptr(buf, &priv);
 
 	{
-		/* Always align structures on word boundary */
+		/* Copies of unaligned parameters */
 		uintptr_t vbuf1[(vbuf1_length +
 				(sizeof(uintptr_t) - 1))/(sizeof(uintptr_t))];
 		uintptr_t vbuf2[(vbuf2_length +
@@ -355,13 +401,13 @@ static void deserialize_b_b_p(uint8_t fn_index, struct net_buf *buf)
 		void *buf2 = NULL;
 
 		if (vbuf1_length) {
-			memcpy(vbuf1, p_vbuf1, vbuf1_length);
-			buf1 = vbuf1;
+			buf1 = param_ptr(p_vbuf1, vbuf1_length,
+					sizeof(uintptr_t), vbuf1);
 		}
 
 		if (vbuf2_length) {
-			memcpy(vbuf2, p_vbuf2, vbuf2_length);
-			buf2 = vbuf2;
+			buf2 = param_ptr(p_vbuf2, vbuf2_length,
+					sizeof(uintptr_t), vbuf2);
 		}
 
 		m_fct_b_b_p[fn_index](buf1, vbuf1_length, buf2, vbuf2_length,
@@ -381,13 +427,15 @@ static void deserialize_s_p(uint8_t fn_index, struct net_buf *buf)
 	if (struct_length != m_size_s_p[fn_index]) {
 		panic(-1);
 	} else {
-		/* Always align structures on word boundary */
+		/* Copies of unaligned parameters */
 		uintptr_t struct_data[(struct_length +
 				(sizeof(uintptr_t) - 1))/(sizeof(uintptr_t))];
+		void *s;
 
-		memcpy(struct_data, p_struct_data, struct_length);
+		s = param_ptr(p_struct_data, struct_length,
+			      sizeof(uintptr_t), struct_data);
 
-		m_fct_s_p[fn_index](struct_data, (void *)priv);
+		m_fct_s_p[fn_index](s, (void *)priv);
 	}
 }
 
@@ -406,21 +454,23 @@ static void deserialize_s_b_p(uint8_t fn_index, struct net_buf *buf)
 	if (struct_length != m_size_s_b_p[fn_index]) {
 		panic(-1);
 	} else {
-		/* Always align structures on word boundary */
+		/* Copies of unaligned parameters */
 		uintptr_t struct_data[(struct_length +
 				(sizeof(uintptr_t) - 1))/(sizeof(uintptr_t))];
 		uintptr_t vbuf[(vbuf_length +
 				(sizeof(uintptr_t) - 1))/(sizeof(uintptr_t))];
 		void *buf = NULL;
+		void *s;
 
-		memcpy(struct_data, p_struct_data, struct_length);
+		s = param_ptr(p_struct_data, struct_length,
+			      sizeof(uintptr_t), struct_data);
 
 		if (vbuf_length) {
-			memcpy(vbuf, p_vbuf, vbuf_length);
-			buf = vbuf;
+			buf = param_ptr(p_vbuf, vbuf_length,
+					m_align_s_b_p[fn_index], vbuf);
 		}
 
-		m_fct_s_b_p[fn_index](struct_data, buf, vbuf_length,
+		m_fct_s_b_p[fn_index](s, buf, vbuf_length,
 				      (void *)priv);
 	}
 }
@@ -443,7 +493,7 @@ static void deserialize_s_b_b_p(uint8_t fn_index, struct net_buf *buf)
 	if (struct_length != m_size_s_b_b_p[fn_index]) {
 		panic(-1);
 	} else {
-		/* Always align structures on word boundary */
+		/* Copies of unaligned parameters */
 		uintptr_t struct_data[(struct_length +
 				(sizeof(uintptr_t) - 1))/(sizeof(uintptr_t))];
 		uintptr_t vbuf1[(vbuf1_length +
@@ -452,20 +502,22 @@ static void deserialize_s_b_b_p(uint8_t fn_index, struct net_buf *buf)
 				(sizeof(uintptr_t) - 1))/(sizeof(uintptr_t))];
 		void *buf1 = NULL;
 		void *buf2 = NULL;
+		void *s;
 
-		memcpy(struct_data, p_struct_data, struct_length);
+		s = param_ptr(p_struct_data, struct_length,
+			      sizeof(uintptr_t), struct_data);
 
 		if (vbuf1_length) {
-			memcpy(vbuf1, p_vbuf1, vbuf1_length);
-			buf1 = vbuf1;
+			buf1 = param_ptr(p_vbuf1, vbuf1_length,
+					sizeof(uintptr_t), vbuf1);
 		}
 
 		if (vbuf2_length) {
-			memcpy(vbuf2, p_vbuf2, vbuf2_length);
-			buf2 = vbuf2;
+			buf2 = param_ptr(p_vbuf2, vbuf2_length,
+					sizeof(uintptr_t), vbuf2);
 		}
 
-		m_fct_s_b_b_p[fn_index](struct_data, buf1, vbuf1_length, buf2,
+		m_fct_s_b_b_p[fn_index](s, buf1, vbuf1_length, buf2,
 					vbuf2_length, (void *)priv);
 	}
 }
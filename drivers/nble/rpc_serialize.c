@@ -136,181 +136,201 @@ LIST_FN_SIG_S_B_B_P
 
 #define SIG_TYPE_SIZE		1
 #define FN_INDEX_SIZE		1
-#define POINTER_SIZE		4
 
-static void _send(struct net_buf *buf)
+/* Signature type and function index, structure length, two buffer
+ * lengths and a pointer.
+ */
+#define RPC_META_MAX		(SIG_TYPE_SIZE + FN_INDEX_SIZE + 1 + 2 * 2 + \
+				 sizeof(uintptr_t))
+/* Every parameter can be preceded by its metadata */
+#define RPC_IOV_MAX		7
+
+/*
+ * A call being serialized. The parameters are referenced where the caller
+ * keeps them, only the small metadata in between is encoded here. It is
+ * all handed to the transport in one go, before returning to the caller.
+ */
+struct rpc_sg {
+	struct rpc_iov		iov[RPC_IOV_MAX];
+	uint8_t			iovcnt;
+	uint16_t		len;
+
+	uint8_t			meta[RPC_META_MAX];
+	uint8_t			meta_len;
+};
+
+static void sg_copy(struct rpc_sg *sg, const void *data, uint8_t len)
 {
-	rpc_transmit_cb(buf);
+	uint8_t *meta = &sg->meta[sg->meta_len];
+
+	memcpy(meta, data, len);
+	sg->meta_len += len;
+	sg->len += len;
+
+	/* Extend the previous element if it ends right here */
+	if (sg->iovcnt) {
+		struct rpc_iov *last = &sg->iov[sg->iovcnt - 1];
+
+		if ((const uint8_t *)last->base + last->len == meta) {
+			last->len += len;
+			return;
+		}
+	}
+
+	sg->iov[sg->iovcnt].base = meta;
+	sg->iov[sg->iovcnt].len = len;
+	sg->iovcnt++;
 }
 
-static uint16_t encoded_structlen(uint8_t structlen)
+static void sg_ref(struct rpc_sg *sg, const void *data, uint16_t len)
 {
-	return 1 + structlen;
+	if (!len) {
+		return;
+	}
+
+	sg->iov[sg->iovcnt].base = data;
+	sg->iov[sg->iovcnt].len = len;
+	sg->iovcnt++;
+	sg->len += len;
 }
 
-static void serialize_struct(struct net_buf *buf, const uint8_t *struct_data,
-			     uint8_t struct_length)
+static void sg_init(struct rpc_sg *sg, uint8_t sig_type, uint8_t fn_index)
 {
-	net_buf_add_u8(buf, struct_length);
-	memcpy(net_buf_add(buf, struct_length), struct_data, struct_length);
+	sg->iovcnt = 0;
+	sg->len = 0;
+	sg->meta_len = 0;
+
+	sg_copy(sg, &sig_type, SIG_TYPE_SIZE);
+	sg_copy(sg, &fn_index, FN_INDEX_SIZE);
 }
 
-static uint16_t encoded_buflen(const uint8_t *buf, uint16_t buflen)
+static void _send(struct rpc_sg *sg)
 {
-	if (!buf) {
-		return 1;
-	}
+	rpc_transmit_cb(sg->iov, sg->iovcnt, sg->len);
+}
 
-	if (buflen < (1 << 7)) {
-		return 1 + buflen;
-	} else {
-		return 2 + buflen;
-	}
+static void serialize_struct(struct rpc_sg *sg, const uint8_t *struct_data,
+			     uint8_t struct_length)
+{
+	sg_copy(sg, &struct_length, sizeof(struct_length));
+	sg_ref(sg, struct_data, struct_length);
 }
 
-static void serialize_buf(struct net_buf *buf, const uint8_t *data,
+static void serialize_buf(struct rpc_sg *sg, const uint8_t *data,
 			  uint16_t len)
 {
-	uint16_t varint;
-	uint8_t *p;
+	uint8_t varint[2];
 
 	if (!data) {
 		len = 0;
 	}
 
-	varint = len;
-
-	p = net_buf_add_u8(buf, (varint & 0x7f));
-	if (varint >= (1 << 7)) {
-		*p |= 0x80;
-		net_buf_add_u8(buf, (varint >> 7));
+	varint[0] = len & 0x7f;
+	if (len < (1 << 7)) {
+		sg_copy(sg, varint, 1);
+	} else {
+		varint[0] |= 0x80;
+		varint[1] = len >> 7;
+		sg_copy(sg, varint, 2);
 	}
 
-	memcpy(net_buf_add(buf, len), data, len);
+	sg_ref(sg, data, len);
 }
 
-static void serialize_p(struct net_buf *buf, void *ptr)
+static void serialize_p(struct rpc_sg *sg, void *ptr)
 {
 	uintptr_t val = (uintptr_t)ptr;
 
-	memcpy(net_buf_add(buf, sizeof(val)), &val, sizeof(val));
+	sg_copy(sg, &val, sizeof(val));
 }
 
 void rpc_serialize_none(uint8_t fn_index)
 {
-	struct net_buf *buf;
+	struct rpc_sg sg;
 
-	buf = rpc_alloc_cb(SIG_TYPE_SIZE + FN_INDEX_SIZE);
+	sg_init(&sg, SIG_TYPE_NONE, fn_index);
 
-	net_buf_add_u8(buf, SIG_TYPE_NONE);
-	net_buf_add_u8(buf, fn_index);
-
-	_send(buf);
+	_send(&sg);
 }
 
 void rpc_serialize_s(uint8_t fn_index, const void *struct_data,
 		     uint8_t struct_length)
 {
-	struct net_buf *buf;
-
-	buf = rpc_alloc_cb(SIG_TYPE_SIZE + FN_INDEX_SIZE +
-			   encoded_structlen(struct_length));
+	struct rpc_sg sg;
 
-	net_buf_add_u8(buf, SIG_TYPE_S);
-	net_buf_add_u8(buf, fn_index);
+	sg_init(&sg, SIG_TYPE_S, fn_index);
 
-	serialize_struct(buf, struct_data, struct_length);
+	serialize_struct(&sg, struct_data, struct_length);
 
-	_send(buf);
+	_send(&sg);
 }
 
 void rpc_serialize_p(uint8_t fn_index, void *priv)
 {
-	struct net_buf *buf;
+	struct rpc_sg sg;
 
-	buf = rpc_alloc_cb(SIG_TYPE_SIZE + FN_INDEX_SIZE + POINTER_SIZE);
+	sg_init(&sg, SIG_TYPE_P, fn_index);
 
-	net_buf_add_u8(buf, SIG_TYPE_P);
-	net_buf_add_u8(buf, fn_index);
-	serialize_p(buf, priv);
+	serialize_p(&sg, priv);
 
-	_send(buf);
+	_send(&sg);
 }
 
 void rpc_serialize_s_b(uint8_t fn_index, const void *struct_data,
 		       uint8_t struct_length, const void *vbuf,
 		       uint16_t vbuf_length)
 {
-	struct net_buf *buf;
+	struct rpc_sg sg;
 
-	buf = rpc_alloc_cb(SIG_TYPE_SIZE + FN_INDEX_SIZE +
-			   encoded_structlen(struct_length) +
-			   encoded_buflen(vbuf, vbuf_length));
+	sg_init(&sg, SIG_TYPE_S_B, fn_index);
 
-	net_buf_add_u8(buf, SIG_TYPE_S_B);
-	net_buf_add_u8(buf, fn_index);
+	serialize_struct(&sg, struct_data, struct_length);
+	serialize_buf(&sg, vbuf, vbuf_length);
 
-	serialize_struct(buf, struct_data, struct_length);
-	serialize_buf(buf, vbuf, vbuf_length);
-
-	_send(buf);
+	_send(&sg);
 }
 
 void rpc_serialize_b_b_p(uint8_t fn_index, const void *vbuf1,
 			 uint16_t vbuf1_length, const void *vbuf2,
 			 uint16_t vbuf2_length, void *priv)
 {
-	struct net_buf *buf;
-
-	buf = rpc_alloc_cb(SIG_TYPE_SIZE + FN_INDEX_SIZE +
-			   encoded_buflen(vbuf1, vbuf1_length) +
-			   encoded_buflen(vbuf2, vbuf2_length) + POINTER_SIZE);
+	struct rpc_sg sg;
 
-	net_buf_add_u8(buf, SIG_TYPE_B_B_P);
-	net_buf_add_u8(buf, fn_index);
+	sg_init(&sg, SIG_TYPE_B_B_P, fn_index);
 
-	serialize_buf(buf, vbuf1, vbuf1_length);
-	serialize_buf(buf, vbuf2, vbuf2_length);
-	serialize_p(buf, priv);
+	serialize_buf(&sg, vbuf1, vbuf1_length);
+	serialize_buf(&sg, vbuf2, vbuf2_length);
+	serialize_p(&sg, priv);
 
-	_send(buf);
+	_send(&sg);
 }
 
 void rpc_serialize_s_p(uint8_t fn_index, const void *struct_data,
 		       uint8_t struct_length, void *priv)
 {
-	struct net_buf *buf;
+	struct rpc_sg sg;
 
-	buf = rpc_alloc_cb(SIG_TYPE_SIZE + FN_INDEX_SIZE +
-			   encoded_structlen(struct_length) + POINTER_SIZE);
+	sg_init(&sg, SIG_TYPE_S_P, fn_index);
 
-	net_buf_add_u8(buf, SIG_TYPE_S_P);
-	net_buf_add_u8(buf, fn_index);
+	serialize_struct(&sg, struct_data, struct_length);
+	serialize_p(&sg, priv);
 
-	serialize_struct(buf, struct_data, struct_length);
-	serialize_p(buf, priv);
-
-	_send(buf);
+	_send(&sg);
 }
 
 void rpc_serialize_s_b_p(uint8_t fn_index, const void *struct_data,
 			 uint8_t struct_length, const void *vbuf,
 			 uint16_t vbuf_length, void *priv)
 {
-	struct net_buf *buf;
-
-	buf = rpc_alloc_cb(SIG_TYPE_SIZE + FN_INDEX_SIZE +
-			   encoded_structlen(struct_length) +
-			   encoded_buflen(vbuf, vbuf_length) + POINTER_SIZE);
+	struct rpc_sg sg;
 
-	net_buf_add_u8(buf, SIG_TYPE_S_B_P);
-	net_buf_add_u8(buf, fn_index);
+	sg_init(&sg, SIG_TYPE_S_B_P, fn_index);
 
-	serialize_struct(buf, struct_data, struct_length);
-	serialize_buf(buf, vbuf, vbuf_length);
-	serialize_p(buf, priv);
+	serialize_struct(&sg, struct_data, struct_length);
+	serialize_buf(&sg, vbuf, vbuf_length);
+	serialize_p(&sg, priv);
 
-	_send(buf);
+	_send(&sg);
 }
 
 void rpc_serialize_s_b_b_p(uint8_t fn_index, const void *struct_data,
@@ -318,20 +338,14 @@ void rpc_serialize_s_b_b_p(uint8_t fn_index, const void *struct_data,
 			   uint16_t vbuf1_length, const void *vbuf2,
 			   uint16_t vbuf2_length, void *priv)
 {
-	struct net_buf *buf;
-
-	buf = rpc_alloc_cb(SIG_TYPE_SIZE + FN_INDEX_SIZE +
-			   encoded_structlen(struct_length) +
-			   encoded_buflen(vbuf1, vbuf1_length) +
-			   encoded_buflen(vbuf2, vbuf2_length) + POINTER_SIZE);
+	struct rpc_sg sg;
 
-	net_buf_add_u8(buf, SIG_TYPE_S_B_B_P);
-	net_buf_add_u8(buf, fn_index);
+	sg_init(&sg, SIG_TYPE_S_B_B_P, fn_index);
 
-	serialize_struct(buf, struct_data, struct_length);
-	serialize_buf(buf, vbuf1, vbuf1_length);
-	serialize_buf(buf, vbuf2, vbuf2_length);
-	serialize_p(buf, priv);
+	serialize_struct(&sg, struct_data, struct_length);
+	serialize_buf(&sg, vbuf1, vbuf1_length);
+	serialize_buf(&sg, vbuf2, vbuf2_length);
+	serialize_p(&sg, priv);
 
-	_send(buf);
+	_send(&sg);
 }
@@ -46,19 +46,18 @@ struct ipc_uart_header {
 } __packed;
 
 /* TODO: check size */
-#define NBLE_TX_BUF_COUNT	2
 #define NBLE_RX_BUF_COUNT	8
 #define NBLE_BUF_SIZE		384
 
 static struct nano_fifo rx;
-static NET_BUF_POOL(rx_pool, NBLE_RX_BUF_COUNT, NBLE_BUF_SIZE, &rx, NULL, 0);
-
-static struct nano_fifo tx;
-static NET_BUF_POOL(tx_pool, NBLE_TX_BUF_COUNT, NBLE_BUF_SIZE, &tx, NULL, 0);
+static NET_BUF_POOL(rx_pool, NBLE_RX_BUF_COUNT,
+		    RPC_RX_RESERVE + NBLE_BUF_SIZE, &rx, NULL, 0);
 
 static BT_STACK_NOINIT(rx_fiber_stack, CONFIG_BLUETOOTH_RX_STACK_SIZE);
 
+#if !defined(CONFIG_NBLE_RPC_LOOPBACK)
 static struct device *nble_dev;
+#endif
 
 static struct nano_fifo rx_queue;
 
@@ -78,43 +77,56 @@ static void rx_fiber(void)
 	}
 }
 
-struct net_buf *rpc_alloc_cb(uint16_t length)
+#if defined(CONFIG_NBLE_RPC_LOOPBACK)
+/* The serialized call is received as is, without going through the UART */
+void rpc_transmit_cb(const struct rpc_iov *iov, uint8_t iovcnt, uint16_t len)
 {
 	struct net_buf *buf;
 
-	BT_DBG("length %u", length);
+	BT_DBG("iovcnt %u length %u", iovcnt, len);
+
+	if (len > NBLE_BUF_SIZE) {
+		BT_ERR("Too much data to fit buffer");
+		return;
+	}
 
-	buf = net_buf_get(&tx, sizeof(struct ipc_uart_header));
+	buf = net_buf_get(&rx, RPC_RX_RESERVE);
 	if (!buf) {
-		BT_ERR("Unable to get tx buffer");
-		return NULL;
+		BT_ERR("No available IPC buffers");
+		return;
 	}
 
-	if (length > net_buf_tailroom(buf)) {
-		BT_ERR("Too big tx buffer requested");
-		net_buf_unref(buf);
-		return NULL;
+	for (; iovcnt; iov++, iovcnt--) {
+		memcpy(net_buf_add(buf, iov->len), iov->base, iov->len);
 	}
 
-	return buf;
+	nano_fifo_put(&rx_queue, buf);
 }
-
-void rpc_transmit_cb(struct net_buf *buf)
+#else
+void rpc_transmit_cb(const struct rpc_iov *iov, uint8_t iovcnt, uint16_t len)
 {
-	struct ipc_uart_header *hdr;
+	struct ipc_uart_header hdr;
+	const uint8_t *data;
+	uint16_t i;
 
-	BT_DBG("buf %p length %u", buf, buf->len);
+	BT_DBG("iovcnt %u length %u", iovcnt, len);
 
-	hdr = net_buf_push(buf, sizeof(*hdr));
-	hdr->len = buf->len - sizeof(*hdr);
-	hdr->channel = 0;
-	hdr->src_cpu_id = 0;
+	hdr.len = len;
+	hdr.channel = 0;
+	hdr.src_cpu_id = 0;
 
-	while (buf->len) {
-		uart_poll_out(nble_dev, net_buf_pull_u8(buf));
+	for (i = 0; i < sizeof(hdr); i++) {
+		uart_poll_out(nble_dev, ((uint8_t *)&hdr)[i]);
 	}
 
-	net_buf_unref(buf);
+	/* Straight from the parameters of the call */
+	for (; iovcnt; iov++, iovcnt--) {
+		data = iov->base;
+
+		for (i = 0; i < iov->len; i++) {
+			uart_poll_out(nble_dev, data[i]);
+		}
+	}
 }
 
 static size_t nble_discard(struct device *uart, size_t len)
@@ -165,7 +177,7 @@ static void bt_uart_isr(struct device *unused)
 				BT_ERR("Too much data to fit buffer");
 				buf = NULL;
 			} else {
-				buf = net_buf_get(&rx, 0);
+				buf = net_buf_get(&rx, RPC_RX_RESERVE);
 				if (!buf) {
 					BT_ERR("No available IPC buffers");
 				}
@@ -193,6 +205,7 @@ static void bt_uart_isr(struct device *unused)
 		}
 	}
 }
+#endif /* CONFIG_NBLE_RPC_LOOPBACK */
 
 int nble_open(void)
 {
@@ -203,6 +216,7 @@ int nble_open(void)
 	fiber_start(rx_fiber_stack, sizeof(rx_fiber_stack),
 		    (nano_fiber_entry_t)rx_fiber, 0, 0, 7, 0);
 
+#if !defined(CONFIG_NBLE_RPC_LOOPBACK)
 	uart_irq_rx_disable(nble_dev);
 	uart_irq_tx_disable(nble_dev);
 
@@ -216,6 +230,7 @@ int nble_open(void)
 	uart_irq_callback_set(nble_dev, bt_uart_isr);
 
 	uart_irq_rx_enable(nble_dev);
+#endif
 
 	return 0;
 }
@@ -224,13 +239,14 @@ static int _bt_nble_init(struct device *unused)
 {
 	ARG_UNUSED(unused);
 
+	net_buf_pool_init(rx_pool);
+
+#if !defined(CONFIG_NBLE_RPC_LOOPBACK)
 	nble_dev = device_get_binding(CONFIG_NBLE_UART_ON_DEV_NAME);
 	if (!nble_dev) {
 		return DEV_INVALID_CONF;
 	}
-
-	net_buf_pool_init(rx_pool);
-	net_buf_pool_init(tx_pool);
+#endif
 
 	return DEV_OK;
 }
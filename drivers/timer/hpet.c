@@ -49,6 +49,12 @@
  * it expires on the next tick, and announces the number of elapsed ticks (if
  * any) to the microkernel.
  *
+ * When configured to support a tickless kernel timer0 is not reprogrammed for
+ * every tick. The kernel programs it for its next deadline instead, and the
+ * interrupt handler announces all the complete ticks elapsed since the last
+ * announcement. The timer then waits, programmed as late as possible, until
+ * the kernel has processed those ticks and programs its next deadline.
+ *
  * In a nanokernel-only system this device driver omits more complex
  * capabilities (such as tickless idle support) that are only used with a
  * microkernel.
@@ -207,8 +213,10 @@ extern int32_t _sys_idle_elapsed_ticks;
 static uint32_t __noinit counter_load_value;
 /* counter value for most recent tick */
 static uint64_t counter_last_value;
+#ifndef CONFIG_TICKLESS_KERNEL
 /* # ticks timer is programmed for */
 static int32_t programmed_ticks = 1;
+#endif
 /* is stale interrupt possible? */
 static int stale_irq_check;
 
@@ -236,6 +244,28 @@ static uint64_t _hpetMainCounterAtomic(void)
 	return ((uint64_t)highBits << 32) | lowBits;
 }
 
+#ifdef CONFIG_TICKLESS_KERNEL
+
+/**
+ *
+ * @brief Program timer0 to expire at a given main counter value
+ *
+ * A value too close to the current counter value is pushed back so that
+ * the HPET cannot miss the interrupt.
+ *
+ * @return N/A
+ */
+static void _hpetComparatorSet(uint64_t value)
+{
+	uint64_t earliest = _hpetMainCounterAtomic() + HPET_COMP_DELAY;
+
+	*_HPET_TIMER0_CONFIG_CAPS |= HPET_Tn_VAL_SET_CNF;
+	*_HPET_TIMER0_COMPARATOR = max(value, earliest);
+	stale_irq_check = 1;
+}
+
+#endif /* CONFIG_TICKLESS_KERNEL */
+
 #endif /* TIMER_SUPPORTS_TICKLESS */
 
 /**
@@ -289,6 +319,31 @@ void _timer_int_handler(void *unused)
 		}
 	}
 
+#ifdef CONFIG_TICKLESS_KERNEL
+	int32_t elapsedTicks = _timer_ticks_elapsed();
+
+	if (elapsedTicks == 0) {
+		/* deadline was set within the current tick, wait for the next */
+		_hpetComparatorSet(counter_last_value + counter_load_value);
+		return;
+	}
+
+	counter_last_value += (uint64_t)elapsedTicks * counter_load_value;
+
+	/* the kernel sets its next deadline once it has processed the ticks */
+	_hpetComparatorSet(~(uint64_t)0);
+
+	_sys_idle_elapsed_ticks += elapsedTicks;
+
+	/*
+	 * If elapsed ticks were pending already the tick event has been
+	 * announced and not yet processed by the microkernel
+	 */
+
+	if (_sys_idle_elapsed_ticks == elapsedTicks) {
+		_sys_clock_tick_announce();
+	}
+#else
 	/* configure timer to expire on next tick */
 
 	counter_last_value = *_HPET_TIMER0_COMPARATOR;
@@ -314,6 +369,7 @@ void _timer_int_handler(void *unused)
 	if (_sys_idle_elapsed_ticks == 1) {
 		_sys_clock_tick_announce();
 	}
+#endif /* CONFIG_TICKLESS_KERNEL */
 
 #endif /* !TIMER_SUPPORTS_TICKLESS */
 
@@ -335,6 +391,60 @@ void _timer_int_handler(void *unused)
 #error Tickless idle threshold is too small (must be at least 2)
 #endif
 
+#ifdef CONFIG_TICKLESS_KERNEL
+
+/**
+ *
+ * @brief Program the timer for the next kernel deadline
+ *
+ * The deadline is <ticks> ticks after the last announced tick, or as late
+ * as possible for TICKS_UNLIMITED.
+ *
+ * @return N/A
+ *
+ * \INTERNAL IMPLEMENTATION DETAILS
+ * Called while interrupts are locked.
+ */
+
+void _timer_deadline_set(int32_t ticks)
+{
+	if (ticks == TICKS_UNLIMITED) {
+		_hpetComparatorSet(~(uint64_t)0);
+	} else {
+		_hpetComparatorSet(counter_last_value +
+				   (uint64_t)max(ticks, 1) * counter_load_value);
+	}
+}
+
+/**
+ *
+ * @brief Get the number of ticks elapsed since the last announced tick
+ *
+ * @return number of complete ticks
+ */
+
+int32_t _timer_ticks_elapsed(void)
+{
+	return (int32_t)((_hpetMainCounterAtomic() - counter_last_value) /
+			 counter_load_value);
+}
+
+/*
+ * The timer is always programmed for the next kernel deadline, so there is
+ * nothing to do when the CPU idles.
+ */
+
+void _timer_idle_enter(int32_t ticks)
+{
+	ARG_UNUSED(ticks);
+}
+
+void _timer_idle_exit(void)
+{
+}
+
+#else
+
 /**
  *
  * @brief Place system timer into idle state
@@ -467,6 +577,8 @@ void _timer_idle_exit(void)
 	programmed_ticks = 1;
 }
 
+#endif /* CONFIG_TICKLESS_KERNEL */
+
 #endif /* TIMER_SUPPORTS_TICKLESS */
 
 /**
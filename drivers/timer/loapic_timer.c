@@ -38,6 +38,14 @@
  * another interrupt is detected, the kernel's interrupt stub invokes
  * _timer_idle_exit() to leave the tickless idle state.
  *
+ * If the TICKLESS_KERNEL kernel configuration option is enabled, the timer
+ * always runs in one-shot mode and is programmed for the next kernel
+ * deadline. As the down counter is reloaded each time, the driver keeps the
+ * cycle count in software: 'accumulated_cycle_count' holds the count when the
+ * timer was last programmed and 'last_tick_cycles' the count at the last
+ * announced tick. The few cycles between the expiry of the counter and its
+ * reprogramming by the interrupt handler are not accounted for.
+ *
  * @internal
  * Factors that increase the driver's complexity:
  *
@@ -133,12 +141,16 @@ static uint32_t __noinit cycles_per_tick;
 static uint32_t accumulated_cycle_count;
 
 #if defined(TIMER_SUPPORTS_TICKLESS)
-static uint32_t programmed_cycles;
-static uint32_t programmed_full_ticks;
 static uint32_t __noinit max_system_ticks;
 static uint32_t __noinit cycles_per_max_ticks;
+#if defined(CONFIG_TICKLESS_KERNEL)
+static uint32_t last_tick_cycles;
+#else
+static uint32_t programmed_cycles;
+static uint32_t programmed_full_ticks;
 static bool timer_known_to_have_expired;
 static unsigned char timer_mode = TIMER_MODE_PERIODIC;
+#endif /* CONFIG_TICKLESS_KERNEL */
 #endif /* TIMER_SUPPORTS_TICKLESS */
 
 /* externs */
@@ -274,6 +286,50 @@ static inline uint32_t initial_count_register_get(void)
 }
 #endif /* TIMER_SUPPORTS_TICKLESS */
 
+#if defined(CONFIG_TICKLESS_KERNEL)
+/**
+ *
+ * @brief Get the current cycle count
+ *
+ * NOTE: Although the cycle count is supposed to stop decrementing once it
+ * hits zero in one-shot mode, not all targets implement this properly (and
+ * continue to decrement). Thus a count above the initial count also means
+ * that the timer has expired.
+ *
+ * @return cycle count
+ */
+static inline uint32_t cycle_count_get(void)
+{
+	uint32_t initial = initial_count_register_get();
+	uint32_t remaining = current_count_register_get();
+
+	if (remaining > initial) {
+		remaining = 0;
+	}
+
+	return accumulated_cycle_count + initial - remaining;
+}
+
+/**
+ *
+ * @brief Program the timer to expire a number of cycles after the last tick
+ *
+ * If that time has passed already the timer expires right away.
+ *
+ * @return N/A
+ */
+static void tick_deadline_program(uint32_t cycles)
+{
+	uint32_t now = cycle_count_get();
+	uint32_t elapsed = now - last_tick_cycles;
+
+	accumulated_cycle_count = now;
+
+	/* zero would stop the timer */
+	initial_count_register_set((cycles > elapsed) ? cycles - elapsed : 1);
+}
+#endif /* CONFIG_TICKLESS_KERNEL */
+
 /**
  *
  * @brief System clock tick handler
@@ -288,7 +344,31 @@ void _timer_int_handler(void *unused /* parameter is not used */
 {
 	ARG_UNUSED(unused);
 
-#ifdef TIMER_SUPPORTS_TICKLESS
+#if defined(CONFIG_TICKLESS_KERNEL)
+	uint32_t elapsed_ticks = _timer_ticks_elapsed();
+
+	if (elapsed_ticks == 0) {
+		/* deadline was set within the current tick, wait for the next */
+		tick_deadline_program(cycles_per_tick);
+		return;
+	}
+
+	last_tick_cycles += elapsed_ticks * cycles_per_tick;
+
+	/* the kernel sets its next deadline once it has processed the ticks */
+	tick_deadline_program(cycles_per_max_ticks);
+
+	_sys_idle_elapsed_ticks += elapsed_ticks;
+
+	/*
+	 * If elapsed ticks were pending already the tick event has been
+	 * announced and not yet processed by the microkernel
+	 */
+
+	if (_sys_idle_elapsed_ticks == elapsed_ticks) {
+		_sys_clock_tick_announce();
+	}
+#elif defined(TIMER_SUPPORTS_TICKLESS)
 	if (timer_mode == TIMER_MODE_ONE_SHOT) {
 		if (!timer_known_to_have_expired) {
 			uint32_t  cycles;
@@ -391,6 +471,53 @@ static void tickless_idle_init(void)
 	cycles_per_max_ticks = max_system_ticks * cycles_per_tick;
 }
 
+#if defined(CONFIG_TICKLESS_KERNEL)
+/**
+ *
+ * @brief Program the timer for the next kernel deadline
+ *
+ * The deadline is <ticks> ticks after the last announced tick, or as late
+ * as the 32-bit down counter allows for TICKS_UNLIMITED.
+ *
+ * Called while interrupts are locked.
+ *
+ * @return N/A
+ */
+void _timer_deadline_set(int32_t ticks)
+{
+	if ((ticks == TICKS_UNLIMITED) || (ticks > max_system_ticks)) {
+		tick_deadline_program(cycles_per_max_ticks);
+	} else {
+		tick_deadline_program(max(ticks, 1) * cycles_per_tick);
+	}
+}
+
+/**
+ *
+ * @brief Get the number of ticks elapsed since the last announced tick
+ *
+ * @return number of complete ticks
+ */
+int32_t _timer_ticks_elapsed(void)
+{
+	return (cycle_count_get() - last_tick_cycles) / cycles_per_tick;
+}
+
+/*
+ * The timer is always programmed for the next kernel deadline, so there is
+ * nothing to do when the CPU idles.
+ */
+
+void _timer_idle_enter(int32_t ticks)
+{
+	ARG_UNUSED(ticks);
+}
+
+void _timer_idle_exit(void)
+{
+}
+#else
+
 /**
  *
  * @brief Place system timer into idle state
@@ -541,6 +668,7 @@ void _timer_idle_exit(void)
 		initial_count_register_set(programmed_cycles);
 	}
 }
+#endif /* CONFIG_TICKLESS_KERNEL */
 #endif /* TIMER_SUPPORTS_TICKLESS */
 
 /**
@@ -564,8 +692,13 @@ int _sys_clock_driver_init(struct device *device)
 	tickless_idle_init();
 
 	divide_configuration_register_set();
+#if defined(CONFIG_TICKLESS_KERNEL)
+	one_shot_mode_set();
+	initial_count_register_set(cycles_per_tick);
+#else
 	initial_count_register_set(cycles_per_tick - 1);
 	periodic_mode_set();
+#endif
 
 	IRQ_CONNECT(CONFIG_LOAPIC_TIMER_IRQ, CONFIG_LOAPIC_TIMER_IRQ_PRIORITY,
 		    _timer_int_handler, 0, 0);
@@ -598,7 +731,9 @@ uint32_t sys_cycle_get_32(void)
 	 * in the Initial Count Register (ICR).
 	 */
 
-#if !defined(TIMER_SUPPORTS_TICKLESS)
+#if defined(CONFIG_TICKLESS_KERNEL)
+	val = cycle_count_get();
+#elif !defined(TIMER_SUPPORTS_TICKLESS)
 	/* The value in the ICR always matches cycles_per_tick. */
 	val = accumulated_cycle_count - current_count_register_get() +
 			cycles_per_tick;
@@ -218,6 +218,43 @@ typedef struct s_isrList {
 #define _VECTOR_ARG(irq_p)			(-1)
 #endif /* CONFIG_MVIC */
 
+/**
+ * Declaration of an interrupt in the intList section, for the stub at
+ * local label 1
+ *
+ * This does the same thing as the NANO_CPU_INT_REGISTER() macro, but is done
+ * in assembly as the .fnc member is the address of an assembly IRQ stub.
+ *
+ * This is only intended to be used by the IRQ_CONNECT() family of macros.
+ */
+#define _INT_LIST_ENTRY_ASM \
+	".pushsection .intList\n\t" \
+	".long 1f\n\t"			/* ISR_LIST.fnc */ \
+	".long %P[irq]\n\t"		/* ISR_LIST.irq */ \
+	".long %P[priority]\n\t"	/* ISR_LIST.priority */ \
+	".long %P[vector]\n\t"		/* ISR_LIST.vec */ \
+	".long 0\n\t"			/* ISR_LIST.dpl */ \
+	".popsection\n\t"
+
+/**
+ * Inline assembly code for the direct interrupt stub
+ *
+ * Only the volatile registers are saved before calling the ISR, on the
+ * interrupted context's stack; the stub then jumps to @a exit with the
+ * return value of the ISR in EAX. This is the same for IAMCU and SYSV, since
+ * the ISR takes no parameter.
+ *
+ * This is only intended to be used by the IRQ_CONNECT_DIRECT() and
+ * NANO_CPU_INT_CONNECT_DIRECT() macros.
+ */
+#define _DIRECT_STUB_ASM(exit) \
+	"pushl %%eax\n\t" \
+	"pushl %%ecx\n\t" \
+	"pushl %%edx\n\t" \
+	"cld\n\t" \
+	"call %P[isr]\n\t" \
+	"jmp " exit "\n\t"
+
 /**
  * Configure a static interrupt.
  *
@@ -254,13 +291,7 @@ typedef struct s_isrList {
 ({ \
 	__asm__ __volatile__(							\
 		"jmp 2f\n\t" \
-		".pushsection .intList\n\t" \
-		".long 1f\n\t"			/* ISR_LIST.fnc */ \
-		".long %P[irq]\n\t"		/* ISR_LIST.irq */ \
-		".long %P[priority]\n\t"	/* ISR_LIST.priority */ \
-		".long %P[vector]\n\t"		/* ISR_LIST.vec */ \
-		".long 0\n\t"			/* ISR_LIST.dpl */ \
-		".popsection\n\t" \
+		_INT_LIST_ENTRY_ASM \
 		"1:\n\t" \
 		_IRQ_STUB_ASM \
 		"2:\n\t" \
@@ -274,6 +305,76 @@ typedef struct s_isrList {
 	_IRQ_TO_INTERRUPT_VECTOR(irq_p); \
 })
 
+/**
+ * Configure a static direct interrupt.
+ *
+ * A direct ISR skips the kernel interrupt entry and exit: its stub only saves
+ * the volatile registers, calls the ISR and sends the EOI. This is meant for
+ * latency-critical handlers, with the following restrictions:
+ *
+ * - the ISR runs with interrupts locked, on the stack of the interrupted
+ *   context, and must keep its stack usage small;
+ * - the kernel does not know it runs in interrupt context, so that
+ *   sys_execution_context_type_get() cannot be relied upon and only the
+ *   nano_isr_xxx() flavours of the kernel APIs may be used;
+ * - kernel event logging, CPU time accounting and interrupt latency
+ *   benchmarking do not see the interrupt.
+ *
+ * The ISR takes no parameter and returns an int: zero returns straight to the
+ * interrupted context, non-zero has the kernel check whether a context switch
+ * is needed, for ISRs that made a fiber ready.
+ *
+ * All arguments must be computable by the compiler at build time.
+ *
+ * @param irq_p IRQ line number
+ * @param priority_p Interrupt priority
+ * @param isr_p Interrupt service routine, int isr(void)
+ * @param flags_p IRQ triggering options
+ *
+ * @return The vector assigned to this interrupt
+ */
+#define IRQ_CONNECT_DIRECT(irq_p, priority_p, isr_p, flags_p) \
+({ \
+	__asm__ __volatile__(							\
+		"jmp 2f\n\t" \
+		_INT_LIST_ENTRY_ASM \
+		"1:\n\t" \
+		_DIRECT_STUB_ASM("_IntExitDirectWithEoi") \
+		"2:\n\t" \
+		: \
+		: [isr] "i" (isr_p), \
+		  [priority] "i" _PRIORITY_ARG(irq_p, priority_p), \
+		  [vector] "i" _VECTOR_ARG(irq_p), \
+		  [irq] "i" (irq_p)); \
+	_SysIntVecProgram(_IRQ_TO_INTERRUPT_VECTOR(irq_p), (irq_p), (flags_p)); \
+	_IRQ_TO_INTERRUPT_VECTOR(irq_p); \
+})
+
+/**
+ * Connect a direct ISR to a software interrupt vector.
+ *
+ * This is the counterpart of IRQ_CONNECT_DIRECT() for interrupts that do not
+ * correspond to any IRQ line, raised with the 'int' instruction: no EOI is
+ * sent. The same restrictions apply to the ISR.
+ *
+ * @param vector_p Interrupt vector
+ * @param isr_p Interrupt service routine, int isr(void)
+ *
+ * @return N/A
+ */
+#define NANO_CPU_INT_CONNECT_DIRECT(vector_p, isr_p) \
+	__asm__ __volatile__(							\
+		"jmp 2f\n\t" \
+		_INT_LIST_ENTRY_ASM \
+		"1:\n\t" \
+		_DIRECT_STUB_ASM("_IntExitDirect") \
+		"2:\n\t" \
+		: \
+		: [isr] "i" (isr_p), \
+		  [priority] "i" ((vector_p) / 16), \
+		  [vector] "i" (vector_p), \
+		  [irq] "i" (NANO_SOFT_IRQ))
+
 #ifdef CONFIG_MVIC
 /* Fixed vector-to-irq association mapping.
  * No need for the table at all.
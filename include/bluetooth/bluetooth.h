@@ -247,6 +247,58 @@ int bt_le_scan_start(const struct bt_le_scan_param *param, bt_le_scan_cb_t cb);
  */
 int bt_le_scan_stop(void);
 
+#if defined(CONFIG_BLUETOOTH_SCAN_FILTER)
+/** Value of bt_le_scan_filter.rssi_min to accept any signal strength */
+#define BT_LE_SCAN_RSSI_ANY -128
+
+/** LE scan report filter
+ *
+ *  Advertising reports are only given to the scan callback if they pass
+ *  all the conditions of the filter. The conditions are evaluated by the
+ *  host in the order of the fields below.
+ */
+struct bt_le_scan_filter {
+	/** Minimum RSSI in dBm or BT_LE_SCAN_RSSI_ANY */
+	int8_t rssi_min;
+
+	/** Number of elements in addrs, 0 to accept any advertiser */
+	uint8_t addr_count;
+
+	/** Accepted advertisers, identity addresses for bonded devices */
+	const bt_addr_le_t *addrs;
+
+	/** Number of elements in ad_types, 0 to accept any data */
+	uint8_t ad_type_count;
+
+	/** Accepted AD types, the report must contain at least one */
+	const uint8_t *ad_types;
+
+	/** Time in milliseconds during which a report repeating the
+	 *  address, type and data of a previous one is dropped, 0 to
+	 *  disable duplicate suppression.
+	 */
+	uint16_t dup_window;
+
+	/** Change of RSSI in dBm for which a duplicate is reported again
+	 *  within dup_window, 0 to never report duplicates.
+	 */
+	uint8_t rssi_delta;
+};
+
+/** @brief Set the LE scan report filter.
+ *
+ *  Set the filter applied to advertising reports before they are passed
+ *  to the callback given to bt_le_scan_start(). The filter is referenced,
+ *  not copied, so it must remain valid until it is replaced. Setting a
+ *  filter forgets the reports seen so far.
+ *
+ *  @param filter Filter to apply or NULL to report everything.
+ *
+ *  @return Zero on success or (negative) error code otherwise.
+ */
+int bt_le_scan_filter_set(const struct bt_le_scan_filter *filter);
+#endif /* CONFIG_BLUETOOTH_SCAN_FILTER */
+
 /** @def BT_ADDR_STR_LEN
  *
  *  @brief Recommended length of user string buffer for Bluetooth address
@@ -741,11 +741,49 @@ typedef void (*bt_gatt_notify_sent_func_t)(struct bt_conn *conn, struct bt_gatt_
  *  @param attr Attribute object.
  *  @param value Attribute value.
  *  @param len Attribute value length.
- *  @param cb callback function called when send is complete (or NULL)
+ *  @param cb callback function called when send is complete (or NULL),
+ *  only available with CONFIG_NBLE_CURIE.
  */
+#if defined(CONFIG_NBLE_CURIE)
 int bt_gatt_notify(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 		   const void *data, uint16_t len,
 		   bt_gatt_notify_sent_func_t cb);
+#else
+int bt_gatt_notify(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+		   const void *data, uint16_t len);
+#endif
+
+#if defined(CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH)
+/** @brief Queue notification of attribute value change.
+ *
+ *  Copy the value into the current batch of notifications, which is sent
+ *  to all peers that have notification enabled via CCC once it is full,
+ *  after CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH_TIMEOUT or when
+ *  bt_gatt_notify_flush() is called. If the attribute already has a
+ *  pending update only the new value is notified.
+ *
+ *  @param attr Attribute object.
+ *  @param data Attribute value.
+ *  @param len Attribute value length.
+ *
+ *  A full batch is handed over to the notification fiber and the update
+ *  goes into the other batch, unless that one is still being sent.
+ *
+ *  @return 0 in case of success, -ENOMEM if the batch is full and the
+ *  previous one is still being sent, in which case the caller may retry
+ *  once the notification fiber has run, or another negative value in case
+ *  of error.
+ */
+int bt_gatt_notify_queue(const struct bt_gatt_attr *attr, const void *data,
+			 uint16_t len);
+
+/** @brief Send the queued notifications.
+ *
+ *  Send the current batch of notifications without waiting for the batch
+ *  timeout.
+ */
+void bt_gatt_notify_flush(void);
+#endif /* CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH */
 
 /** @brief Indication complete result callback.
  *
@@ -948,8 +986,13 @@ typedef void (*bt_gatt_write_rsp_func_t)(struct bt_conn *conn, uint8_t err, cons
  *
  * @return 0 in case of success or negative value in case of error.
  */
+#if defined(CONFIG_NBLE_CURIE)
 int bt_gatt_write(struct bt_conn *conn, uint16_t handle, uint16_t offset,
 		  const void *data, uint16_t length, bt_gatt_write_rsp_func_t func);
+#else
+int bt_gatt_write(struct bt_conn *conn, uint16_t handle, uint16_t offset,
+		  const void *data, uint16_t length, bt_gatt_rsp_func_t func);
+#endif
 
 /** @brief Write Attribute Value by handle without response
  *
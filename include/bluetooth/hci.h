@@ -62,10 +62,14 @@ static inline void bt_addr_le_copy(bt_addr_le_t *dst, const bt_addr_le_t *src)
 }
 
 /* HCI Error Codes */
+#define BT_HCI_ERR_UNKNOWN_CMD			0x01
 #define BT_HCI_ERR_UNKNOWN_CONN_ID		0x02
 #define BT_HCI_ERR_AUTHENTICATION_FAIL		0x05
+#define BT_HCI_ERR_CONN_LIMIT_EXCEEDED		0x09
+#define BT_HCI_ERR_CMD_DISALLOWED		0x0c
 #define BT_HCI_ERR_INSUFFICIENT_RESOURCES	0x0d
 #define BT_HCI_ERR_REMOTE_USER_TERM_CONN	0x13
+#define BT_HCI_ERR_LOCALHOST_TERM_CONN		0x16
 #define BT_HCI_ERR_PAIRING_NOT_ALLOWED		0x18
 #define BT_HCI_ERR_UNSUPP_REMOTE_FEATURE	0x1a
 #define BT_HCI_ERR_INVALID_LL_PARAMS		0x1e
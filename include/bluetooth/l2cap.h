@@ -39,6 +39,7 @@ extern "C" {
 #endif
 
 #if defined(CONFIG_BLUETOOTH_CENTRAL) || defined(CONFIG_BLUETOOTH_PERIPHERAL)
+#include <atomic.h>
 #include <net/buf.h>
 #include <bluetooth/conn.h>
 
@@ -72,6 +73,13 @@ struct bt_l2cap_chan {
 
 	uint8_t			_ident;
 
+#if defined(CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL)
+	/* SDUs waiting to be sent and the one being segmented */
+	struct nano_fifo	_tx_queue;
+	struct net_buf		*_tx_buf;
+	atomic_t		_tx_flags;
+#endif /* CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL */
+
 	struct bt_l2cap_chan	*_next;
 };
 
@@ -178,11 +186,14 @@ int bt_l2cap_chan_disconnect(struct bt_l2cap_chan *chan);
 
 /** @brief Send data to L2CAP channel
  *
- *  Send data from buffer to the channel. This procedure may block waiting for
- *  credits to send data therefore it shall be used from a fiber to be able to
- *  receive credits when necessary.
+ *  Queue the buffer as an SDU on the channel. The SDU is segmented and sent
+ *  as the peer gives credits, without blocking the caller, and the buffer is
+ *  released once it is sent. The buffer should be allocated with
+ *  BT_L2CAP_CHAN_SEND_RESERVE headroom, so that the segments can refer to
+ *  its data instead of copying it.
  *
- *  @return Bytes sent in case of success or negative value in case of error.
+ *  @return Bytes queued in case of success or negative value in case of
+ *  error.
  */
 int bt_l2cap_chan_send(struct bt_l2cap_chan *chan, struct net_buf *buf);
 
@@ -18,6 +18,8 @@
 #ifndef _DEVICE_H_
 #define _DEVICE_H_
 
+#include <nanokernel.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -88,6 +90,88 @@ extern "C" {
 		 .driver_data = data \
 	}
 
+/**
+ * @def DEVICE_INIT_DEFERRED
+ *
+ * @brief create device object with a deferred initialization part
+ *
+ * @details This macro defines a device object like DEVICE_INIT() does, for
+ * a driver whose initialization is split in two parts. @a init_fn is run at
+ * the device's level and priority like for any other device. It should only
+ * do what is needed to make the device object usable, e.g. setting up
+ * driver_api. @a deferred_init_fn is then run from the kernel's device
+ * initialization fiber once the whole level has been initialized, so that
+ * slow operations such as waiting for a hardware reset do not hold the boot
+ * sequence. It is only called if @a init_fn succeeded.
+ *
+ * The deferred parts of all devices are run one after the other, in the
+ * order the devices are initialized; they can use the nanokernel services
+ * and run concurrently with the initialization of the subsequent levels
+ * whenever they wait. The deferred parts of the PRIMARY and SECONDARY
+ * devices are run once the NANOKERNEL level has completed.
+ * Code depending on the device being fully initialized must call
+ * device_wait_ready() first.
+ *
+ * If CONFIG_DEVICE_DEFERRED_INIT is disabled, @a deferred_init_fn is run
+ * right after @a init_fn instead.
+ *
+ * @param dev_name Device name.
+ *
+ * @param drv_name The name this instance of the driver exposes to
+ * the system.
+ *
+ * @param init_fn Address to the init function of the driver.
+ *
+ * @param deferred_init_fn Address to the deferred init function of the
+ * driver.
+ *
+ * @param data Pointer to the device's configuration data.
+ *
+ * @param cfg_info The address to the structure containing the
+ * configuration information for this instance of the driver.
+ *
+ * @param level The initialization level at which configuration occurs.
+ * See DEVICE_INIT().
+ *
+ * @param prio The initialization priority of the device, relative to
+ * other devices of the same initialization level. See DEVICE_INIT().
+ */
+
+#ifdef CONFIG_DEVICE_DEFERRED_INIT
+#define DEVICE_INIT_DEFERRED(dev_name, drv_name, init_fn, deferred_init_fn, \
+			     data, cfg_info, level, prio) \
+	\
+	static struct device_config __config_##dev_name __used \
+	__attribute__((__section__(".devconfig.init"))) = { \
+		.name = drv_name, .init = (init_fn), \
+		.config_info = (cfg_info) \
+	}; \
+	\
+	static struct device_deferred_init __deferred_##dev_name = { \
+		.init = (deferred_init_fn) \
+	}; \
+	\
+	struct device (__device_##dev_name) __used \
+	__attribute__((__section__(".init_" #level STRINGIFY(prio)))) = { \
+		 .config = &(__config_##dev_name), \
+		 .driver_data = data, \
+		 .deferred = &(__deferred_##dev_name) \
+	}
+#else
+#define DEVICE_INIT_DEFERRED(dev_name, drv_name, init_fn, deferred_init_fn, \
+			     data, cfg_info, level, prio) \
+	\
+	static int __init_##dev_name(struct device *device) \
+	{ \
+		int ret = (init_fn)(device); \
+		\
+		return (ret == DEV_OK) ? (deferred_init_fn)(device) : ret; \
+	} \
+	\
+	DEVICE_INIT(dev_name, drv_name, __init_##dev_name, data, cfg_info, \
+		    level, prio)
+#endif /* CONFIG_DEVICE_DEFERRED_INIT */
+
 /**
  * @def DEVICE_NAME_GET
  *
@@ -119,6 +203,27 @@ extern "C" {
  */
 #define DEVICE_GET(name) (&DEVICE_NAME_GET(name))
 
+/**
+ * @def DEVICE_BINDING
+ *
+ * @brief Bind to a device object at build time
+ *
+ * @details Return the address of a device object created by DEVICE_INIT()
+ * or DEVICE_INIT_DEFERRED(), using the @dev_name provided to it. Unlike
+ * device_get_binding(), this is resolved by the linker and has no runtime
+ * cost; it does not need the device object to be declared beforehand, and
+ * fails to link if the device does not exist in the image.
+ *
+ * @param name The same as dev_name provided to DEVICE_INIT()
+ *
+ * @return A pointer to the device object created by DEVICE_INIT()
+ */
+#define DEVICE_BINDING(name) \
+	({ \
+		extern struct device DEVICE_NAME_GET(name); \
+		DEVICE_GET(name); \
+	})
+
 /* Common Error Codes devices can provide */
 #define DEV_OK			0  /* No error */
 #define DEV_FAIL		1 /* General operation failure */
@@ -154,17 +259,88 @@ struct device {
 	struct device_config *config;
 	void *driver_api;
 	void *driver_data;
+#ifdef CONFIG_DEVICE_DEFERRED_INIT
+	struct device_deferred_init *deferred;
+#endif
+#ifdef CONFIG_BOOT_TIME_MEASUREMENT
+	uint32_t init_cycles;
+#endif
 };
 
+#ifdef CONFIG_DEVICE_DEFERRED_INIT
+/**
+ * @brief Deferred initialization state of a device (In memory)
+ * @param _reserved used by the kernel to queue the device for initialization
+ * @param device device being initialized, filled in by the kernel
+ * @param init deferred part of the init function of the driver
+ * @param ready_sem semaphore the waiters for the device to be ready pend on
+ * @param done non-zero once the deferred init function has returned
+ * @param status value returned by the deferred init function
+ * @param cycles CPU cycles spent in the deferred init function
+ */
+struct device_deferred_init {
+	void *_reserved;
+	struct device *device;
+	int (*init)(struct device *device);
+	struct nano_sem ready_sem;
+	volatile int done;
+	int status;
+#ifdef CONFIG_BOOT_TIME_MEASUREMENT
+	uint32_t cycles;
+#endif
+};
+#endif
+
 void _sys_device_do_config_level(int level);
 struct device* device_get_binding(char *name);
 
+/**
+ * @brief Get the list of all the device objects
+ *
+ * @details Return the address and the number of the device objects created
+ * by DEVICE_INIT() and SYS_INIT(), in the order they are initialized.
+ *
+ * @param device_list where the address of the first device object is stored
+ * @param device_count where the number of device objects is stored
+ */
+void device_list_get(struct device **device_list, int *device_count);
+
+/**
+ * @brief Wait for a device to be fully initialized
+ *
+ * @details Devices created by DEVICE_INIT_DEFERRED() complete their
+ * initialization in the kernel's device initialization fiber; this routine
+ * waits for it to be done. It returns right away for the other devices.
+ * It can be called from a fiber or a task, or from an ISR with a timeout of
+ * TICKS_NONE.
+ *
+ * @param device device to wait for
+ * @param timeout_in_ticks Affects the action taken should the device not be
+ * ready yet. If TICKS_NONE, then return immediately. If TICKS_UNLIMITED, then
+ * wait as long as necessary. Otherwise wait up to the specified number of
+ * ticks before timing out.
+ *
+ * @return DEV_OK or the error returned by the deferred init function if the
+ * device is initialized, DEV_NOT_CONFIG if it is not ready yet.
+ */
+#ifdef CONFIG_DEVICE_DEFERRED_INIT
+int device_wait_ready(struct device *device, int32_t timeout_in_ticks);
+#else
+static inline int device_wait_ready(struct device *device,
+				    int32_t timeout_in_ticks)
+{
+	ARG_UNUSED(device);
+	ARG_UNUSED(timeout_in_ticks);
+
+	return DEV_OK;
+}
+#endif
+
 /**
  * Synchronous calls API
  */
 
 #include <stdbool.h>
-#include <nanokernel.h>
 #ifdef CONFIG_MICROKERNEL
 #include <microkernel.h>
 #endif
@@ -55,6 +55,21 @@ extern void _timer_idle_enter(int32_t ticks);
 extern void _timer_idle_exit(void);
 #endif /* TIMER_SUPPORTS_TICKLESS */
 
+#ifdef CONFIG_TICKLESS_KERNEL
+/*
+ * Program the timer to expire <ticks> ticks after the last tick it announced
+ * (TICKS_UNLIMITED: as late as possible), or as soon as possible if that
+ * deadline has passed. Called with interrupts locked.
+ */
+extern void _timer_deadline_set(int32_t ticks);
+/* complete ticks elapsed since the last tick the timer announced */
+extern int32_t _timer_ticks_elapsed(void);
+
+extern int32_t _sys_clock_ticks_pending(void);
+extern void _sys_clock_deadline_set(int32_t ticks);
+extern void _sys_clock_deadline_update(int32_t ticks);
+#endif /* CONFIG_TICKLESS_KERNEL */
+
 extern uint32_t _nano_get_earliest_deadline(void);
 
 extern void _nano_sys_clock_tick_announce(int32_t ticks);
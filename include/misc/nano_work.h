@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * @brief Nanokernel workqueues
+ *
+ * A workqueue is a fiber processing work items in the order they are
+ * submitted. Work items can be submitted from any context, including ISRs,
+ * either right away or after a delay. Several subsystems sharing one
+ * workqueue only need a single fiber stack for their deferred processing.
+ */
+
+#ifndef _misc_nano_work__h_
+#define _misc_nano_work__h_
+
+#include <nanokernel.h>
+#include <atomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct nano_work;
+
+typedef void (*work_handler_t)(struct nano_work *);
+
+/**
+ * A workqueue is a fiber that executes @ref nano_work items that are
+ * queued to it. This is useful for drivers which need to schedule
+ * execution of code which might sleep from ISR context. The actual
+ * fiber identifier is not stored in the structure in order to save
+ * space.
+ */
+struct nano_workqueue {
+	struct nano_fifo fifo;
+};
+
+/**
+ * @brief Work item states
+ */
+enum {
+	NANO_WORK_STATE_PENDING,	/* Work item pending state */
+};
+
+/**
+ * @brief An item which can be scheduled on a @ref nano_workqueue.
+ */
+struct nano_work {
+	void *_reserved;		/* Used by nano_fifo implementation. */
+	work_handler_t handler;
+	atomic_t flags[1];
+};
+
+/**
+ * @brief Initialize work item
+ *
+ * @param work Work item
+ * @param handler Function called when the work item is processed
+ */
+static inline void nano_work_init(struct nano_work *work,
+				  work_handler_t handler)
+{
+	atomic_clear_bit(work->flags, NANO_WORK_STATE_PENDING);
+	work->handler = handler;
+}
+
+/**
+ * @brief Submit a work item to a workqueue.
+ *
+ * This routine can be called from any context. Submitting a work item that
+ * is already pending has no effect.
+ *
+ * @param wq Workqueue
+ * @param work Work item
+ */
+static inline void nano_work_submit_to_queue(struct nano_workqueue *wq,
+					     struct nano_work *work)
+{
+	if (!atomic_test_and_set_bit(work->flags, NANO_WORK_STATE_PENDING)) {
+		nano_fifo_put(&wq->fifo, work);
+	}
+}
+
+/**
+ * @brief Check if work item is pending.
+ *
+ * @param work Work item
+ *
+ * @return 1 if the work item is waiting to be processed, 0 otherwise
+ */
+static inline int nano_work_pending(struct nano_work *work)
+{
+	return atomic_test_bit(work->flags, NANO_WORK_STATE_PENDING);
+}
+
+/**
+ * @brief Start a new workqueue.
+ *
+ * This routine can be called from either fiber or task context.
+ *
+ * @param wq Workqueue
+ * @param stack Stack of the workqueue fiber
+ * @param stack_size Size of the stack in bytes
+ * @param prio Priority of the workqueue fiber
+ */
+extern void fiber_workqueue_start(struct nano_workqueue *wq, char *stack,
+				  unsigned stack_size, unsigned prio);
+
+/**
+ * @brief An item which can be scheduled on a @ref nano_workqueue after a
+ * delay.
+ */
+struct nano_delayed_work {
+	struct nano_work work;
+	struct _nano_timeout timeout;
+	struct nano_workqueue *wq;
+};
+
+/**
+ * @brief Initialize delayed work item
+ *
+ * @param work Delayed work item
+ * @param handler Function called when the work item is processed, it gets
+ * a pointer to the embedded @ref nano_work
+ */
+extern void nano_delayed_work_init(struct nano_delayed_work *work,
+				   work_handler_t handler);
+
+/**
+ * @brief Submit a delayed work item to a workqueue.
+ *
+ * This routine can be called from any context. The work item is submitted
+ * to the workqueue once the delay has elapsed, or right away if it is 0.
+ * If the work item is already scheduled on the same workqueue, it is
+ * cancelled and scheduled again with the new delay.
+ *
+ * @param wq Workqueue
+ * @param work Delayed work item
+ * @param ticks Ticks to wait before submitting the work item
+ *
+ * @return 0 on success, -EADDRINUSE if the work item is scheduled on another
+ * workqueue, -EINPROGRESS if the delay has elapsed and the workqueue fiber is
+ * about to process the work item, in which case it is not scheduled again
+ */
+extern int nano_delayed_work_submit_to_queue(struct nano_workqueue *wq,
+					     struct nano_delayed_work *work,
+					     int ticks);
+
+/**
+ * @brief Cancel a delayed work item
+ *
+ * This routine can be called from any context. A work item whose delay has
+ * elapsed is cancelled as well if it is still in the workqueue, so that its
+ * handler is not called after this routine returns 0.
+ *
+ * @param work Delayed work item
+ *
+ * @return 0 on success, -EINVAL if the work item is not scheduled,
+ * -EINPROGRESS if the workqueue fiber has taken the work item already: its
+ * handler is running or about to run, and cannot be cancelled
+ */
+extern int nano_delayed_work_cancel(struct nano_delayed_work *work);
+
+#if defined(CONFIG_SYSTEM_WORKQUEUE)
+
+extern struct nano_workqueue sys_workqueue;
+
+/**
+ * @brief Submit a work item to the system workqueue.
+ *
+ * @ref nano_work_submit_to_queue
+ *
+ * When using the system workqueue it is not recommended to block or yield
+ * on the handler since its fiber is shared system wide, this may cause
+ * unexpected behavior.
+ */
+static inline void nano_work_submit(struct nano_work *work)
+{
+	nano_work_submit_to_queue(&sys_workqueue, work);
+}
+
+/**
+ * @brief Submit a delayed work item to the system workqueue.
+ *
+ * @ref nano_delayed_work_submit_to_queue
+ *
+ * When using the system workqueue it is not recommended to block or yield
+ * on the handler since its fiber is shared system wide, this may cause
+ * unexpected behavior.
+ */
+static inline int nano_delayed_work_submit(struct nano_delayed_work *work,
+					   int ticks)
+{
+	return nano_delayed_work_submit_to_queue(&sys_workqueue, work, ticks);
+}
+
+#endif /* CONFIG_SYSTEM_WORKQUEUE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _misc_nano_work__h_ */
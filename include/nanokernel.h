@@ -57,10 +57,17 @@ struct _nano_queue {
 
 #include <misc/dlist.h>
 
+struct _nano_timeout;
+struct nano_poll_event;
+
+typedef void (*_nano_timeout_func_t)(struct _nano_timeout *t);
+
 struct _nano_timeout {
 	sys_dlist_t node;
+	struct tcs *tcs;
 	struct _nano_queue *wait_q;
 	int32_t delta_ticks_from_prev;
+	_nano_timeout_func_t func;
 };
 /**
  * @endcond
@@ -333,6 +340,9 @@ struct nano_fifo {
 		struct _nano_queue data_q;
 	};
 	int stat;
+#ifdef CONFIG_NANO_POLL
+	struct nano_poll_event *poll_event;
+#endif
 #ifdef CONFIG_DEBUG_TRACING_KERNEL_OBJECTS
 	struct nano_fifo *next;
 #endif
@@ -530,6 +540,9 @@ extern void *nano_task_fifo_get(struct nano_fifo *fifo,
 struct nano_lifo {
 	struct _nano_queue wait_q;
 	void *list;
+#ifdef CONFIG_NANO_POLL
+	struct nano_poll_event *poll_event;
+#endif
 #ifdef CONFIG_DEBUG_TRACING_KERNEL_OBJECTS
 	struct nano_lifo *next;
 #endif
@@ -705,6 +718,9 @@ extern void *nano_task_lifo_get(struct nano_lifo *lifo,
 struct nano_sem {
 	struct _nano_queue wait_q;
 	int nsig;
+#ifdef CONFIG_NANO_POLL
+	struct nano_poll_event *poll_event;
+#endif
 #ifdef CONFIG_DEBUG_TRACING_KERNEL_OBJECTS
 	struct nano_sem *next;
 #endif
@@ -1049,6 +1065,464 @@ extern void sys_thread_custom_data_set(void *value);
 extern void *sys_thread_custom_data_get(void);
 #endif /* CONFIG_THREAD_CUSTOM_DATA */
 
+/* thread CPU time accounting APIs */
+#ifdef CONFIG_THREAD_CPU_ACCOUNTING
+
+/** CPU time, in hardware clock cycles, used by one thread */
+struct sys_thread_cpu_usage {
+	nano_thread_id_t thread;
+	nano_context_type_t type;  /* NANO_CTX_FIBER or NANO_CTX_TASK */
+	uint64_t cycles;
+};
+
+/** CPU time, in hardware clock cycles, since the system started */
+struct sys_cpu_usage {
+	uint64_t total;
+	uint64_t idle;
+	uint64_t isr;
+};
+
+/**
+ *
+ * @brief Take a snapshot of the CPU time used by the system and its threads
+ *
+ * This routine charges the time used so far by the running thread, then
+ * copies the CPU usage of up to @a max_threads threads to @a threads. The
+ * time used by threads that have terminated is only part of the total.
+ *
+ * @param usage Where to store the system-wide usage, or NULL.
+ * @param threads Where to store the per-thread usage, or NULL.
+ * @param max_threads Number of entries available in @a threads.
+ *
+ * @return Number of threads in the system, which can be larger than
+ * @a max_threads.
+ */
+extern int sys_thread_cpu_usage_get(struct sys_cpu_usage *usage,
+				    struct sys_thread_cpu_usage *threads,
+				    int max_threads);
+
+/**
+ *
+ * @brief Return the CPU time used by a thread
+ *
+ * @param thread Thread to query.
+ *
+ * @return Hardware clock cycles the thread has run for.
+ */
+extern uint64_t sys_thread_cpu_cycles_get(nano_thread_id_t thread);
+#endif /* CONFIG_THREAD_CPU_ACCOUNTING */
+
+/**
+ * @}
+ * @brief Nanokernel Memory Slabs
+ * @defgroup nanokernel_mem_slab Nanokernel Memory Slabs
+ * @ingroup nanokernel_services
+ * @{
+ */
+
+/*
+ * A memory slab hands out fixed-size blocks from a buffer. Blocks never
+ * allocated yet are carved from the unused part of the buffer, in order, so
+ * that the slab does not have to be walked at initialization; freed blocks
+ * are linked on a free list through their first word.
+ */
+struct nano_mem_slab {
+	struct _nano_queue wait_q;
+	char *free_list;
+	char *next_unused;
+	char *buffer_end;
+	uint32_t block_size;
+	uint32_t num_blocks;
+	uint32_t num_used;
+	uint32_t max_used;
+#ifdef CONFIG_DEBUG_TRACING_KERNEL_OBJECTS
+	struct nano_mem_slab *next;
+#endif
+};
+
+/* block sizes are rounded up so that each block can hold a link word */
+#define _NANO_MEM_SLAB_BLOCK_SIZE(block_size) \
+	(((block_size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+/**
+ * @cond internal
+ */
+#define _NANO_MEM_SLAB_INITIALIZER(obj, slab_buffer, slab_block_size, \
+				   slab_num_blocks) \
+	{ \
+	  .wait_q = { .head = NULL, .tail = &(obj).wait_q.head }, \
+	  .free_list = NULL, \
+	  .next_unused = (slab_buffer), \
+	  .buffer_end = (slab_buffer) + \
+			_NANO_MEM_SLAB_BLOCK_SIZE(slab_block_size) * \
+			(slab_num_blocks), \
+	  .block_size = _NANO_MEM_SLAB_BLOCK_SIZE(slab_block_size), \
+	  .num_blocks = (slab_num_blocks), \
+	  .num_used = 0, \
+	  .max_used = 0, \
+	}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Statically define and initialize a memory slab
+ *
+ * The slab can be used right away, without calling nano_mem_slab_init().
+ *
+ * @param name Name of the memory slab.
+ * @param block_size Size of each block, in bytes.
+ * @param blocks Number of blocks.
+ */
+#define NANO_MEM_SLAB_DEFINE(name, block_size, blocks) \
+	char __aligned(sizeof(void *)) _nano_mem_slab_buffer_##name \
+		[_NANO_MEM_SLAB_BLOCK_SIZE(block_size) * (blocks)]; \
+	struct nano_mem_slab name = \
+		_NANO_MEM_SLAB_INITIALIZER(name, _nano_mem_slab_buffer_##name, \
+					   block_size, blocks)
+
+/**
+ *
+ * @brief Initialize a nanokernel memory slab object
+ *
+ * This function initializes a nanokernel memory slab object structure.
+ *
+ * It may be called from either a fiber or task.
+ *
+ * @param slab Memory slab to initialize.
+ * @param buffer Buffer holding the blocks, aligned on a pointer boundary and
+ * at least @a num_blocks * @a block_size bytes long, with @a block_size
+ * rounded up to a multiple of the pointer size.
+ * @param block_size Size of each block, in bytes.
+ * @param num_blocks Number of blocks.
+ *
+ * @return N/A
+ */
+extern void nano_mem_slab_init(struct nano_mem_slab *slab, void *buffer,
+			       uint32_t block_size, uint32_t num_blocks);
+
+/**
+ *
+ * @brief Allocate a block from a memory slab
+ *
+ * This is a convenience wrapper for the execution context-specific APIs.
+ * This is helpful whenever the exact execution context is not known, but
+ * should be avoided when the context is known up-front (to avoid unnecessary
+ * overhead).
+ *
+ * @param slab Memory slab on which to interact.
+ * @param timeout_in_ticks Affects the action taken should no block be
+ * available. If TICKS_NONE, then return immediately. If TICKS_UNLIMITED, then
+ * wait as long as necessary. Otherwise wait up to the specified number of
+ * ticks before timing out.
+ *
+ * @warning If it is to be called from the context of an ISR, then @a
+ * timeout_in_ticks must be set to TICKS_NONE.
+ *
+ * @return Pointer to the block if available, otherwise NULL
+ */
+extern void *nano_mem_slab_alloc(struct nano_mem_slab *slab,
+				 int32_t timeout_in_ticks);
+
+/**
+ *
+ * @brief Return a block to a memory slab
+ *
+ * This is a convenience wrapper for the execution context-specific APIs.
+ * This is helpful whenever the exact execution context is not known, but
+ * should be avoided when the context is known up-front (to avoid unnecessary
+ * overhead).
+ *
+ * If a fiber is waiting for a block, the block is given to it directly.
+ *
+ * @param slab Memory slab on which to interact.
+ * @param block Block to free, allocated from @a slab.
+ *
+ * @return N/A
+ */
+extern void nano_mem_slab_free(struct nano_mem_slab *slab, void *block);
+
+/**
+ * @brief Allocate a block from a memory slab from an ISR context
+ *
+ * @param slab Memory slab on which to interact.
+ * @param timeout_in_ticks Always use TICKS_NONE.
+ *
+ * @return Pointer to the block if available, otherwise NULL
+ */
+extern void *nano_isr_mem_slab_alloc(struct nano_mem_slab *slab,
+				     int32_t timeout_in_ticks);
+
+/**
+ * @brief Return a block to a memory slab from an ISR context
+ *
+ * @sa nano_mem_slab_free
+ */
+extern void nano_isr_mem_slab_free(struct nano_mem_slab *slab, void *block);
+
+/**
+ * @brief Allocate a block from a memory slab from a fiber
+ *
+ * @sa nano_mem_slab_alloc
+ */
+extern void *nano_fiber_mem_slab_alloc(struct nano_mem_slab *slab,
+				       int32_t timeout_in_ticks);
+
+/**
+ * @brief Return a block to a memory slab from a fiber
+ *
+ * A fiber waiting for a block is made ready, but will NOT be scheduled to
+ * execute.
+ *
+ * @sa nano_mem_slab_free
+ */
+extern void nano_fiber_mem_slab_free(struct nano_mem_slab *slab, void *block);
+
+/**
+ * @brief Allocate a block from a memory slab from a task
+ *
+ * @sa nano_mem_slab_alloc
+ */
+extern void *nano_task_mem_slab_alloc(struct nano_mem_slab *slab,
+				      int32_t timeout_in_ticks);
+
+/**
+ * @brief Return a block to a memory slab from a task
+ *
+ * A fiber waiting for a block is scheduled right away.
+ *
+ * @sa nano_mem_slab_free
+ */
+extern void nano_task_mem_slab_free(struct nano_mem_slab *slab, void *block);
+
+/**
+ * @brief Get the number of blocks in use in a memory slab
+ *
+ * @param slab Memory slab to query.
+ *
+ * @return Number of allocated blocks
+ */
+static inline uint32_t nano_mem_slab_num_used_get(struct nano_mem_slab *slab)
+{
+	return slab->num_used;
+}
+
+/**
+ * @brief Get the highest number of blocks ever in use in a memory slab
+ *
+ * @param slab Memory slab to query.
+ *
+ * @return Highest number of allocated blocks at any one time
+ */
+static inline uint32_t nano_mem_slab_max_used_get(struct nano_mem_slab *slab)
+{
+	return slab->max_used;
+}
+
+/**
+ * @}
+ * @brief Nanokernel Message Queues
+ * @defgroup nanokernel_msgq Nanokernel Message Queues
+ * @ingroup nanokernel_services
+ * @{
+ */
+
+/*
+ * A message queue copies fixed-size messages in and out of a ring buffer, so
+ * that neither the sender nor the receiver has to allocate a container for
+ * them. Putting messages never waits: it fails when the ring is full.
+ */
+struct nano_msgq {
+	struct _nano_queue wait_q;
+	char *buffer_start;
+	char *buffer_end;
+	char *read_ptr;
+	char *write_ptr;
+	uint32_t msg_size;
+	uint32_t max_msgs;
+	uint32_t num_used;
+#ifdef CONFIG_DEBUG_TRACING_KERNEL_OBJECTS
+	struct nano_msgq *next;
+#endif
+};
+
+/**
+ * @cond internal
+ */
+#define _NANO_MSGQ_INITIALIZER(obj, q_buffer, q_msg_size, q_max_msgs) \
+	{ \
+	  .wait_q = { .head = NULL, .tail = &(obj).wait_q.head }, \
+	  .buffer_start = (q_buffer), \
+	  .buffer_end = (q_buffer) + (q_msg_size) * (q_max_msgs), \
+	  .read_ptr = (q_buffer), \
+	  .write_ptr = (q_buffer), \
+	  .msg_size = (q_msg_size), \
+	  .max_msgs = (q_max_msgs), \
+	  .num_used = 0, \
+	}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Statically define and initialize a message queue
+ *
+ * The queue can be used right away, without calling nano_msgq_init().
+ *
+ * @param name Name of the message queue.
+ * @param msg_size Size of each message, in bytes.
+ * @param max_msgs Maximum number of messages the queue can hold.
+ */
+#define NANO_MSGQ_DEFINE(name, msg_size, max_msgs) \
+	char __aligned(sizeof(void *)) _nano_msgq_buffer_##name \
+		[(msg_size) * (max_msgs)]; \
+	struct nano_msgq name = \
+		_NANO_MSGQ_INITIALIZER(name, _nano_msgq_buffer_##name, \
+				       msg_size, max_msgs)
+
+/**
+ *
+ * @brief Initialize a nanokernel message queue object
+ *
+ * This function initializes a nanokernel message queue object structure.
+ *
+ * It may be called from either a fiber or task.
+ *
+ * @param msgq Message queue to initialize.
+ * @param buffer Ring buffer holding the messages, at least
+ * @a msg_size * @a max_msgs bytes long.
+ * @param msg_size Size of each message, in bytes.
+ * @param max_msgs Maximum number of messages the queue can hold.
+ *
+ * @return N/A
+ */
+extern void nano_msgq_init(struct nano_msgq *msgq, void *buffer,
+			   uint32_t msg_size, uint32_t max_msgs);
+
+/**
+ *
+ * @brief Put messages in a message queue
+ *
+ * This is a convenience wrapper for the execution context-specific APIs.
+ * This is helpful whenever the exact execution context is not known, but
+ * should be avoided when the context is known up-front (to avoid unnecessary
+ * overhead).
+ *
+ * The messages are copied in the queue, in order, as long as there is room
+ * for them; this routine never waits. One fiber waiting for messages is
+ * woken up for each message put.
+ *
+ * @param msgq Message queue on which to interact.
+ * @param data Messages to put, @a num_msgs * msg_size bytes long.
+ * @param num_msgs Number of messages to put.
+ *
+ * @return Number of messages put, less than @a num_msgs if the queue is full
+ */
+extern int nano_msgq_put(struct nano_msgq *msgq, const void *data,
+			 int num_msgs);
+
+/**
+ *
+ * @brief Get messages from a message queue
+ *
+ * This is a convenience wrapper for the execution context-specific APIs.
+ * This is helpful whenever the exact execution context is not known, but
+ * should be avoided when the context is known up-front (to avoid unnecessary
+ * overhead).
+ *
+ * All the messages available, up to @a max_msgs, are copied out of the queue
+ * in the order they were put. If the queue is empty, the caller waits for at
+ * least one message.
+ *
+ * @param msgq Message queue on which to interact.
+ * @param data Where to copy the messages, @a max_msgs * msg_size bytes long.
+ * @param max_msgs Maximum number of messages to get.
+ * @param timeout_in_ticks Affects the action taken should the queue be empty.
+ * If TICKS_NONE, then return immediately. If TICKS_UNLIMITED, then wait as
+ * long as necessary. Otherwise wait up to the specified number of ticks
+ * before timing out.
+ *
+ * @warning If it is to be called from the context of an ISR, then @a
+ * timeout_in_ticks must be set to TICKS_NONE.
+ *
+ * @return Number of messages copied, 0 if the queue stayed empty
+ */
+extern int nano_msgq_get(struct nano_msgq *msgq, void *data, int max_msgs,
+			 int32_t timeout_in_ticks);
+
+/**
+ * @brief Put messages in a message queue from an ISR context
+ *
+ * The time it takes is bounded by the number of messages put: it never
+ * waits.
+ *
+ * @sa nano_msgq_put
+ */
+extern int nano_isr_msgq_put(struct nano_msgq *msgq, const void *data,
+			     int num_msgs);
+
+/**
+ * @brief Get messages from a message queue from an ISR context
+ *
+ * @param msgq Message queue on which to interact.
+ * @param data Where to copy the messages.
+ * @param max_msgs Maximum number of messages to get.
+ * @param timeout_in_ticks Always use TICKS_NONE.
+ *
+ * @return Number of messages copied
+ */
+extern int nano_isr_msgq_get(struct nano_msgq *msgq, void *data, int max_msgs,
+			     int32_t timeout_in_ticks);
+
+/**
+ * @brief Put messages in a message queue from a fiber
+ *
+ * Fibers waiting for messages are made ready, but will NOT be scheduled to
+ * execute.
+ *
+ * @sa nano_msgq_put
+ */
+extern int nano_fiber_msgq_put(struct nano_msgq *msgq, const void *data,
+			       int num_msgs);
+
+/**
+ * @brief Get messages from a message queue from a fiber
+ *
+ * @sa nano_msgq_get
+ */
+extern int nano_fiber_msgq_get(struct nano_msgq *msgq, void *data,
+			       int max_msgs, int32_t timeout_in_ticks);
+
+/**
+ * @brief Put messages in a message queue from a task
+ *
+ * Fibers waiting for messages are scheduled right away.
+ *
+ * @sa nano_msgq_put
+ */
+extern int nano_task_msgq_put(struct nano_msgq *msgq, const void *data,
+			      int num_msgs);
+
+/**
+ * @brief Get messages from a message queue from a task
+ *
+ * @sa nano_msgq_get
+ */
+extern int nano_task_msgq_get(struct nano_msgq *msgq, void *data,
+			      int max_msgs, int32_t timeout_in_ticks);
+
+/**
+ * @brief Get the number of messages in a message queue
+ *
+ * @param msgq Message queue to query.
+ *
+ * @return Number of messages waiting to be read
+ */
+static inline uint32_t nano_msgq_num_used_get(struct nano_msgq *msgq)
+{
+	return msgq->num_used;
+}
+
 /**
  * @}
  * @brief Nanokernel Timers
@@ -1320,6 +1794,128 @@ extern int64_t sys_tick_delta(int64_t *reftime);
 extern uint32_t sys_tick_delta_32(int64_t *reftime);
 
 
+/**
+ * @}
+ * @brief Nanokernel polling
+ * @defgroup nanokernel_poll Nanokernel Polling
+ * @ingroup nanokernel_services
+ * @{
+ */
+
+#ifdef CONFIG_NANO_POLL
+
+/* object types that can be polled */
+enum {
+	NANO_POLL_TYPE_FIFO,
+	NANO_POLL_TYPE_LIFO,
+	NANO_POLL_TYPE_SEM,
+	NANO_POLL_TYPE_TIMER,
+};
+
+/* state of a poll event */
+enum {
+	NANO_POLL_STATE_NOT_READY,
+	NANO_POLL_STATE_READY,
+};
+
+struct _nano_poller;
+
+/**
+ * @brief A nanokernel object being polled, and whether it is ready
+ *
+ * A FIFO, LIFO or timer is ready when it holds data, a semaphore when it
+ * has been given. Only one poll event at a time can be registered with an
+ * object.
+ */
+struct nano_poll_event {
+	struct _nano_poller *poller;
+	uint8_t type;
+	uint8_t state;
+	union {
+		void *obj;
+		struct nano_fifo *fifo;
+		struct nano_lifo *lifo;
+		struct nano_sem *sem;
+		struct nano_timer *timer;
+	};
+};
+
+/**
+ * @brief Initialize a poll event
+ *
+ * @param event Poll event to initialize
+ * @param type NANO_POLL_TYPE_xxx of the object
+ * @param obj Object to poll
+ *
+ * @return N/A
+ */
+static inline void nano_poll_event_init(struct nano_poll_event *event,
+					int type, void *obj)
+{
+	event->poller = NULL;
+	event->type = type;
+	event->state = NANO_POLL_STATE_NOT_READY;
+	event->obj = obj;
+}
+
+/**
+ * @brief Wait for any of several nanokernel objects to be ready
+ *
+ * This is a convenience wrapper for the execution context-specific APIs.
+ * This is helpful whenever the exact execution context is not known, but
+ * should be avoided when the context is known up-front (to avoid unnecessary
+ * overhead).
+ *
+ * The state of each event is set to NANO_POLL_STATE_READY or
+ * NANO_POLL_STATE_NOT_READY. Polling does not take anything from the
+ * objects: the caller gets the data or semaphore of the ready objects with
+ * a TICKS_NONE timeout, which can fail if another context took it first.
+ *
+ * A fiber waiting on an object is handed the data before a poller is
+ * signalled.
+ *
+ * @param events Array of poll events
+ * @param num_events Number of events in the array
+ * @param timeout_in_ticks Affects the action taken should no object be
+ * ready. If TICKS_NONE, then return immediately. If TICKS_UNLIMITED, then
+ * wait as long as necessary. Otherwise, wait up to the specified number of
+ * ticks before timing out.
+ *
+ * @return Number of ready objects, 0 on timeout, -EADDRINUSE if one of the
+ * objects is already being polled by another fiber
+ */
+extern int nano_poll(struct nano_poll_event *events, int num_events,
+		     int32_t timeout_in_ticks);
+
+/**
+ * @brief Check several nanokernel objects for readiness from an ISR
+ *
+ * Like nano_poll(), but only TICKS_NONE is a valid timeout.
+ */
+extern int nano_isr_poll(struct nano_poll_event *events, int num_events,
+			 int32_t timeout_in_ticks);
+
+/**
+ * @brief Wait for any of several nanokernel objects to be ready from a fiber
+ *
+ * @sa nano_poll
+ */
+extern int nano_fiber_poll(struct nano_poll_event *events, int num_events,
+			   int32_t timeout_in_ticks);
+
+/**
+ * @brief Wait for any of several nanokernel objects to be ready from a task
+ *
+ * Since a task cannot pend on nanokernel objects, it checks them every time
+ * it is woken up from idle.
+ *
+ * @sa nano_poll
+ */
+extern int nano_task_poll(struct nano_poll_event *events, int num_events,
+			  int32_t timeout_in_ticks);
+
+#endif /* CONFIG_NANO_POLL */
+
 /*
  * Lists for object tracing
  */
@@ -1333,6 +1929,10 @@ struct nano_lifo *_track_list_nano_lifo;
 
 struct nano_timer *_track_list_nano_timer;
 
+struct nano_mem_slab *_track_list_nano_mem_slab;
+
+struct nano_msgq *_track_list_nano_msgq;
+
 #define DEBUG_TRACING_OBJ_INIT(type, obj, list) { \
 	obj->next = NULL; \
 	if (list == NULL) { \
@@ -131,6 +131,22 @@ struct net_buf {
  */
 struct net_buf *net_buf_get(struct nano_fifo *fifo, size_t reserve_head);
 
+/** @brief Get a new buffer from the pool, waiting at most a given time.
+ *
+ *  Get buffer from the available buffers pool with specified type and
+ *  reserved headroom, without blocking longer than the given timeout.
+ *
+ *  @param fifo Which FIFO to take the buffer from.
+ *  @param reserve_head How much headroom to reserve.
+ *  @param timeout Ticks to wait for a buffer, TICKS_NONE not to wait or
+ *  TICKS_UNLIMITED to wait as long as necessary. Must be TICKS_NONE from
+ *  an ISR.
+ *
+ *  @return New buffer or NULL if out of buffers.
+ */
+struct net_buf *net_buf_get_timeout(struct nano_fifo *fifo,
+				    size_t reserve_head, int32_t timeout);
+
 /** @brief Decrements the reference count of a buffer.
  *
  *  Decrements the reference count of a buffer and puts it back into the
@@ -179,6 +195,18 @@ struct net_buf *net_buf_clone(struct net_buf *buf);
  */
 void *net_buf_add(struct net_buf *buf, size_t len);
 
+/** @brief Add (8-bit) byte at the end of the buffer
+ *
+ *  Adds a byte at the end of the buffer. Increments the data length of
+ *  the buffer to account for more data at the end.
+ *
+ *  @param buf Buffer to update.
+ *  @param value byte value to be added.
+ *
+ *  @return Pointer to the value added
+ */
+uint8_t *net_buf_add_u8(struct net_buf *buf, uint8_t value);
+
 /** @brief Add 16-bit value at the end of the buffer
  *
  *  Adds 16-bit value in little endian format at the end of buffer.
@@ -228,6 +256,17 @@ void net_buf_push_le16(struct net_buf *buf, uint16_t value);
  */
 void *net_buf_pull(struct net_buf *buf, size_t len);
 
+/** @brief Remove a 8-bit value from the beginning of the buffer
+ *
+ *  Same idea as with bt_buf_pull(), but a helper for operating on
+ *  8-bit values.
+ *
+ *  @param buf Buffer.
+ *
+ *  @return The 8-bit removed value
+ */
+uint8_t net_buf_pull_u8(struct net_buf *buf);
+
 /** @brief Remove and convert 16 bits from the beginning of the buffer.
  *
  *  Same idea as with bt_buf_pull(), but a helper for operating on
@@ -67,6 +67,10 @@ struct l2_buf {
 	uint8_t uncomp_hdr_len;
 	int last_tx_status;
 
+	/* 6LoWPAN reassembly, fragments of a datagram sorted by offset */
+	struct net_buf *frag_next;
+	uint16_t frag_offset;
+
 	struct packetbuf_attr pkt_packetbuf_attrs[PACKETBUF_NUM_ATTRS];
 	struct packetbuf_addr pkt_packetbuf_addrs[PACKETBUF_NUM_ADDRS];
 	uint16_t pkt_buflen, pkt_bufptr;
@@ -86,6 +90,10 @@ struct l2_buf {
 	(((struct l2_buf *)net_buf_user_data((buf)))->uncomp_hdr_len)
 #define uip_last_tx_status(buf) \
 	(((struct l2_buf *)net_buf_user_data((buf)))->last_tx_status)
+#define uip_frag_next(buf) \
+	(((struct l2_buf *)net_buf_user_data((buf)))->frag_next)
+#define uip_frag_offset(buf) \
+	(((struct l2_buf *)net_buf_user_data((buf)))->frag_offset)
 #define uip_pkt_buflen(buf) \
 	(((struct l2_buf *)net_buf_user_data((buf)))->pkt_buflen)
 #define uip_pkt_bufptr(buf) \
@@ -78,6 +78,10 @@ extern void _k_timeout_alloc(struct k_args *P);
 extern void _k_timeout_free(struct k_timer *T);
 extern void _k_timeout_cancel(struct k_args *A);
 
+#ifdef CONFIG_TICKLESS_KERNEL
+extern void _k_time_slice_deadline_update(void);
+#endif
+
 extern void _k_timer_list_update(int ticks);
 
 extern void _k_do_event_signal(kevent_t event);
@@ -165,6 +165,10 @@ FUNC_NORETURN void _k_server(int unused1, int unused2)
 			_k_current_task = pNextTask;
 			_nanokernel.task = (struct tcs *)pNextTask->workspace;
 
+#ifdef CONFIG_TICKLESS_KERNEL
+			_k_time_slice_deadline_update();
+#endif
+
 #ifdef CONFIG_TASK_MONITOR
 			if (_k_monitor_mask & MON_TSWAP) {
 				_k_task_monitor(_k_current_task, 0);
@@ -72,14 +72,15 @@ static inline int _TlDebugUpdate(int32_t ticks)
  * This routine checks to see if it is time for the current task
  * to relinquish control, and yields CPU if so.
  *
+ * @param ticks Number of ticks
  * @return N/A
  *
  */
-static inline void _TimeSliceUpdate(void)
+static inline void _TimeSliceUpdate(int32_t ticks)
 {
 #ifdef CONFIG_TIMESLICING
 	int yield = slice_time && (_k_current_task->priority >= slice_prio) &&
-		    (++slice_count >= slice_time);
+		    ((slice_count += ticks) >= slice_time);
 	if (yield) {
 		slice_count = 0;
 		_k_task_yield(NULL);
@@ -89,6 +90,60 @@ static inline void _TimeSliceUpdate(void)
 #endif /* CONFIG_TIMESLICING */
 }
 
+#ifdef CONFIG_TICKLESS_KERNEL
+/**
+ * @internal
+ * @brief Get ticks left in the current task's time slice
+ *
+ * @return number of ticks, TICKS_UNLIMITED if the task is not time sliced
+ */
+static inline int32_t _TimeSliceLeftGet(void)
+{
+#ifdef CONFIG_TIMESLICING
+	if (slice_time && (_k_current_task->priority >= slice_prio)) {
+		return max(slice_time - slice_count, 1);
+	}
+#endif /* CONFIG_TIMESLICING */
+	return TICKS_UNLIMITED;
+}
+
+/**
+ * @internal
+ * @brief Get ticks until the next kernel deadline
+ *
+ * @return number of ticks, TICKS_UNLIMITED if there is none
+ */
+static int32_t _NextDeadlineGet(void)
+{
+	uint32_t closest_deadline = (uint32_t)_TimeSliceLeftGet();
+
+	if (_k_timer_list_head) {
+		closest_deadline = min(closest_deadline,
+				       (uint32_t)_k_timer_list_head->duration);
+	}
+
+	return (int32_t)min(closest_deadline, _nano_get_earliest_deadline());
+}
+
+/**
+ *
+ * @brief Program the timer for the time slice of a new current task
+ *
+ * Called by the microkernel server when it switches tasks, since the time
+ * slice of the new task may expire before the timer's current deadline.
+ *
+ * @return N/A
+ */
+void _k_time_slice_deadline_update(void)
+{
+	int32_t ticks = _TimeSliceLeftGet();
+
+	if (ticks != TICKS_UNLIMITED) {
+		_sys_clock_deadline_update(ticks);
+	}
+}
+#endif /* CONFIG_TICKLESS_KERNEL */
+
 /**
  * @internal
  * @brief Get elapsed ticks
@@ -138,11 +193,15 @@ int _k_ticker(int event)
 	_k_workload_monitor_update();
 
 	if (_TlDebugUpdate(ticks)) {
-		_TimeSliceUpdate();
+		_TimeSliceUpdate(ticks);
 		_k_timer_list_update(ticks);
 		_nano_sys_clock_tick_announce(ticks);
 	}
 
+#ifdef CONFIG_TICKLESS_KERNEL
+	_sys_clock_deadline_set(_NextDeadlineGet());
+#endif
+
 	return 1;
 }
 
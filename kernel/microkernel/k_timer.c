@@ -81,6 +81,34 @@ void _k_timer_delist(struct k_timer *T)
 	T->duration = -1;
 }
 
+/**
+ * @brief Insert a timer that starts now into the timer queue
+ *
+ * With a tickless kernel the timer queue only advances when the ticker
+ * processes the elapsed ticks, so the ticks elapsed since then are added to
+ * the timer's duration. The system timer is reprogrammed if the new timer
+ * expires before its current deadline.
+ *
+ * @param T Timer
+ * @return N/A
+ */
+static void _k_timer_enlist_now(struct k_timer *T)
+{
+#ifdef CONFIG_TICKLESS_KERNEL
+	int32_t ticks;
+	int key;
+
+	key = irq_lock();
+	T->duration += _sys_clock_ticks_pending();
+	ticks = T->duration;
+	_k_timer_enlist(T);
+	_sys_clock_deadline_update(ticks);
+	irq_unlock(key);
+#else
+	_k_timer_enlist(T);
+#endif
+}
+
 /**
  * @brief Allocate timer used for command packet timeout
  *
@@ -96,7 +124,7 @@ void _k_timeout_alloc(struct k_args *P)
 	T->duration = P->Time.ticks;
 	T->period = 0;
 	T->args = P;
-	_k_timer_enlist(T);
+	_k_timer_enlist_now(T);
 	P->Time.timer = T;
 }
 
@@ -149,6 +177,10 @@ void _k_timeout_free(struct k_timer *T)
  * and that a periodic timer may exhibit a slow, ever-increasing degree of drift
  * from the main system timer over long intervals.
  *
+ * With a tickless kernel, an announcement routinely exceeds the first timer's
+ * remaining tick count, so the excess ticks are carried over to the following
+ * timers, including a periodic timer that has just been re-inserted.
+ *
  * @param ticks Number of ticks
  * @return N/A
  */
@@ -164,6 +196,11 @@ void _k_timer_list_update(int ticks)
 		}
 
 		T = _k_timer_list_head;
+#ifdef CONFIG_TICKLESS_KERNEL
+		ticks = -T->duration; /* excess ticks for subsequent timer(s) */
+#else
+		ticks = 0; /* don't decrement duration for subsequent timer(s) */
+#endif
 		if (T == _k_timer_list_tail) {
 			_k_timer_list_head = _k_timer_list_tail = NULL;
 		} else {
@@ -177,8 +214,6 @@ void _k_timer_list_update(int ticks)
 			T->duration = -1;
 		}
 		TO_ALIST(&_k_command_stack, T->args);
-
-		ticks = 0; /* don't decrement duration for subsequent timer(s) */
 	}
 }
 
@@ -282,7 +317,7 @@ void _k_timer_start(struct k_args *P)
 		T->args->Comm = _K_SVC_SEM_SIGNAL;
 		T->args->args.s1.sema = P->args.c1.sema;
 	}
-	_k_timer_enlist(T);
+	_k_timer_enlist_now(T);
 }
 
 
@@ -374,7 +409,7 @@ void _k_task_sleep(struct k_args *P)
 	P->Ctxt.task = _k_current_task;
 	P->Time.timer = T;
 
-	_k_timer_enlist(T);
+	_k_timer_enlist_now(T);
 	_k_state_bit_set(_k_current_task, TF_TIME);
 }
 
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * @brief Per-thread CPU time accounting
+ *
+ * This module provides the following APIs:
+ *
+ * sys_thread_cpu_usage_get, sys_thread_cpu_cycles_get
+ *
+ * The architecture code calls the hooks below on every context switch,
+ * interrupt entry and exit and low power entry. Each hook charges the cycles
+ * elapsed since the previous one to whoever was running in between: the
+ * current thread, the interrupt handlers or the idle CPU.
+ */
+
+#include <nano_private.h>
+#include <toolchain.h>
+#include <sections.h>
+
+static uint32_t last_stamp;
+static uint64_t total_cycles;
+static uint64_t idle_cycles;
+static uint64_t isr_cycles;
+
+/* interrupt nesting level, as seen by the accounting hooks */
+static int isr_nested;
+
+/* set while the CPU is in low power mode */
+static int sleeping;
+
+/*
+ * Charge the cycles elapsed since the last hook to whoever was running.
+ * Called with interrupts locked.
+ */
+static void charge(void)
+{
+	uint32_t now = sys_cycle_get_32();
+	uint32_t delta = now - last_stamp;
+
+	last_stamp = now;
+	total_cycles += delta;
+
+	if (isr_nested) {
+		isr_cycles += delta;
+	} else if (sleeping) {
+		/* also covers a low power entry that did not end up sleeping */
+		sleeping = 0;
+		idle_cycles += delta;
+	} else {
+		_nanokernel.current->cpu_cycles += delta;
+	}
+}
+
+/* called by _Swap() before the outgoing thread is switched out */
+void _sys_cpu_accounting_switch(void)
+{
+	unsigned int key = irq_lock();
+
+	charge();
+
+	irq_unlock(key);
+}
+
+void _sys_cpu_accounting_isr_enter(void)
+{
+	unsigned int key = irq_lock();
+
+	charge();
+	isr_nested++;
+
+	irq_unlock(key);
+}
+
+void _sys_cpu_accounting_isr_exit(void)
+{
+	unsigned int key = irq_lock();
+
+	charge();
+	isr_nested--;
+
+	irq_unlock(key);
+}
+
+/* the time until the next interrupt is idle time */
+void _sys_cpu_accounting_enter_sleep(void)
+{
+	unsigned int key = irq_lock();
+
+	charge();
+	sleeping = 1;
+
+	irq_unlock(key);
+}
+
+int sys_thread_cpu_usage_get(struct sys_cpu_usage *usage,
+			     struct sys_thread_cpu_usage *threads,
+			     int max_threads)
+{
+	struct tcs *tcs;
+	unsigned int key;
+	int num_threads = 0;
+
+	key = irq_lock();
+
+	charge();
+
+	if (usage) {
+		usage->total = total_cycles;
+		usage->idle = idle_cycles;
+		usage->isr = isr_cycles;
+	}
+
+	for (tcs = _nanokernel.threads; tcs; tcs = tcs->next_thread) {
+		if (threads && num_threads < max_threads) {
+			threads[num_threads].thread = tcs;
+			threads[num_threads].type =
+				(tcs->flags & TASK) ? NANO_CTX_TASK : NANO_CTX_FIBER;
+			threads[num_threads].cycles = tcs->cpu_cycles;
+		}
+		num_threads++;
+	}
+
+	irq_unlock(key);
+
+	return num_threads;
+}
+
+uint64_t sys_thread_cpu_cycles_get(nano_thread_id_t thread)
+{
+	unsigned int key;
+	uint64_t cycles;
+
+	key = irq_lock();
+
+	charge();
+	cycles = thread->cpu_cycles;
+
+	irq_unlock(key);
+
+	return cycles;
+}
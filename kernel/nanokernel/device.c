@@ -1,6 +1,13 @@
 #include <string.h>
 #include <device.h>
+#include <init.h>
 #include <misc/util.h>
+#include <sections.h>
+
+#ifdef CONFIG_BOOT_TIME_MEASUREMENT
+#include <arch/cpu.h>
+#define INIT_STAMP() ((uint32_t)_NanoTscRead())
+#endif
 
 extern struct device __device_init_start[];
 extern struct device __device_PRIMARY_start[];
@@ -19,6 +26,114 @@ static struct device *config_levels[] = {
 	__device_init_end,
 };
 
+#ifdef CONFIG_DEVICE_DEFERRED_INIT
+
+static char __stack deferred_init_stack[CONFIG_DEVICE_DEFERRED_INIT_STACK_SIZE];
+static int deferred_init_started;
+static struct nano_fifo deferred_init_fifo;
+
+/* devices before this one have been handed to the device init fiber */
+static struct device *deferred_init_next = __device_init_start;
+
+/* queued after the last level to make the device init fiber terminate */
+static struct device_deferred_init deferred_init_end;
+
+/**
+ * @brief Device initialization fiber
+ *
+ * @details Runs the deferred part of the initialization of the devices, in
+ * the order they are queued, then wakes up the waiters for each device.
+ */
+static void deferred_init_fiber(int unused1, int unused2)
+{
+	struct device_deferred_init *deferred;
+
+	ARG_UNUSED(unused1);
+	ARG_UNUSED(unused2);
+
+	while ((deferred = nano_fiber_fifo_get(&deferred_init_fifo,
+					       TICKS_UNLIMITED)) !=
+	       &deferred_init_end) {
+#ifdef CONFIG_BOOT_TIME_MEASUREMENT
+		uint32_t start = INIT_STAMP();
+#endif
+
+		deferred->status = deferred->init(deferred->device);
+
+#ifdef CONFIG_BOOT_TIME_MEASUREMENT
+		deferred->cycles = INIT_STAMP() - start;
+#endif
+		deferred->done = 1;
+		nano_fiber_sem_give(&deferred->ready_sem);
+	}
+}
+
+/**
+ * @brief Hand the devices initialized so far to the device init fiber
+ *
+ * @details Called by the main task at the end of each level, starting with
+ * the NANOKERNEL level, so that the deferred parts can use the nanokernel
+ * services. The fiber preempts the main task whenever it is ready, so the
+ * deferred parts run as soon as they are queued, but not before the level
+ * has completed.
+ *
+ * @param end device object following the last device initialized
+ */
+static void deferred_init_queue(struct device *end)
+{
+	struct device *info;
+
+	if (!deferred_init_started) {
+		deferred_init_started = 1;
+		nano_fifo_init(&deferred_init_fifo);
+		task_fiber_start(deferred_init_stack,
+				 CONFIG_DEVICE_DEFERRED_INIT_STACK_SIZE,
+				 deferred_init_fiber, 0, 0,
+				 CONFIG_DEVICE_DEFERRED_INIT_PRIORITY, 0);
+	}
+
+	for (info = deferred_init_next; info < end; info++) {
+		struct device_deferred_init *deferred = info->deferred;
+
+		/* the deferred part only runs if the first one succeeded */
+		if (deferred && !deferred->done) {
+			deferred->device = info;
+			nano_task_fifo_put(&deferred_init_fifo, deferred);
+		}
+	}
+
+	deferred_init_next = end;
+
+	if (end == __device_init_end) {
+		nano_task_fifo_put(&deferred_init_fifo, &deferred_init_end);
+	}
+}
+
+/**
+ * @brief Wait for a device to be fully initialized
+ *
+ * @details The device init fiber gives the semaphore once; each waiter gives
+ * it back after taking it, so that all of them get woken up in turn.
+ */
+int device_wait_ready(struct device *device, int32_t timeout_in_ticks)
+{
+	struct device_deferred_init *deferred = device->deferred;
+
+	if (!deferred || deferred->done) {
+		return deferred ? deferred->status : DEV_OK;
+	}
+
+	if (!nano_sem_take(&deferred->ready_sem, timeout_in_ticks)) {
+		return DEV_NOT_CONFIG;
+	}
+
+	nano_sem_give(&deferred->ready_sem);
+
+	return deferred->status;
+}
+
+#endif /* CONFIG_DEVICE_DEFERRED_INIT */
+
 /**
  * @brief Execute all the device initialization functions at a given level
  *
@@ -28,6 +143,10 @@ static struct device *config_levels[] = {
  * they need to be invoked, with symbols indicating where one level leaves
  * off and the next one begins.
  *
+ * The deferred part of the initialization of the devices created by the
+ * DEVICE_INIT_DEFERRED() macro is handed to the device init fiber once the
+ * level has completed.
+ *
  * @param level init level to run.
  */
 void _sys_device_do_config_level(int level)
@@ -36,18 +155,131 @@ void _sys_device_do_config_level(int level)
 
 	for (info = config_levels[level]; info < config_levels[level+1]; info++) {
 		struct device_config *device = info->config;
+		int ret;
+#ifdef CONFIG_BOOT_TIME_MEASUREMENT
+		uint32_t start = INIT_STAMP();
+#endif
+
+		ret = device->init(info);
+
+#ifdef CONFIG_BOOT_TIME_MEASUREMENT
+		info->init_cycles = INIT_STAMP() - start;
+#endif
+#ifdef CONFIG_DEVICE_DEFERRED_INIT
+		if (info->deferred) {
+			nano_sem_init(&info->deferred->ready_sem);
+			if (ret != DEV_OK) {
+				/* nothing left to do: report the error */
+				info->deferred->status = ret;
+				info->deferred->done = 1;
+			}
+		}
+#else
+		ARG_UNUSED(ret);
+#endif
+	}
 
-		device->init(info);
+#ifdef CONFIG_DEVICE_DEFERRED_INIT
+	if (level >= _SYS_INIT_LEVEL_NANOKERNEL) {
+		deferred_init_queue(config_levels[level+1]);
 	}
+#endif
 }
 
+#ifdef CONFIG_DEVICE_BINDING_HASH
+
+#define BINDING_HASH_MASK (CONFIG_DEVICE_BINDING_HASH_SIZE - 1)
+
+#if (CONFIG_DEVICE_BINDING_HASH_SIZE & BINDING_HASH_MASK) != 0
+#error "CONFIG_DEVICE_BINDING_HASH_SIZE must be a power of two"
+#endif
+
+/* named device objects, indexed by the hash of their name */
+static struct device *binding_hash[CONFIG_DEVICE_BINDING_HASH_SIZE];
+
+/* 0: not built yet, 1: built, -1: too small, use the linear search */
+static int binding_hash_state;
+
+/* FNV-1a hash of a device name */
+static uint32_t binding_hash_name(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Build the device name hash table
+ *
+ * @details The set of devices is fixed when the image is linked, so the
+ * table is filled once, on the first lookup, and never changes after that.
+ * Collisions are resolved by linear probing. Devices are inserted in the
+ * order they are initialized, so that a name exposed by several devices
+ * resolves to the same one as with a linear search.
+ *
+ * @return 1 if the table holds all the named devices, -1 if it is too small.
+ */
+static int binding_hash_build(void)
+{
+	struct device *info;
+
+	for (info = __device_init_start; info != __device_init_end; info++) {
+		uint32_t slot;
+		int probes = 0;
+
+		if (info->config->name[0] == '\0') {
+			continue;
+		}
+
+		slot = binding_hash_name(info->config->name) & BINDING_HASH_MASK;
+		while (binding_hash[slot]) {
+			if (++probes == CONFIG_DEVICE_BINDING_HASH_SIZE) {
+				return -1;
+			}
+			slot = (slot + 1) & BINDING_HASH_MASK;
+		}
+		binding_hash[slot] = info;
+	}
+
+	return 1;
+}
+
+static struct device *binding_hash_lookup(char *name)
+{
+	uint32_t slot = binding_hash_name(name) & BINDING_HASH_MASK;
+	int probes;
+
+	for (probes = 0; probes < CONFIG_DEVICE_BINDING_HASH_SIZE; probes++) {
+		struct device *info = binding_hash[slot];
+
+		if (!info) {
+			break;
+		}
+		if (!strcmp(name, info->config->name)) {
+			return info;
+		}
+		slot = (slot + 1) & BINDING_HASH_MASK;
+	}
+
+	return NULL;
+}
+
+#endif /* CONFIG_DEVICE_BINDING_HASH */
+
 /**
  * @brief Retrieve the device structure for a driver by name
  *
  * @details Device objects are created via the DEVICE_INIT() macro and
  * placed in memory by the linker. If a driver needs to bind to another driver
  * it can use this function to retrieve the device structure of the lower level
- * driver by the name the driver exposes to the system.
+ * driver by the name the driver exposes to the system. When the name of the
+ * device object is known at build time, DEVICE_BINDING() should be used
+ * instead.
  *
  * @param name device name to search for.
  *
@@ -57,6 +289,22 @@ struct device *device_get_binding(char *name)
 {
 	struct device *info;
 
+#ifdef CONFIG_DEVICE_BINDING_HASH
+	if (!binding_hash_state) {
+		unsigned int key = irq_lock();
+
+		if (!binding_hash_state) {
+			binding_hash_state = binding_hash_build();
+		}
+
+		irq_unlock(key);
+	}
+
+	if (binding_hash_state > 0) {
+		return binding_hash_lookup(name);
+	}
+#endif
+
 	for (info = __device_init_start; info != __device_init_end; info++) {
 		if (!strcmp(name, info->config->name)) {
 			return info;
@@ -65,3 +313,9 @@ struct device *device_get_binding(char *name)
 
 	return NULL;
 }
+
+void device_list_get(struct device **device_list, int *device_count)
+{
+	*device_list = __device_init_start;
+	*device_count = __device_init_end - __device_init_start;
+}
@@ -74,6 +74,28 @@ extern void _thread_exit(struct tcs *tcs);
 	} while (0)
 #endif /* CONFIG_THREAD_MONITOR */
 
+/* CPU time accounting hooks */
+
+#ifdef CONFIG_THREAD_CPU_ACCOUNTING
+extern void _sys_cpu_accounting_switch(void);
+extern void _sys_cpu_accounting_isr_enter(void);
+extern void _sys_cpu_accounting_isr_exit(void);
+extern void _sys_cpu_accounting_enter_sleep(void);
+#else
+#define _sys_cpu_accounting_switch() \
+	do {/* nothing */    \
+	} while (0)
+#define _sys_cpu_accounting_isr_enter() \
+	do {/* nothing */    \
+	} while (0)
+#define _sys_cpu_accounting_isr_exit() \
+	do {/* nothing */    \
+	} while (0)
+#define _sys_cpu_accounting_enter_sleep() \
+	do {/* nothing */    \
+	} while (0)
+#endif /* CONFIG_THREAD_CPU_ACCOUNTING */
+
 /* special nanokernel object APIs */
 
 struct nano_lifo;
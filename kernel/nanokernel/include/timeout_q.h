@@ -24,51 +24,74 @@
 #define _kernel_nanokernel_include_timeout_q__h_
 
 #include <misc/dlist.h>
+#include <drivers/system_timer.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* initialize the nano timeouts part of TCS when enabled in the kernel */
-
-static inline void _nano_timeout_tcs_init(struct tcs *tcs)
+/* initialize a timeout, <func> is called when it expires if not NULL */
+static inline void _nano_timeout_init(struct _nano_timeout *t,
+				      _nano_timeout_func_t func)
 {
 	/*
 	 * Must be initialized here and when dequeueing a timeout so that code
 	 * not dealing with timeouts does not have to handle this, such as when
 	 * waiting forever on a semaphore.
 	 */
-	tcs->nano_timeout.delta_ticks_from_prev = -1;
+	t->delta_ticks_from_prev = -1;
+
+	/*
+	 * Must be initialized here so the timeout handler does not try to
+	 * dequeue or ready a fiber for a timeout not tied to one.
+	 */
+	t->tcs = NULL;
+	t->wait_q = NULL;
+
+	t->func = func;
 
 	/*
 	 * These are initialized when enqueing on the timeout queue:
 	 *
-	 *   tcs->nano_timeout.node.next
-	 *   tcs->nano_timeout.node.prev
-	 *   tcs->nano_timeout.wait_q
+	 *   t->node.next
+	 *   t->node.prev
 	 */
 }
 
+/* initialize the nano timeouts part of TCS when enabled in the kernel */
+
+static inline void _nano_timeout_tcs_init(struct tcs *tcs)
+{
+	_nano_timeout_init(&tcs->nano_timeout, NULL);
+}
+
 /*
  * Handle one expired timeout.
- * This removes the fiber from the timeout queue head, and also removes it
- * from the wait queue it is on if waiting for an object. In that case, it
- * also sets the return value to 0/NULL.
+ * If the timeout is tied to a fiber, this readies the fiber and also removes
+ * it from the wait queue it is on if waiting for an object. In that case, it
+ * also sets the return value to 0/NULL. The timeout function, if any, is
+ * then called.
  */
 
 static inline struct _nano_timeout *_nano_timeout_handle_one_timeout(
 	sys_dlist_t *timeout_q)
 {
 	struct _nano_timeout *t = (void *)sys_dlist_get(timeout_q);
-	struct tcs *tcs = CONTAINER_OF(t, struct tcs, nano_timeout);
-
-	if (tcs->nano_timeout.wait_q) {
-		_nano_timeout_remove_tcs_from_wait_q(tcs);
-		fiberRtnValueSet(tcs, (unsigned int)0);
+	struct tcs *tcs = t->tcs;
+
+	if (tcs) {
+		if (t->wait_q) {
+			_nano_timeout_remove_tcs_from_wait_q(tcs);
+			fiberRtnValueSet(tcs, (unsigned int)0);
+		}
+		_nano_fiber_ready(tcs);
 	}
-	_nano_fiber_ready(tcs);
 	t->delta_ticks_from_prev = -1;
 
+	if (t->func) {
+		t->func(t);
+	}
+
 	return (struct _nano_timeout *)sys_dlist_peek_head(timeout_q);
 }
 
@@ -84,11 +107,10 @@ static inline void _nano_timeout_handle_timeouts(void)
 	}
 }
 
-/* abort a timeout for a specific fiber */
-static inline void _nano_timeout_abort(struct tcs *tcs)
+/* abort a timeout, nothing happens if it is not active */
+static inline void _do_nano_timeout_abort(struct _nano_timeout *t)
 {
 	sys_dlist_t *timeout_q = &_nanokernel.timeout_q;
-	struct _nano_timeout *t = &tcs->nano_timeout;
 
 	if (-1 == t->delta_ticks_from_prev) {
 		return;
@@ -104,6 +126,12 @@ static inline void _nano_timeout_abort(struct tcs *tcs)
 	t->delta_ticks_from_prev = -1;
 }
 
+/* abort a timeout for a specific fiber */
+static inline void _nano_timeout_abort(struct tcs *tcs)
+{
+	_do_nano_timeout_abort(&tcs->nano_timeout);
+}
+
 /*
  * callback for sys_dlist_insert_at():
  *
@@ -130,19 +158,39 @@ static int _nano_timeout_insert_point_test(sys_dnode_t *test, void *timeout)
 	return 1;
 }
 
-/* put a fiber on the timeout queue and record its wait queue */
-static inline void _nano_timeout_add(struct tcs *tcs,
-				     struct _nano_queue *wait_q,
-				     int32_t timeout)
+/*
+ * put a timeout on the timeout queue, and record the fiber (if any) to ready
+ * and the wait queue (if any) to remove it from when it expires
+ */
+static inline void _do_nano_timeout_add(struct tcs *tcs,
+					struct _nano_timeout *t,
+					struct _nano_queue *wait_q,
+					int32_t timeout)
 {
 	sys_dlist_t *timeout_q = &_nanokernel.timeout_q;
-	struct _nano_timeout *t = &tcs->nano_timeout;
 
+#ifdef CONFIG_TICKLESS_KERNEL
+	timeout += _sys_clock_ticks_pending();
+#endif
+
+	t->tcs = tcs;
 	t->delta_ticks_from_prev = timeout;
 	t->wait_q = wait_q;
 	sys_dlist_insert_at(timeout_q, (void *)t,
 						_nano_timeout_insert_point_test,
 						&t->delta_ticks_from_prev);
+
+#ifdef CONFIG_TICKLESS_KERNEL
+	_sys_clock_deadline_update(timeout);
+#endif
+}
+
+/* put a fiber on the timeout queue and record its wait queue */
+static inline void _nano_timeout_add(struct tcs *tcs,
+				     struct _nano_queue *wait_q,
+				     int32_t timeout)
+{
+	_do_nano_timeout_add(tcs, &tcs->nano_timeout, wait_q, timeout);
 }
 
 /* find the closest deadline in the timeout queue */
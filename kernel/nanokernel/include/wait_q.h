@@ -74,6 +74,21 @@ static inline void _nano_wait_q_put(struct _nano_queue *wait_q)
 	wait_q->tail = _nanokernel.current;
 }
 
+#ifdef CONFIG_NANO_POLL
+extern struct tcs *_nano_poll_signal(struct nano_poll_event *event);
+
+/*
+ * Signal a fiber polling an object that it is ready, when no fiber was waiting
+ * on it. Evaluates to the fiber readied, if any. Call with interrupts locked.
+ */
+#define _NANO_POLL_SIGNAL(obj) \
+	((obj)->poll_event ? _nano_poll_signal((obj)->poll_event) : NULL)
+#define _NANO_POLL_INIT(obj) ((obj)->poll_event = NULL)
+#else
+#define _NANO_POLL_SIGNAL(obj) ((struct tcs *)NULL)
+#define _NANO_POLL_INIT(obj) do { } while ((0))
+#endif
+
 #ifdef CONFIG_NANO_TIMEOUTS
 static inline void _nano_timeout_remove_tcs_from_wait_q(struct tcs *tcs)
 {
@@ -107,8 +122,20 @@ static inline void _nano_timeout_remove_tcs_from_wait_q(struct tcs *tcs)
 				_nano_timeout_add(_nanokernel.current, (pq), (ticks));   \
 			}                                                            \
 		} while (0)
+#ifdef CONFIG_TICKLESS_KERNEL
+	/* only the timer can wake up a task idling until its timeout */
+	#define _NANO_TIMEOUT_SET_TASK_TIMEOUT(ticks)                        \
+		do {                                                             \
+			_nanokernel.task_timeout = (ticks);                          \
+			if ((ticks) != TICKS_UNLIMITED) {                            \
+				_sys_clock_deadline_update((ticks) +                     \
+					_sys_clock_ticks_pending());                         \
+			}                                                            \
+		} while (0)
+#else
 	#define _NANO_TIMEOUT_SET_TASK_TIMEOUT(ticks) \
 		_nanokernel.task_timeout = (ticks)
+#endif
 #else
 	#define _nano_timeout_tcs_init(tcs) do { } while ((0))
 	#define _nano_timeout_abort(tcs) do { } while ((0))
@@ -54,6 +54,7 @@ void nano_fifo_init(struct nano_fifo *fifo)
 	 * that reflects an empty queue to both the data and wait queues.
 	 */
 	_nano_wait_q_init(&fifo->wait_q);
+	_NANO_POLL_INIT(fifo);
 
 	/*
 	 * If the 'stat' field is a positive value, it indicates how many data
@@ -120,6 +121,7 @@ void _fifo_put_non_preemptible(struct nano_fifo *fifo, void *data)
 		fiberRtnValueSet(tcs, (unsigned int)data);
 	} else {
 		enqueue_data(fifo, data);
+		(void)_NANO_POLL_SIGNAL(fifo);
 	}
 
 	irq_unlock(imask);
@@ -143,6 +145,11 @@ void nano_task_fifo_put(struct nano_fifo *fifo, void *data)
 
 	enqueue_data(fifo, data);
 
+	if (_NANO_POLL_SIGNAL(fifo)) {
+		_Swap(imask);
+		return;
+	}
+
 	irq_unlock(imask);
 }
 
@@ -48,6 +48,7 @@ void nano_lifo_init(struct nano_lifo *lifo)
 {
 	lifo->list = (void *) 0;
 	_nano_wait_q_init(&lifo->wait_q);
+	_NANO_POLL_INIT(lifo);
 	DEBUG_TRACING_OBJ_INIT(struct nano_lifo *, lifo, _track_list_nano_lifo);
 }
 
@@ -74,6 +75,7 @@ void _lifo_put_non_preemptible(struct nano_lifo *lifo, void *data)
 	} else {
 		*(void **) data = lifo->list;
 		lifo->list = data;
+		(void)_NANO_POLL_SIGNAL(lifo);
 	}
 
 	irq_unlock(imask);
@@ -96,6 +98,11 @@ void nano_task_lifo_put(struct nano_lifo *lifo, void *data)
 	*(void **) data = lifo->list;
 	lifo->list = data;
 
+	if (_NANO_POLL_SIGNAL(lifo)) {
+		_Swap(imask);
+		return;
+	}
+
 	irq_unlock(imask);
 }
 
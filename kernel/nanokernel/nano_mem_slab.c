@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * @brief Nanokernel memory slab object.
+ *
+ * This module provides the nanokernel memory slab object implementation,
+ * including the following APIs:
+ *
+ * nano_mem_slab_init
+ * nano_fiber_mem_slab_alloc, nano_task_mem_slab_alloc, nano_isr_mem_slab_alloc
+ * nano_fiber_mem_slab_free, nano_task_mem_slab_free, nano_isr_mem_slab_free
+ * nano_mem_slab_alloc, nano_mem_slab_free
+ *
+ * Both allocating and freeing a block take constant time. A freed block is
+ * handed directly to the first fiber waiting for one, if any.
+ */
+
+/**
+ * INTERNAL
+ * In some cases the compiler "alias" attribute is used to map two or more
+ * APIs to the same function, since they have identical implementations.
+ */
+
+#include <nano_private.h>
+#include <toolchain.h>
+#include <sections.h>
+#include <wait_q.h>
+
+void nano_mem_slab_init(struct nano_mem_slab *slab, void *buffer,
+			uint32_t block_size, uint32_t num_blocks)
+{
+	block_size = _NANO_MEM_SLAB_BLOCK_SIZE(block_size);
+
+	_nano_wait_q_init(&slab->wait_q);
+	slab->free_list = NULL;
+	slab->next_unused = buffer;
+	slab->buffer_end = (char *)buffer + block_size * num_blocks;
+	slab->block_size = block_size;
+	slab->num_blocks = num_blocks;
+	slab->num_used = 0;
+	slab->max_used = 0;
+
+	DEBUG_TRACING_OBJ_INIT(struct nano_mem_slab *, slab,
+			       _track_list_nano_mem_slab);
+}
+
+/*
+ * Take a block from the free list, or carve a never used one from the
+ * buffer. Called with interrupts locked.
+ */
+static inline void *block_get(struct nano_mem_slab *slab)
+{
+	char *block = slab->free_list;
+
+	if (block) {
+		slab->free_list = *(char **)block;
+	} else if (slab->next_unused != slab->buffer_end) {
+		block = slab->next_unused;
+		slab->next_unused += slab->block_size;
+	} else {
+		return NULL;
+	}
+
+	if (++slab->num_used > slab->max_used) {
+		slab->max_used = slab->num_used;
+	}
+
+	return block;
+}
+
+/* put a block on the free list, called with interrupts locked */
+static inline void block_put(struct nano_mem_slab *slab, void *block)
+{
+	*(char **)block = slab->free_list;
+	slab->free_list = block;
+	slab->num_used--;
+}
+
+FUNC_ALIAS(_mem_slab_free_non_preemptible, nano_isr_mem_slab_free, void);
+FUNC_ALIAS(_mem_slab_free_non_preemptible, nano_fiber_mem_slab_free, void);
+
+/**
+ * INTERNAL
+ * This function is capable of supporting invocations from both a fiber and an
+ * ISR context.  However, the nano_isr_mem_slab_free and
+ * nano_fiber_mem_slab_free aliases are created to support any required
+ * implementation differences in the future without introducing a source code
+ * migration issue.
+ */
+void _mem_slab_free_non_preemptible(struct nano_mem_slab *slab, void *block)
+{
+	struct tcs *tcs;
+	unsigned int imask;
+
+	imask = irq_lock();
+	tcs = _nano_wait_q_remove(&slab->wait_q);
+	if (tcs) {
+		/* the block stays in use, it changes owner */
+		_nano_timeout_abort(tcs);
+		fiberRtnValueSet(tcs, (unsigned int)block);
+	} else {
+		block_put(slab, block);
+	}
+
+	irq_unlock(imask);
+}
+
+void nano_task_mem_slab_free(struct nano_mem_slab *slab, void *block)
+{
+	struct tcs *tcs;
+	unsigned int imask;
+
+	imask = irq_lock();
+	tcs = _nano_wait_q_remove(&slab->wait_q);
+	if (tcs) {
+		_nano_timeout_abort(tcs);
+		fiberRtnValueSet(tcs, (unsigned int)block);
+		_Swap(imask);
+		return;
+	}
+
+	block_put(slab, block);
+
+	irq_unlock(imask);
+}
+
+void nano_mem_slab_free(struct nano_mem_slab *slab, void *block)
+{
+	static void (*func[3])(struct nano_mem_slab *, void *) = {
+		nano_isr_mem_slab_free,
+		nano_fiber_mem_slab_free,
+		nano_task_mem_slab_free
+	};
+
+	func[sys_execution_context_type_get()](slab, block);
+}
+
+FUNC_ALIAS(_mem_slab_alloc, nano_isr_mem_slab_alloc, void *);
+FUNC_ALIAS(_mem_slab_alloc, nano_fiber_mem_slab_alloc, void *);
+
+void *_mem_slab_alloc(struct nano_mem_slab *slab, int32_t timeout_in_ticks)
+{
+	unsigned int key;
+	void *block;
+
+	key = irq_lock();
+
+	block = block_get(slab);
+	if (likely(block)) {
+		irq_unlock(key);
+		return block;
+	}
+
+	if (timeout_in_ticks != TICKS_NONE) {
+		_NANO_TIMEOUT_ADD(&slab->wait_q, timeout_in_ticks);
+		_nano_wait_q_put(&slab->wait_q);
+		return (void *)_Swap(key);
+	}
+
+	irq_unlock(key);
+	return NULL;
+}
+
+/**
+ * INTERNAL
+ * Since a task cannot pend on a nanokernel object, it polls the
+ * memory slab object.
+ */
+void *nano_task_mem_slab_alloc(struct nano_mem_slab *slab,
+			       int32_t timeout_in_ticks)
+{
+	int64_t cur_ticks;
+	int64_t limit = 0x7fffffffffffffffll;
+	unsigned int key;
+	void *block;
+
+	key = irq_lock();
+	cur_ticks = _NANO_TIMEOUT_TICK_GET();
+	if (timeout_in_ticks != TICKS_UNLIMITED) {
+		limit = cur_ticks + timeout_in_ticks;
+	}
+
+	do {
+		block = block_get(slab);
+		if (likely(block)) {
+			break;
+		}
+
+		if (timeout_in_ticks != TICKS_NONE) {
+
+			_NANO_TIMEOUT_SET_TASK_TIMEOUT(timeout_in_ticks);
+
+			/* see explanation in nano_stack.c:nano_task_stack_pop() */
+			nano_cpu_atomic_idle(key);
+
+			key = irq_lock();
+			cur_ticks = _NANO_TIMEOUT_TICK_GET();
+		}
+	} while (cur_ticks < limit);
+
+	irq_unlock(key);
+	return block;
+}
+
+void *nano_mem_slab_alloc(struct nano_mem_slab *slab, int32_t timeout_in_ticks)
+{
+	static void *(*func[3])(struct nano_mem_slab *, int32_t) = {
+		nano_isr_mem_slab_alloc,
+		nano_fiber_mem_slab_alloc,
+		nano_task_mem_slab_alloc
+	};
+
+	return func[sys_execution_context_type_get()](slab, timeout_in_ticks);
+}
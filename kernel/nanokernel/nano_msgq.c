@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * @brief Nanokernel message queue object.
+ *
+ * This module provides the nanokernel message queue object implementation,
+ * including the following APIs:
+ *
+ * nano_msgq_init
+ * nano_fiber_msgq_put, nano_task_msgq_put, nano_isr_msgq_put
+ * nano_fiber_msgq_get, nano_task_msgq_get, nano_isr_msgq_get
+ * nano_msgq_put, nano_msgq_get
+ *
+ * Messages are copied in and out of a ring buffer owned by the queue, so
+ * that an ISR can pass data to a fiber or a task without allocating a
+ * buffer. Putting messages never waits, which makes it usable from any ISR.
+ */
+
+/**
+ * INTERNAL
+ * In some cases the compiler "alias" attribute is used to map two or more
+ * APIs to the same function, since they have identical implementations.
+ */
+
+#include <nano_private.h>
+#include <toolchain.h>
+#include <sections.h>
+#include <wait_q.h>
+#include <string.h>
+#include <misc/util.h>
+
+void nano_msgq_init(struct nano_msgq *msgq, void *buffer,
+		    uint32_t msg_size, uint32_t max_msgs)
+{
+	_nano_wait_q_init(&msgq->wait_q);
+	msgq->buffer_start = buffer;
+	msgq->buffer_end = (char *)buffer + msg_size * max_msgs;
+	msgq->read_ptr = buffer;
+	msgq->write_ptr = buffer;
+	msgq->msg_size = msg_size;
+	msgq->max_msgs = max_msgs;
+	msgq->num_used = 0;
+
+	DEBUG_TRACING_OBJ_INIT(struct nano_msgq *, msgq, _track_list_nano_msgq);
+}
+
+/*
+ * Copy messages in the ring buffer, as many as there is room for. The copy
+ * wraps around the end of the buffer at most once. Called with interrupts
+ * locked.
+ */
+static inline int ring_put(struct nano_msgq *msgq, const char *data,
+			   int num_msgs)
+{
+	uint32_t bytes;
+	uint32_t first;
+
+	if (num_msgs > (int)(msgq->max_msgs - msgq->num_used)) {
+		num_msgs = msgq->max_msgs - msgq->num_used;
+	}
+
+	bytes = num_msgs * msgq->msg_size;
+	first = min(bytes, (uint32_t)(msgq->buffer_end - msgq->write_ptr));
+
+	memcpy(msgq->write_ptr, data, first);
+	memcpy(msgq->buffer_start, data + first, bytes - first);
+
+	msgq->write_ptr += bytes;
+	if (msgq->write_ptr >= msgq->buffer_end) {
+		msgq->write_ptr -= msgq->buffer_end - msgq->buffer_start;
+	}
+	msgq->num_used += num_msgs;
+
+	return num_msgs;
+}
+
+/*
+ * Copy messages out of the ring buffer, as many as available. Called with
+ * interrupts locked.
+ */
+static inline int ring_get(struct nano_msgq *msgq, char *data, int max_msgs)
+{
+	uint32_t bytes;
+	uint32_t first;
+
+	if (max_msgs > (int)msgq->num_used) {
+		max_msgs = msgq->num_used;
+	}
+
+	bytes = max_msgs * msgq->msg_size;
+	first = min(bytes, (uint32_t)(msgq->buffer_end - msgq->read_ptr));
+
+	memcpy(data, msgq->read_ptr, first);
+	memcpy(data + first, msgq->buffer_start, bytes - first);
+
+	msgq->read_ptr += bytes;
+	if (msgq->read_ptr >= msgq->buffer_end) {
+		msgq->read_ptr -= msgq->buffer_end - msgq->buffer_start;
+	}
+	msgq->num_used -= max_msgs;
+
+	return max_msgs;
+}
+
+/*
+ * Make ready one waiting fiber per message put. Evaluates to whether any
+ * fiber was made ready. Called with interrupts locked.
+ */
+static inline int waiters_wake(struct nano_msgq *msgq, int num_msgs)
+{
+	struct tcs *tcs;
+	int woken = 0;
+
+	while (num_msgs-- > 0) {
+		tcs = _nano_wait_q_remove(&msgq->wait_q);
+		if (!tcs) {
+			break;
+		}
+		_nano_timeout_abort(tcs);
+		fiberRtnValueSet(tcs, 1);
+		woken = 1;
+	}
+
+	return woken;
+}
+
+FUNC_ALIAS(_msgq_put_non_preemptible, nano_isr_msgq_put, int);
+FUNC_ALIAS(_msgq_put_non_preemptible, nano_fiber_msgq_put, int);
+
+/**
+ * INTERNAL
+ * This function is capable of supporting invocations from both a fiber and an
+ * ISR context.  However, the nano_isr_msgq_put and nano_fiber_msgq_put
+ * aliases are created to support any required implementation differences in
+ * the future without introducing a source code migration issue.
+ */
+int _msgq_put_non_preemptible(struct nano_msgq *msgq, const void *data,
+			      int num_msgs)
+{
+	unsigned int imask;
+
+	imask = irq_lock();
+
+	num_msgs = ring_put(msgq, data, num_msgs);
+	waiters_wake(msgq, num_msgs);
+
+	irq_unlock(imask);
+
+	return num_msgs;
+}
+
+int nano_task_msgq_put(struct nano_msgq *msgq, const void *data, int num_msgs)
+{
+	unsigned int imask;
+
+	imask = irq_lock();
+
+	num_msgs = ring_put(msgq, data, num_msgs);
+	if (waiters_wake(msgq, num_msgs)) {
+		_Swap(imask);
+		return num_msgs;
+	}
+
+	irq_unlock(imask);
+
+	return num_msgs;
+}
+
+int nano_msgq_put(struct nano_msgq *msgq, const void *data, int num_msgs)
+{
+	static int (*func[3])(struct nano_msgq *, const void *, int) = {
+		nano_isr_msgq_put,
+		nano_fiber_msgq_put,
+		nano_task_msgq_put
+	};
+
+	return func[sys_execution_context_type_get()](msgq, data, num_msgs);
+}
+
+FUNC_ALIAS(_msgq_get, nano_isr_msgq_get, int);
+FUNC_ALIAS(_msgq_get, nano_fiber_msgq_get, int);
+
+/**
+ * INTERNAL
+ * A fiber woken up by a put is not handed the messages directly: another
+ * fiber or an ISR can get them before it runs, in which case it waits again
+ * for the rest of its timeout.
+ */
+int _msgq_get(struct nano_msgq *msgq, void *data, int max_msgs,
+	      int32_t timeout_in_ticks)
+{
+	int64_t limit = _NANO_TIMEOUT_TICK_GET() + timeout_in_ticks;
+	unsigned int key;
+	int num_msgs;
+
+	key = irq_lock();
+
+	while (!(num_msgs = ring_get(msgq, data, max_msgs)) &&
+	       timeout_in_ticks != TICKS_NONE) {
+
+		_NANO_TIMEOUT_ADD(&msgq->wait_q, timeout_in_ticks);
+		_nano_wait_q_put(&msgq->wait_q);
+		if (!_Swap(key)) {
+			/* timed out */
+			return 0;
+		}
+
+		key = irq_lock();
+
+		if (timeout_in_ticks != TICKS_UNLIMITED) {
+			int64_t remaining = limit - _NANO_TIMEOUT_TICK_GET();
+
+			timeout_in_ticks = (remaining > 0) ?
+				(int32_t)remaining : TICKS_NONE;
+		}
+	}
+
+	irq_unlock(key);
+	return num_msgs;
+}
+
+/**
+ * INTERNAL
+ * Since a task cannot pend on a nanokernel object, it polls the
+ * message queue object.
+ */
+int nano_task_msgq_get(struct nano_msgq *msgq, void *data, int max_msgs,
+		       int32_t timeout_in_ticks)
+{
+	int64_t cur_ticks;
+	int64_t limit = 0x7fffffffffffffffll;
+	unsigned int key;
+	int num_msgs;
+
+	key = irq_lock();
+	cur_ticks = _NANO_TIMEOUT_TICK_GET();
+	if (timeout_in_ticks != TICKS_UNLIMITED) {
+		limit = cur_ticks + timeout_in_ticks;
+	}
+
+	do {
+		num_msgs = ring_get(msgq, data, max_msgs);
+		if (likely(num_msgs)) {
+			break;
+		}
+
+		if (timeout_in_ticks != TICKS_NONE) {
+
+			_NANO_TIMEOUT_SET_TASK_TIMEOUT(timeout_in_ticks);
+
+			/* see explanation in nano_stack.c:nano_task_stack_pop() */
+			nano_cpu_atomic_idle(key);
+
+			key = irq_lock();
+			cur_ticks = _NANO_TIMEOUT_TICK_GET();
+		}
+	} while (cur_ticks < limit);
+
+	irq_unlock(key);
+	return num_msgs;
+}
+
+int nano_msgq_get(struct nano_msgq *msgq, void *data, int max_msgs,
+		  int32_t timeout_in_ticks)
+{
+	static int (*func[3])(struct nano_msgq *, void *, int, int32_t) = {
+		nano_isr_msgq_get,
+		nano_fiber_msgq_get,
+		nano_task_msgq_get
+	};
+
+	return func[sys_execution_context_type_get()](msgq, data, max_msgs,
+						      timeout_in_ticks);
+}
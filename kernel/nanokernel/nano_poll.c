@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * @brief Nanokernel polling
+ *
+ * This module provides waiting on several nanokernel objects at once,
+ * including the following APIs:
+ *
+ * nano_isr_poll, nano_fiber_poll, nano_task_poll
+ * nano_poll
+ *
+ * A polling fiber registers its poll events with the objects, which signal
+ * it when they become ready while no fiber is waiting on them directly.
+ */
+
+/**
+ * INTERNAL
+ * In some cases the compiler "alias" attribute is used to map two or more
+ * APIs to the same function, since they have identical implementations.
+ */
+
+#include <nano_private.h>
+#include <toolchain.h>
+#include <sections.h>
+#include <wait_q.h>
+#include <errno.h>
+
+/* the fiber a set of registered poll events belongs to */
+struct _nano_poller {
+	/* NULL once the fiber has been readied */
+	struct tcs *tcs;
+	struct _nano_timeout timeout;
+};
+
+static inline struct nano_poll_event **poll_event_slot(
+	struct nano_poll_event *event)
+{
+	switch (event->type) {
+	case NANO_POLL_TYPE_FIFO:
+		return &event->fifo->poll_event;
+	case NANO_POLL_TYPE_LIFO:
+		return &event->lifo->poll_event;
+	case NANO_POLL_TYPE_SEM:
+		return &event->sem->poll_event;
+	case NANO_POLL_TYPE_TIMER:
+		return &event->timer->lifo.poll_event;
+	default:
+		return NULL;
+	}
+}
+
+static inline int is_ready(struct nano_poll_event *event)
+{
+	switch (event->type) {
+	case NANO_POLL_TYPE_FIFO:
+		return event->fifo->stat > 0;
+	case NANO_POLL_TYPE_LIFO:
+		return event->lifo->list != NULL;
+	case NANO_POLL_TYPE_SEM:
+		return event->sem->nsig > 0;
+	case NANO_POLL_TYPE_TIMER:
+		return event->timer->lifo.list != NULL;
+	default:
+		return 0;
+	}
+}
+
+/* update the state of all events, returns the number of ready ones */
+static int update_states(struct nano_poll_event *events, int num_events)
+{
+	int num_ready = 0;
+	int i;
+
+	for (i = 0; i < num_events; i++) {
+		if (is_ready(&events[i])) {
+			events[i].state = NANO_POLL_STATE_READY;
+			num_ready++;
+		} else {
+			events[i].state = NANO_POLL_STATE_NOT_READY;
+		}
+	}
+
+	return num_ready;
+}
+
+static void unregister_events(struct nano_poll_event *events, int num_events)
+{
+	int i;
+
+	for (i = 0; i < num_events; i++) {
+		*poll_event_slot(&events[i]) = NULL;
+		events[i].poller = NULL;
+	}
+}
+
+static int register_events(struct nano_poll_event *events, int num_events,
+			   struct _nano_poller *poller)
+{
+	int i;
+
+	for (i = 0; i < num_events; i++) {
+		struct nano_poll_event **slot = poll_event_slot(&events[i]);
+
+		if (*slot) {
+			unregister_events(events, i);
+			return -EADDRINUSE;
+		}
+
+		*slot = &events[i];
+		events[i].poller = poller;
+	}
+
+	return 0;
+}
+
+/*
+ * The timeout readies the fiber, the objects must not ready it again if they
+ * become ready before it runs. Called with interrupts locked.
+ */
+static void poll_timeout(struct _nano_timeout *t)
+{
+	struct _nano_poller *poller = CONTAINER_OF(t, struct _nano_poller,
+						   timeout);
+
+	poller->tcs = NULL;
+}
+
+/*
+ * INTERNAL
+ * Called by the objects with interrupts locked, when they become ready and no
+ * fiber is waiting on them.
+ */
+struct tcs *_nano_poll_signal(struct nano_poll_event *event)
+{
+	struct tcs *tcs = event->poller->tcs;
+
+	event->state = NANO_POLL_STATE_READY;
+
+	/* several objects can signal before the fiber gets to run */
+	if (!tcs) {
+		return NULL;
+	}
+
+	event->poller->tcs = NULL;
+	_do_nano_timeout_abort(&event->poller->timeout);
+	_nano_fiber_ready(tcs);
+
+	return tcs;
+}
+
+FUNC_ALIAS(_poll, nano_isr_poll, int);
+FUNC_ALIAS(_poll, nano_fiber_poll, int);
+
+int _poll(struct nano_poll_event *events, int num_events,
+	  int32_t timeout_in_ticks)
+{
+	struct _nano_poller poller;
+	unsigned int key;
+	int ret;
+
+	key = irq_lock();
+
+	ret = update_states(events, num_events);
+	if (ret || timeout_in_ticks == TICKS_NONE) {
+		irq_unlock(key);
+		return ret;
+	}
+
+	poller.tcs = _nanokernel.current;
+	_nano_timeout_init(&poller.timeout, poll_timeout);
+
+	ret = register_events(events, num_events, &poller);
+	if (ret) {
+		irq_unlock(key);
+		return ret;
+	}
+
+	if (timeout_in_ticks != TICKS_UNLIMITED) {
+		_do_nano_timeout_add(_nanokernel.current, &poller.timeout, NULL,
+				     timeout_in_ticks);
+	}
+
+	_Swap(key);
+
+	/* woken up by an object or by the timeout */
+	key = irq_lock();
+
+	unregister_events(events, num_events);
+	ret = update_states(events, num_events);
+
+	irq_unlock(key);
+
+	return ret;
+}
+
+/**
+ * INTERNAL
+ * Since a task cannot pend on a nanokernel object, it checks the objects
+ * every time it is woken up.
+ */
+int nano_task_poll(struct nano_poll_event *events, int num_events,
+		   int32_t timeout_in_ticks)
+{
+	int64_t cur_ticks;
+	int64_t limit = 0x7fffffffffffffffll;
+	unsigned int key;
+	int ret;
+
+	key = irq_lock();
+	cur_ticks = _NANO_TIMEOUT_TICK_GET();
+	if (timeout_in_ticks != TICKS_UNLIMITED) {
+		limit = cur_ticks + timeout_in_ticks;
+	}
+
+	do {
+		ret = update_states(events, num_events);
+		if (ret) {
+			break;
+		}
+
+		if (timeout_in_ticks != TICKS_NONE) {
+
+			_NANO_TIMEOUT_SET_TASK_TIMEOUT(timeout_in_ticks);
+
+			/* see explanation in nano_stack.c:nano_task_stack_pop() */
+			nano_cpu_atomic_idle(key);
+
+			key = irq_lock();
+			cur_ticks = _NANO_TIMEOUT_TICK_GET();
+		}
+	} while (cur_ticks < limit);
+
+	irq_unlock(key);
+
+	return ret;
+}
+
+int nano_poll(struct nano_poll_event *events, int num_events,
+	      int32_t timeout_in_ticks)
+{
+	static int (*func[3])(struct nano_poll_event *, int, int32_t) = {
+		nano_isr_poll,
+		nano_fiber_poll,
+		nano_task_poll
+	};
+
+	return func[sys_execution_context_type_get()](events, num_events,
+						      timeout_in_ticks);
+}
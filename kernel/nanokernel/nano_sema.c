@@ -55,6 +55,7 @@ void nano_sem_init(struct nano_sem *sem)
 {
 	sem->nsig = 0;
 	_nano_wait_q_init(&sem->wait_q);
+	_NANO_POLL_INIT(sem);
 	DEBUG_TRACING_OBJ_INIT(struct nano_sem *, sem, _track_list_nano_sem);
 }
 
@@ -83,6 +84,7 @@ void _sem_give_non_preemptible(struct nano_sem *sem)
 	tcs = _nano_wait_q_remove(&sem->wait_q);
 	if (!tcs) {
 		sem->nsig++;
+		(void)_NANO_POLL_SIGNAL(sem);
 	} else {
 		_nano_timeout_abort(tcs);
 		set_sem_available(tcs);
@@ -107,6 +109,11 @@ void nano_task_sem_give(struct nano_sem *sem)
 
 	sem->nsig++;
 
+	if (_NANO_POLL_SIGNAL(sem)) {
+		_Swap(imask);
+		return;
+	}
+
 	irq_unlock(imask);
 }
 
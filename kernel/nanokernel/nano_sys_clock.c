@@ -47,6 +47,89 @@ int32_t _sys_idle_elapsed_ticks = 1;
 
 int64_t _sys_clock_tick_count;
 
+#ifdef CONFIG_TICKLESS_KERNEL
+extern int32_t _sys_idle_elapsed_ticks;
+
+/*
+ * Deadline the timer is programmed for, in ticks after the last tick
+ * processed by the kernel. It is only meaningful until the kernel processes
+ * ticks again, which always ends with a call to _sys_clock_deadline_set().
+ */
+static int32_t programmed_deadline = TICKS_UNLIMITED;
+
+/**
+ *
+ * @brief Return the number of ticks elapsed but not processed by the kernel
+ *
+ * These are the ticks announced by the timer driver but not yet processed
+ * plus the complete ticks the timer hardware counted since its last
+ * announcement. A timeout starting now must add them to its tick count.
+ *
+ * Called with interrupts locked.
+ *
+ * @return number of pending ticks
+ */
+int32_t _sys_clock_ticks_pending(void)
+{
+	return _sys_idle_elapsed_ticks + _timer_ticks_elapsed();
+}
+
+static void deadline_program(int32_t ticks)
+{
+	programmed_deadline = ticks;
+
+	if (ticks == TICKS_UNLIMITED) {
+		_timer_deadline_set(TICKS_UNLIMITED);
+	} else {
+		/* the timer counts from the last tick it announced */
+		_timer_deadline_set(ticks - _sys_idle_elapsed_ticks);
+	}
+}
+
+/**
+ *
+ * @brief Program the timer for the next kernel deadline
+ *
+ * Called by the kernel after it has processed the elapsed ticks.
+ *
+ * @param ticks ticks after the last processed tick, TICKS_UNLIMITED if none
+ *
+ * @return N/A
+ */
+void _sys_clock_deadline_set(int32_t ticks)
+{
+	unsigned int key = irq_lock();
+
+	deadline_program(ticks);
+	irq_unlock(key);
+}
+
+/**
+ *
+ * @brief Bring the timer deadline forward if needed
+ *
+ * Called when a timeout is added between two tick processings. The timer
+ * is only reprogrammed if the new deadline comes first.
+ *
+ * @param ticks ticks after the last processed tick
+ *
+ * @return N/A
+ */
+void _sys_clock_deadline_update(int32_t ticks)
+{
+	unsigned int key = irq_lock();
+
+	if ((uint32_t)ticks < (uint32_t)programmed_deadline) {
+		deadline_program(ticks);
+	}
+	irq_unlock(key);
+}
+
+#define TICKS_PENDING() _sys_clock_ticks_pending()
+#else
+#define TICKS_PENDING() 0
+#endif /* CONFIG_TICKLESS_KERNEL */
+
 /**
  *
  * @brief Return the lower part of the current system tick count
@@ -56,7 +139,11 @@ int64_t _sys_clock_tick_count;
  */
 uint32_t sys_tick_get_32(void)
 {
+#ifdef CONFIG_TICKLESS_KERNEL
+	return (uint32_t)sys_tick_get();
+#else
 	return (uint32_t)_sys_clock_tick_count;
+#endif
 }
 
 /**
@@ -77,7 +164,7 @@ int64_t sys_tick_get(void)
 	 */
 	unsigned int imask = irq_lock();
 
-	tmp_sys_clock_tick_count = _sys_clock_tick_count;
+	tmp_sys_clock_tick_count = _sys_clock_tick_count + TICKS_PENDING();
 	irq_unlock(imask);
 	return tmp_sys_clock_tick_count;
 }
@@ -123,7 +210,7 @@ static ALWAYS_INLINE int64_t _nano_tick_delta(int64_t *reftime)
 	 */
 	unsigned int imask = irq_lock();
 
-	saved = _sys_clock_tick_count;
+	saved = _sys_clock_tick_count + TICKS_PENDING();
 	irq_unlock(imask);
 	delta = saved - (*reftime);
 	*reftime = saved;
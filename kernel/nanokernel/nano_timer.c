@@ -17,6 +17,7 @@
  */
 
 #include <nano_private.h>
+#include <drivers/system_timer.h>
 
 struct nano_timer *_nano_timer_list;
 
@@ -53,10 +54,15 @@ void _timer_start(struct nano_timer *timer, /* timer to start */
 	struct nano_timer *cur;
 	struct nano_timer *prev = NULL;
 
-	timer->ticks = ticks;
-
 	imask = irq_lock();
 
+#ifdef CONFIG_TICKLESS_KERNEL
+	ticks += _sys_clock_ticks_pending();
+	_sys_clock_deadline_update(ticks);
+#endif
+
+	timer->ticks = ticks;
+
 	cur = _nano_timer_list;
 
 	while (cur && (timer->ticks > cur->ticks)) {
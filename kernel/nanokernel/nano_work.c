@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ *
+ * Workqueue support functions
+ */
+
+#include <nano_private.h>
+#include <wait_q.h>
+#include <errno.h>
+#include <init.h>
+#include <misc/nano_work.h>
+
+static void workqueue_fiber_main(int arg1, int unused)
+{
+	struct nano_workqueue *wq = (struct nano_workqueue *)arg1;
+
+	ARG_UNUSED(unused);
+
+	while (1) {
+		struct nano_work *work;
+		work_handler_t handler;
+
+		work = nano_fiber_fifo_get(&wq->fifo, TICKS_UNLIMITED);
+
+		handler = work->handler;
+
+		/* Reset pending state so it can be resubmitted by handler */
+		if (atomic_test_and_clear_bit(work->flags,
+					      NANO_WORK_STATE_PENDING)) {
+			handler(work);
+		}
+
+		/*
+		 * Make sure we don't hog up CPU if the FIFO never (or very
+		 * rarely) gets empty.
+		 */
+		fiber_yield();
+	}
+}
+
+void fiber_workqueue_start(struct nano_workqueue *wq, char *stack,
+			   unsigned stack_size, unsigned prio)
+{
+	nano_fifo_init(&wq->fifo);
+
+	fiber_start(stack, stack_size, workqueue_fiber_main, (int)wq, 0, prio,
+		    0);
+}
+
+/*
+ * Unlink a work item from the data queue of the workqueue FIFO. Returns 0 if
+ * it is not there, which for a pending item means it has been handed over to
+ * the workqueue fiber already. Called with interrupts locked.
+ */
+static int work_unlink(struct nano_workqueue *wq, struct nano_work *work)
+{
+	struct nano_fifo *fifo = &wq->fifo;
+	void **link = &fifo->data_q.head;
+	int count;
+
+	for (count = fifo->stat; count > 0; count--) {
+		if (*link == work) {
+			*link = work->_reserved;
+
+			if (fifo->data_q.tail == work) {
+				fifo->data_q.tail = link;
+			}
+
+			if (--fifo->stat == 0) {
+				_nano_wait_q_reset(&fifo->data_q);
+			}
+
+			return 1;
+		}
+
+		link = *link;
+	}
+
+	return 0;
+}
+
+static void work_timeout(struct _nano_timeout *t)
+{
+	struct nano_delayed_work *w = CONTAINER_OF(t, struct nano_delayed_work,
+						   timeout);
+
+	/* submit work to workqueue */
+	nano_work_submit_to_queue(w->wq, &w->work);
+}
+
+void nano_delayed_work_init(struct nano_delayed_work *work,
+			    work_handler_t handler)
+{
+	nano_work_init(&work->work, handler);
+	_nano_timeout_init(&work->timeout, work_timeout);
+	work->wq = NULL;
+}
+
+int nano_delayed_work_submit_to_queue(struct nano_workqueue *wq,
+				      struct nano_delayed_work *work,
+				      int ticks)
+{
+	int key = irq_lock();
+	int err;
+
+	/* Work cannot be active in multiple queues */
+	if (work->wq && work->wq != wq) {
+		err = -EADDRINUSE;
+		goto done;
+	}
+
+	/* Cancel if work has been submitted, unless it is being processed */
+	if (work->wq == wq &&
+	    nano_delayed_work_cancel(work) == -EINPROGRESS) {
+		err = -EINPROGRESS;
+		goto done;
+	}
+
+	/* Attach workqueue so the timeout callback can submit it */
+	work->wq = wq;
+
+	if (!ticks) {
+		/* Submit work if no ticks is 0 */
+		nano_work_submit_to_queue(wq, &work->work);
+	} else {
+		/* Add timeout */
+		_do_nano_timeout_add(NULL, &work->timeout, NULL, ticks);
+	}
+
+	err = 0;
+
+done:
+	irq_unlock(key);
+
+	return err;
+}
+
+int nano_delayed_work_cancel(struct nano_delayed_work *work)
+{
+	int key = irq_lock();
+	int err = 0;
+
+	if (!work->wq) {
+		err = -EINVAL;
+	} else if (work->timeout.delta_ticks_from_prev != -1) {
+		_do_nano_timeout_abort(&work->timeout);
+	} else if (!nano_work_pending(&work->work)) {
+		/* Timeout expired and work has been processed already */
+		err = -EINVAL;
+	} else if (work_unlink(work->wq, &work->work)) {
+		atomic_clear_bit(work->work.flags, NANO_WORK_STATE_PENDING);
+	} else {
+		/* The workqueue fiber is about to process it */
+		err = -EINPROGRESS;
+	}
+
+	if (err != -EINPROGRESS) {
+		/* Detach from workqueue */
+		work->wq = NULL;
+	}
+
+	irq_unlock(key);
+
+	return err;
+}
+
+#ifdef CONFIG_SYSTEM_WORKQUEUE
+
+static char __stack sys_wq_stack[CONFIG_SYSTEM_WORKQUEUE_STACK_SIZE];
+
+struct nano_workqueue sys_workqueue;
+
+static int sys_workqueue_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	fiber_workqueue_start(&sys_workqueue, sys_wq_stack,
+			      sizeof(sys_wq_stack),
+			      CONFIG_SYSTEM_WORKQUEUE_PRIORITY);
+
+	return 0;
+}
+
+SYS_INIT(sys_workqueue_init, NANOKERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+
+#endif /* CONFIG_SYSTEM_WORKQUEUE */
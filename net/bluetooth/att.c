@@ -1733,6 +1733,8 @@ void bt_att_init(void)
 	net_buf_pool_init(att_pool);
 
 	bt_l2cap_fixed_chan_register(&chan);
+
+	bt_gatt_init();
 }
 
 uint16_t bt_att_get_mtu(struct bt_conn *conn)
@@ -19,6 +19,7 @@
 #include <nanokernel.h>
 #include <arch/cpu.h>
 #include <toolchain.h>
+#include <sections.h>
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
@@ -32,6 +33,7 @@
 #include <bluetooth/conn.h>
 #include <bluetooth/driver.h>
 
+#include "stack.h"
 #include "hci_core.h"
 #include "conn_internal.h"
 #include "l2cap_internal.h"
@@ -44,13 +46,28 @@
 #define BT_DBG(fmt, ...)
 #endif
 
-/* Pool for outgoing ACL fragments */
+/* Pool for outgoing ACL fragments which are copied from the original
+ * buffer.
+ */
+#define FRAG_SIZE	BT_L2CAP_BUF_SIZE(23)
+#define FRAG_RESERVE	(sizeof(struct bt_hci_acl_hdr) + \
+			 CONFIG_BLUETOOTH_HCI_SEND_RESERVE)
+#define FRAG_MTU	(FRAG_SIZE - FRAG_RESERVE)
+
 static struct nano_fifo frag_buf;
-static NET_BUF_POOL(frag_pool, 1, BT_L2CAP_BUF_SIZE(23), &frag_buf, NULL, 0);
+static NET_BUF_POOL(frag_pool, CONFIG_BLUETOOTH_CONN_FRAG_COUNT, FRAG_SIZE,
+		    &frag_buf, NULL, 0);
+
+/* Pool for outgoing ACL fragments which point into the original buffer.
+ * The user data holds a reference to the original buffer.
+ */
+#define frag_parent(buf) (*(struct net_buf **)net_buf_user_data(buf))
 
-/* Pool for dummy buffers to wake up the tx fibers */
-static struct nano_fifo dummy;
-static NET_BUF_POOL(dummy_pool, CONFIG_BLUETOOTH_MAX_CONN, 0, &dummy, NULL, 0);
+static void frag_view_destroy(struct net_buf *buf);
+
+static struct nano_fifo frag_view_buf;
+static NET_BUF_POOL(frag_view_pool, CONFIG_BLUETOOTH_CONN_FRAG_COUNT, 0,
+		    &frag_view_buf, frag_view_destroy, sizeof(struct net_buf *));
 
 /* How long until we cancel HCI_LE_Create_Connection */
 #define CONN_TIMEOUT	(3 * sys_clock_ticks_per_sec)
@@ -62,6 +79,64 @@ const struct bt_conn_auth_cb *bt_auth;
 static struct bt_conn conns[CONFIG_BLUETOOTH_MAX_CONN];
 static struct bt_conn_cb *callback_list;
 
+/* Connection indexes, by HCI handle for connections in CONNECTED or
+ * DISCONNECT state and by peer address for LE connections. The buckets
+ * are chains of conns[] indexes. Lookups check every candidate, so the
+ * chains only need to be modified with interrupts locked.
+ */
+#define CONN_HASH_SIZE	(2 * CONFIG_BLUETOOTH_MAX_CONN)
+#define CONN_NONE	0xff
+
+static uint8_t conn_hash[CONN_HASH_COUNT][CONN_HASH_SIZE] = {
+	[0 ... (CONN_HASH_COUNT - 1)] = {
+		[0 ... (CONN_HASH_SIZE - 1)] = CONN_NONE,
+	},
+};
+
+static inline uint8_t handle_key(uint16_t handle)
+{
+	return handle % CONN_HASH_SIZE;
+}
+
+static uint8_t addr_key(const bt_addr_le_t *addr)
+{
+	uint32_t hash = addr->type;
+	int i;
+
+	for (i = 0; i < sizeof(addr->val); i++) {
+		hash = hash * 31 + addr->val[i];
+	}
+
+	return hash % CONN_HASH_SIZE;
+}
+
+/* Must be called with interrupts locked */
+static void conn_hash_add(int hash, uint8_t key, struct bt_conn *conn)
+{
+	conn->hash_next[hash] = conn_hash[hash][key];
+	conn_hash[hash][key] = conn - conns;
+}
+
+/* Must be called with interrupts locked */
+static void conn_hash_del(int hash, uint8_t key, struct bt_conn *conn)
+{
+	uint8_t *next = &conn_hash[hash][key];
+
+	while (*next != CONN_NONE) {
+		if (&conns[*next] == conn) {
+			*next = conn->hash_next[hash];
+			return;
+		}
+
+		next = &conns[*next].hash_next[hash];
+	}
+}
+
+/* ACL scheduler shared by all connections */
+static BT_STACK_NOINIT(tx_fiber_stack, CONFIG_BLUETOOTH_CONN_TX_STACK_SIZE);
+static struct nano_sem tx_sem;
+static uint8_t tx_next;
+
 #if defined(CONFIG_BLUETOOTH_DEBUG_CONN)
 static const char *state2str(bt_conn_state_t state)
 {
@@ -123,6 +198,17 @@ uint8_t bt_conn_enc_key_size(struct bt_conn *conn)
 	return conn->keys ? conn->keys->enc_size : 0;
 }
 
+void bt_conn_set_dst_le(struct bt_conn *conn, const bt_addr_le_t *dst)
+{
+	unsigned int key;
+
+	key = irq_lock();
+	conn_hash_del(CONN_HASH_ADDR, addr_key(&conn->le.dst), conn);
+	bt_addr_le_copy(&conn->le.dst, dst);
+	conn_hash_add(CONN_HASH_ADDR, addr_key(&conn->le.dst), conn);
+	irq_unlock(key);
+}
+
 void bt_conn_identity_resolved(struct bt_conn *conn)
 {
 	const bt_addr_le_t *rpa;
@@ -360,9 +446,10 @@ void bt_conn_recv(struct bt_conn *conn, struct net_buf *buf, uint8_t flags)
 	bt_l2cap_recv(conn, buf);
 }
 
-void bt_conn_send(struct bt_conn *conn, struct net_buf *buf)
+void bt_conn_send(struct bt_conn *conn, struct net_buf *buf, uint8_t prio)
 {
-	BT_DBG("conn handle %u buf len %u", conn->handle, buf->len);
+	BT_DBG("conn handle %u buf len %u prio %u", conn->handle, buf->len,
+	       prio);
 
 	if (conn->state != BT_CONN_CONNECTED) {
 		BT_ERR("not connected!");
@@ -370,9 +457,16 @@ void bt_conn_send(struct bt_conn *conn, struct net_buf *buf)
 		return;
 	}
 
-	nano_fifo_put(&conn->tx_queue, buf);
+	nano_fifo_put(&conn->tx_queue[prio], buf);
+	nano_sem_give(&tx_sem);
+}
+
+void bt_conn_tx_notify(void)
+{
+	nano_sem_give(&tx_sem);
 }
 
+/* The caller has already taken a controller buffer for the fragment */
 static bool send_frag(struct bt_conn *conn, struct net_buf *buf, uint8_t flags,
 		      bool always_consume)
 {
@@ -382,10 +476,7 @@ static bool send_frag(struct bt_conn *conn, struct net_buf *buf, uint8_t flags,
 	BT_DBG("conn %p buf %p len %u flags 0x%02x", conn, buf, buf->len,
 	       flags);
 
-	/* Wait until the controller can accept ACL packets */
-	nano_fiber_sem_take(bt_conn_get_pkts(conn), TICKS_UNLIMITED);
-
-	/* Check for disconnection while waiting for pkts_sem */
+	/* Check for disconnection while waiting for a fragment buffer */
 	if (conn->state != BT_CONN_CONNECTED) {
 		goto fail;
 	}
@@ -423,103 +514,245 @@ static inline uint16_t conn_mtu(struct bt_conn *conn)
 	return bt_dev.le.mtu;
 }
 
-static struct net_buf *create_frag(struct bt_conn *conn, struct net_buf *buf)
+static void frag_view_destroy(struct net_buf *buf)
+{
+	struct net_buf *parent = frag_parent(buf);
+
+	nano_fifo_put(buf->free, buf);
+	net_buf_unref(parent);
+}
+
+static struct net_buf *create_frag(struct bt_conn *conn, struct net_buf *buf,
+				   uint16_t len, bool view)
 {
 	struct net_buf *frag;
-	uint16_t frag_len;
 
-	frag = bt_conn_create_pdu(&frag_buf, 0);
+	if (view) {
+		frag = net_buf_get(&frag_view_buf, 0);
+		frag_parent(frag) = net_buf_ref(buf);
+	} else {
+		frag = bt_conn_create_pdu(&frag_buf, 0);
+	}
 
 	if (conn->state != BT_CONN_CONNECTED) {
 		net_buf_unref(frag);
 		return NULL;
 	}
 
-	frag_len = min(conn_mtu(conn), net_buf_tailroom(frag));
+	if (view) {
+		frag->data = buf->data;
+		frag->len = len;
+	} else {
+		memcpy(net_buf_add(frag, len), buf->data, len);
+	}
 
-	memcpy(net_buf_add(frag, frag_len), buf->data, frag_len);
-	net_buf_pull(buf, frag_len);
+	net_buf_pull(buf, len);
 
 	return frag;
 }
 
-static bool send_buf(struct bt_conn *conn, struct net_buf *buf)
+/* Send the next fragment of the PDU in progress on the connection */
+static void send_next_frag(struct bt_conn *conn)
 {
+	struct net_buf *buf = conn->tx;
+	uint16_t mtu = conn_mtu(conn);
+	uint16_t frag_len = min(mtu, FRAG_MTU);
+	uint8_t flags = conn->tx_flags;
 	struct net_buf *frag;
+	int remaining;
 
 	BT_DBG("conn %p buf %p len %u", conn, buf, buf->len);
 
-	/* Send directly if the packet fits the ACL MTU */
-	if (buf->len <= conn_mtu(conn)) {
-		return send_frag(conn, buf, BT_ACL_START_NO_FLUSH, false);
+	conn->tx_flags = BT_ACL_CONT;
+
+	/* The last fragment is the original buffer (which works since we
+	 * use net_buf_pull on it).
+	 */
+	if (buf->len <= mtu) {
+		conn->tx = NULL;
+
+		if (!send_frag(conn, buf, flags, false)) {
+			net_buf_unref(buf);
+		}
+
+		return;
 	}
 
-	/* Create & enqueue first fragment */
-	frag = create_frag(conn, buf);
+	/*
+	 * The other fragments are alternately copied and sent as views
+	 * into the original buffer, counting from the end: the ACL header
+	 * of a view (and of the original buffer) is pushed over the tail
+	 * of the fragment before it, so that one must be a copy, or over
+	 * the original headroom for the first fragment. This way no
+	 * fragment data is overwritten while the driver may still be
+	 * holding it.
+	 */
+	remaining = (buf->len - mtu + frag_len - 1) / frag_len;
+
+	frag = create_frag(conn, buf, frag_len, !(remaining & 1));
 	if (!frag) {
-		return false;
+		nano_fiber_sem_give(bt_conn_get_pkts(conn));
+	} else if (send_frag(conn, frag, flags, true)) {
+		return;
 	}
 
-	if (!send_frag(conn, frag, BT_ACL_START_NO_FLUSH, true)) {
-		return false;
+	conn->tx = NULL;
+	net_buf_unref(buf);
+}
+
+static void tx_cleanup(struct bt_conn *conn)
+{
+	struct net_buf *buf;
+	int i;
+
+	BT_DBG("handle %u disconnected - cleaning up", conn->handle);
+
+	/* Give back any allocated buffers */
+	if (conn->tx) {
+		net_buf_unref(conn->tx);
+		conn->tx = NULL;
 	}
 
-	/*
-	 * Send the fragments. For the last one simply use the original
-	 * buffer (which works since we've used net_buf_pull on it.
-	 */
-	while (buf->len > conn_mtu(conn)) {
-		frag = create_frag(conn, buf);
-		if (!frag) {
-			return false;
+	for (i = 0; i < ARRAY_SIZE(conn->tx_queue); i++) {
+		while ((buf = nano_fifo_get(&conn->tx_queue[i], TICKS_NONE))) {
+			net_buf_unref(buf);
 		}
+	}
 
-		if (!send_frag(conn, frag, BT_ACL_CONT, true)) {
-			return false;
+	/* Return any unacknowledged packets */
+	while (conn->pending_pkts) {
+		conn->pending_pkts--;
+		nano_fiber_sem_give(bt_conn_get_pkts(conn));
+	}
+
+	bt_conn_reset_rx_state(conn);
+
+	stack_analyze("conn tx stack", tx_fiber_stack, sizeof(tx_fiber_stack));
+
+	atomic_clear_bit(conn->flags, BT_CONN_TX);
+	bt_conn_unref(conn);
+}
+
+/* Pick the PDU to continue with if the connection is not in the middle of
+ * one already, highest priority first.
+ */
+static bool tx_pending(struct bt_conn *conn)
+{
+	int i;
+
+	if (conn->tx) {
+		return true;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(conn->tx_queue); i++) {
+		conn->tx = nano_fifo_get(&conn->tx_queue[i], TICKS_NONE);
+		if (conn->tx) {
+			conn->tx_prio = i;
+			conn->tx_flags = BT_ACL_START_NO_FLUSH;
+			return true;
 		}
 	}
 
-	return send_frag(conn, buf, BT_ACL_CONT, false);
+	return false;
 }
 
-static void conn_tx_fiber(int arg1, int arg2)
+/* Connections are served one ACL fragment at a time, the highest priority
+ * class first and round robin within the same class, so that a long PDU
+ * on one connection cannot hold back the others.
+ */
+static struct bt_conn *tx_select(void)
 {
-	struct bt_conn *conn = (struct bt_conn *)arg1;
-	struct net_buf *buf;
+	struct bt_conn *conn, *sel = NULL;
+	int i;
 
-	BT_DBG("Started for handle %u", conn->handle);
+	for (i = 0; i < ARRAY_SIZE(conns); i++) {
+		conn = &conns[(tx_next + i) % ARRAY_SIZE(conns)];
+
+		if (!atomic_test_bit(conn->flags, BT_CONN_TX)) {
+			continue;
+		}
 
-	while (conn->state == BT_CONN_CONNECTED) {
-		/* Get next ACL packet for connection */
-		buf = nano_fifo_get(&conn->tx_queue, TICKS_UNLIMITED);
 		if (conn->state != BT_CONN_CONNECTED) {
-			net_buf_unref(buf);
-			break;
+			tx_cleanup(conn);
+			continue;
 		}
 
-		if (!send_buf(conn, buf)) {
-			net_buf_unref(buf);
+		if (!tx_pending(conn)) {
+			continue;
+		}
+
+		if (!sel || conn->tx_prio < sel->tx_prio) {
+			sel = conn;
 		}
 	}
 
-	BT_DBG("handle %u disconnected - cleaning up", conn->handle);
+	return sel;
+}
 
-	/* Give back any allocated buffers */
-	while ((buf = nano_fifo_get(&conn->tx_queue, TICKS_NONE))) {
-		net_buf_unref(buf);
-	}
+/* Cancel LE Create Connection attempts which have timed out, returns the
+ * number of ticks until the next one expires.
+ */
+static int32_t conn_timeouts(void)
+{
+	int32_t next = TICKS_UNLIMITED;
+	int32_t left;
+	int i;
 
-	/* Return any unacknowledged packets */
-	if (conn->pending_pkts) {
-		while (conn->pending_pkts--) {
-			nano_fiber_sem_give(bt_conn_get_pkts(conn));
+	for (i = 0; i < ARRAY_SIZE(conns); i++) {
+		struct bt_conn *conn = &conns[i];
+
+		if (!atomic_test_bit(conn->flags, BT_CONN_TIMEOUT)) {
+			continue;
+		}
+
+		left = (int32_t)(conn->timeout - sys_tick_get_32());
+		if (left > 0) {
+			if (next == TICKS_UNLIMITED || left < next) {
+				next = left;
+			}
+
+			continue;
 		}
+
+		atomic_clear_bit(conn->flags, BT_CONN_TIMEOUT);
+
+		bt_conn_ref(conn);
+		bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+		bt_conn_unref(conn);
 	}
 
-	bt_conn_reset_rx_state(conn);
+	return next;
+}
 
-	BT_DBG("handle %u exiting", conn->handle);
-	bt_conn_unref(conn);
+static void conn_tx_fiber(int arg1, int arg2)
+{
+	struct bt_conn *conn;
+	int32_t timeout;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	while (1) {
+		timeout = conn_timeouts();
+
+		conn = tx_select();
+		if (!conn) {
+			nano_fiber_sem_take(&tx_sem, timeout);
+			continue;
+		}
+
+		/* Wait for the controller to free buffers if it cannot
+		 * accept more ACL packets.
+		 */
+		if (!nano_fiber_sem_take(bt_conn_get_pkts(conn), TICKS_NONE)) {
+			nano_fiber_sem_take(&tx_sem, timeout);
+			continue;
+		}
+
+		send_next_frag(conn);
+
+		tx_next = (conn - conns + 1) % ARRAY_SIZE(conns);
+	}
 }
 
 static struct bt_conn *conn_new(void)
@@ -548,6 +781,7 @@ static struct bt_conn *conn_new(void)
 struct bt_conn *bt_conn_add_le(const bt_addr_le_t *peer)
 {
 	struct bt_conn *conn = conn_new();
+	unsigned int key;
 
 	if (!conn) {
 		return NULL;
@@ -562,6 +796,10 @@ struct bt_conn *bt_conn_add_le(const bt_addr_le_t *peer)
 	conn->le.interval_min = BT_GAP_INIT_CONN_INT_MIN;
 	conn->le.interval_max = BT_GAP_INIT_CONN_INT_MAX;
 
+	key = irq_lock();
+	conn_hash_add(CONN_HASH_ADDR, addr_key(peer), conn);
+	irq_unlock(key);
+
 	return conn;
 }
 
@@ -602,20 +840,11 @@ struct bt_conn *bt_conn_add_br(const bt_addr_t *peer)
 }
 #endif
 
-static void timeout_fiber(int arg1, int arg2)
-{
-	struct bt_conn *conn = (struct bt_conn *)arg1;
-	ARG_UNUSED(arg2);
-
-	conn->timeout = NULL;
-
-	bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
-	bt_conn_unref(conn);
-}
-
 void bt_conn_set_state(struct bt_conn *conn, bt_conn_state_t state)
 {
 	bt_conn_state_t old_state;
+	unsigned int key;
+	int i;
 
 	BT_DBG("%s -> %s", state2str(conn->state), state2str(state));
 
@@ -637,13 +866,7 @@ void bt_conn_set_state(struct bt_conn *conn, bt_conn_state_t state)
 		bt_conn_ref(conn);
 		break;
 	case BT_CONN_CONNECT:
-		if (conn->timeout) {
-			fiber_delayed_start_cancel(conn->timeout);
-			conn->timeout = NULL;
-
-			/* Drop the reference taken by timeout fiber */
-			bt_conn_unref(conn);
-		}
+		atomic_clear_bit(conn->flags, BT_CONN_TIMEOUT);
 		break;
 	default:
 		break;
@@ -652,24 +875,39 @@ void bt_conn_set_state(struct bt_conn *conn, bt_conn_state_t state)
 	/* Actions needed for entering the new state */
 	switch (conn->state){
 	case BT_CONN_CONNECTED:
-		nano_fifo_init(&conn->tx_queue);
-		fiber_start(conn->stack, sizeof(conn->stack), conn_tx_fiber,
-			    (int)bt_conn_ref(conn), 0, 7, 0);
+		key = irq_lock();
+		conn_hash_add(CONN_HASH_HANDLE, handle_key(conn->handle), conn);
+		irq_unlock(key);
+
+		/* The ACL scheduler keeps a reference until it has cleaned
+		 * up after disconnection.
+		 */
+		if (!atomic_test_and_set_bit(conn->flags, BT_CONN_TX)) {
+			for (i = 0; i < ARRAY_SIZE(conn->tx_queue); i++) {
+				nano_fifo_init(&conn->tx_queue[i]);
+			}
+
+			bt_conn_ref(conn);
+		}
 
 		bt_l2cap_connected(conn);
 		notify_connected(conn);
 		break;
 	case BT_CONN_DISCONNECTED:
-		/* Notify disconnection and queue a dummy buffer to wake
-		 * up and stop the tx fiber for states where it was
-		 * running.
+		/* Notify disconnection and wake up the ACL scheduler to
+		 * clean up for states where the connection was using it.
 		 */
 		if (old_state == BT_CONN_CONNECTED ||
 		    old_state == BT_CONN_DISCONNECT) {
+			key = irq_lock();
+			conn_hash_del(CONN_HASH_HANDLE,
+				      handle_key(conn->handle), conn);
+			irq_unlock(key);
+
 			bt_l2cap_disconnected(conn);
 			notify_disconnected(conn);
 
-			nano_fifo_put(&conn->tx_queue, net_buf_get(&dummy, 0));
+			nano_sem_give(&tx_sem);
 		} else if (old_state == BT_CONN_CONNECT) {
 			/* conn->err will be set in this case */
 			notify_connected(conn);
@@ -695,12 +933,12 @@ void bt_conn_set_state(struct bt_conn *conn, bt_conn_state_t state)
 			break;
 		}
 
-		/* Add LE Create Connection timeout */
-		conn->timeout = fiber_delayed_start(conn->stack,
-						    sizeof(conn->stack),
-						    timeout_fiber,
-						    (int)bt_conn_ref(conn),
-						    0, 7, 0, CONN_TIMEOUT);
+		/* Add LE Create Connection timeout, handled by the ACL
+		 * scheduler fiber.
+		 */
+		conn->timeout = sys_tick_get_32() + CONN_TIMEOUT;
+		atomic_set_bit(conn->flags, BT_CONN_TIMEOUT);
+		nano_sem_give(&tx_sem);
 		break;
 	case BT_CONN_DISCONNECT:
 		break;
@@ -713,53 +951,82 @@ void bt_conn_set_state(struct bt_conn *conn, bt_conn_state_t state)
 
 struct bt_conn *bt_conn_lookup_handle(uint16_t handle)
 {
-	int i;
+	struct bt_conn *conn;
+	uint8_t i;
+	int n;
 
-	for (i = 0; i < ARRAY_SIZE(conns); i++) {
-		if (!atomic_get(&conns[i].ref)) {
+	i = conn_hash[CONN_HASH_HANDLE][handle_key(handle)];
+
+	/* The chain may change under a preempted task, bound the walk */
+	for (n = 0; i != CONN_NONE && n < ARRAY_SIZE(conns); n++) {
+		conn = &conns[i];
+		i = conn->hash_next[CONN_HASH_HANDLE];
+
+		if (!atomic_get(&conn->ref)) {
 			continue;
 		}
 
 		/* We only care about connections with a valid handle */
-		if (conns[i].state != BT_CONN_CONNECTED &&
-		    conns[i].state != BT_CONN_DISCONNECT) {
+		if (conn->state != BT_CONN_CONNECTED &&
+		    conn->state != BT_CONN_DISCONNECT) {
 			continue;
 		}
 
-		if (conns[i].handle == handle) {
-			return bt_conn_ref(&conns[i]);
+		if (conn->handle == handle) {
+			return bt_conn_ref(conn);
 		}
 	}
 
 	return NULL;
 }
 
-struct bt_conn *bt_conn_lookup_addr_le(const bt_addr_le_t *peer)
+static struct bt_conn *lookup_addr_le(const bt_addr_le_t *peer,
+				      const bt_conn_state_t *state)
 {
-	int i;
+	struct bt_conn *conn;
+	uint8_t i;
+	int n;
 
-	for (i = 0; i < ARRAY_SIZE(conns); i++) {
-		if (!atomic_get(&conns[i].ref)) {
+	i = conn_hash[CONN_HASH_ADDR][addr_key(peer)];
+
+	for (n = 0; i != CONN_NONE && n < ARRAY_SIZE(conns); n++) {
+		conn = &conns[i];
+		i = conn->hash_next[CONN_HASH_ADDR];
+
+		if (!atomic_get(&conn->ref)) {
 			continue;
 		}
 
-		if (conns[i].type != BT_CONN_TYPE_LE) {
+		if (conn->type != BT_CONN_TYPE_LE) {
 			continue;
 		}
 
-		if (!bt_addr_le_cmp(peer, &conns[i].le.dst)) {
-			return bt_conn_ref(&conns[i]);
+		if (bt_addr_le_cmp(peer, &conn->le.dst)) {
+			continue;
+		}
+
+		if (!state || conn->state == *state) {
+			return bt_conn_ref(conn);
 		}
 	}
 
 	return NULL;
 }
 
+struct bt_conn *bt_conn_lookup_addr_le(const bt_addr_le_t *peer)
+{
+	return lookup_addr_le(peer, NULL);
+}
+
 struct bt_conn *bt_conn_lookup_state_le(const bt_addr_le_t *peer,
 					const bt_conn_state_t state)
 {
 	int i;
 
+	if (peer) {
+		return lookup_addr_le(peer, &state);
+	}
+
 	for (i = 0; i < ARRAY_SIZE(conns); i++) {
 		if (!atomic_get(&conns[i].ref)) {
 			continue;
@@ -769,10 +1036,6 @@ struct bt_conn *bt_conn_lookup_state_le(const bt_addr_le_t *peer,
 			continue;
 		}
 
-		if (peer && bt_addr_le_cmp(peer, &conns[i].le.dst)) {
-			continue;
-		}
-
 		if (conns[i].state == state) {
 			return bt_conn_ref(&conns[i]);
 		}
@@ -792,7 +1055,18 @@ struct bt_conn *bt_conn_ref(struct bt_conn *conn)
 
 void bt_conn_unref(struct bt_conn *conn)
 {
-	atomic_dec(&conn->ref);
+	unsigned int key;
+
+	/* Drop the last reference and the address index entry atomically,
+	 * the connection object may be reused right after.
+	 */
+	key = irq_lock();
+
+	if (atomic_dec(&conn->ref) == 1 && conn->type == BT_CONN_TYPE_LE) {
+		conn_hash_del(CONN_HASH_ADDR, addr_key(&conn->le.dst), conn);
+	}
+
+	irq_unlock(key);
 
 	BT_DBG("handle %u ref %u", conn->handle, atomic_get(&conn->ref));
 }
@@ -859,13 +1133,7 @@ static int bt_hci_connect_le_cancel(struct bt_conn *conn)
 {
 	int err;
 
-	if (conn->timeout) {
-		fiber_delayed_start_cancel(conn->timeout);
-		conn->timeout = NULL;
-
-		/* Drop the reference took by timeout fiber */
-		bt_conn_unref(conn);
-	}
+	atomic_clear_bit(conn->flags, BT_CONN_TIMEOUT);
 
 	err = bt_hci_cmd_send(BT_HCI_OP_LE_CREATE_CONN_CANCEL, NULL);
 	if (err) {
@@ -1236,7 +1504,11 @@ int bt_conn_init(void)
 	int err;
 
 	net_buf_pool_init(frag_pool);
-	net_buf_pool_init(dummy_pool);
+	net_buf_pool_init(frag_view_pool);
+
+	nano_sem_init(&tx_sem);
+	fiber_start(tx_fiber_stack, sizeof(tx_fiber_stack), conn_tx_fiber,
+		    0, 0, 7, 0);
 
 	bt_att_init();
 
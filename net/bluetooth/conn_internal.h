@@ -31,6 +31,26 @@ enum {
 	BT_CONN_AUTO_CONNECT,
 	BT_CONN_BR_LEGACY_SECURE,	/* 16 digits legacy PIN tracker */
 	BT_CONN_USER,			/* user I/O when pairing */
+	BT_CONN_TX,			/* served by the ACL scheduler */
+	BT_CONN_TIMEOUT,		/* LE Create Connection timeout */
+};
+
+/* Connection indexes */
+enum {
+	CONN_HASH_HANDLE,
+	CONN_HASH_ADDR,
+
+	CONN_HASH_COUNT,
+};
+
+/* Priority classes of outgoing ACL data, lower values are sent first */
+enum {
+	BT_CONN_TX_SIG,			/* L2CAP signaling */
+	BT_CONN_TX_SMP,			/* Security Manager */
+	BT_CONN_TX_ATT,			/* Attribute Protocol */
+	BT_CONN_TX_DATA,		/* Other channels */
+
+	BT_CONN_TX_CLASSES,
 };
 
 struct bt_conn_le {
@@ -74,8 +94,13 @@ struct bt_conn {
 	uint16_t		rx_len;
 	struct net_buf		*rx;
 
-	/* Queue for outgoing ACL data */
-	struct nano_fifo	tx_queue;
+	/* Queues for outgoing ACL data, one per priority class */
+	struct nano_fifo	tx_queue[BT_CONN_TX_CLASSES];
+
+	/* PDU being fragmented, its class and the next ACL flags */
+	struct net_buf		*tx;
+	uint8_t			tx_prio;
+	uint8_t			tx_flags;
 
 	struct bt_keys		*keys;
 
@@ -84,13 +109,16 @@ struct bt_conn {
 
 	atomic_t		ref;
 
+	/* Next connection in the index buckets */
+	uint8_t			hash_next[CONN_HASH_COUNT];
+
 	/* Connection error or reason for disconnect */
 	uint8_t			err;
 
 	bt_conn_state_t		state;
 
-	/* Handle allowing to cancel timeout fiber */
-	nano_thread_id_t timeout;
+	/* When to cancel LE Create Connection (in ticks) */
+	uint32_t		timeout;
 
 	union {
 		struct bt_conn_le	le;
@@ -98,19 +126,16 @@ struct bt_conn {
 		struct bt_conn_br	br;
 #endif
 	};
-
-	/* Stack for TX fiber and timeout fiber.
-	 * Since these fibers don't overlap, one stack can be used by
-	 * both of them.
-	 */
-	BT_STACK(stack, 256);
 };
 
 /* Process incoming data for a connection */
 void bt_conn_recv(struct bt_conn *conn, struct net_buf *buf, uint8_t flags);
 
-/* Send data over a connection */
-void bt_conn_send(struct bt_conn *conn, struct net_buf *buf);
+/* Send data over a connection with one of the BT_CONN_TX_* priorities */
+void bt_conn_send(struct bt_conn *conn, struct net_buf *buf, uint8_t prio);
+
+/* Wake up the ACL scheduler when controller buffers have been freed */
+void bt_conn_tx_notify(void);
 
 /* Add a new LE connection */
 struct bt_conn *bt_conn_add_le(const bt_addr_le_t *peer);
@@ -156,6 +181,9 @@ int bt_conn_le_start_encryption(struct bt_conn *conn, uint64_t rand,
 /* Notify higher layers that RPA was resolved */
 void bt_conn_identity_resolved(struct bt_conn *conn);
 
+/* Update the LE peer address, e.g. to its resolved identity */
+void bt_conn_set_dst_le(struct bt_conn *conn, const bt_addr_le_t *dst);
+
 /* Notify higher layers that connection security changed */
 void bt_conn_security_changed(struct bt_conn *conn);
 #endif /* CONFIG_BLUETOOTH_SMP */
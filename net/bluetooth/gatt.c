@@ -18,6 +18,7 @@
 
 #include <nanokernel.h>
 #include <toolchain.h>
+#include <sections.h>
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
@@ -32,6 +33,7 @@
 #include <bluetooth/gatt.h>
 #include <bluetooth/driver.h>
 
+#include "stack.h"
 #include "hci_core.h"
 #include "conn_internal.h"
 #include "keys.h"
@@ -406,10 +408,14 @@ struct notify_data {
 	const void *data;
 	uint16_t len;
 	struct bt_gatt_indicate_params *params;
+	/* notification PDU shared by all the subscribers */
+	struct net_buf *pdu;
+	/* last subscriber found, which is sent the PDU itself */
+	struct bt_conn *conn;
 };
 
-static int att_notify(struct bt_conn *conn, uint16_t handle, const void *data,
-		      size_t len)
+static struct net_buf *att_notify_create(struct bt_conn *conn, uint16_t handle,
+					 const void *data, size_t len)
 {
 	struct net_buf *buf;
 	struct bt_att_notify *nfy;
@@ -417,7 +423,7 @@ static int att_notify(struct bt_conn *conn, uint16_t handle, const void *data,
 	buf = bt_att_create_pdu(conn, BT_ATT_OP_NOTIFY, sizeof(*nfy) + len);
 	if (!buf) {
 		BT_WARN("No buffer available to send notification");
-		return -ENOMEM;
+		return NULL;
 	}
 
 	BT_DBG("conn %p handle 0x%04x", conn, handle);
@@ -428,11 +434,75 @@ static int att_notify(struct bt_conn *conn, uint16_t handle, const void *data,
 	net_buf_add(buf, len);
 	memcpy(nfy->value, data, len);
 
+	return buf;
+}
+
+static int att_notify(struct bt_conn *conn, uint16_t handle, const void *data,
+		      size_t len)
+{
+	struct net_buf *buf;
+
+	buf = att_notify_create(conn, handle, data, len);
+	if (!buf) {
+		return -ENOMEM;
+	}
+
 	bt_l2cap_send(conn, BT_L2CAP_CID_ATT, buf);
 
 	return 0;
 }
 
+/*
+ * The notification is encoded once, for the first subscriber. Every
+ * subscriber is sent a copy of it but the last one, which is sent the PDU
+ * itself once all the subscribers have been found. The PDU cannot be shared
+ * by reference since the L2CAP and ACL headers of each connection are pushed
+ * into the buffer. Takes over the reference to the connection.
+ */
+static int notify_peer_add(struct bt_conn *conn, struct notify_data *data)
+{
+	struct net_buf *buf;
+
+	if (!data->pdu) {
+		data->pdu = att_notify_create(conn, data->attr->handle,
+					      data->data, data->len);
+		if (!data->pdu) {
+			bt_conn_unref(conn);
+			return -ENOMEM;
+		}
+	} else if (data->pdu->len > bt_att_get_mtu(conn)) {
+		BT_WARN("ATT MTU exceeded for conn %p", conn);
+		bt_conn_unref(conn);
+		return 0;
+	}
+
+	if (data->conn) {
+		buf = net_buf_clone(data->pdu);
+		if (!buf) {
+			BT_WARN("No buffer available to send notification");
+			bt_conn_unref(conn);
+			return -ENOMEM;
+		}
+
+		bt_l2cap_send(data->conn, BT_L2CAP_CID_ATT, buf);
+		bt_conn_unref(data->conn);
+	}
+
+	data->conn = conn;
+
+	return 0;
+}
+
+static void notify_peers_send(struct notify_data *data)
+{
+	if (data->conn) {
+		bt_l2cap_send(data->conn, BT_L2CAP_CID_ATT, data->pdu);
+		bt_conn_unref(data->conn);
+	} else if (data->pdu) {
+		net_buf_unref(data->pdu);
+	}
+}
+
 static void gatt_indicate_rsp(struct bt_conn *conn, uint8_t err,
 			      const void *pdu, uint16_t length, void *user_data)
 {
@@ -517,13 +587,11 @@ static uint8_t notify_cb(const struct bt_gatt_attr *attr, void *user_data)
 
 		if (data->type == BT_GATT_CCC_INDICATE) {
 			err = att_indicate(conn, data->params);
+			bt_conn_unref(conn);
 		} else {
-			err = att_notify(conn, data->attr->handle, data->data,
-					 data->len);
+			err = notify_peer_add(conn, data);
 		}
 
-		bt_conn_unref(conn);
-
 		if (err < 0) {
 			return BT_GATT_ITER_STOP;
 		}
@@ -549,12 +617,220 @@ int bt_gatt_notify(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 	nfy.type = BT_GATT_CCC_NOTIFY;
 	nfy.data = data;
 	nfy.len = len;
+	nfy.pdu = NULL;
+	nfy.conn = NULL;
 
 	bt_gatt_foreach_attr(attr->handle, 0xffff, notify_cb, &nfy);
+	notify_peers_send(&nfy);
+
+	return 0;
+}
+
+#if defined(CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH)
+struct notify_entry {
+	const struct bt_gatt_attr *attr;
+	uint16_t offset;
+	uint16_t len;
+};
+
+/* Updates pending for all subscribers, each value is stored once */
+struct notify_batch {
+	struct notify_entry entry[CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH_COUNT];
+	uint8_t count;
+	uint16_t used;
+	uint32_t deadline;
+	uint8_t data[CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH_SIZE];
+};
+
+/*
+ * One batch is filled while the fiber sends the other one. A batch is swapped
+ * out, by the fiber or by a producer finding it full, only once the other one
+ * has been sent.
+ */
+static struct notify_batch batches[2];
+static uint8_t batch_fill;
+static bool batch_flush;
+
+static struct nano_sem batch_sem;
+static BT_STACK_NOINIT(batch_fiber_stack,
+		       CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH_STACK_SIZE);
+
+static void batch_send(struct notify_batch *batch)
+{
+	struct notify_data nfy;
+	unsigned int key;
+	int i;
+
+	nfy.type = BT_GATT_CCC_NOTIFY;
+
+	for (i = 0; i < batch->count; i++) {
+		struct notify_entry *entry = &batch->entry[i];
+
+		/* Replaced by an update of a different length */
+		if (!entry->attr) {
+			continue;
+		}
+
+		nfy.attr = entry->attr;
+		nfy.data = &batch->data[entry->offset];
+		nfy.len = entry->len;
+		nfy.pdu = NULL;
+		nfy.conn = NULL;
+
+		bt_gatt_foreach_attr(entry->attr->handle, 0xffff, notify_cb,
+				     &nfy);
+		notify_peers_send(&nfy);
+	}
+
+	key = irq_lock();
+	batch->count = 0;
+	batch->used = 0;
+	irq_unlock(key);
+}
+
+static void batch_fiber(int arg1, int arg2)
+{
+	struct notify_batch *batch;
+	int32_t timeout;
+	unsigned int key;
+
+	while (1) {
+		key = irq_lock();
+
+		batch = &batches[batch_fill ^ 1];
+
+		if (batch->count) {
+			irq_unlock(key);
+
+			batch_send(batch);
+			continue;
+		}
+
+		batch = &batches[batch_fill];
+
+		if (batch->count &&
+		    (batch_flush ||
+		     (int32_t)(batch->deadline - sys_tick_get_32()) <= 0)) {
+			batch_fill ^= 1;
+			batch_flush = false;
+			irq_unlock(key);
+			continue;
+		}
+
+		batch_flush = false;
+
+		if (batch->count) {
+			timeout = batch->deadline - sys_tick_get_32();
+		} else {
+			timeout = TICKS_UNLIMITED;
+		}
+
+		irq_unlock(key);
+
+		nano_fiber_sem_take(&batch_sem, timeout);
+	}
+}
+
+/* Called with interrupts locked */
+static int batch_add(const struct bt_gatt_attr *attr, const void *data,
+		     uint16_t len)
+{
+	struct notify_batch *batch = &batches[batch_fill];
+	struct notify_entry *entry;
+	int i;
+
+	for (i = 0; i < batch->count; i++) {
+		entry = &batch->entry[i];
+
+		if (entry->attr != attr) {
+			continue;
+		}
+
+		if (entry->len == len) {
+			memcpy(&batch->data[entry->offset], data, len);
+			return 0;
+		}
+
+		entry->attr = NULL;
+		break;
+	}
+
+	if (batch->count == ARRAY_SIZE(batch->entry) ||
+	    batch->used + len > sizeof(batch->data)) {
+		return -ENOMEM;
+	}
+
+	if (!batch->count) {
+		batch->deadline = sys_tick_get_32() +
+			(CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH_TIMEOUT *
+			 sys_clock_ticks_per_sec + 999) / 1000;
+	}
+
+	entry = &batch->entry[batch->count++];
+	entry->attr = attr;
+	entry->offset = batch->used;
+	entry->len = len;
+
+	memcpy(&batch->data[batch->used], data, len);
+	batch->used += len;
 
 	return 0;
 }
 
+int bt_gatt_notify_queue(const struct bt_gatt_attr *attr, const void *data,
+			 uint16_t len)
+{
+	unsigned int key;
+	int err;
+
+	if (!attr || !attr->handle) {
+		return -EINVAL;
+	}
+
+	if (len > CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH_SIZE) {
+		return -EINVAL;
+	}
+
+	key = irq_lock();
+
+	err = batch_add(attr, data, len);
+	if (err != -ENOMEM || batches[batch_fill ^ 1].count) {
+		irq_unlock(key);
+		return err;
+	}
+
+	/* Hand the full batch over to the fiber and fill the other one */
+	batch_fill ^= 1;
+	err = batch_add(attr, data, len);
+
+	irq_unlock(key);
+
+	nano_sem_give(&batch_sem);
+
+	return err;
+}
+
+void bt_gatt_notify_flush(void)
+{
+	unsigned int key;
+
+	key = irq_lock();
+	batch_flush = true;
+	irq_unlock(key);
+
+	nano_sem_give(&batch_sem);
+}
+#endif /* CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH */
+
+void bt_gatt_init(void)
+{
+#if defined(CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH)
+	nano_sem_init(&batch_sem);
+	fiber_start(batch_fiber_stack, sizeof(batch_fiber_stack),
+		    batch_fiber, 0, 0, 7, 0);
+#endif /* CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH */
+}
+
 int bt_gatt_indicate(struct bt_conn *conn,
 		     struct bt_gatt_indicate_params *params)
 {
@@ -18,6 +18,8 @@
  * limitations under the License.
  */
 
+void bt_gatt_init(void);
+
 void bt_gatt_connected(struct bt_conn *conn);
 void bt_gatt_disconnected(struct bt_conn *conn);
 
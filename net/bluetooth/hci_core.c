@@ -444,6 +444,8 @@ static void hci_num_completed_packets(struct net_buf *buf)
 
 		bt_conn_unref(conn);
 	}
+
+	bt_conn_tx_notify();
 }
 
 static int hci_le_create_conn(const struct bt_conn *conn)
@@ -499,7 +501,6 @@ static void hci_disconn_complete(struct net_buf *buf)
 		      sizeof(rx_prio_fiber_stack));
 	stack_analyze("cmd tx stack", cmd_tx_fiber_stack,
 		      sizeof(cmd_tx_fiber_stack));
-	stack_analyze("conn tx stack", conn->stack, sizeof(conn->stack));
 
 	bt_conn_set_state(conn, BT_CONN_DISCONNECTED);
 	conn->handle = 0;
@@ -1751,6 +1752,183 @@ int bt_le_scan_update(bool fast_scan)
 #endif /* CONFIG_BLUETOOTH_CENTRAL */
 }
 
+#if defined(CONFIG_BLUETOOTH_SCAN_FILTER)
+/* RSSI value of reports for which it is not available */
+#define RSSI_NONE 127
+
+struct scan_dup {
+	bt_addr_le_t addr;
+	uint8_t evt_type;
+	int8_t rssi;
+	uint32_t ad_hash;
+	/* Tick of the last report given to the application */
+	uint32_t time;
+};
+
+static const struct bt_le_scan_filter *scan_filter;
+
+static struct scan_dup scan_dup[CONFIG_BLUETOOTH_SCAN_DUP_COUNT];
+static uint8_t scan_dup_count;
+
+static uint32_t scan_ad_hash(const uint8_t *data, uint8_t len)
+{
+	uint32_t hash = 5381;
+
+	while (len--) {
+		hash = hash * 33 + *data++;
+	}
+
+	return hash;
+}
+
+/* Returns true if the report repeats one given to the application less
+ * than dup_window ago. Duplicates do not refresh the entry, so that a
+ * present advertiser is still reported once per window.
+ */
+static bool scan_dup_check(const struct bt_le_scan_filter *filter,
+			   const bt_addr_le_t *addr, uint8_t evt_type,
+			   int8_t rssi, const uint8_t *data, uint8_t len)
+{
+	uint32_t window, hash, now = sys_tick_get_32();
+	struct scan_dup *dup, *oldest = NULL;
+	int i, delta;
+
+	hash = scan_ad_hash(data, len);
+
+	for (i = 0; i < scan_dup_count; i++) {
+		dup = &scan_dup[i];
+
+		if (dup->evt_type == evt_type &&
+		    !bt_addr_le_cmp(&dup->addr, addr)) {
+			goto found;
+		}
+
+		if (!oldest || (int32_t)(dup->time - oldest->time) < 0) {
+			oldest = dup;
+		}
+	}
+
+	if (scan_dup_count < ARRAY_SIZE(scan_dup)) {
+		dup = &scan_dup[scan_dup_count++];
+	} else {
+		dup = oldest;
+	}
+
+	bt_addr_le_copy(&dup->addr, addr);
+	dup->evt_type = evt_type;
+	goto report;
+
+found:
+	window = ((uint32_t)filter->dup_window * sys_clock_ticks_per_sec +
+		  999) / 1000;
+
+	if (dup->ad_hash == hash && now - dup->time < window) {
+		delta = rssi - dup->rssi;
+		if (delta < 0) {
+			delta = -delta;
+		}
+
+		if (!filter->rssi_delta || rssi == RSSI_NONE ||
+		    dup->rssi == RSSI_NONE || delta < filter->rssi_delta) {
+			return true;
+		}
+	}
+
+report:
+	dup->ad_hash = hash;
+	dup->rssi = rssi;
+	dup->time = now;
+
+	return false;
+}
+
+static bool scan_ad_type_match(const struct bt_le_scan_filter *filter,
+			       const uint8_t *data, uint8_t len)
+{
+	uint8_t field_len;
+	int i;
+
+	while (len > 1) {
+		field_len = data[0];
+
+		/* Early termination or malformed data */
+		if (!field_len || field_len >= len) {
+			break;
+		}
+
+		for (i = 0; i < filter->ad_type_count; i++) {
+			if (data[1] == filter->ad_types[i]) {
+				return true;
+			}
+		}
+
+		data += field_len + 1;
+		len -= field_len + 1;
+	}
+
+	return false;
+}
+
+static bool scan_filter_accept(const bt_addr_le_t *addr, int8_t rssi,
+			       const struct bt_hci_ev_le_advertising_info *info)
+{
+	const struct bt_le_scan_filter *filter = scan_filter;
+	int i;
+
+	if (!filter) {
+		return true;
+	}
+
+	if (rssi != RSSI_NONE && rssi < filter->rssi_min) {
+		return false;
+	}
+
+	if (filter->addr_count) {
+		for (i = 0; i < filter->addr_count; i++) {
+			if (!bt_addr_le_cmp(addr, &filter->addrs[i])) {
+				break;
+			}
+		}
+
+		if (i == filter->addr_count) {
+			return false;
+		}
+	}
+
+	if (filter->ad_type_count &&
+	    !scan_ad_type_match(filter, info->data, info->length)) {
+		return false;
+	}
+
+	if (filter->dup_window &&
+	    scan_dup_check(filter, addr, info->evt_type, rssi, info->data,
+			   info->length)) {
+		return false;
+	}
+
+	return true;
+}
+
+int bt_le_scan_filter_set(const struct bt_le_scan_filter *filter)
+{
+	unsigned int key;
+
+	if (filter && ((filter->addr_count && !filter->addrs) ||
+		       (filter->ad_type_count && !filter->ad_types))) {
+		return -EINVAL;
+	}
+
+	key = irq_lock();
+	scan_filter = filter;
+	scan_dup_count = 0;
+	irq_unlock(key);
+
+	return 0;
+}
+#else
+#define scan_filter_accept(addr, rssi, info) true
+#endif /* CONFIG_BLUETOOTH_SCAN_FILTER */
+
 static void le_adv_report(struct net_buf *buf)
 {
 	uint8_t num_reports = net_buf_pull_u8(buf);
@@ -1769,7 +1947,8 @@ static void le_adv_report(struct net_buf *buf)
 
 		addr = find_id_addr(&info->addr);
 
-		if (scan_dev_found_cb) {
+		if (scan_dev_found_cb &&
+		    scan_filter_accept(addr, rssi, info)) {
 			scan_dev_found_cb(addr, rssi, info->evt_type,
 					  info->data, info->length);
 		}
@@ -2747,6 +2926,11 @@ int bt_le_scan_start(const struct bt_le_scan_param *param, bt_le_scan_cb_t cb)
 
 	scan_dev_found_cb = cb;
 
+#if defined(CONFIG_BLUETOOTH_SCAN_FILTER)
+	/* Report every advertiser again to the new scan */
+	scan_dup_count = 0;
+#endif
+
 	return 0;
 }
 
@@ -37,6 +37,29 @@
 
 static struct bt_keys key_pool[CONFIG_BLUETOOTH_MAX_PAIRED];
 
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+#define RPA_NEG_TIMEOUT	(CONFIG_BLUETOOTH_RPA_NEG_TIMEOUT * \
+			 sys_clock_ticks_per_sec)
+
+/* Recently resolved RPAs, most recently used first */
+static struct {
+	bt_addr_t		rpa;
+	struct bt_keys		*keys;
+} rpa_cache[CONFIG_BLUETOOTH_RPA_CACHE_SIZE];
+
+/* Recently seen RPAs which no IRK resolved, replaced in a round robin
+ * fashion. Any RPA has the two most significant bits set to 01, so
+ * unused entries never match.
+ */
+static struct {
+	bt_addr_t		rpa;
+	uint32_t		time;
+} rpa_neg[CONFIG_BLUETOOTH_RPA_NEG_CACHE_SIZE];
+static uint8_t rpa_neg_next;
+
+static void rpa_cache_remove(struct bt_keys *keys);
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
+
 struct bt_keys *bt_keys_get_addr(const bt_addr_le_t *addr)
 {
 	struct bt_keys *keys;
@@ -67,13 +90,18 @@ void bt_keys_clear(struct bt_keys *keys, int type)
 {
 	BT_DBG("keys for %s type %d", bt_addr_le_str(&keys->addr), type);
 
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+	if (type & BT_KEYS_IRK) {
+		rpa_cache_remove(keys);
+	}
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
+
 	keys->keys &= ~type;
 
 	if (!keys->keys) {
 		memset(keys, 0, sizeof(*keys));
 	}
 }
-
 struct bt_keys *bt_keys_find(int type, const bt_addr_le_t *addr)
 {
 	int i;
@@ -116,8 +144,116 @@ struct bt_keys *bt_keys_get_type(int type, const bt_addr_le_t *addr)
 	return keys;
 }
 
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+static struct bt_keys *rpa_cache_lookup(const bt_addr_t *rpa)
+{
+	struct bt_keys *keys;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rpa_cache) && rpa_cache[i].keys; i++) {
+		if (bt_addr_cmp(&rpa_cache[i].rpa, rpa)) {
+			continue;
+		}
+
+		/* Move to front */
+		keys = rpa_cache[i].keys;
+		memmove(&rpa_cache[1], &rpa_cache[0], i * sizeof(rpa_cache[0]));
+		bt_addr_copy(&rpa_cache[0].rpa, rpa);
+		rpa_cache[0].keys = keys;
+
+		return keys;
+	}
+
+	return NULL;
+}
+
+static void rpa_cache_add(const bt_addr_t *rpa, struct bt_keys *keys)
+{
+	/* Evicts the least recently used entry */
+	memmove(&rpa_cache[1], &rpa_cache[0],
+		(ARRAY_SIZE(rpa_cache) - 1) * sizeof(rpa_cache[0]));
+	bt_addr_copy(&rpa_cache[0].rpa, rpa);
+	rpa_cache[0].keys = keys;
+}
+
+static void rpa_cache_remove(struct bt_keys *keys)
+{
+	int i, j;
+
+	for (i = 0, j = 0; i < ARRAY_SIZE(rpa_cache); i++) {
+		if (rpa_cache[i].keys != keys) {
+			rpa_cache[j++] = rpa_cache[i];
+		}
+	}
+
+	for (; j < ARRAY_SIZE(rpa_cache); j++) {
+		rpa_cache[j].keys = NULL;
+	}
+}
+
+static int rpa_neg_lookup(const bt_addr_t *rpa)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rpa_neg); i++) {
+		if (!bt_addr_cmp(&rpa_neg[i].rpa, rpa)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void rpa_neg_add(const bt_addr_t *rpa)
+{
+	int i = rpa_neg_lookup(rpa);
+
+	if (i < 0) {
+		i = rpa_neg_next;
+		rpa_neg_next = (rpa_neg_next + 1) % ARRAY_SIZE(rpa_neg);
+		bt_addr_copy(&rpa_neg[i].rpa, rpa);
+	}
+
+	rpa_neg[i].time = sys_tick_get_32();
+}
+
+/* Peers change their RPA periodically, so an RPA which did not resolve
+ * is only remembered for that long. A new IRK may resolve any of them.
+ */
+static bool rpa_neg_valid(const bt_addr_t *rpa)
+{
+	int i = rpa_neg_lookup(rpa);
+
+	return i >= 0 && sys_tick_get_32() - rpa_neg[i].time < RPA_NEG_TIMEOUT;
+}
+
+static bool irk_matches(struct bt_keys *keys, const bt_addr_t *rpa)
+{
+	return bt_smp_irk_sched_matches(&keys->irk.sched, rpa);
+}
+#else
+static bool irk_matches(struct bt_keys *keys, const bt_addr_t *rpa)
+{
+	return bt_smp_irk_matches(keys->irk.val, rpa);
+}
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
+
+void bt_keys_set_irk(struct bt_keys *keys, const uint8_t irk[16])
+{
+	memcpy(keys->irk.val, irk, 16);
+
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+	bt_smp_irk_expand(irk, &keys->irk.sched);
+
+	rpa_cache_remove(keys);
+	memset(rpa_neg, 0, sizeof(rpa_neg));
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
+}
+
 struct bt_keys *bt_keys_find_irk(const bt_addr_le_t *addr)
 {
+	const bt_addr_t *rpa = (const bt_addr_t *)addr->val;
+	struct bt_keys *keys;
 	int i;
 
 	BT_DBG("%s", bt_addr_le_str(addr));
@@ -131,8 +267,7 @@ struct bt_keys *bt_keys_find_irk(const bt_addr_le_t *addr)
 			continue;
 		}
 
-		if (!bt_addr_cmp((bt_addr_t *)addr->val,
-				 &key_pool[i].irk.rpa)) {
+		if (!bt_addr_cmp(rpa, &key_pool[i].irk.rpa)) {
 			BT_DBG("cached RPA %s for %s",
 			       bt_addr_str(&key_pool[i].irk.rpa),
 			       bt_addr_le_str(&key_pool[i].addr));
@@ -140,26 +275,46 @@ struct bt_keys *bt_keys_find_irk(const bt_addr_le_t *addr)
 		}
 	}
 
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+	keys = rpa_cache_lookup(rpa);
+	if (keys) {
+		BT_DBG("RPA %s cached for %s", bt_addr_str(rpa),
+		       bt_addr_le_str(&keys->addr));
+		return keys;
+	}
+
+	if (rpa_neg_valid(rpa)) {
+		BT_DBG("RPA %s cached as unresolvable", bt_addr_str(rpa));
+		return NULL;
+	}
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
+
 	for (i = 0; i < ARRAY_SIZE(key_pool); i++) {
-		if (!(key_pool[i].keys & BT_KEYS_IRK)) {
+		keys = &key_pool[i];
+
+		if (!(keys->keys & BT_KEYS_IRK)) {
 			continue;
 		}
 
-		if (bt_smp_irk_matches(key_pool[i].irk.val,
-				       (bt_addr_t *)addr->val)) {
-			BT_DBG("RPA %s matches %s",
-			       bt_addr_str(&key_pool[i].irk.rpa),
-			       bt_addr_le_str(&key_pool[i].addr));
+		if (irk_matches(keys, rpa)) {
+			BT_DBG("RPA %s matches %s", bt_addr_str(rpa),
+			       bt_addr_le_str(&keys->addr));
 
-			bt_addr_copy(&key_pool[i].irk.rpa,
-				     (bt_addr_t *)addr->val);
+			bt_addr_copy(&keys->irk.rpa, rpa);
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+			rpa_cache_add(rpa, keys);
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
 
-			return &key_pool[i];
+			return keys;
 		}
 	}
 
 	BT_DBG("No IRK for %s", bt_addr_le_str(addr));
 
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+	rpa_neg_add(rpa);
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
+
 	return NULL;
 }
 
@@ -16,6 +16,10 @@
  * limitations under the License.
  */
 
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+#include <tinycrypt/aes.h>
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
+
 #if defined(CONFIG_BLUETOOTH_SMP) || defined(CONFIG_BLUETOOTH_BREDR)
 enum {
 	BT_KEYS_SLAVE_LTK      = BIT(0),
@@ -47,6 +51,10 @@ struct bt_ltk {
 struct bt_irk {
 	uint8_t			val[16];
 	bt_addr_t		rpa;
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+	/* Expanded val, set by bt_keys_set_irk() */
+	struct tc_aes_key_sched_struct sched;
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
 };
 
 struct bt_csrk {
@@ -96,5 +104,8 @@ void bt_keys_add_type(struct bt_keys *keys, int type);
 void bt_keys_clear(struct bt_keys *keys, int type);
 struct bt_keys *bt_keys_find(int type, const bt_addr_le_t *addr);
 struct bt_keys *bt_keys_find_irk(const bt_addr_le_t *addr);
+#if defined(CONFIG_BLUETOOTH_SMP)
+void bt_keys_set_irk(struct bt_keys *keys, const uint8_t irk[16]);
+#endif /* CONFIG_BLUETOOTH_SMP */
 struct bt_keys *bt_keys_find_addr(const bt_addr_le_t *addr);
 #endif /* CONFIG_BLUETOOTH_SMP || CONFIG_BLUETOOTH_BREDR */
@@ -42,7 +42,14 @@
 
 #define L2CAP_LE_MIN_MTU		23
 #define L2CAP_LE_MAX_CREDITS		(CONFIG_BLUETOOTH_ACL_IN_COUNT - 1)
-#define L2CAP_LE_CREDITS_THRESHOLD	(L2CAP_LE_MAX_CREDITS / 2)
+
+#if defined(CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL)
+/* Credits are returned to the peer once this many have been consumed */
+#define L2CAP_LE_CREDITS_RETURN		max(1, L2CAP_LE_MAX_CREDITS * \
+					    CONFIG_BLUETOOTH_L2CAP_RX_CREDITS_RETURN / 100)
+#define L2CAP_LE_CREDITS_THRESHOLD	(L2CAP_LE_MAX_CREDITS - \
+					 L2CAP_LE_CREDITS_RETURN)
+#endif /* CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL */
 
 #define L2CAP_LE_DYN_CID_START	0x0040
 #define L2CAP_LE_DYN_CID_END	0x007f
@@ -71,10 +78,39 @@ static NET_BUF_POOL(le_sig_pool, CONFIG_BLUETOOTH_MAX_CONN,
 		    BT_L2CAP_BUF_SIZE(L2CAP_LE_MIN_MTU), &le_sig, NULL, 0);
 
 #if defined(CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL)
-/* Pool for outgoing LE data packets, MTU is 23 */
+/* Headroom needed by a segment for the L2CAP, ACL and driver headers */
+#define L2CAP_SEG_RESERVE	(BT_L2CAP_CHAN_SEND_RESERVE - \
+				 BT_L2CAP_SDU_HDR_LEN)
+
+/* Pool for outgoing LE data segments which are copied from the SDU */
+static void le_data_destroy(struct net_buf *buf);
+
 static struct nano_fifo le_data;
-static NET_BUF_POOL(le_data_pool, CONFIG_BLUETOOTH_MAX_CONN,
-		    BT_L2CAP_BUF_SIZE(L2CAP_LE_MIN_MTU), &le_data, NULL, 0);
+static NET_BUF_POOL(le_data_pool, CONFIG_BLUETOOTH_L2CAP_TX_SEG_COUNT,
+		    BT_L2CAP_BUF_SIZE(CONFIG_BLUETOOTH_L2CAP_TX_MPS), &le_data,
+		    le_data_destroy, 0);
+
+/* Pool for outgoing LE data segments which point into the SDU. The user
+ * data holds a reference to the SDU.
+ */
+#define seg_parent(buf) (*(struct net_buf **)net_buf_user_data(buf))
+
+static void le_view_destroy(struct net_buf *buf);
+
+static struct nano_fifo le_view;
+static NET_BUF_POOL(le_view_pool, CONFIG_BLUETOOTH_L2CAP_TX_SEG_COUNT, 0,
+		    &le_view, le_view_destroy, sizeof(struct net_buf *));
+
+/* Channel transmit flags */
+enum {
+	L2CAP_TX_BUSY,			/* Segments are being sent */
+	L2CAP_TX_KICK,			/* Resume sending once not busy */
+	L2CAP_TX_SDU_HDR,		/* SDU length not in the buffer yet */
+	L2CAP_TX_NO_BUF,		/* Waiting for a segment buffer */
+};
+
+static void l2cap_chan_le_send_resume(struct bt_l2cap_chan *chan);
+static void l2cap_chan_le_tx_flush(struct bt_l2cap_chan *chan);
 #endif /* CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL */
 
 /* L2CAP signalling channel specific context */
@@ -205,6 +241,16 @@ void bt_l2cap_disconnected(struct bt_conn *conn)
 		/* prefetch since disconnected callback may cleanup */
 		next = chan->_next;
 
+#if defined(CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL)
+		/* Drop the SDUs not sent yet, the segment buffers cannot
+		 * resume sending on this channel once it is unlinked.
+		 */
+		if (chan->rx.cid >= L2CAP_LE_DYN_CID_START &&
+		    chan->rx.cid <= L2CAP_LE_DYN_CID_END) {
+			l2cap_chan_le_tx_flush(chan);
+		}
+#endif /* CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL */
+
 		if (chan->ops->disconnected) {
 			chan->ops->disconnected(chan);
 		}
@@ -232,6 +278,20 @@ struct net_buf *bt_l2cap_create_pdu(struct nano_fifo *fifo)
 	return bt_conn_create_pdu(fifo, sizeof(struct bt_l2cap_hdr));
 }
 
+static uint8_t l2cap_tx_prio(uint16_t cid)
+{
+	switch (cid) {
+	case BT_L2CAP_CID_LE_SIG:
+		return BT_CONN_TX_SIG;
+	case BT_L2CAP_CID_SMP:
+		return BT_CONN_TX_SMP;
+	case BT_L2CAP_CID_ATT:
+		return BT_CONN_TX_ATT;
+	default:
+		return BT_CONN_TX_DATA;
+	}
+}
+
 void bt_l2cap_send(struct bt_conn *conn, uint16_t cid, struct net_buf *buf)
 {
 	struct bt_l2cap_hdr *hdr;
@@ -240,7 +300,7 @@ void bt_l2cap_send(struct bt_conn *conn, uint16_t cid, struct net_buf *buf)
 	hdr->len = sys_cpu_to_le16(buf->len - sizeof(*hdr));
 	hdr->cid = sys_cpu_to_le16(cid);
 
-	bt_conn_send(conn, buf);
+	bt_conn_send(conn, buf, l2cap_tx_prio(cid));
 }
 
 static void l2cap_send_reject(struct bt_conn *conn, uint8_t ident,
@@ -390,6 +450,9 @@ static void l2cap_chan_tx_init(struct bt_l2cap_chan *chan)
 
 	memset(&chan->tx, 0, sizeof(chan->tx));
 	nano_sem_init(&chan->tx.credits);
+	nano_fifo_init(&chan->_tx_queue);
+	chan->_tx_buf = NULL;
+	atomic_set(&chan->_tx_flags, 0);
 }
 
 static void l2cap_chan_tx_give_credits(struct bt_l2cap_chan *chan,
@@ -545,12 +608,8 @@ static void l2cap_chan_del(struct bt_l2cap_chan *chan)
 		chan->ops->disconnected(chan);
 	}
 
-	/* There could be a writer waiting for credits so return a dummy credit
-	 * to wake it up.
-	 */
-	if (!chan->tx.credits.nsig) {
-		l2cap_chan_tx_give_credits(chan, 1);
-	}
+	/* Drop the SDUs not sent yet */
+	l2cap_chan_le_send_resume(chan);
 
 	/* Destroy segmented SDU if it exists */
 	if (chan->_sdu) {
@@ -747,6 +806,8 @@ static void le_credits(struct bt_l2cap *l2cap, uint8_t ident,
 	l2cap_chan_tx_give_credits(chan, credits);
 
 	BT_DBG("chan %p total credits %u", chan, chan->tx.credits.nsig);
+
+	l2cap_chan_le_send_resume(chan);
 }
 
 static void reject_cmd(struct bt_l2cap *l2cap, uint8_t ident,
@@ -1065,6 +1126,7 @@ void bt_l2cap_init(void)
 	net_buf_pool_init(le_sig_pool);
 #if defined(CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL)
 	net_buf_pool_init(le_data_pool);
+	net_buf_pool_init(le_view_pool);
 #endif /* CONFIG_BLUETOOTH_L2CAP_DYNAMIC_CHANNEL */
 
 	bt_l2cap_fixed_chan_register(&chan);
@@ -1192,109 +1254,232 @@ int bt_l2cap_chan_disconnect(struct bt_l2cap_chan *chan)
 	return 0;
 }
 
-static struct net_buf *l2cap_chan_create_seg(struct bt_l2cap_chan *chan,
-					     struct net_buf *buf,
-					     size_t sdu_hdr_len)
+/* A segment buffer was freed, resume sending on the channels which ran out
+ * of them.
+ */
+static void l2cap_chan_le_seg_freed(void)
+{
+	struct bt_l2cap_chan *chan;
+	struct bt_conn *conn;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bt_l2cap_pool); i++) {
+		conn = bt_l2cap_pool[i].chan.conn;
+		if (!conn) {
+			continue;
+		}
+
+		for (chan = conn->channels; chan; chan = chan->_next) {
+			if (chan->rx.cid < L2CAP_LE_DYN_CID_START ||
+			    chan->rx.cid > L2CAP_LE_DYN_CID_END) {
+				continue;
+			}
+
+			if (atomic_test_and_clear_bit(&chan->_tx_flags,
+						      L2CAP_TX_NO_BUF)) {
+				l2cap_chan_le_send_resume(chan);
+			}
+		}
+	}
+}
+
+static void le_data_destroy(struct net_buf *buf)
+{
+	nano_fifo_put(buf->free, buf);
+	l2cap_chan_le_seg_freed();
+}
+
+static void le_view_destroy(struct net_buf *buf)
+{
+	struct net_buf *parent = seg_parent(buf);
+
+	nano_fifo_put(buf->free, buf);
+	net_buf_unref(parent);
+	l2cap_chan_le_seg_freed();
+}
+
+
+/* Start sending the next queued SDU, its length goes in front of the data
+ * unless there is no headroom for it and the headers of the segment.
+ */
+static bool l2cap_chan_le_next_sdu(struct bt_l2cap_chan *chan)
+{
+	struct net_buf *buf;
+
+	buf = nano_fifo_get(&chan->_tx_queue, TICKS_NONE);
+	if (!buf) {
+		return false;
+	}
+
+	if (net_buf_headroom(buf) >= BT_L2CAP_CHAN_SEND_RESERVE) {
+		net_buf_push_le16(buf, buf->len);
+	} else {
+		atomic_set_bit(&chan->_tx_flags, L2CAP_TX_SDU_HDR);
+	}
+
+	chan->_tx_buf = buf;
+
+	return true;
+}
+
+/* Create the next segment of the SDU in progress, the SDU buffer itself is
+ * the last segment (which works since we use net_buf_pull on it). Segment
+ * buffers are shared by all the channels so they are not waited for, sending
+ * resumes once one is freed instead.
+ */
+static struct net_buf *l2cap_chan_create_seg(struct bt_l2cap_chan *chan)
 {
+	struct net_buf *buf = chan->_tx_buf;
+	uint16_t len = min(chan->tx.mps, CONFIG_BLUETOOTH_L2CAP_TX_MPS);
 	struct net_buf *seg;
-	uint16_t headroom;
-	uint16_t len;
+	int remaining;
+	bool view;
+
+	if (atomic_test_and_clear_bit(&chan->_tx_flags, L2CAP_TX_SDU_HDR)) {
+		seg = net_buf_get_timeout(&le_data, L2CAP_SEG_RESERVE,
+					  TICKS_NONE);
+		if (!seg) {
+			atomic_set_bit(&chan->_tx_flags, L2CAP_TX_SDU_HDR);
+			return NULL;
+		}
 
-	/* Segment if data (+ data headroom) is bigger than MPS */
-	if (buf->len + sdu_hdr_len > chan->tx.mps) {
-		goto segment;
+		net_buf_add_le16(seg, buf->len);
+		len = min(buf->len, len - BT_L2CAP_SDU_HDR_LEN);
+		goto copy;
 	}
 
-	headroom = sizeof(struct bt_hci_acl_hdr) +
-		   sizeof(struct bt_l2cap_hdr) + sdu_hdr_len;
+	if (buf->len <= chan->tx.mps) {
+		chan->_tx_buf = NULL;
+		return buf;
+	}
 
-	/* Check if original buffer has enough headroom */
-	if (net_buf_headroom(buf) >= headroom) {
-		if (sdu_hdr_len) {
-			/* Push SDU length if set */
-			net_buf_push_le16(buf, buf->len);
+	/*
+	 * The other segments are alternately copied and sent as views into
+	 * the SDU, counting from the end: the headers of a view (and of the
+	 * SDU buffer) are pushed over the tail of the segment before it, so
+	 * that one must be a copy, or over the headroom of the SDU for the
+	 * first segment.
+	 */
+	remaining = (buf->len - chan->tx.mps + len - 1) / len;
+	view = !(remaining & 1);
+
+	if (view) {
+		seg = net_buf_get_timeout(&le_view, 0, TICKS_NONE);
+		if (!seg) {
+			return NULL;
 		}
-		return net_buf_ref(buf);
+
+		seg_parent(seg) = net_buf_ref(buf);
+		seg->data = buf->data;
+		seg->len = len;
+		net_buf_pull(buf, len);
+
+		return seg;
 	}
 
-segment:
-	seg = bt_l2cap_create_pdu(&le_data);
+	seg = net_buf_get_timeout(&le_data, L2CAP_SEG_RESERVE, TICKS_NONE);
 	if (!seg) {
 		return NULL;
 	}
 
-	if (sdu_hdr_len) {
-		net_buf_add_le16(seg, buf->len);
-	}
-
-	len = min(min(buf->len, L2CAP_LE_MIN_MTU - sdu_hdr_len), chan->tx.mps);
+copy:
 	memcpy(net_buf_add(seg, len), buf->data, len);
 	net_buf_pull(buf, len);
 
-	BT_DBG("chan %p seg %p len %u", chan, seg, seg->len);
+	/* The whole SDU fit in the first segment */
+	if (!buf->len) {
+		net_buf_unref(buf);
+		chan->_tx_buf = NULL;
+	}
 
 	return seg;
 }
 
-static int l2cap_chan_le_send(struct bt_l2cap_chan *chan, struct net_buf *buf,
-			      uint16_t sdu_hdr_len)
+static void l2cap_chan_le_tx_flush(struct bt_l2cap_chan *chan)
 {
-	int len;
-
-	/* Wait for credits */
-	nano_sem_take(&chan->tx.credits, TICKS_UNLIMITED);
+	struct net_buf *buf;
 
-	buf = l2cap_chan_create_seg(chan, buf, sdu_hdr_len);
-	if (!buf) {
-		return -ENOMEM;
+	if (chan->_tx_buf) {
+		net_buf_unref(chan->_tx_buf);
+		chan->_tx_buf = NULL;
 	}
 
-	/* Channel may have been disconnected while waiting for credits */
-	if (!chan->conn) {
+	while ((buf = nano_fifo_get(&chan->_tx_queue, TICKS_NONE))) {
 		net_buf_unref(buf);
-		return -ECONNRESET;
 	}
+}
 
-	BT_DBG("chan %p cid 0x%04x len %u credits %u", chan, chan->tx.cid,
-	       buf->len, chan->tx.credits.nsig);
+/* Send as many segments as there are credits for. Called by the sender and
+ * whenever credits arrive, only one of them sends at a time and the other
+ * one makes it go through the queue again.
+ */
+static void l2cap_chan_le_send_resume(struct bt_l2cap_chan *chan)
+{
+	struct net_buf *seg;
 
-	len = buf->len;
+	if (atomic_test_and_set_bit(&chan->_tx_flags, L2CAP_TX_BUSY)) {
+		atomic_set_bit(&chan->_tx_flags, L2CAP_TX_KICK);
+		return;
+	}
 
-	bt_l2cap_send(chan->conn, chan->tx.cid, buf);
+again:
+	atomic_clear_bit(&chan->_tx_flags, L2CAP_TX_KICK);
 
-	return len;
-}
+	while (chan->conn) {
+		if (!chan->_tx_buf && !l2cap_chan_le_next_sdu(chan)) {
+			break;
+		}
 
-static int l2cap_chan_le_send_sdu(struct bt_l2cap_chan *chan,
-				  struct net_buf *buf)
-{
-	int ret, sent, total_len;
+		if (!nano_sem_take(&chan->tx.credits, TICKS_NONE)) {
+			break;
+		}
 
-	if (buf->len > chan->tx.mtu) {
-		return -EMSGSIZE;
+		/* Set before trying so that a segment buffer freed meanwhile
+		 * makes it go through the queue again.
+		 */
+		atomic_set_bit(&chan->_tx_flags, L2CAP_TX_NO_BUF);
+
+		seg = l2cap_chan_create_seg(chan);
+		if (!seg) {
+			BT_DBG("chan %p waiting for a segment buffer", chan);
+			l2cap_chan_tx_give_credits(chan, 1);
+			break;
+		}
+
+		atomic_clear_bit(&chan->_tx_flags, L2CAP_TX_NO_BUF);
+
+		BT_DBG("chan %p cid 0x%04x len %u credits %u", chan,
+		       chan->tx.cid, seg->len, chan->tx.credits.nsig);
+
+		bt_l2cap_send(chan->conn, chan->tx.cid, seg);
+	}
+
+	if (!chan->conn) {
+		l2cap_chan_le_tx_flush(chan);
 	}
 
-	total_len = buf->len;
+	atomic_clear_bit(&chan->_tx_flags, L2CAP_TX_BUSY);
 
-	/* Add SDU length for the first segment */
-	ret = l2cap_chan_le_send(chan, buf, BT_L2CAP_SDU_HDR_LEN);
-	if (ret < 0) {
-		return ret;
+	if (atomic_test_bit(&chan->_tx_flags, L2CAP_TX_KICK) &&
+	    !atomic_test_and_set_bit(&chan->_tx_flags, L2CAP_TX_BUSY)) {
+		goto again;
 	}
+}
 
-	/* Send remaining segments */
-	for (sent = ret; sent < total_len; sent += ret) {
-		ret = l2cap_chan_le_send(chan, buf, 0);
-		if (ret < 0) {
-			return ret;
-		}
+static int l2cap_chan_le_send_sdu(struct bt_l2cap_chan *chan,
+				  struct net_buf *buf)
+{
+	int len = buf->len;
+
+	if (len > chan->tx.mtu) {
+		return -EMSGSIZE;
 	}
 
-	BT_DBG("chan %p cid 0x%04x sent %u", chan, chan->tx.cid, sent);
+	nano_fifo_put(&chan->_tx_queue, buf);
 
-	net_buf_unref(buf);
+	l2cap_chan_le_send_resume(chan);
 
-	return sent;
+	return len;
 }
 
 int bt_l2cap_chan_send(struct bt_l2cap_chan *chan, struct net_buf *buf)
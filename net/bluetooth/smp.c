@@ -27,6 +27,7 @@
 #include <atomic.h>
 #include <misc/util.h>
 #include <misc/byteorder.h>
+#include <misc/nano_work.h>
 
 #include <net/buf.h>
 #include <bluetooth/log.h>
@@ -48,7 +49,6 @@
 #include "conn_internal.h"
 #include "l2cap_internal.h"
 #include "smp.h"
-#include "stack.h"
 
 #define SMP_TIMEOUT (30 * sys_clock_ticks_per_sec)
 
@@ -87,6 +87,8 @@ enum {
 	SMP_FLAG_USER,		/* if waiting for user input */
 	SMP_FLAG_BOND,		/* if bonding */
 	SMP_FLAG_SC_DEBUG_KEY,	/* if Secure Connection are using debug key */
+	SMP_FLAG_TIMER_RESTART,	/* if expired timeout should restart timer */
+	SMP_FLAG_TIMER_STALE,	/* if expired timeout should be ignored */
 };
 
 /* SMP channel specific context */
@@ -94,8 +96,8 @@ struct bt_smp {
 	/* The channel this context is associated with */
 	struct bt_l2cap_chan	chan;
 
-	/* SMP Timeout fiber handle */
-	nano_thread_id_t  timeout;
+	/* SMP Timeout */
+	struct nano_delayed_work	work;
 
 	/* Commands that remote is allowed to send */
 	atomic_t		allowed_cmds;
@@ -147,9 +149,6 @@ struct bt_smp {
 
 	/* Remote key distribution */
 	uint8_t			remote_dist;
-
-	/* stack for timeout fiber */
-	BT_STACK(stack, 128);
 };
 
 /* based on table 2.8 Core Spec 2.3.5.1 Vol. 3 Part H */
@@ -562,19 +561,19 @@ static int smp_g2(const uint8_t u[32], const uint8_t v[32],
 static void smp_reset(struct bt_smp *smp)
 {
 	struct bt_conn *conn = smp->chan.conn;
+	int err;
 
-	if (smp->timeout) {
-		fiber_fiber_delayed_start_cancel(smp->timeout);
-		smp->timeout = NULL;
-
-		stack_analyze("smp timeout stack", smp->stack,
-			      sizeof(smp->stack));
-	}
+	err = nano_delayed_work_cancel(&smp->work);
 
 	smp->method = JUST_WORKS;
 	atomic_set(&smp->allowed_cmds, 0);
 	atomic_set(&smp->flags, 0);
 
+	/* The timeout expired already and its handler is about to run */
+	if (err == -EINPROGRESS) {
+		atomic_set_bit(&smp->flags, SMP_FLAG_TIMER_STALE);
+	}
+
 	if (conn->required_sec_level != conn->sec_level) {
 		/* TODO report error */
 		/* reset required security level in case of error */
@@ -593,14 +592,23 @@ static void smp_reset(struct bt_smp *smp)
 #endif /* CONFIG_BLUETOOTH_PERIPHERAL */
 }
 
-static void smp_timeout(int arg1, int arg2)
+static void smp_timeout(struct nano_work *work)
 {
-	struct bt_smp *smp = (struct bt_smp *)arg1;
-	ARG_UNUSED(arg2);
+	struct bt_smp *smp = CONTAINER_OF(work, struct bt_smp, work.work);
 
-	BT_ERR("SMP Timeout");
+	/* The timer was restarted after the timeout expired */
+	if (atomic_test_and_clear_bit(&smp->flags, SMP_FLAG_TIMER_RESTART)) {
+		atomic_clear_bit(&smp->flags, SMP_FLAG_TIMER_STALE);
+		nano_delayed_work_submit(&smp->work, SMP_TIMEOUT);
+		return;
+	}
 
-	smp->timeout = NULL;
+	/* The pairing was reset after the timeout expired */
+	if (atomic_test_and_clear_bit(&smp->flags, SMP_FLAG_TIMER_STALE)) {
+		return;
+	}
+
+	BT_ERR("SMP Timeout");
 
 	/*
 	 * If SMP timeout occurred during key distribution we should assume
@@ -618,13 +626,14 @@ static void smp_timeout(int arg1, int arg2)
 
 static void smp_restart_timer(struct bt_smp *smp)
 {
-	if (smp->timeout) {
-		fiber_fiber_delayed_start_cancel(smp->timeout);
+	/*
+	 * If the timeout expired already, its handler is about to run and
+	 * cannot be cancelled: let it restart the timer instead of failing
+	 * the pairing.
+	 */
+	if (nano_delayed_work_submit(&smp->work, SMP_TIMEOUT) == -EINPROGRESS) {
+		atomic_set_bit(&smp->flags, SMP_FLAG_TIMER_RESTART);
 	}
-
-	smp->timeout = fiber_delayed_start(smp->stack, sizeof(smp->stack),
-					   smp_timeout, (int) smp, 0, 7, 0,
-					   SMP_TIMEOUT);
 }
 
 static struct net_buf *smp_create_pdu(struct bt_conn *conn, uint8_t op,
@@ -2028,7 +2037,7 @@ static uint8_t smp_ident_info(struct bt_smp *smp, struct net_buf *buf)
 			return BT_SMP_ERR_UNSPECIFIED;
 		}
 
-		memcpy(keys->irk.val, req->irk, 16);
+		bt_keys_set_irk(keys, req->irk);
 	}
 
 	atomic_set_bit(&smp->allowed_cmds, BT_SMP_CMD_IDENT_ADDR_INFO);
@@ -2084,7 +2093,7 @@ static uint8_t smp_ident_addr_info(struct bt_smp *smp, struct net_buf *buf)
 			 */
 			if (!bt_addr_le_is_identity(&conn->le.dst)) {
 				bt_addr_le_copy(&keys->addr, &req->addr);
-				bt_addr_le_copy(&conn->le.dst, &req->addr);
+				bt_conn_set_dst_le(conn, &req->addr);
 
 				bt_conn_identity_resolved(conn);
 			}
@@ -2584,9 +2593,11 @@ static void bt_smp_disconnected(struct bt_l2cap_chan *chan)
 
 	BT_DBG("chan %p cid 0x%04x", chan, chan->tx.cid);
 
-	if (smp->timeout) {
-		fiber_fiber_delayed_start_cancel(smp->timeout);
-	}
+	/*
+	 * If the timeout work is being processed already, clearing the
+	 * context below prevents the system workqueue from running it.
+	 */
+	nano_delayed_work_cancel(&smp->work);
 
 	if (keys) {
 		/*
@@ -2670,6 +2681,44 @@ bool bt_smp_irk_matches(const uint8_t irk[16], const bt_addr_t *addr)
 	return !memcmp(addr->val, hash, 3);
 }
 
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+int bt_smp_irk_expand(const uint8_t irk[16],
+		      struct tc_aes_key_sched_struct *sched)
+{
+	uint8_t tmp[16];
+
+	swap_buf(tmp, irk, 16);
+
+	if (tc_aes128_set_encrypt_key(sched, tmp) == TC_FAIL) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Same as bt_smp_irk_matches() but without expanding the IRK every time */
+bool bt_smp_irk_sched_matches(struct tc_aes_key_sched_struct *sched,
+			      const bt_addr_t *addr)
+{
+	uint8_t res[16];
+
+	BT_DBG("bdaddr %s", bt_addr_str(addr));
+
+	/* r' = padding || r, in big endian for tinycrypt, and ah is the
+	 * least significant 24 bits of e(k, r').
+	 */
+	memset(res, 0, 13);
+	swap_buf(&res[13], addr->val + 3, 3);
+
+	if (tc_aes_encrypt(res, res, sched) == TC_FAIL) {
+		return false;
+	}
+
+	return res[15] == addr->val[0] && res[14] == addr->val[1] &&
+	       res[13] == addr->val[2];
+}
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
+
 #if defined(CONFIG_BLUETOOTH_SIGNING)
 /* Sign message using msg as a buffer, len is a size of the message,
  * msg buffer contains message itself, 32 bit count and signature,
@@ -3362,6 +3411,8 @@ static int bt_smp_accept(struct bt_conn *conn, struct bt_l2cap_chan **chan)
 
 		smp->chan.ops = &ops;
 
+		nano_delayed_work_init(&smp->work, smp_timeout);
+
 		*chan = &smp->chan;
 
 		return 0;
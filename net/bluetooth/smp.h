@@ -131,6 +131,14 @@ struct bt_smp_dhkey_check {
 } __packed;
 
 bool bt_smp_irk_matches(const uint8_t irk[16], const bt_addr_t *addr);
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+struct tc_aes_key_sched_struct;
+
+int bt_smp_irk_expand(const uint8_t irk[16],
+		      struct tc_aes_key_sched_struct *sched);
+bool bt_smp_irk_sched_matches(struct tc_aes_key_sched_struct *sched,
+			      const bt_addr_t *addr);
+#endif /* CONFIG_BLUETOOTH_RPA_CACHE */
 int bt_smp_send_pairing_req(struct bt_conn *conn);
 int bt_smp_send_security_req(struct bt_conn *conn);
 void bt_smp_update_keys(struct bt_conn *conn);
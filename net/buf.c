@@ -43,21 +43,18 @@
 #define NET_BUF_ASSERT(cond)
 #endif /* CONFIG_NET_BUF_DEBUG */
 
-struct net_buf *net_buf_get(struct nano_fifo *fifo, size_t reserve_head)
+struct net_buf *net_buf_get_timeout(struct nano_fifo *fifo,
+				    size_t reserve_head, int32_t timeout)
 {
 	struct net_buf *buf;
 
-	NET_BUF_DBG("fifo %p reserve %u\n", fifo, reserve_head);
+	NET_BUF_DBG("fifo %p reserve %u timeout %d\n", fifo, reserve_head,
+		    timeout);
 
-	buf = nano_fifo_get(fifo, TICKS_NONE);
+	buf = nano_fifo_get(fifo, timeout);
 	if (!buf) {
-		if (sys_execution_context_type_get() == NANO_CTX_ISR) {
-			NET_BUF_ERR("Failed to get free buffer\n");
-			return NULL;
-		}
-
-		NET_BUF_WARN("Low on buffers. Waiting (fifo %p)\n", fifo);
-		buf = nano_fifo_get(fifo, TICKS_UNLIMITED);
+		NET_BUF_DBG("Failed to get free buffer (fifo %p)\n", fifo);
+		return NULL;
 	}
 
 	buf->ref  = 1;
@@ -69,6 +66,25 @@ struct net_buf *net_buf_get(struct nano_fifo *fifo, size_t reserve_head)
 	return buf;
 }
 
+struct net_buf *net_buf_get(struct nano_fifo *fifo, size_t reserve_head)
+{
+	struct net_buf *buf;
+
+	buf = net_buf_get_timeout(fifo, reserve_head, TICKS_NONE);
+	if (buf) {
+		return buf;
+	}
+
+	if (sys_execution_context_type_get() == NANO_CTX_ISR) {
+		NET_BUF_ERR("Failed to get free buffer\n");
+		return NULL;
+	}
+
+	NET_BUF_WARN("Low on buffers. Waiting (fifo %p)\n", fifo);
+
+	return net_buf_get_timeout(fifo, reserve_head, TICKS_UNLIMITED);
+}
+
 void net_buf_unref(struct net_buf *buf)
 {
 	NET_BUF_DBG("buf %p ref %u fifo %p\n", buf, buf->ref, buf->free);
@@ -119,6 +135,18 @@ void *net_buf_add(struct net_buf *buf, size_t len)
 	return tail;
 }
 
+uint8_t *net_buf_add_u8(struct net_buf *buf, uint8_t value)
+{
+	uint8_t *u8;
+
+	NET_BUF_DBG("buf %p value 0x%02x\n", buf, value);
+
+	u8 = net_buf_add(buf, 1);
+	*u8 = value;
+
+	return u8;
+}
+
 void net_buf_add_le16(struct net_buf *buf, uint16_t value)
 {
 	NET_BUF_DBG("buf %p value %u\n", buf, value);
@@ -156,6 +184,16 @@ void *net_buf_pull(struct net_buf *buf, size_t len)
 	return buf->data += len;
 }
 
+uint8_t net_buf_pull_u8(struct net_buf *buf)
+{
+	uint8_t value;
+
+	value = buf->data[0];
+	net_buf_pull(buf, 1);
+
+	return value;
+}
+
 uint16_t net_buf_pull_le16(struct net_buf *buf)
 {
 	uint16_t value;
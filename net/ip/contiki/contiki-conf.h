@@ -64,6 +64,10 @@ typedef unsigned int uip_stats_t;
 #define NETSTACK_CONF_FRAGMENT null_fragmentation
 #endif /* SICSLOWPAN_CONF_ENABLE */
 
+#ifdef CONFIG_6LOWPAN_IPHC_CACHE_SIZE
+#define SICSLOWPAN_CONF_IPHC_CACHE_SIZE CONFIG_6LOWPAN_IPHC_CACHE_SIZE
+#endif /* CONFIG_6LOWPAN_IPHC_CACHE_SIZE */
+
 #ifdef CONFIG_NETWORKING_WITH_15_4
 #ifdef CONFIG_NETWORKING_WITH_15_4_PAN_ID
 #define IEEE802154_CONF_PANID CONFIG_NETWORKING_WITH_15_4_PAN_ID
@@ -81,6 +85,21 @@ typedef unsigned int uip_stats_t;
 #else /* 6lowpan compression method */
 #define SICSLOWPAN_CONF_COMPRESSION SICSLOWPAN_COMPRESSION_IPV6
 #endif /* 6lowpan compression method */
+#ifdef CONFIG_6LOWPAN_REASS_CONTEXTS
+#define SICSLOWPAN_CONF_REASS_CONTEXTS CONFIG_6LOWPAN_REASS_CONTEXTS
+#endif /* CONFIG_6LOWPAN_REASS_CONTEXTS */
+#ifdef CONFIG_6LOWPAN_REASS_FRAGMENTS
+#define SICSLOWPAN_CONF_FRAGMENT_BUFFERS CONFIG_6LOWPAN_REASS_FRAGMENTS
+#endif /* CONFIG_6LOWPAN_REASS_FRAGMENTS */
+#ifdef CONFIG_CSMA_NEIGHBOR_QUEUES
+#define CSMA_CONF_MAX_NEIGHBOR_QUEUES CONFIG_CSMA_NEIGHBOR_QUEUES
+#endif /* CONFIG_CSMA_NEIGHBOR_QUEUES */
+#ifdef CONFIG_CSMA_BURST
+#define CSMA_CONF_BURST 1
+#endif /* CONFIG_CSMA_BURST */
+#ifdef CONFIG_CSMA_ADAPTIVE_BACKOFF
+#define CSMA_CONF_ADAPTIVE_BACKOFF 1
+#endif /* CONFIG_CSMA_ADAPTIVE_BACKOFF */
 #ifdef CONFIG_15_4_BEACON_SUPPORT
 #define FRAMER_802154_HANDLER handler_802154_frame_received
 #endif /* CONFIG_15_4_BEACON_SUPPORT */
@@ -170,6 +189,11 @@ typedef unsigned int uip_stats_t;
 #undef COAP_OBSERVE_CLIENT
 #endif
 
+#ifdef CONFIG_COAP_CONGESTION_CONTROL
+#define COAP_CONGESTION_CONTROL 1
+#define COAP_NSTART CONFIG_COAP_NSTART
+#endif
+
 #ifdef CONFIG_NETWORKING_STATISTICS
 #define UIP_CONF_STATISTICS 1
 #endif
@@ -97,6 +97,34 @@ void uip_log(char *msg);
 #error Change CSMA_CONF_MAX_MAC_TRANSMISSIONS in contiki-conf.h or in your Makefile.
 #endif /* CSMA_CONF_MAX_MAC_TRANSMISSIONS < 1 */
 
+/* When enabled, the packets queued for a neighbor are handed to the
+   RDC layer as a list and sent back-to-back, with the frame pending
+   bit set in all but the last one. */
+#ifdef CSMA_CONF_BURST
+#define CSMA_BURST CSMA_CONF_BURST
+#else
+#define CSMA_BURST 0
+#endif /* CSMA_CONF_BURST */
+
+/* When enabled, the retransmission backoff window follows the recent
+   collision rate instead of only the number of transmissions. */
+#ifdef CSMA_CONF_ADAPTIVE_BACKOFF
+#define CSMA_ADAPTIVE_BACKOFF CSMA_CONF_ADAPTIVE_BACKOFF
+#else
+#define CSMA_ADAPTIVE_BACKOFF 0
+#endif /* CSMA_CONF_ADAPTIVE_BACKOFF */
+
+/* The number of buckets of the neighbor queue hash table */
+#ifdef CSMA_CONF_NEIGHBOR_HASH_SIZE
+#define CSMA_NEIGHBOR_HASH_SIZE CSMA_CONF_NEIGHBOR_HASH_SIZE
+#else
+#define CSMA_NEIGHBOR_HASH_SIZE 8
+#endif /* CSMA_CONF_NEIGHBOR_HASH_SIZE */
+
+#if (CSMA_NEIGHBOR_HASH_SIZE & (CSMA_NEIGHBOR_HASH_SIZE - 1)) != 0
+#error CSMA_CONF_NEIGHBOR_HASH_SIZE must be a power of two.
+#endif
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
@@ -111,6 +139,8 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
+  /* The head packet waits for its retransmission timer */
+  uint8_t backoff;
   LIST_STRUCT(queued_packet_list);
 };
 
@@ -132,16 +162,43 @@ struct neighbor_queue {
 MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
-LIST(neighbor_list);
+
+/* Neighbor queues hashed by link address, each bucket is a list */
+static void *neighbor_hash[CSMA_NEIGHBOR_HASH_SIZE];
+
+/* The neighbor whose queue transmit_packet_list() is sending, reset
+   when the queue is emptied and the neighbor freed. */
+static struct neighbor_queue *sending;
+
+#if CSMA_ADAPTIVE_BACKOFF
+/* Recent channel contention, as a fraction of CONTENTION_ONE. Every
+   transmission result moves it by 1/2^CONTENTION_SHIFT towards busy
+   (collision or deferral) or idle (success). */
+#define CONTENTION_ONE   256
+#define CONTENTION_SHIFT 3
+static uint16_t contention;
+#endif /* CSMA_ADAPTIVE_BACKOFF */
 
 static void packet_sent(struct net_buf *buf, void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(struct net_buf *buf, void *ptr);
 
+/*---------------------------------------------------------------------------*/
+static list_t
+neighbor_bucket(const linkaddr_t *addr)
+{
+  uint8_t hash = 0;
+  int i;
+
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = ((hash << 1) | (hash >> 7)) ^ addr->u8[i];
+  }
+  return (list_t)&neighbor_hash[hash & (CSMA_NEIGHBOR_HASH_SIZE - 1)];
+}
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
-  struct neighbor_queue *n = list_head(neighbor_list);
+  struct neighbor_queue *n = list_head(neighbor_bucket(addr));
   while(n != NULL) {
     if(linkaddr_cmp(&n->addr, addr)) {
       return n;
@@ -169,6 +226,33 @@ default_timebase(void)
 }
 /*---------------------------------------------------------------------------*/
 static void
+free_neighbor(struct neighbor_queue *n)
+{
+  list_remove(neighbor_bucket(&n->addr), n);
+  memb_free(&neighbor_memb, n);
+  if(sending == n) {
+    sending = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if CSMA_ADAPTIVE_BACKOFF
+static void
+update_contention(int status)
+{
+  switch(status) {
+  case MAC_TX_OK:
+    contention -= contention >> CONTENTION_SHIFT;
+    break;
+  case MAC_TX_COLLISION:
+  case MAC_TX_DEFERRED:
+    contention -= contention >> CONTENTION_SHIFT;
+    contention += CONTENTION_ONE >> CONTENTION_SHIFT;
+    break;
+  }
+}
+#endif /* CSMA_ADAPTIVE_BACKOFF */
+/*---------------------------------------------------------------------------*/
+static void
 free_packet(struct net_buf *buf, struct neighbor_queue *n, struct rdc_buf_list *p)
 {
   if(p != NULL) {
@@ -181,15 +265,14 @@ free_packet(struct net_buf *buf, struct neighbor_queue *n, struct rdc_buf_list *
     PRINTF("csma: free_queued_packet, queue length %d, free packets %d\n",
            list_length(n->queued_packet_list), memb_numfree(&packet_memb));
     if(list_head(n->queued_packet_list) != NULL) {
-      /* There is a next packet. We reset current tx information */
+      /* There is a next packet. We reset current tx information, the
+         packet is sent by the transmit_packet_list() loop. */
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
-      transmit_packet_list(buf, n);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      free_neighbor(n);
       l2_buf_unref(buf);
     }
   }
@@ -199,15 +282,39 @@ static void
 transmit_packet_list(struct net_buf *buf, void *ptr)
 {
   struct neighbor_queue *n = ptr;
-  if(n) {
-    struct rdc_buf_list *q = list_head(n->queued_packet_list);
-    if(q != NULL) {
-      PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
-          list_length(n->queued_packet_list));
-      /* Send packets in the neighbor's list */
-      NETSTACK_RDC.send_list(buf, packet_sent, n, q);
+  struct neighbor_queue *prev = sending;
+  struct rdc_buf_list *q;
+
+  if(n == NULL) {
+    return;
+  }
+
+  /* Called by the retransmission timer or for a new packet. Keep
+     sending until the queue is empty, which frees the neighbor, or
+     until the head packet has to back off. The sent callback does
+     not call back here, so the stack depth does not grow with the
+     queue length. */
+  n->backoff = 0;
+  sending = n;
+  while((q = list_head(n->queued_packet_list)) != NULL) {
+    PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
+        list_length(n->queued_packet_list));
+#if CSMA_BURST
+    /* Send packets in the neighbor's list */
+    NETSTACK_RDC.send_list(buf, packet_sent, n, q);
+#else /* CSMA_BURST */
+    queuebuf_to_packetbuf(buf, q->buf);
+    NETSTACK_RDC.send(buf, packet_sent, n);
+#endif /* CSMA_BURST */
+    if(sending != n || n->backoff) {
+      break;
+    }
+    if(list_head(n->queued_packet_list) == q) {
+      PRINTF("csma: packet %p not reported by the RDC\n", q);
+      break;
     }
   }
+  sending = prev;
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -241,6 +348,10 @@ packet_sent(struct net_buf *buf, void *ptr, int status, int num_transmissions)
     break;
   }
 
+#if CSMA_ADAPTIVE_BACKOFF
+  update_contention(status);
+#endif /* CSMA_ADAPTIVE_BACKOFF */
+
   /* Find out what packet this callback refers to */
   for(q = list_head(n->queued_packet_list);
       q != NULL; q = list_item_next(q)) {
@@ -282,7 +393,14 @@ packet_sent(struct net_buf *buf, void *ptr, int status, int num_transmissions)
         /* The retransmission time uses a truncated exponential backoff
          * so that the interval between the transmissions increase with
          * each retransmit. */
+#if CSMA_ADAPTIVE_BACKOFF
+        /* Start from the smallest window on an idle channel and widen
+         * it by up to CSMA_MAX_BACKOFF_EXPONENT with the contention. */
+        backoff_exponent = num_tx - 1 +
+          contention * (CSMA_MAX_BACKOFF_EXPONENT + 1) / (CONTENTION_ONE + 1);
+#else /* CSMA_ADAPTIVE_BACKOFF */
         backoff_exponent = num_tx;
+#endif /* CSMA_ADAPTIVE_BACKOFF */
 
         /* Truncate the exponent if needed. */
         if(backoff_exponent > CSMA_MAX_BACKOFF_EXPONENT) {
@@ -300,6 +418,7 @@ packet_sent(struct net_buf *buf, void *ptr, int status, int num_transmissions)
           PRINTF("csma: retransmitting with time %lu %p\n", time, q);
           ctimer_set(buf, &n->transmit_timer, time,
                      transmit_packet_list, n);
+          n->backoff = 1;
           /* This is needed to correctly attribute energy that we spent
              transmitting this packet. */
           queuebuf_update_attr_from_packetbuf(buf, q->buf);
@@ -364,10 +483,11 @@ send_packet(struct net_buf *buf, mac_callback_t sent, bool last_fragment, void *
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+      n->backoff = 0;
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
-      /* Add neighbor to the list */
-      list_add(neighbor_list, n);
+      /* Add neighbor to the hash table */
+      list_add(neighbor_bucket(addr), n);
     }
   }
 
@@ -404,7 +524,13 @@ send_packet(struct net_buf *buf, mac_callback_t sent, bool last_fragment, void *
             /* if received packet is last fragment/only one packet start sending
              * packets in list, do not start any timer.*/
             if (last_fragment) {
-               transmit_packet_list(buf, n);
+              if (n->backoff || sending == n) {
+                /* The queue is already being sent with another buffer,
+                 * the new packets follow the pending ones. */
+                l2_buf_unref(buf);
+              } else {
+                transmit_packet_list(buf, n);
+              }
             }
             return 1;
           }
@@ -416,8 +542,7 @@ send_packet(struct net_buf *buf, mac_callback_t sent, bool last_fragment, void *
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
       if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+        free_neighbor(n);
       }
     } else {
       PRINTF("csma: Neighbor queue full\n");
@@ -460,8 +585,14 @@ channel_check_interval(void)
 static void
 init(void)
 {
+  int i;
+
   queuebuf_init();
 
+  for(i = 0; i < CSMA_NEIGHBOR_HASH_SIZE; i++) {
+    list_init((list_t)&neighbor_hash[i]);
+  }
+
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
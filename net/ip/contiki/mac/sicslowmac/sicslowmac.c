@@ -109,7 +109,7 @@ send_packet(struct net_buf *buf, mac_callback_t sent, void *ptr)
   /* Build the FCF. */
   params.fcf.frame_type = FRAME802154_DATAFRAME;
   params.fcf.security_enabled = 0;
-  params.fcf.frame_pending = 0;
+  params.fcf.frame_pending = packetbuf_attr(buf, PACKETBUF_ATTR_PENDING);
   params.fcf.ack_required = packetbuf_attr(buf, PACKETBUF_ATTR_RELIABLE);
   params.fcf.panid_compression = 0;
 
@@ -169,16 +169,23 @@ send_packet(struct net_buf *buf, mac_callback_t sent, void *ptr)
       case RADIO_TX_OK:
         sent(buf, ptr, MAC_TX_OK, 1);
         break;
-      case RADIO_TX_ERR:
-        sent(buf, ptr, MAC_TX_ERR, 1);
-        break;
       case RADIO_TX_COLLISION:
         sent(buf, ptr, MAC_TX_COLLISION, 1);
         break;
+      case RADIO_TX_NOACK:
+        sent(buf, ptr, MAC_TX_NOACK, 1);
+        break;
+      default:
+        sent(buf, ptr, MAC_TX_ERR, 1);
+        break;
       }
     }
   } else {
     PRINTF("6MAC-UT: too large header: %u\n", len);
+    ret = RADIO_TX_ERR;
+    if(sent) {
+      sent(buf, ptr, MAC_TX_ERR, 1);
+    }
   }
 
   return ret;
@@ -187,11 +194,22 @@ send_packet(struct net_buf *buf, mac_callback_t sent, void *ptr)
 uint8_t
 send_list(struct net_buf *buf, mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
 {
-  if(buf_list != NULL) {
+  while(buf_list != NULL) {
+    /* We backup the next pointer, as the sent callback frees the
+     * current entry */
+    struct rdc_buf_list *next = buf_list->next;
+
     queuebuf_to_packetbuf(buf, buf_list->buf);
-    if (!send_packet(buf, sent, ptr)) {
+
+    /* Tell the receiver that more frames follow */
+    packetbuf_set_attr(buf, PACKETBUF_ATTR_PENDING, next != NULL);
+
+    /* If the transmission failed, let the MAC layer back off rather
+     * than sending the next frames. */
+    if(send_packet(buf, sent, ptr) != RADIO_TX_OK) {
       return 0;
     }
+    buf_list = next;
   }
 
   return 1;
@@ -170,6 +170,16 @@ rpl_get_parent_link_metric(const uip_lladdr_t *addr)
   }
 }
 /*---------------------------------------------------------------------------*/
+uint16_t
+rpl_get_parent_path_cost(rpl_parent_t *p)
+{
+  if(!(p->flags & RPL_PARENT_FLAG_PATH_COST_VALID)) {
+    p->path_cost = p->dag->instance->of->parent_path_cost(p);
+    p->flags |= RPL_PARENT_FLAG_PATH_COST_VALID;
+  }
+  return p->path_cost;
+}
+/*---------------------------------------------------------------------------*/
 uip_ipaddr_t *
 rpl_get_parent_ipaddr(rpl_parent_t *p)
 {
@@ -704,6 +714,47 @@ rpl_find_parent_any_dag(rpl_instance_t *instance, uip_ipaddr_t *addr)
   }
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Updates the preferred parent of a DAG after a change of parent p, without
+ * going through the whole parent set when possible. The preferred parent is
+ * the best one of the set as long as every change is reported here, so:
+ * - another parent only has to be compared with the preferred parent,
+ * - the preferred parent stays if its path cost did not increase.
+ * The set is only searched again when the preferred parent got worse, and
+ * the OF hysteresis still keeps it if the others are not clearly better.
+ */
+static rpl_parent_t *
+update_parent(rpl_dag_t *dag, rpl_parent_t *p)
+{
+  rpl_parent_t *preferred = dag->preferred_parent;
+  rpl_parent_t *best;
+  uint16_t last_cost;
+
+  if(preferred == NULL || preferred->dag != dag ||
+     preferred->rank == INFINITE_RANK) {
+    return rpl_select_parent(dag);
+  }
+
+  if(p == preferred) {
+    last_cost = preferred->path_cost;
+    if(rpl_get_parent_path_cost(preferred) > last_cost) {
+      RPL_STAT(rpl_stats.parent_rescans++);
+      return rpl_select_parent(dag);
+    }
+    return preferred;
+  }
+
+  if(p->dag != dag || p->rank == INFINITE_RANK) {
+    return preferred;
+  }
+
+  best = dag->instance->of->best_parent(preferred, p);
+  if(best != NULL) {
+    rpl_set_preferred_parent(dag, best);
+  }
+  return dag->preferred_parent;
+}
+/*---------------------------------------------------------------------------*/
 rpl_dag_t *
 rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
 {
@@ -716,7 +767,7 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
 
   best_dag = instance->current_dag;
   if(best_dag->rank != ROOT_RANK(instance)) {
-    if(rpl_select_parent(p->dag) != NULL) {
+    if(update_parent(p->dag, p) != NULL) {
       if(p->dag != best_dag) {
         best_dag = instance->of->best_dag(best_dag, p->dag);
       }
@@ -827,6 +878,9 @@ rpl_select_parent(rpl_dag_t *dag)
 
   if(best != NULL) {
     rpl_set_preferred_parent(dag, best);
+    /* Keep the path cost of the preferred parent up to date, a change
+       of it is detected by update_parent(). */
+    rpl_get_parent_path_cost(best);
   }
 
   return best;
@@ -897,6 +951,7 @@ rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent)
   PRINTF("\n");
 
   parent->dag = dag_dst;
+  parent->flags &= ~RPL_PARENT_FLAG_PATH_COST_VALID;
 }
 /*---------------------------------------------------------------------------*/
 rpl_dag_t *
@@ -1388,6 +1443,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
       }
     } else {
       p->rank=dio->rank;
+      p->flags &= ~RPL_PARENT_FLAG_PATH_COST_VALID;
     }
   }
 
@@ -1406,7 +1462,10 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
   /* We have allocated a candidate parent; process the DIO further. */
 
 #if RPL_DAG_MC != RPL_DAG_MC_NONE
-  memcpy(&p->mc, &dio->mc, sizeof(p->mc));
+  if(memcmp(&p->mc, &dio->mc, sizeof(p->mc))) {
+    memcpy(&p->mc, &dio->mc, sizeof(p->mc));
+    p->flags &= ~RPL_PARENT_FLAG_PATH_COST_VALID;
+  }
 #endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
   if(rpl_process_parent_event(instance, p) == 0) {
     PRINTF("RPL: The candidate parent is rejected\n");
@@ -674,6 +674,7 @@ dao_input(struct net_buf *buf)
           DAG_RANK(parent->rank, instance), DAG_RANK(dag->rank, instance));
       parent->rank = INFINITE_RANK;
       parent->flags |= RPL_PARENT_FLAG_UPDATED;
+      parent->flags &= ~RPL_PARENT_FLAG_PATH_COST_VALID;
       return;
     }
 
@@ -682,6 +683,7 @@ dao_input(struct net_buf *buf)
       PRINTF("RPL: Loop detected when receiving a unicast DAO from our parent\n");
       parent->rank = INFINITE_RANK;
       parent->flags |= RPL_PARENT_FLAG_UPDATED;
+      parent->flags &= ~RPL_PARENT_FLAG_PATH_COST_VALID;
       return;
     }
   }
@@ -54,6 +54,7 @@
 
 static void reset(rpl_dag_t *);
 static void neighbor_link_callback(rpl_parent_t *, int, int);
+static uint16_t calculate_path_metric(rpl_parent_t *);
 static rpl_parent_t *best_parent(rpl_parent_t *, rpl_parent_t *);
 static rpl_dag_t *best_dag(rpl_dag_t *, rpl_dag_t *);
 static rpl_rank_t calculate_rank(rpl_parent_t *, rpl_rank_t);
@@ -62,6 +63,7 @@ static void update_metric_container(rpl_instance_t *);
 rpl_of_t rpl_mrhof = {
   reset,
   neighbor_link_callback,
+  calculate_path_metric,
   best_parent,
   best_dag,
   calculate_rank,
@@ -217,8 +219,8 @@ best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
   min_diff = RPL_DAG_MC_ETX_DIVISOR /
              PARENT_SWITCH_THRESHOLD_DIV;
 
-  p1_metric = calculate_path_metric(p1);
-  p2_metric = calculate_path_metric(p2);
+  p1_metric = rpl_get_parent_path_cost(p1);
+  p2_metric = rpl_get_parent_path_cost(p2);
 
   /* Maintain stability of the preferred parent in case of similar ranks. */
   if(p1 == dag->preferred_parent || p2 == dag->preferred_parent) {
@@ -265,8 +267,10 @@ update_metric_container(rpl_instance_t *instance)
 
   if(dag->rank == ROOT_RANK(instance)) {
     path_metric = 0;
+  } else if(dag->preferred_parent == NULL) {
+    path_metric = calculate_path_metric(NULL);
   } else {
-    path_metric = calculate_path_metric(dag->preferred_parent);
+    path_metric = rpl_get_parent_path_cost(dag->preferred_parent);
   }
 
 #if RPL_DAG_MC == RPL_DAG_MC_ETX
@@ -47,6 +47,7 @@
 #include "contiki/ip/uip-debug.h"
 
 static void reset(rpl_dag_t *);
+static uint16_t parent_path_cost(rpl_parent_t *);
 static rpl_parent_t *best_parent(rpl_parent_t *, rpl_parent_t *);
 static rpl_dag_t *best_dag(rpl_dag_t *, rpl_dag_t *);
 static rpl_rank_t calculate_rank(rpl_parent_t *, rpl_rank_t);
@@ -55,6 +56,7 @@ static void update_metric_container(rpl_instance_t *);
 rpl_of_t rpl_of0 = {
   reset,
   NULL,
+  parent_path_cost,
   best_parent,
   best_dag,
   calculate_rank,
@@ -122,34 +124,37 @@ best_dag(rpl_dag_t *d1, rpl_dag_t *d2)
   }
 }
 
+static uint16_t
+parent_path_cost(rpl_parent_t *p)
+{
+  uip_ds6_nbr_t *nbr = rpl_get_nbr(p);
+
+  if(nbr == NULL) {
+    return INFINITE_RANK;
+  }
+
+  /* Combine the rank of the parent and the ETX of the link to it. */
+  return DAG_RANK(p->rank, p->dag->instance) * RPL_MIN_HOPRANKINC +
+    nbr->link_metric;
+}
+
 static rpl_parent_t *
 best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
 {
   rpl_rank_t r1, r2;
-  rpl_dag_t *dag;  
-  uip_ds6_nbr_t *nbr1, *nbr2;
-  nbr1 = rpl_get_nbr(p1);
-  nbr2 = rpl_get_nbr(p2);
+  rpl_dag_t *dag;
 
   dag = (rpl_dag_t *)p1->dag; /* Both parents must be in the same DAG. */
 
-  if(nbr1 == NULL || nbr2 == NULL) {
-    return dag->preferred_parent;
-  }
+  r1 = rpl_get_parent_path_cost(p1);
+  r2 = rpl_get_parent_path_cost(p2);
 
   PRINTF("RPL: Comparing parent ");
   PRINT6ADDR(rpl_get_parent_ipaddr(p1));
-  PRINTF(" (confidence %d, rank %d) with parent ",
-        nbr1->link_metric, p1->rank);
+  PRINTF(" (rank %d, cost %d) with parent ", p1->rank, r1);
   PRINT6ADDR(rpl_get_parent_ipaddr(p2));
-  PRINTF(" (confidence %d, rank %d)\n",
-        nbr2->link_metric, p2->rank);
-
+  PRINTF(" (rank %d, cost %d)\n", p2->rank, r2);
 
-  r1 = DAG_RANK(p1->rank, p1->dag->instance) * RPL_MIN_HOPRANKINC  +
-    nbr1->link_metric;
-  r2 = DAG_RANK(p2->rank, p1->dag->instance) * RPL_MIN_HOPRANKINC  +
-    nbr2->link_metric;
   /* Compare two parents by looking both and their rank and at the ETX
      for that parent. We choose the parent that has the most
      favourable combination. */
@@ -264,6 +264,8 @@ rpl_link_neighbor_callback(const linkaddr_t *addr, int status, int numtx)
         if(instance->of->neighbor_link_callback != NULL) {
           instance->of->neighbor_link_callback(parent, status, numtx);
           parent->last_tx_time = clock_time();
+          /* The link metric may have changed */
+          parent->flags &= ~RPL_PARENT_FLAG_PATH_COST_VALID;
         }
       }
     }
@@ -288,6 +290,7 @@ rpl_ipv6_neighbor_callback(uip_ds6_nbr_t *nbr)
         /* Trigger DAG rank recalculation. */
         PRINTF("RPL: rpl_ipv6_neighbor_callback infinite rank\n");
         p->flags |= RPL_PARENT_FLAG_UPDATED;
+        p->flags &= ~RPL_PARENT_FLAG_PATH_COST_VALID;
       }
     }
   }
@@ -108,6 +108,7 @@ struct rpl_dag;
 /*---------------------------------------------------------------------------*/
 #define RPL_PARENT_FLAG_UPDATED           0x1
 #define RPL_PARENT_FLAG_LINK_METRIC_VALID 0x2
+#define RPL_PARENT_FLAG_PATH_COST_VALID   0x4
 
 struct rpl_parent {
   struct rpl_parent *next;
@@ -116,6 +117,8 @@ struct rpl_parent {
   rpl_metric_container_t mc;
 #endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
   rpl_rank_t rank;
+  /* Last path cost computed by the OF, see rpl_get_parent_path_cost() */
+  uint16_t path_cost;
   clock_time_t last_tx_time;
   uint8_t dtsn;
   uint8_t flags;
@@ -163,6 +166,13 @@ typedef struct rpl_instance rpl_instance_t;
  *  either to 0 or 1. The "etx" parameter specifies the current
  *  ETX(estimated transmissions) for the neighbor.
  *
+ * parent_path_cost(parent)
+ *
+ *  Returns the cost of the path to the root through a parent, as compared
+ *  by best_parent(). The result is cached in the parent until its rank,
+ *  metric container or link metric changes, use rpl_get_parent_path_cost()
+ *  to read it.
+ *
  * best_parent(parent1, parent2)
  *
  *  Compares two parents and returns the best one, according to the OF.
@@ -187,6 +197,7 @@ typedef struct rpl_instance rpl_instance_t;
 struct rpl_of {
   void (*reset)(struct rpl_dag *);
   void (*neighbor_link_callback)(rpl_parent_t *, int, int);
+  uint16_t (*parent_path_cost)(rpl_parent_t *);
   rpl_parent_t *(*best_parent)(rpl_parent_t *, rpl_parent_t *);
   rpl_dag_t *(*best_dag)(rpl_dag_t *, rpl_dag_t *);
   rpl_rank_t (*calculate_rank)(rpl_parent_t *, rpl_rank_t);
@@ -256,6 +267,7 @@ uip_ipaddr_t *rpl_get_parent_ipaddr(rpl_parent_t *nbr);
 rpl_parent_t *rpl_get_parent(uip_lladdr_t *addr);
 rpl_rank_t rpl_get_parent_rank(uip_lladdr_t *addr);
 uint16_t rpl_get_parent_link_metric(const uip_lladdr_t *addr);
+uint16_t rpl_get_parent_path_cost(rpl_parent_t *p);
 void rpl_dag_init(void);
 uip_ds6_nbr_t *rpl_get_nbr(rpl_parent_t *parent);
 void rpl_print_neighbor_list();
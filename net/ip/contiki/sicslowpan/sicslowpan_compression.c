@@ -27,6 +27,8 @@
 #include "contiki/ip/tcpip.h"
 #include "dev/watchdog.h"
 #include "contiki/ipv6/uip-ds6.h"
+#include "lib/list.h"
+#include "lib/memb.h"
 
 #define DEBUG 0
 #include "contiki/ip/uip-debug.h"
@@ -167,6 +169,38 @@ const uint8_t llprefix[] = {0xfe, 0x80};
 /* TTL uncompression values */
 static const uint8_t ttl_values[] = {0, 1, 64, 255};
 
+/* Number of flows for which the IPHC address encoding is cached */
+#ifdef SICSLOWPAN_CONF_IPHC_CACHE_SIZE
+#define SICSLOWPAN_IPHC_CACHE_SIZE SICSLOWPAN_CONF_IPHC_CACHE_SIZE
+#else
+#define SICSLOWPAN_IPHC_CACHE_SIZE 4
+#endif
+
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+/* Address encoding chosen for a (link destination, source, destination,
+ * next header) flow. The addresses only affect the second IPHC byte,
+ * the CID byte and the inline address bytes, so these are reused as is
+ * for the following packets of the flow.
+ */
+struct iphc_cache_entry {
+  struct iphc_cache_entry *next;
+  linkaddr_t lladdr;
+  uip_ipaddr_t srcipaddr;
+  uip_ipaddr_t destipaddr;
+  uint8_t proto;
+  uint8_t iphc1;
+  uint8_t cid;
+  uint8_t addr_len;
+  uint8_t addr[2 * sizeof(uip_ipaddr_t)];
+};
+
+MEMB(iphc_cache_memb, struct iphc_cache_entry, SICSLOWPAN_IPHC_CACHE_SIZE);
+LIST(iphc_cache);
+
+/* Our link address when the cached source encodings were computed */
+static uip_lladdr_t iphc_cache_lladdr;
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
+
 /*--------------------------------------------------------------------*/
 /** \name IPHC related functions
  * @{                                                                 */
@@ -223,6 +257,75 @@ compress_addr_64(uint8_t bitpos, uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
   }
 }
 
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+/*--------------------------------------------------------------------*/
+static void
+iphc_cache_flush(void)
+{
+  struct iphc_cache_entry *e;
+
+  while((e = list_pop(iphc_cache)) != NULL) {
+    memb_free(&iphc_cache_memb, e);
+  }
+
+  memcpy(&iphc_cache_lladdr, &uip_lladdr, sizeof(iphc_cache_lladdr));
+}
+/*--------------------------------------------------------------------*/
+/** \brief find the cached address encoding of the flow of the packet */
+static struct iphc_cache_entry *
+iphc_cache_lookup(struct net_buf *buf, linkaddr_t *link_destaddr)
+{
+  struct iphc_cache_entry *e;
+
+  if(memcmp(&iphc_cache_lladdr, &uip_lladdr, sizeof(iphc_cache_lladdr))) {
+    /* Source addresses may have been compressed against the old one */
+    iphc_cache_flush();
+    return NULL;
+  }
+
+  for(e = list_head(iphc_cache); e != NULL; e = list_item_next(e)) {
+    if(e->proto == UIP_IP_BUF(buf)->proto &&
+       uip_ipaddr_cmp(&e->destipaddr, &UIP_IP_BUF(buf)->destipaddr) &&
+       uip_ipaddr_cmp(&e->srcipaddr, &UIP_IP_BUF(buf)->srcipaddr) &&
+       linkaddr_cmp(&e->lladdr, link_destaddr)) {
+      /* Keep the most recently used flow first */
+      if(e != list_head(iphc_cache)) {
+        list_remove(iphc_cache, e);
+        list_push(iphc_cache, e);
+      }
+      return e;
+    }
+  }
+
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/** \brief remember the address encoding of the flow of the packet */
+static void
+iphc_cache_add(struct net_buf *buf, linkaddr_t *link_destaddr,
+               uint8_t iphc1, uint8_t cid, uint8_t *addr, uint8_t addr_len)
+{
+  struct iphc_cache_entry *e;
+
+  e = memb_alloc(&iphc_cache_memb);
+  if(e == NULL) {
+    /* Recycle the least recently used flow */
+    e = list_chop(iphc_cache);
+  }
+
+  linkaddr_copy(&e->lladdr, link_destaddr);
+  uip_ipaddr_copy(&e->srcipaddr, &UIP_IP_BUF(buf)->srcipaddr);
+  uip_ipaddr_copy(&e->destipaddr, &UIP_IP_BUF(buf)->destipaddr);
+  e->proto = UIP_IP_BUF(buf)->proto;
+  e->iphc1 = iphc1;
+  e->cid = cid;
+  e->addr_len = addr_len;
+  memcpy(e->addr, addr, addr_len);
+
+  list_push(iphc_cache, e);
+}
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
+
 /*-------------------------------------------------------------------- */
 /* Uncompress addresses based on a prefix and a postfix with zeroes in
  * between. If the postfix is zero in length it will use the link address
@@ -265,6 +368,107 @@ uncompress_addr(uip_ipaddr_t *ipaddr, uint8_t const prefix[],
   PRINTF("\n");
 }
 
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Compress the source and destination addresses
+ *
+ * The inline address bytes are written at iphc_ptr and the context
+ * numbers to the CID byte.
+ *
+ * \return SAC, SAM, M, DAC and DAM bits of the second IPHC byte
+ */
+static uint8_t
+compress_addr_iphc(struct net_buf *mbuf, struct net_buf *buf,
+                   linkaddr_t *link_destaddr,
+                   struct sicslowpan_addr_context *src_context,
+                   struct sicslowpan_addr_context *dest_context)
+{
+  uint8_t iphc1 = 0;
+
+  /* source address - cannot be multicast */
+  if(uip_is_addr_unspecified(&UIP_IP_BUF(buf)->srcipaddr)) {
+    PRINTF("IPHC: compressing unspecified - setting SAC\n");
+    iphc1 |= SICSLOWPAN_IPHC_SAC;
+    iphc1 |= SICSLOWPAN_IPHC_SAM_00;
+  } else if(src_context != NULL) {
+    /* elide the prefix - indicate by CID and set context + SAC */
+    PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
+	   src_context->number);
+    iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC;
+    PACKETBUF_IPHC_BUF(mbuf)[2] |= src_context->number << 4;
+    /* compession compare with this nodes address (source) */
+
+    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
+                              &UIP_IP_BUF(buf)->srcipaddr, &uip_lladdr);
+    /* No context found for this address */
+  } else if(uip_is_addr_link_local(&UIP_IP_BUF(buf)->srcipaddr) &&
+	    UIP_IP_BUF(buf)->destipaddr.u16[1] == 0 &&
+	    UIP_IP_BUF(buf)->destipaddr.u16[2] == 0 &&
+	    UIP_IP_BUF(buf)->destipaddr.u16[3] == 0) {
+    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
+                              &UIP_IP_BUF(buf)->srcipaddr, &uip_lladdr);
+  } else {
+    /* send the full address => SAC = 0, SAM = 00 */
+    iphc1 |= SICSLOWPAN_IPHC_SAM_00; /* 128-bits */
+    memcpy(iphc_ptr, &UIP_IP_BUF(buf)->srcipaddr.u16[0], 16);
+    iphc_ptr += 16;
+  }
+
+  /* dest address*/
+  if(uip_is_addr_mcast(&UIP_IP_BUF(buf)->destipaddr)) {
+    /* Address is multicast, try to compress */
+    iphc1 |= SICSLOWPAN_IPHC_M;
+    if(sicslowpan_is_mcast_addr_compressable8(&UIP_IP_BUF(buf)->destipaddr)) {
+      iphc1 |= SICSLOWPAN_IPHC_DAM_11;
+      /* use last byte */
+      *iphc_ptr = UIP_IP_BUF(buf)->destipaddr.u8[15];
+      iphc_ptr += 1;
+    } else if(sicslowpan_is_mcast_addr_compressable32(&UIP_IP_BUF(buf)->destipaddr)) {
+      iphc1 |= SICSLOWPAN_IPHC_DAM_10;
+      /* second byte + the last three */
+      *iphc_ptr = UIP_IP_BUF(buf)->destipaddr.u8[1];
+      memcpy(iphc_ptr + 1, &UIP_IP_BUF(buf)->destipaddr.u8[13], 3);
+      iphc_ptr += 4;
+    } else if(sicslowpan_is_mcast_addr_compressable48(&UIP_IP_BUF(buf)->destipaddr)) {
+      iphc1 |= SICSLOWPAN_IPHC_DAM_01;
+      /* second byte + the last five */
+      *iphc_ptr = UIP_IP_BUF(buf)->destipaddr.u8[1];
+      memcpy(iphc_ptr + 1, &UIP_IP_BUF(buf)->destipaddr.u8[11], 5);
+      iphc_ptr += 6;
+    } else {
+      iphc1 |= SICSLOWPAN_IPHC_DAM_00;
+      /* full address */
+      memcpy(iphc_ptr, &UIP_IP_BUF(buf)->destipaddr.u8[0], 16);
+      iphc_ptr += 16;
+    }
+  } else {
+    /* Address is unicast, try to compress */
+    if(dest_context != NULL) {
+      /* elide the prefix */
+      iphc1 |= SICSLOWPAN_IPHC_DAC;
+      PACKETBUF_IPHC_BUF(mbuf)[2] |= dest_context->number;
+      /* compession compare with link adress (destination) */
+
+      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
+	       &UIP_IP_BUF(buf)->destipaddr, (uip_lladdr_t *)link_destaddr);
+      /* No context found for this address */
+    } else if(uip_is_addr_link_local(&UIP_IP_BUF(buf)->destipaddr) &&
+	      UIP_IP_BUF(buf)->destipaddr.u16[1] == 0 &&
+	      UIP_IP_BUF(buf)->destipaddr.u16[2] == 0 &&
+	      UIP_IP_BUF(buf)->destipaddr.u16[3] == 0) {
+      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
+               &UIP_IP_BUF(buf)->destipaddr, (uip_lladdr_t *)link_destaddr);
+    } else {
+      /* send the full address */
+      iphc1 |= SICSLOWPAN_IPHC_DAM_00; /* 128-bits */
+      memcpy(iphc_ptr, &UIP_IP_BUF(buf)->destipaddr.u16[0], 16);
+      iphc_ptr += 16;
+    }
+  }
+
+  return iphc1;
+}
+
 /*--------------------------------------------------------------------*/
 /**
  * \brief Compress IP/UDP header
@@ -304,6 +508,10 @@ static int
 compress_hdr_iphc(struct net_buf *mbuf, struct net_buf *buf, linkaddr_t *link_destaddr)
 {
   uint8_t tmp, iphc0, iphc1;
+  struct sicslowpan_addr_context *src_context = NULL, *dest_context = NULL;
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+  struct iphc_cache_entry *cached;
+#endif
 
   iphc_ptr = uip_packetbuf_ptr(mbuf) + 2;
   /*
@@ -324,15 +532,28 @@ compress_hdr_iphc(struct net_buf *mbuf, struct net_buf *buf, linkaddr_t *link_de
    */
 
 
-  /* check if dest context exists (for allocating third byte) */
-  /* TODO: fix this so that it remembers the looked up values for
-     avoiding two lookups - or set the lookup values immediately */
-  if(addr_context_lookup_by_prefix(&UIP_IP_BUF(buf)->destipaddr) != NULL ||
-     addr_context_lookup_by_prefix(&UIP_IP_BUF(buf)->srcipaddr) != NULL) {
-    /* set context flag and increase iphc_ptr */
-    PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
-    iphc1 |= SICSLOWPAN_IPHC_CID;
-    iphc_ptr++;
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+  cached = iphc_cache_lookup(buf, link_destaddr);
+  if(cached) {
+    /* Same flow as before, reuse its address encoding */
+    iphc1 = cached->iphc1;
+    PACKETBUF_IPHC_BUF(mbuf)[2] = cached->cid;
+    if(iphc1 & SICSLOWPAN_IPHC_CID) {
+      iphc_ptr++;
+    }
+  } else
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
+  {
+    /* check if dest context exists (for allocating third byte),
+       the looked up contexts are used again for the addresses */
+    src_context = addr_context_lookup_by_prefix(&UIP_IP_BUF(buf)->srcipaddr);
+    dest_context = addr_context_lookup_by_prefix(&UIP_IP_BUF(buf)->destipaddr);
+    if(src_context != NULL || dest_context != NULL) {
+      /* set context flag and increase iphc_ptr */
+      PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
+      iphc1 |= SICSLOWPAN_IPHC_CID;
+      iphc_ptr++;
+    }
   }
 
   /*
@@ -414,87 +635,23 @@ compress_hdr_iphc(struct net_buf *mbuf, struct net_buf *buf, linkaddr_t *link_de
       break;
   }
 
-  /* source address - cannot be multicast */
-  if(uip_is_addr_unspecified(&UIP_IP_BUF(buf)->srcipaddr)) {
-    PRINTF("IPHC: compressing unspecified - setting SAC\n");
-    iphc1 |= SICSLOWPAN_IPHC_SAC;
-    iphc1 |= SICSLOWPAN_IPHC_SAM_00;
-  } else if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF(buf)->srcipaddr))
-     != NULL) {
-    /* elide the prefix - indicate by CID and set context + SAC */
-    PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
-	   context->number);
-    iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC;
-    PACKETBUF_IPHC_BUF(mbuf)[2] |= context->number << 4;
-    /* compession compare with this nodes address (source) */
-
-    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF(buf)->srcipaddr, &uip_lladdr);
-    /* No context found for this address */
-  } else if(uip_is_addr_link_local(&UIP_IP_BUF(buf)->srcipaddr) &&
-	    UIP_IP_BUF(buf)->destipaddr.u16[1] == 0 &&
-	    UIP_IP_BUF(buf)->destipaddr.u16[2] == 0 &&
-	    UIP_IP_BUF(buf)->destipaddr.u16[3] == 0) {
-    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF(buf)->srcipaddr, &uip_lladdr);
-  } else {
-    /* send the full address => SAC = 0, SAM = 00 */
-    iphc1 |= SICSLOWPAN_IPHC_SAM_00; /* 128-bits */
-    memcpy(iphc_ptr, &UIP_IP_BUF(buf)->srcipaddr.u16[0], 16);
-    iphc_ptr += 16;
-  }
-
-  /* dest address*/
-  if(uip_is_addr_mcast(&UIP_IP_BUF(buf)->destipaddr)) {
-    /* Address is multicast, try to compress */
-    iphc1 |= SICSLOWPAN_IPHC_M;
-    if(sicslowpan_is_mcast_addr_compressable8(&UIP_IP_BUF(buf)->destipaddr)) {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_11;
-      /* use last byte */
-      *iphc_ptr = UIP_IP_BUF(buf)->destipaddr.u8[15];
-      iphc_ptr += 1;
-    } else if(sicslowpan_is_mcast_addr_compressable32(&UIP_IP_BUF(buf)->destipaddr)) {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_10;
-      /* second byte + the last three */
-      *iphc_ptr = UIP_IP_BUF(buf)->destipaddr.u8[1];
-      memcpy(iphc_ptr + 1, &UIP_IP_BUF(buf)->destipaddr.u8[13], 3);
-      iphc_ptr += 4;
-    } else if(sicslowpan_is_mcast_addr_compressable48(&UIP_IP_BUF(buf)->destipaddr)) {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_01;
-      /* second byte + the last five */
-      *iphc_ptr = UIP_IP_BUF(buf)->destipaddr.u8[1];
-      memcpy(iphc_ptr + 1, &UIP_IP_BUF(buf)->destipaddr.u8[11], 5);
-      iphc_ptr += 6;
-    } else {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_00;
-      /* full address */
-      memcpy(iphc_ptr, &UIP_IP_BUF(buf)->destipaddr.u8[0], 16);
-      iphc_ptr += 16;
-    }
+  /* Addresses, inline bytes are taken from the flow cache if possible */
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+  if(cached) {
+    memcpy(iphc_ptr, cached->addr, cached->addr_len);
+    iphc_ptr += cached->addr_len;
   } else {
-    /* Address is unicast, try to compress */
-    if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF(buf)->destipaddr)) != NULL) {
-      /* elide the prefix */
-      iphc1 |= SICSLOWPAN_IPHC_DAC;
-      PACKETBUF_IPHC_BUF(mbuf)[2] |= context->number;
-      /* compession compare with link adress (destination) */
+    uint8_t *addr_ptr = iphc_ptr;
 
-      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-	       &UIP_IP_BUF(buf)->destipaddr, (uip_lladdr_t *)link_destaddr);
-      /* No context found for this address */
-    } else if(uip_is_addr_link_local(&UIP_IP_BUF(buf)->destipaddr) &&
-	      UIP_IP_BUF(buf)->destipaddr.u16[1] == 0 &&
-	      UIP_IP_BUF(buf)->destipaddr.u16[2] == 0 &&
-	      UIP_IP_BUF(buf)->destipaddr.u16[3] == 0) {
-      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-               &UIP_IP_BUF(buf)->destipaddr, (uip_lladdr_t *)link_destaddr);
-    } else {
-      /* send the full address */
-      iphc1 |= SICSLOWPAN_IPHC_DAM_00; /* 128-bits */
-      memcpy(iphc_ptr, &UIP_IP_BUF(buf)->destipaddr.u16[0], 16);
-      iphc_ptr += 16;
-    }
+    iphc1 |= compress_addr_iphc(mbuf, buf, link_destaddr,
+                                src_context, dest_context);
+    iphc_cache_add(buf, link_destaddr, iphc1, PACKETBUF_IPHC_BUF(mbuf)[2],
+                   addr_ptr, iphc_ptr - addr_ptr);
   }
+#else
+  iphc1 |= compress_addr_iphc(mbuf, buf, link_destaddr,
+                              src_context, dest_context);
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
 
   uip_uncomp_hdr_len(mbuf) = UIP_IPH_LEN;
 
@@ -962,6 +1119,12 @@ fail:
 static void init(void)
 {
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPHC
+#if SICSLOWPAN_IPHC_CACHE_SIZE > 0
+  memb_init(&iphc_cache_memb);
+  list_init(iphc_cache);
+  iphc_cache_flush();
+#endif /* SICSLOWPAN_IPHC_CACHE_SIZE > 0 */
+
 /* Preinitialize any address contexts for better header compression
  * (Saves up to 13 bytes per 6lowpan packet)
  * The platform contiki-conf.h file can override this using e.g.
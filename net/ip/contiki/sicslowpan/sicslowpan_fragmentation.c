@@ -109,12 +109,13 @@ static int last_rssi;
 /** Datagram tag to be put in the fragments I send. */
 static uint16_t my_tag;
 
-/* This needs to be defined in NBR / Nodes depending on available RAM   */
-/*   and expected reassembly requirements                               */
+/* Max number of L2 fragment buffers that the reassembly contexts can   */
+/* hold. This needs to be defined depending on available L2 buffers     */
+/* and expected reassembly requirements                                 */
 #ifdef SICSLOWPAN_CONF_FRAGMENT_BUFFERS
 #define SICSLOWPAN_FRAGMENT_BUFFERS SICSLOWPAN_CONF_FRAGMENT_BUFFERS
 #else
-#define SICSLOWPAN_FRAGMENT_BUFFERS 16
+#define SICSLOWPAN_FRAGMENT_BUFFERS 13
 #endif
 
 /* REASS_CONTEXTS corresponds to the number of simultaneous             */
@@ -125,16 +126,6 @@ static uint16_t my_tag;
 #define SICSLOWPAN_REASS_CONTEXTS 2
 #endif
 
-/* The size of each fragment (IP payload) for the 6lowpan fragmentation */
-#ifdef SICSLOWPAN_CONF_FRAGMENT_SIZE
-#define SICSLOWPAN_FRAGMENT_SIZE SICSLOWPAN_CONF_FRAGMENT_SIZE
-#else
-#define SICSLOWPAN_FRAGMENT_SIZE 110
-#endif
-
-/* Assuming that the worst growth for uncompression is 38 bytes */
-#define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
-
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
   /** When reassembling, the source address of the fragments being merged */
@@ -143,145 +134,161 @@ struct sicslowpan_frag_info {
   linkaddr_t receiver;
   /** When reassembling, the tag in the fragments being merged. */
   uint16_t tag;
-  /** Total length of the fragmented packet */
+  /** Total length of the fragmented packet (zero if context is free) */
   uint16_t len;
   /** Current length of reassembled fragments */
   uint16_t reassembled_len;
+  /** Received L2 fragment buffers, sorted by offset */
+  struct net_buf *frags;
   /** Reassembly %process %timer. */
   struct timer reass_timer;
 };
 
 static struct sicslowpan_frag_info frag_info[SICSLOWPAN_REASS_CONTEXTS];
 
-struct sicslowpan_frag_buf {
-  /* the index of the frag_info */
-  uint8_t index;
-  /* Fragment offset */
-  uint8_t offset;
-  /* Length of this fragment (if zero this buffer is not allocated) */
-  uint8_t len;
-  uint8_t data[SICSLOWPAN_FRAGMENT_SIZE];
-};
-
-static struct sicslowpan_frag_buf frag_buf[SICSLOWPAN_FRAGMENT_BUFFERS];
+/* Number of L2 buffers held by all the reassembly contexts */
+static uint16_t held_frags;
 
 /*---------------------------------------------------------------------------*/
-static int
-clear_fragments(uint8_t frag_info_index)
+static void
+clear_fragments(struct sicslowpan_frag_info *info)
 {
-  int i, clear_count;
-  clear_count = 0;
-  frag_info[frag_info_index].len = 0;
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    if(frag_buf[i].len > 0 && frag_buf[i].index == frag_info_index) {
-      /* deallocate the buffer */
-      frag_buf[i].len = 0;
-      clear_count++;
-    }
+  struct net_buf *frag;
+
+  while(info->frags) {
+    frag = info->frags;
+    info->frags = uip_frag_next(frag);
+    l2_buf_unref(frag);
+    held_frags--;
   }
-  return clear_count;
+
+  info->len = 0;
+  info->reassembled_len = 0;
+  timer_stop(&info->reass_timer);
 }
 /*---------------------------------------------------------------------------*/
-static int
-store_fragment(struct net_buf *mbuf, uint8_t index, uint8_t offset)
+/* Return the context that was started first, skipping the given one. */
+static struct sicslowpan_frag_info *
+oldest_context(struct sicslowpan_frag_info *skip)
 {
+  struct sicslowpan_frag_info *oldest = NULL;
+  clock_time_t now = clock_time();
   int i;
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    if(frag_buf[i].len == 0) {
-      /* copy over the data from packetbuf into the fragment buffer
-       * and store offset and len */
-      frag_buf[i].offset = offset; /* frag offset */
-      frag_buf[i].len = packetbuf_datalen(mbuf) - uip_packetbuf_hdr_len(mbuf);
-      frag_buf[i].index = index;
-      memcpy(frag_buf[i].data, uip_packetbuf_ptr(mbuf) + uip_packetbuf_hdr_len(mbuf),
-             packetbuf_datalen(mbuf) - uip_packetbuf_hdr_len(mbuf));
-
-      PRINTF("Fragsize: %d\n", frag_buf[i].len);
-      /* return the length of the stored fragment */
-      return frag_buf[i].len;
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(frag_info[i].len == 0 || &frag_info[i] == skip) {
+      continue;
+    }
+
+    if(!oldest || (clock_time_t)(now - frag_info[i].reass_timer.start) >
+       (clock_time_t)(now - oldest->reass_timer.start)) {
+      oldest = &frag_info[i];
     }
   }
-  /* failed */
-  return -1;
+
+  return oldest;
 }
 /*---------------------------------------------------------------------------*/
-/* add a new fragment to the buffer */
-static int8_t
-add_fragment(struct net_buf *mbuf, uint16_t tag, uint16_t frag_size, uint8_t offset)
+/* Find the context of the datagram identified by sender, tag and size,
+ * or start a new one. Fragments may arrive in any order so any fragment
+ * can start the reassembly. */
+static struct sicslowpan_frag_info *
+get_context(struct net_buf *mbuf, uint16_t tag, uint16_t frag_size)
 {
+  const linkaddr_t *sender = packetbuf_addr(mbuf, PACKETBUF_ADDR_SENDER);
+  struct sicslowpan_frag_info *found = NULL;
   int i;
-  int len;
-  int8_t found = -1;
-
-  if(offset == 0) {
-    /* This is a first fragment - check if we can add this */
-    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-      /* clear all fragment info with expired timer to free all fragment buffers */
-      if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
-       clear_fragments(i);
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(frag_info[i].len == 0) {
+      if(!found) {
+        found = &frag_info[i];
       }
+      continue;
+    }
 
-      /* We use len as indication on used or not used */
-      if(found < 0 && frag_info[i].len == 0) {
-        /* We remember the first free fragment info but must continue
-           the loop to free any other expired fragment buffers. */
-        found = i;
+    /* clear all fragment info with expired timer to free all fragment buffers */
+    if(timer_expired(&frag_info[i].reass_timer)) {
+      PRINTF("reassembly timeout - tag: %d\n", frag_info[i].tag);
+      clear_fragments(&frag_info[i]);
+      if(!found) {
+        found = &frag_info[i];
       }
+      continue;
     }
 
-    if(found < 0) {
-      PRINTF("*** Failed to store new fragment session - tag: %d\n", tag);
-      return -1;
+    if(frag_info[i].tag == tag && frag_info[i].len == frag_size &&
+       linkaddr_cmp(&frag_info[i].sender, sender)) {
+      return &frag_info[i];
     }
+  }
 
-    /* Found a free fragment info to store data in */
-    frag_info[found].len = frag_size;
-    frag_info[found].tag = tag;
-    linkaddr_copy(&frag_info[found].sender,
-                  packetbuf_addr(mbuf, PACKETBUF_ADDR_SENDER));
-    linkaddr_copy(&frag_info[found].receiver,
-                  packetbuf_addr(mbuf, PACKETBUF_ADDR_RECEIVER));
-
-    timer_set(&frag_info[found].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
-    i = found;
-    goto store;
+  if(!found) {
+    found = oldest_context(NULL);
+    PRINTF("*** No free reassembly context, dropping tag: %d\n", found->tag);
+    clear_fragments(found);
   }
 
-  /* This is a N-fragment - should find the info */
-  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-    if(frag_info[i].tag == tag && frag_info[i].len > 0 &&
-       linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(mbuf, PACKETBUF_ADDR_SENDER))) {
-      /* Tag and Sender match - this must be the correct info to store in */
-      found = i;
-      break;
-    }
+  found->len = frag_size;
+  found->tag = tag;
+  linkaddr_copy(&found->sender, sender);
+  linkaddr_copy(&found->receiver,
+                packetbuf_addr(mbuf, PACKETBUF_ADDR_RECEIVER));
+
+  timer_set(&found->reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+/* Link the fragment into the context, the L2 buffer is owned by the
+ * context after this. Duplicate or overlapping fragments are refused. */
+static int
+add_fragment(struct sicslowpan_frag_info *info, struct net_buf *mbuf,
+             uint16_t offset)
+{
+  struct net_buf *frag, *prev = NULL;
+  uint16_t len = uip_packetbuf_payload_len(mbuf);
+
+  /* We must be liberal about extra bytes at the end of the last fragment */
+  if(offset + len > info->len) {
+    len = info->len - offset;
+    uip_packetbuf_payload_len(mbuf) = len;
   }
 
-  if(found < 0) {
-    /* no entry found for storing the new fragment */
-    PRINTF("*** Failed to store N-fragment - could not find session - tag: %d offset: %d\n", tag, offset);
-    return -1;
+  for(frag = info->frags; frag; prev = frag, frag = uip_frag_next(frag)) {
+    if(uip_frag_offset(frag) + uip_packetbuf_payload_len(frag) <= offset) {
+      continue;
+    }
+
+    if(uip_frag_offset(frag) < offset + len) {
+      PRINTF("*** Overlapping fragment - tag: %d offset: %d\n",
+             info->tag, offset);
+      return -1;
+    }
+
+    break;
   }
 
-store:
-  /* i is the index of the reassembly context */
-  len = store_fragment(mbuf, i, offset);
-  if(len > 0) {
-    frag_info[i].reassembled_len += len;
-    return i;
+  uip_frag_offset(mbuf) = offset;
+  uip_frag_next(mbuf) = frag;
+  if(prev) {
+    uip_frag_next(prev) = mbuf;
   } else {
-    /* should we also clear all fragments since we failed to store this fragment? */
-    PRINTF("*** Failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[i].tag);
-    return -1;
+    info->frags = mbuf;
   }
-}
 
+  info->reassembled_len += len;
+  held_frags++;
+
+  PRINTF("Fragsize: %d, held fragments: %d\n", len, held_frags);
+
+  return len;
+}
 /*---------------------------------------------------------------------------*/
 /* Copy all the fragments that are associated with a specific context into uip */
-static struct net_buf *copy_frags2uip(int context)
+static struct net_buf *copy_frags2uip(struct sicslowpan_frag_info *info)
 {
-  int i, total_len = 0;
-  struct net_buf *buf;
+  struct net_buf *buf, *frag;
 
   buf = ip_buf_get_reserve_rx(0);
   if(!buf) {
@@ -289,22 +296,17 @@ static struct net_buf *copy_frags2uip(int context)
   }
 
   /* Copy from the fragment context info buffer first */
-  linkaddr_copy(&ip_buf_ll_dest(buf), &frag_info[context].receiver);
-  linkaddr_copy(&ip_buf_ll_src(buf), &frag_info[context].sender);
-
-  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
-    /* And also copy all matching fragments */
-    if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
-      memcpy(uip_buf(buf) + (uint16_t)(frag_buf[i].offset << 3),
-            (uint8_t *)frag_buf[i].data, frag_buf[i].len);
-      total_len += frag_buf[i].len;
-    }
+  linkaddr_copy(&ip_buf_ll_dest(buf), &info->receiver);
+  linkaddr_copy(&ip_buf_ll_src(buf), &info->sender);
+
+  /* And then the payload of each fragment directly from its L2 buffer */
+  for(frag = info->frags; frag; frag = uip_frag_next(frag)) {
+    memcpy(uip_buf(buf) + uip_frag_offset(frag),
+           uip_packetbuf_ptr(frag) + uip_packetbuf_hdr_len(frag),
+           uip_packetbuf_payload_len(frag));
   }
-  net_buf_add(buf, total_len);
-  uip_len(buf) = total_len;
-
-  /* deallocate all the fragments for this context */
-  clear_fragments(context);
+  net_buf_add(buf, info->len);
+  uip_len(buf) = info->len;
 
   return buf;
 }
@@ -383,7 +385,6 @@ send_packet(struct net_buf *buf, linkaddr_t *dest, bool last_fragment, void *ptr
 
 static int fragment(struct net_buf *buf, void *ptr)
 {
-   struct queuebuf *q;
    int max_payload;
    int framer_hdrlen;
    uint16_t frag_tag;
@@ -430,6 +431,7 @@ static int fragment(struct net_buf *buf, void *ptr)
 
     uip_uncomp_hdr_len(mbuf) = 0;
     uip_packetbuf_hdr_len(mbuf) = 0;
+    uip_last_tx_status(mbuf) = MAC_TX_OK;
     packetbuf_clear(mbuf);
     uip_packetbuf_ptr(mbuf) = packetbuf_dataptr(mbuf);
 
@@ -453,79 +455,42 @@ static int fragment(struct net_buf *buf, void *ptr)
       goto fail;
     }
 
-    /* Create 1st Fragment */
-    SET16(uip_packetbuf_ptr(mbuf), PACKETBUF_FRAG_DISPATCH_SIZE,
-          ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | uip_len(buf)));
-
     frag_tag = my_tag++;
-    SET16(uip_packetbuf_ptr(mbuf), PACKETBUF_FRAG_TAG, frag_tag);
     PRINTFO("fragmentation: fragment %d \n", frag_tag);
 
-    /* Copy payload and send */
-    uip_packetbuf_hdr_len(mbuf) += SICSLOWPAN_FRAG1_HDR_LEN;
-    uip_packetbuf_payload_len(mbuf) = (max_payload - uip_packetbuf_hdr_len(mbuf)) & 0xfffffff8;
-    PRINTFO("(payload len %d, hdr len %d, tag %d)\n",
-               uip_packetbuf_payload_len(mbuf), uip_packetbuf_hdr_len(mbuf), frag_tag);
-
-    memcpy(uip_packetbuf_ptr(mbuf) + uip_packetbuf_hdr_len(mbuf),
-              uip_buf(buf), uip_packetbuf_payload_len(mbuf));
-    packetbuf_set_datalen(mbuf, uip_packetbuf_payload_len(mbuf) + uip_packetbuf_hdr_len(mbuf));
-    q = queuebuf_new_from_packetbuf(mbuf);
-    if(q == NULL) {
-      PRINTFO("could not allocate queuebuf for first fragment, dropping packet\n");
-      goto fail;
-    }
-    send_packet(mbuf, &ip_buf_ll_dest(buf), last_fragment, ptr);
-    queuebuf_to_packetbuf(mbuf, q);
-    queuebuf_free(q);
-    q = NULL;
-
-    /* Check tx result. */
-    if((uip_last_tx_status(mbuf) == MAC_TX_COLLISION) ||
-       (uip_last_tx_status(mbuf) == MAC_TX_ERR) ||
-       (uip_last_tx_status(mbuf) == MAC_TX_ERR_FATAL)) {
-      PRINTFO("error in fragment tx, dropping subsequent fragments.\n");
-      goto fail;
-    }
-
-    /* set processed_ip_out_len to what we already sent from the IP payload*/
-    processed_ip_out_len = uip_packetbuf_payload_len(mbuf);
-
     /*
-     * Create following fragments
-     * Datagram tag is already in the buffer, we need to set the
-     * FRAGN dispatch and for each fragment, the offset
+     * Each fragment is built in mbuf from its slice of the IP buffer.
+     * The MAC queues its own copy of every frame, so there is no need to
+     * save and restore mbuf around send_packet().
      */
-    uip_packetbuf_hdr_len(mbuf) = SICSLOWPAN_FRAGN_HDR_LEN;
     SET16(uip_packetbuf_ptr(mbuf), PACKETBUF_FRAG_DISPATCH_SIZE,
-          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len(buf)));
-    uip_packetbuf_payload_len(mbuf) = (max_payload - uip_packetbuf_hdr_len(mbuf)) & 0xfffffff8;
+          ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | uip_len(buf)));
+    SET16(uip_packetbuf_ptr(mbuf), PACKETBUF_FRAG_TAG, frag_tag);
+    uip_packetbuf_hdr_len(mbuf) = SICSLOWPAN_FRAG1_HDR_LEN;
 
-    while(processed_ip_out_len < uip_len(buf)) {
-      PRINTFO("fragmentation: fragment:%d, processed_ip_out_len:%d \n", my_tag, processed_ip_out_len);
-      uip_packetbuf_ptr(mbuf)[PACKETBUF_FRAG_OFFSET] = processed_ip_out_len >> 3;
+    processed_ip_out_len = 0;
 
-      /* Copy payload and send */
-      if(uip_len(buf) - processed_ip_out_len < uip_packetbuf_payload_len(mbuf)) {
+    while(processed_ip_out_len < uip_len(buf)) {
+      uip_packetbuf_payload_len(mbuf) = (max_payload - uip_packetbuf_hdr_len(mbuf)) & 0xfffffff8;
+      if(uip_len(buf) - processed_ip_out_len <= uip_packetbuf_payload_len(mbuf)) {
         /* last fragment */
         last_fragment = true;
         uip_packetbuf_payload_len(mbuf) = uip_len(buf) - processed_ip_out_len;
       }
-      PRINTFO("(offset %d, len %d, tag %d)\n",
-             processed_ip_out_len >> 3, uip_packetbuf_payload_len(mbuf), my_tag);
+
+      PRINTFO("(offset %d, len %d, hdr len %d, tag %d)\n",
+             processed_ip_out_len >> 3, uip_packetbuf_payload_len(mbuf),
+             uip_packetbuf_hdr_len(mbuf), frag_tag);
+
       memcpy(uip_packetbuf_ptr(mbuf) + uip_packetbuf_hdr_len(mbuf),
-             (uint8_t *)UIP_IP_BUF(buf) + processed_ip_out_len, uip_packetbuf_payload_len(mbuf));
+             uip_buf(buf) + processed_ip_out_len, uip_packetbuf_payload_len(mbuf));
       packetbuf_set_datalen(mbuf, uip_packetbuf_payload_len(mbuf) + uip_packetbuf_hdr_len(mbuf));
-      q = queuebuf_new_from_packetbuf(mbuf);
-      if(q == NULL) {
-        PRINTFO("could not allocate queuebuf, dropping fragment\n");
-        goto fail;
-      }
       send_packet(mbuf, &ip_buf_ll_dest(buf), last_fragment, ptr);
-      queuebuf_to_packetbuf(mbuf, q);
-      queuebuf_free(q);
-      q = NULL;
-      processed_ip_out_len += uip_packetbuf_payload_len(mbuf);
+
+      if(last_fragment) {
+        /* The MAC owns mbuf now and releases it when the queue is sent */
+        break;
+      }
 
       /* Check tx result. */
       if((uip_last_tx_status(mbuf) == MAC_TX_COLLISION) ||
@@ -534,6 +499,19 @@ static int fragment(struct net_buf *buf, void *ptr)
         PRINTFO("error in fragment tx, dropping subsequent fragments.\n");
         goto fail;
       }
+
+      processed_ip_out_len += uip_packetbuf_payload_len(mbuf);
+
+      /*
+       * Following fragments: the datagram tag is already in the buffer,
+       * we need to set the FRAGN dispatch and for each fragment, the offset
+       */
+      if(uip_packetbuf_hdr_len(mbuf) == SICSLOWPAN_FRAG1_HDR_LEN) {
+        SET16(uip_packetbuf_ptr(mbuf), PACKETBUF_FRAG_DISPATCH_SIZE,
+              ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len(buf)));
+        uip_packetbuf_hdr_len(mbuf) = SICSLOWPAN_FRAGN_HDR_LEN;
+      }
+      uip_packetbuf_ptr(mbuf)[PACKETBUF_FRAG_OFFSET] = processed_ip_out_len >> 3;
     }
 
     ip_buf_unref(buf);
@@ -550,14 +528,12 @@ static int reassemble(struct net_buf *mbuf)
 {
   /* size of the IP packet (read from fragment) */
   uint16_t frag_size = 0;
-  int8_t frag_context = 0;
+  struct sicslowpan_frag_info *frag_context;
   /* offset of the fragment in the IP packet */
-  uint8_t frag_offset = 0;
-  uint8_t is_fragment = 0;
+  uint16_t frag_offset = 0;
   /* tag of the fragment */
   uint16_t frag_tag = 0;
-  uint8_t first_fragment = 0, last_fragment = 0;
-  struct net_buf *buf = NULL; 
+  struct net_buf *buf = NULL;
 
   /* init */
   uip_uncomp_hdr_len(mbuf) = 0;
@@ -584,15 +560,6 @@ static int reassemble(struct net_buf *mbuf)
       PRINTFI("size %d, tag %d, offset %d\n", frag_size, frag_tag, frag_offset);
 
       uip_packetbuf_hdr_len(mbuf) += SICSLOWPAN_FRAG1_HDR_LEN;
-      first_fragment = 1;
-      is_fragment = 1;
-
-      /* Add the fragment to the fragmentation context (this will also copy the payload)*/
-      frag_context = add_fragment(mbuf, frag_tag, frag_size, frag_offset);
-      if(frag_context == -1) {
-        goto fail;
-      }
-
       break;
 
     case SICSLOWPAN_DISPATCH_FRAGN:
@@ -601,26 +568,13 @@ static int reassemble(struct net_buf *mbuf)
        * Offset is in units of 8 bytes
        */
       PRINTFI("reassemble: FRAGN ");
-      frag_offset = uip_packetbuf_ptr(mbuf)[PACKETBUF_FRAG_OFFSET];
+      frag_offset = (uint16_t)uip_packetbuf_ptr(mbuf)[PACKETBUF_FRAG_OFFSET] << 3;
       frag_tag = GET16(uip_packetbuf_ptr(mbuf), PACKETBUF_FRAG_TAG);
       frag_size = GET16(uip_packetbuf_ptr(mbuf), PACKETBUF_FRAG_DISPATCH_SIZE) & 0x07ff;
 
       PRINTFI("reassemble: size %d, tag %d, offset %d\n", frag_size, frag_tag, frag_offset);
 
       uip_packetbuf_hdr_len(mbuf) += SICSLOWPAN_FRAGN_HDR_LEN;
-
-      /* If this is the last fragment, we may shave off any extrenous
-         bytes at the end. We must be liberal in what we accept. */
-      /* Add the fragment to the fragmentation context  (this will also copy the payload) */
-      frag_context = add_fragment(mbuf, frag_tag, frag_size, frag_offset);
-      if(frag_context == -1) {
-        goto fail;
-      }
-
-      if(frag_info[frag_context].reassembled_len >= frag_size) {
-        last_fragment = 1;
-      }
-      is_fragment = 1;
       break;
 
     default:
@@ -631,17 +585,13 @@ static int reassemble(struct net_buf *mbuf)
       if(!buf || net_driver_15_4_recv(buf) < 0) {
         goto fail;
       }
-      goto out;
+
+      /* free MAC buffer */
+      l2_buf_unref(mbuf);
+      return 1;
   }
 
-  /*
-   * copy "payload" from the packetbuf buffer to the sicslowpan_buf
-   * if this is a first fragment or not fragmented packet,
-   * we have already copied the compressed headers, uncomp_hdr_len
-   * and packetbuf_hdr_len are non 0, frag_offset is.
-   * If this is a subsequent fragment, this is the contrary.
-   */
-  if(packetbuf_datalen(mbuf) < uip_packetbuf_hdr_len(mbuf)) {
+  if(packetbuf_datalen(mbuf) <= uip_packetbuf_hdr_len(mbuf)) {
     PRINTF("reassemble: packet dropped due to header > total packet\n");
     goto fail;
   }
@@ -649,56 +599,53 @@ static int reassemble(struct net_buf *mbuf)
   uip_packetbuf_payload_len(mbuf) = packetbuf_datalen(mbuf) - uip_packetbuf_hdr_len(mbuf);
 
   /* Sanity-check size of incoming packet to avoid buffer overflow */
-  {
-    int req_size = UIP_LLH_LEN + (uint16_t)(frag_offset << 3)
-        + uip_packetbuf_payload_len(mbuf);
+  if(UIP_LLH_LEN + frag_size > UIP_BUFSIZE || frag_offset >= frag_size) {
+    PRINTF("reassemble: packet dropped, size %d offset %d (current size: %d)\n",
+           frag_size, frag_offset, UIP_BUFSIZE);
+    goto fail;
+  }
 
-    if(req_size > UIP_BUFSIZE) {
-      PRINTF("reassemble: packet dropped, minimum required IP_BUF size: %d+%d+%d=%d (current size: %d)\n", UIP_LLH_LEN, (uint16_t)(frag_offset << 3),
-              uip_packetbuf_payload_len(mbuf), req_size, UIP_BUFSIZE);
-      goto fail;
-    }
+  frag_context = get_context(mbuf, frag_tag, frag_size);
+
+  /* From here on the fragment is owned by the reassembly context */
+  if(add_fragment(frag_context, mbuf, frag_offset) < 0) {
+    goto fail;
   }
 
-  if(frag_size > 0) {
-    /* Add the size of the header only for the first fragment. */
-    if(first_fragment != 0) {
-      frag_info[frag_context].reassembled_len = uip_uncomp_hdr_len(mbuf) + uip_packetbuf_payload_len(mbuf);
-    }
+  if(frag_context->reassembled_len < frag_context->len) {
+    /* Keep the number of held L2 buffers bounded so that pending
+     * reassemblies cannot starve the radio of buffers. */
+    if(held_frags > SICSLOWPAN_FRAGMENT_BUFFERS) {
+      struct sicslowpan_frag_info *oldest = oldest_context(frag_context);
 
-    /* For the last fragment, we are OK if there is extrenous bytes at
-       the end of the packet. */
-    if(last_fragment != 0) {
-      frag_info[frag_context].reassembled_len = frag_size;
-      /* copy to uip(net_buf) */
-      buf = copy_frags2uip(frag_context);
-      if(!buf)
-        goto fail;
+      if(!oldest) {
+        oldest = frag_context;
+      }
+
+      PRINTF("*** Too many fragments held, dropping tag: %d\n", oldest->tag);
+      clear_fragments(oldest);
     }
+
+    return 1;
   }
 
   /*
-   * If we have a full IP packet in sicslowpan_buf, deliver it to
-   * the IP stack
+   * We have a full IP packet in the fragment chain, copy it into
+   * an IP buffer and deliver it to the IP stack.
    */
-  if(!is_fragment || last_fragment) {
-    /* packet is in uip already - just set length */
-    if(is_fragment != 0 && last_fragment != 0) {
-      uip_len(buf) = frag_size;
-    } else {
-      uip_len(buf) = uip_packetbuf_payload_len(mbuf) + uip_uncomp_hdr_len(mbuf);
-    }
+  buf = copy_frags2uip(frag_context);
+  clear_fragments(frag_context);
 
-    PRINTFI("reassemble: IP packet ready (length %d)\n", uip_len(buf));
+  if(!buf) {
+    return 1;
+  }
 
-    if(net_driver_15_4_recv(buf) < 0) {
-      goto fail;
-    }
+  PRINTFI("reassemble: IP packet ready (length %d)\n", uip_len(buf));
+
+  if(net_driver_15_4_recv(buf) < 0) {
+    ip_buf_unref(buf);
   }
 
-out:
-  /* free MAC buffer */
-  l2_buf_unref(mbuf);
   return 1;
 
 fail:
@@ -16,6 +16,8 @@
  * limitations under the License.
  */
 
+#include <nanokernel.h>
+
 #include "contiki.h"
 
 #include <net/l2_buf.h>
@@ -23,6 +25,7 @@
 
 #include "contiki/packetbuf.h"
 #include "contiki/netstack.h"
+#include "lib/random.h"
 #include "dummy_15_4_radio.h"
 #include "net_driver_15_4.h"
 
@@ -191,6 +194,37 @@ transmit(struct net_buf *buf, unsigned short transmit_len)
 }
 
 #ifndef CONFIG_NETWORKING_WITH_15_4_LOOPBACK_UART
+#ifdef CONFIG_NET_15_4_LOOPBACK_REORDER
+/* Frame waiting to be fed back after the next one */
+static struct net_buf *reorder_buf;
+#endif
+
+#if defined(CONFIG_NET_15_4_LOOPBACK_COLLISION_RATE) && \
+	CONFIG_NET_15_4_LOOPBACK_COLLISION_RATE > 0
+#define BUSY_PERIOD (sys_clock_ticks_per_sec / 5)
+
+/* End of the frame exchange of another simulated node */
+static uint32_t busy_until;
+
+static bool collision(void)
+{
+	uint32_t now = sys_tick_get_32();
+
+	if ((int32_t)(busy_until - now) > 0) {
+		return true;
+	}
+
+	if (random_rand() % 100 < CONFIG_NET_15_4_LOOPBACK_COLLISION_RATE) {
+		busy_until = now + BUSY_PERIOD;
+		return true;
+	}
+
+	return false;
+}
+#else
+#define collision() false
+#endif
+
 static void route_buf(struct net_buf *buf)
 {
 	int len;
@@ -208,6 +242,13 @@ static void route_buf(struct net_buf *buf)
 						last_packet_timestamp);
 		PRINTF("dummy154radio: 15.4 Rx input %d bytes\n", len);
 
+#ifdef CONFIG_NET_15_4_LOOPBACK_REORDER
+		if (!reorder_buf) {
+			reorder_buf = mbuf;
+			return;
+		}
+#endif
+
 		if (net_driver_15_4_recv_from_hw(mbuf) < 0) {
 			PRINTF("dummy154radio: rdc input failed, "
 							"packet discarded\n");
@@ -215,6 +256,14 @@ static void route_buf(struct net_buf *buf)
 		}
 
 		NET_BUF_CHECK_IF_NOT_IN_USE(mbuf);
+
+#ifdef CONFIG_NET_15_4_LOOPBACK_REORDER
+		if (net_driver_15_4_recv_from_hw(reorder_buf) < 0) {
+			l2_buf_unref(reorder_buf);
+		}
+
+		reorder_buf = NULL;
+#endif
 	}
 }
 #endif
@@ -254,6 +303,11 @@ send(struct net_buf *buf, const void *payload, unsigned short payload_len)
 
   return RADIO_TX_OK;
 #else
+  if (collision()) {
+    PRINTF("dummy154radio: simulated collision\n");
+    return RADIO_TX_COLLISION;
+  }
+
   route_buf(buf);
   return transmit(buf, payload_len);
 #endif
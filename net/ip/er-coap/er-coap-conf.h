@@ -53,6 +53,16 @@
 #define COAP_MAX_OPEN_TRANSACTIONS     4
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
+/* Adapt the retransmission timers to the measured RTT of each endpoint (CoCoA). */
+#ifndef COAP_CONGESTION_CONTROL
+#define COAP_CONGESTION_CONTROL        0
+#endif /* COAP_CONGESTION_CONTROL */
+
+/* The number of confirmable messages that can be outstanding towards one endpoint. */
+#ifndef COAP_NSTART
+#define COAP_NSTART                    1
+#endif /* COAP_NSTART */
+
 /* Maximum number of failed request attempts before action */
 #ifndef COAP_MAX_ATTEMPTS
 #define COAP_MAX_ATTEMPTS              4
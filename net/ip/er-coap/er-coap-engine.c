@@ -243,6 +243,7 @@ coap_engine_receive(coap_context_t *coap_ctx)
           restful_response_handler callback = transaction->callback;
           void *callback_data = transaction->callback_data;
 
+          coap_transaction_acked(transaction);
           coap_clear_transaction(transaction);
 
           /* check if someone registered for the response */
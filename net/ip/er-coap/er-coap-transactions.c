@@ -50,6 +50,130 @@ LIST(transactions_list);
 
 static struct process *transaction_handler_process = NULL;
 
+#if COAP_CONGESTION_CONTROL
+/* srtt and rttvar are stored multiplied by 8 to keep precision in ticks */
+#define COAP_RTT_SHIFT          3
+#define COAP_INITIAL_RTO        (2 * CLOCK_SECOND)
+#define COAP_MAX_RTO            (60 * CLOCK_SECOND)
+
+/* Every transaction uses at most one endpoint, so there is always an idle
+ * one to recycle when a new destination shows up.
+ */
+MEMB(endpoints_memb, coap_endpoint_t, COAP_MAX_OPEN_TRANSACTIONS);
+LIST(endpoints_list);
+
+/*---------------------------------------------------------------------------*/
+static coap_endpoint_t *
+get_endpoint(uip_ipaddr_t *addr, uint16_t port)
+{
+  coap_endpoint_t *ep;
+  coap_endpoint_t *idle = NULL;
+
+  /* the list is kept in most recently used order */
+  for(ep = (coap_endpoint_t *)list_head(endpoints_list); ep; ep = ep->next) {
+    if(ep->port == port && uip_ipaddr_cmp(&ep->addr, addr)) {
+      list_remove(endpoints_list, ep);
+      list_push(endpoints_list, ep);
+      return ep;
+    }
+    if(!ep->outstanding && !ep->queued) {
+      idle = ep;
+    }
+  }
+
+  ep = memb_alloc(&endpoints_memb);
+  if(!ep) {
+    if(!idle) {
+      return NULL;
+    }
+    PRINTF("Recycling endpoint %p\n", idle);
+    list_remove(endpoints_list, idle);
+    ep = idle;
+  }
+
+  memset(ep, 0, sizeof(*ep));
+  uip_ipaddr_copy(&ep->addr, addr);
+  ep->port = port;
+  ep->rto = COAP_INITIAL_RTO;
+  ep->last_update = clock_time();
+  list_push(endpoints_list, ep);
+
+  return ep;
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+get_endpoint_rto(coap_endpoint_t *ep)
+{
+  clock_time_t elapsed = clock_time() - ep->last_update;
+
+  /* let stale estimates decay towards the default */
+  if(ep->rto < CLOCK_SECOND && elapsed > 16 * ep->rto) {
+    ep->rto = (CLOCK_SECOND + 2 * ep->rto) / 3;
+    ep->last_update = clock_time();
+  } else if(ep->rto > 3 * CLOCK_SECOND && elapsed > 4 * ep->rto) {
+    ep->rto = (2 * CLOCK_SECOND + ep->rto) / 2;
+    ep->last_update = clock_time();
+  }
+
+  return ep->rto;
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+rtt_update(coap_rtt_estimator_t *e, clock_time_t rtt, uint8_t k)
+{
+  clock_time_t delta;
+
+  rtt <<= COAP_RTT_SHIFT;
+
+  if(!e->srtt) {
+    e->srtt = rtt;
+    e->rttvar = rtt / 2;
+  } else {
+    delta = e->srtt > rtt ? e->srtt - rtt : rtt - e->srtt;
+    e->rttvar = (3 * e->rttvar + delta) / 4;
+    e->srtt = (7 * e->srtt + rtt) / 8;
+  }
+
+  e->rto = (e->srtt + k * e->rttvar) >> COAP_RTT_SHIFT;
+  return e->rto;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns 1 if the transaction may be sent now, 0 if it has to wait for
+ * one of the outstanding transactions to the same endpoint to complete.
+ */
+static int
+window_acquire(coap_transaction_t *t)
+{
+  coap_endpoint_t *ep = t->endpoint;
+
+  if(!ep) {
+    ep = t->endpoint = get_endpoint(&t->addr, t->port);
+    if(!ep) {
+      return 1;
+    }
+  } else if(!t->queued) {
+    return 1;
+  }
+
+  if(ep->outstanding >= COAP_NSTART) {
+    if(!t->queued) {
+      PRINTF("Window full, queueing transaction %u\n", t->mid);
+      t->queued = 1;
+      ep->queued++;
+    }
+    return 0;
+  }
+
+  if(t->queued) {
+    t->queued = 0;
+    ep->queued--;
+  }
+  ep->outstanding++;
+
+  return 1;
+}
+#endif /* COAP_CONGESTION_CONTROL */
+
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -67,6 +191,11 @@ coap_new_transaction(uint16_t mid, coap_context_t *coap_ctx,
   if(t) {
     t->mid = mid;
     t->retrans_counter = 0;
+    t->buf = NULL;
+#if COAP_CONGESTION_CONTROL
+    t->endpoint = NULL;
+    t->queued = 0;
+#endif
 
     /* save client address */
     uip_ipaddr_copy(&t->addr, addr);
@@ -79,6 +208,21 @@ coap_new_transaction(uint16_t mid, coap_context_t *coap_ctx,
   return t;
 }
 /*---------------------------------------------------------------------------*/
+static void
+retain_buf(coap_transaction_t *t)
+{
+#ifndef WITH_DTLS
+  struct net_buf *buf = t->coap_ctx->buf;
+
+  /* Replies are sent from the received buffer which cannot be rewound,
+   * those keep allocating a new TX buffer for every retransmission.
+   */
+  if(!t->buf && buf && ip_buf_type(buf) == IP_BUF_TX) {
+    t->buf = net_buf_ref(buf);
+  }
+#endif
+}
+/*---------------------------------------------------------------------------*/
 void
 coap_send_transaction(coap_transaction_t *t)
 {
@@ -94,6 +238,26 @@ coap_send_transaction(coap_transaction_t *t)
     return;
   }
 
+  if(COAP_TYPE_CON ==
+     ((COAP_HEADER_TYPE_MASK & t->packet[0]) >> COAP_HEADER_TYPE_POSITION)) {
+#if COAP_CONGESTION_CONTROL
+    if(t->retrans_counter == 0 && !window_acquire(t)) {
+#ifndef WITH_DTLS
+      /* hold on to the prepared buffer, coap_check_transactions()
+       * sends it once the window opens
+       */
+      if(!t->buf && ip_buf_type(t->coap_ctx->buf) == IP_BUF_TX) {
+        t->buf = t->coap_ctx->buf;
+        t->coap_ctx->buf = NULL;
+      }
+#endif
+      return;
+    }
+#endif /* COAP_CONGESTION_CONTROL */
+
+    retain_buf(t);
+  }
+
   NET_COAP_STAT(sent++);
 
   coap_send_message(t->coap_ctx, &t->addr, t->port,
@@ -106,16 +270,43 @@ coap_send_transaction(coap_transaction_t *t)
       PRINTF("Keeping transaction %u\n", t->mid);
 
       if(t->retrans_counter == 0) {
+#if COAP_CONGESTION_CONTROL
+        clock_time_t rto = COAP_RESPONSE_TIMEOUT_TICKS;
+
+        if(t->endpoint) {
+          rto = get_endpoint_rto(t->endpoint);
+        }
+
+        /* CoCoA variable backoff factor, kept in halves */
+        if(rto < CLOCK_SECOND) {
+          t->backoff = 6;
+        } else if(rto > 3 * CLOCK_SECOND) {
+          t->backoff = 3;
+        } else {
+          t->backoff = 4;
+        }
+
+        t->start_time = clock_time();
+        t->retrans_timer.timer.interval =
+          rto + (random_rand() % (rto / 2 + 1));
+#else
         t->retrans_timer.timer.interval =
           COAP_RESPONSE_TIMEOUT_TICKS + (random_rand()
                                          %
                                          (clock_time_t)
                                          COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
+#endif /* COAP_CONGESTION_CONTROL */
         PRINTF("Initial interval %d\n",
                t->retrans_timer.timer.interval / CLOCK_SECOND);
       } else {
+#if COAP_CONGESTION_CONTROL
+        t->retrans_timer.timer.interval =
+          MIN(t->retrans_timer.timer.interval * t->backoff / 2,
+              COAP_MAX_RTO);
+#else
         t->retrans_timer.timer.interval <<= 1;  /* double */
-        PRINTF("Doubled (%u) interval %d\n", t->retrans_counter,
+#endif
+        PRINTF("Backed off (%u) interval %d\n", t->retrans_counter,
                t->retrans_timer.timer.interval / CLOCK_SECOND);
       }
 
@@ -151,10 +342,63 @@ coap_clear_transaction(coap_transaction_t *t)
     PRINTF("Freeing transaction %u: %p\n", t->mid, t);
 
     etimer_stop(&t->retrans_timer);
+
+#if COAP_CONGESTION_CONTROL
+    if(t->endpoint) {
+      if(t->queued) {
+        t->endpoint->queued--;
+      } else {
+        t->endpoint->outstanding--;
+      }
+    }
+#endif
+
+    if(t->buf) {
+      ip_buf_unref(t->buf);
+    }
+
     list_remove(transactions_list, t);
     memb_free(&transactions_memb, t);
   }
 }
+/*---------------------------------------------------------------------------*/
+void
+coap_transaction_acked(coap_transaction_t *t)
+{
+#if COAP_CONGESTION_CONTROL
+  coap_endpoint_t *ep = t->endpoint;
+  clock_time_t rtt, rto;
+
+  if(!ep || t->queued) {
+    return;
+  }
+
+  rtt = clock_time() - t->start_time;
+  if(!rtt) {
+    rtt = 1;
+  }
+
+  if(t->retrans_counter == 0) {
+    rto = rtt_update(&ep->strong, rtt, 4);
+    ep->rto = (rto + ep->rto) / 2;
+  } else if(t->retrans_counter <= 2) {
+    /* the response may belong to any of the transmissions */
+    rto = rtt_update(&ep->weak, rtt, 1);
+    ep->rto = (rto + 3 * ep->rto) / 4;
+  } else {
+    return;
+  }
+
+  if(!ep->rto) {
+    ep->rto = 1;
+  } else if(ep->rto > COAP_MAX_RTO) {
+    ep->rto = COAP_MAX_RTO;
+  }
+  ep->last_update = clock_time();
+
+  PRINTF("RTT %u ticks, RTO now %u ticks\n", (unsigned)rtt, (unsigned)ep->rto);
+#endif /* COAP_CONGESTION_CONTROL */
+}
 coap_transaction_t *
 coap_get_transaction_by_mid(uint16_t mid)
 {
@@ -172,44 +416,77 @@ coap_get_transaction_by_mid(uint16_t mid)
 static inline struct net_buf *get_retransmit_buf(coap_transaction_t *t)
 {
   coap_context_t *coap_ctx = t->coap_ctx;
+  struct net_buf *buf;
 
   if (coap_ctx->buf) {
     return coap_ctx->buf;
   }
 
-  coap_ctx->buf = ip_buf_get_tx(coap_ctx->net_ctx);
-  if (!coap_ctx->buf) {
-    return NULL;
+  if (t->buf) {
+    /* Wait until the stack has released the previous transmission
+     * and then rewind the original buffer instead of allocating a new
+     * one from the TX pool.
+     */
+    if (t->buf->ref > 1) {
+      return NULL;
+    }
+
+    buf = net_buf_ref(t->buf);
+    buf->len = 0;
+    net_buf_add(buf, ip_buf_reserve(buf));
+    uip_set_conn(buf) = NULL;
+    uip_set_udp_conn(buf) = NULL;
+    uip_ext_len(buf) = 0;
+  } else {
+    buf = ip_buf_get_tx(coap_ctx->net_ctx);
+    if (!buf) {
+      return NULL;
+    }
   }
 
+  coap_ctx->buf = buf;
+
   /* We set the major buf params correctly. The application data pointer
    * should point to start of the coap packet data.
    * The tail of the packet points now to byte after coap packet.
    */
-  ip_buf_appdata(coap_ctx->buf) = net_buf_add(coap_ctx->buf, t->packet_len);
-  ip_buf_appdatalen(coap_ctx->buf) = t->packet_len;
+  ip_buf_appdata(buf) = net_buf_add(buf, t->packet_len);
+  ip_buf_appdatalen(buf) = t->packet_len;
+  memcpy(ip_buf_appdata(buf), t->packet, t->packet_len);
 
   /* The total length of the packet is the coap packet + all the UDP/IP
    * headers.
    */
-  uip_len(coap_ctx->buf) = ip_buf_len(coap_ctx->buf);
+  uip_len(buf) = ip_buf_len(buf);
 
-  return coap_ctx->buf;
+  return buf;
 }
 
 void
 coap_check_transactions()
 {
   coap_transaction_t *t = NULL;
+  coap_transaction_t *next;
 
-  for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
-    if(etimer_expired(&t->retrans_timer)) {
-      ++(t->retrans_counter);
-      PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
-      if (get_retransmit_buf(t)) {
+  for(t = (coap_transaction_t *)list_head(transactions_list); t; t = next) {
+    /* sending may free the transaction */
+    next = t->next;
+
+#if COAP_CONGESTION_CONTROL
+    if(t->queued) {
+      if(t->endpoint->outstanding < COAP_NSTART && get_retransmit_buf(t)) {
+        PRINTF("Window open, sending %u\n", t->mid);
         coap_send_transaction(t);
-	NET_COAP_STAT(re_sent++);
       }
+      continue;
+    }
+#endif /* COAP_CONGESTION_CONTROL */
+
+    if(etimer_expired(&t->retrans_timer) && get_retransmit_buf(t)) {
+      ++(t->retrans_counter);
+      PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
+      coap_send_transaction(t);
+      NET_COAP_STAT(re_sent++);
     }
   }
 }
@@ -52,6 +52,31 @@
 	(long)((CLOCK_SECOND * COAP_RESPONSE_TIMEOUT * \
 		(COAP_RESPONSE_RANDOM_FACTOR_INT - 10)) + 5) / 10 + 1
 
+#if COAP_CONGESTION_CONTROL
+/* RFC 6298 style estimator, srtt and rttvar are kept scaled by 1 << COAP_RTT_SHIFT */
+typedef struct coap_rtt_estimator {
+  clock_time_t srtt;
+  clock_time_t rttvar;
+  clock_time_t rto;
+} coap_rtt_estimator_t;
+
+/* per-destination state for the CoCoA congestion control */
+typedef struct coap_endpoint {
+  struct coap_endpoint *next;           /* for LIST */
+
+  uip_ipaddr_t addr;
+  uint16_t port;
+
+  uint8_t outstanding;                  /* CON transactions waiting for a response */
+  uint8_t queued;                       /* transactions waiting for the NSTART window */
+
+  coap_rtt_estimator_t strong;          /* samples from non-retransmitted exchanges */
+  coap_rtt_estimator_t weak;            /* samples from retransmitted exchanges */
+  clock_time_t rto;                     /* overall RTO used for new transactions */
+  clock_time_t last_update;
+} coap_endpoint_t;
+#endif /* COAP_CONGESTION_CONTROL */
+
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
   struct coap_transaction *next;        /* for LIST */
@@ -64,6 +89,16 @@ typedef struct coap_transaction {
   uint16_t port;
   coap_context_t *coap_ctx;
 
+  /* reference to the sent buffer, reused for retransmissions */
+  struct net_buf *buf;
+
+#if COAP_CONGESTION_CONTROL
+  coap_endpoint_t *endpoint;
+  clock_time_t start_time;              /* first transmission, for RTT samples */
+  uint8_t backoff;                      /* variable backoff factor, in halves */
+  uint8_t queued;
+#endif /* COAP_CONGESTION_CONTROL */
+
   restful_response_handler callback;
   void *callback_data;
 
@@ -78,6 +113,7 @@ coap_transaction_t *coap_new_transaction(uint16_t mid, coap_context_t *coap_ctx,
                                          uip_ipaddr_t *addr, uint16_t port);
 void coap_send_transaction(coap_transaction_t *t);
 void coap_clear_transaction(coap_transaction_t *t);
+void coap_transaction_acked(coap_transaction_t *t);
 coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
 
 void coap_check_transactions();
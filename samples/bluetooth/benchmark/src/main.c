@@ -0,0 +1,695 @@
+/* main.c - Bluetooth host benchmark */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Runs the host stack on top of the virtual controller, which loops a
+ * connection back to ourselves: we are both the central and the
+ * peripheral of every link. The benchmark measures the connection setup
+ * time, the ATT notification throughput from the peripheral to the
+ * central and the L2CAP connection oriented channel throughput from the
+ * central to the peripheral, both with SDUs fitting a single segment and
+ * with IPSP sized SDUs. The SDUs still queued on a channel when the link
+ * drops must be released. Cycles are measured over the whole system,
+ * so they include the (small) cost of the virtual controller.
+ */
+
+#include <zephyr.h>
+
+#if defined(CONFIG_STDOUT_CONSOLE)
+#include <stdio.h>
+#define PRINT           printf
+#else
+#include <misc/printk.h>
+#define PRINT           printk
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <tc_util.h>
+
+#include <misc/byteorder.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/uuid.h>
+#include <bluetooth/gatt.h>
+#include <bluetooth/l2cap.h>
+
+#define CONN_ROUNDS    5
+#define NOTIFICATIONS  200
+#define SDUS           100
+
+#define NOTIFY_LEN     20    /* Default ATT MTU minus the header */
+#define SDU_LEN        (CONFIG_BLUETOOTH_L2CAP_IN_MTU - 2)
+
+#define PSM            0x0080
+#define BULK_PSM       0x0081
+
+/* IPSP carries IPv6 packets of up to 1280 bytes as SDUs */
+#define BULK_SDUS      20
+#define BULK_SDU_LEN   1280
+#define BULK_BUFS      2
+
+#define TIMEOUT        (5 * sys_clock_ticks_per_sec)
+
+static struct bt_conn *central;
+static struct bt_conn *peripheral;
+
+static struct nano_sem conn_sem;
+static struct nano_sem disconn_sem;
+static struct nano_sem found_sem;
+static struct nano_sem done_sem;
+
+static bt_addr_le_t peer;
+
+static uint32_t received;
+static uint32_t expected;
+
+static const struct bt_data ad[] = {
+	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+};
+
+static struct bt_uuid_128 bench_uuid = BT_UUID_INIT_128(
+	0xf0, 0xde, 0xbc, 0x9a, 0x78, 0x56, 0x34, 0x12,
+	0x78, 0x56, 0x34, 0x12, 0x78, 0x56, 0x34, 0x12);
+
+static struct bt_uuid_128 bench_data_uuid = BT_UUID_INIT_128(
+	0xf1, 0xde, 0xbc, 0x9a, 0x78, 0x56, 0x34, 0x12,
+	0x78, 0x56, 0x34, 0x12, 0x78, 0x56, 0x34, 0x12);
+
+static struct bt_gatt_ccc_cfg bench_ccc_cfg[CONFIG_BLUETOOTH_MAX_PAIRED] = {};
+
+static void bench_ccc_cfg_changed(uint16_t value)
+{
+}
+
+#if defined(CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH)
+/* Characteristics updated at a high rate, e.g. by a sensor hub */
+#define SENSORS        3
+#define SENSOR_ROUNDS  200
+#define SENSOR_ATTR(i) (&bench_attrs[5 + (i) * 3])
+
+static struct bt_uuid_16 sensor_uuid[SENSORS] = {
+	BT_UUID_INIT_16(0xfff1),
+	BT_UUID_INIT_16(0xfff2),
+	BT_UUID_INIT_16(0xfff3),
+};
+
+static struct bt_gatt_ccc_cfg
+		sensor_ccc_cfg[SENSORS][CONFIG_BLUETOOTH_MAX_PAIRED] = {};
+
+static struct nano_sem ccc_sem;
+
+static void sensor_ccc_cfg_changed(uint16_t value)
+{
+	nano_sem_give(&ccc_sem);
+}
+#endif /* CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH */
+
+static struct bt_gatt_attr bench_attrs[] = {
+	BT_GATT_PRIMARY_SERVICE(&bench_uuid),
+	BT_GATT_CHARACTERISTIC(&bench_data_uuid.uuid, BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DESCRIPTOR(&bench_data_uuid.uuid, BT_GATT_PERM_READ, NULL,
+			   NULL, NULL),
+	BT_GATT_CCC(bench_ccc_cfg, bench_ccc_cfg_changed),
+#if defined(CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH)
+	BT_GATT_CHARACTERISTIC(&sensor_uuid[0].uuid, BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DESCRIPTOR(&sensor_uuid[0].uuid, BT_GATT_PERM_READ, NULL,
+			   NULL, NULL),
+	BT_GATT_CCC(sensor_ccc_cfg[0], sensor_ccc_cfg_changed),
+	BT_GATT_CHARACTERISTIC(&sensor_uuid[1].uuid, BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DESCRIPTOR(&sensor_uuid[1].uuid, BT_GATT_PERM_READ, NULL,
+			   NULL, NULL),
+	BT_GATT_CCC(sensor_ccc_cfg[1], sensor_ccc_cfg_changed),
+	BT_GATT_CHARACTERISTIC(&sensor_uuid[2].uuid, BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DESCRIPTOR(&sensor_uuid[2].uuid, BT_GATT_PERM_READ, NULL,
+			   NULL, NULL),
+	BT_GATT_CCC(sensor_ccc_cfg[2], sensor_ccc_cfg_changed),
+#endif /* CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH */
+};
+
+static struct bt_gatt_subscribe_params subscribe_params;
+
+static struct nano_fifo data_fifo;
+static NET_BUF_POOL(data_pool, 2, BT_L2CAP_CHAN_SEND_RESERVE + SDU_LEN,
+		    &data_fifo, NULL, 0);
+
+static struct nano_fifo bulk_fifo;
+static NET_BUF_POOL(bulk_pool, BULK_BUFS,
+		    BT_L2CAP_CHAN_SEND_RESERVE + BULK_SDU_LEN,
+		    &bulk_fifo, NULL, 0);
+
+/* The receiver reassembles the SDUs */
+static struct nano_fifo bulk_rx_fifo;
+static NET_BUF_POOL(bulk_rx_pool, 1, BULK_SDU_LEN, &bulk_rx_fifo, NULL, 0);
+
+static struct bt_l2cap_chan client_chan;
+static struct bt_l2cap_chan server_chan;
+static struct bt_l2cap_chan bulk_client_chan;
+static struct bt_l2cap_chan bulk_server_chan;
+static struct nano_sem chan_sem;
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	struct bt_conn_info info;
+
+	if (err) {
+		PRINT("Connection failed (err %u)\n", err);
+		return;
+	}
+
+	bt_conn_get_info(conn, &info);
+
+	/* The central connection is referenced by bt_conn_create_le() */
+	if (info.role == BT_HCI_ROLE_SLAVE) {
+		peripheral = bt_conn_ref(conn);
+	}
+
+	nano_sem_give(&conn_sem);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	if (conn == peripheral) {
+		bt_conn_unref(peripheral);
+		peripheral = NULL;
+	}
+
+	nano_sem_give(&disconn_sem);
+}
+
+static struct bt_conn_cb conn_callbacks = {
+	.connected = connected,
+	.disconnected = disconnected,
+};
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi,
+			 uint8_t type, const uint8_t *ad, uint8_t len)
+{
+	if (type != BT_LE_ADV_IND) {
+		return;
+	}
+
+	bt_addr_le_copy(&peer, addr);
+	nano_sem_give(&found_sem);
+}
+
+static void count_received(uint16_t len)
+{
+	received += len;
+	if (received == expected) {
+		nano_sem_give(&done_sem);
+	}
+}
+
+static uint8_t notify_func(struct bt_conn *conn,
+			   struct bt_gatt_subscribe_params *params,
+			   const void *data, uint16_t length)
+{
+	if (data) {
+		count_received(length);
+	}
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static void chan_connected(struct bt_l2cap_chan *chan)
+{
+	nano_sem_give(&chan_sem);
+}
+
+static void chan_disconnected(struct bt_l2cap_chan *chan)
+{
+}
+
+static void chan_recv(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+	count_received(buf->len);
+}
+
+static struct bt_l2cap_chan_ops chan_ops = {
+	.connected = chan_connected,
+	.disconnected = chan_disconnected,
+	.recv = chan_recv,
+};
+
+static int accept(struct bt_conn *conn, struct bt_l2cap_chan **chan)
+{
+	if (server_chan.conn) {
+		return -ENOMEM;
+	}
+
+	*chan = &server_chan;
+
+	return 0;
+}
+
+static struct bt_l2cap_server server = {
+	.psm = PSM,
+	.accept = accept,
+};
+
+static struct net_buf *bulk_alloc_buf(struct bt_l2cap_chan *chan)
+{
+	return net_buf_get(&bulk_rx_fifo, 0);
+}
+
+static struct bt_l2cap_chan_ops bulk_ops = {
+	.connected = chan_connected,
+	.disconnected = chan_disconnected,
+	.alloc_buf = bulk_alloc_buf,
+	.recv = chan_recv,
+};
+
+static int bulk_accept(struct bt_conn *conn, struct bt_l2cap_chan **chan)
+{
+	if (bulk_server_chan.conn) {
+		return -ENOMEM;
+	}
+
+	bulk_server_chan.ops = &bulk_ops;
+	bulk_server_chan.rx.mtu = BULK_SDU_LEN;
+	*chan = &bulk_server_chan;
+
+	return 0;
+}
+
+static struct bt_l2cap_server bulk_server = {
+	.psm = BULK_PSM,
+	.accept = bulk_accept,
+};
+
+static void print_rate(const char *name, uint32_t bytes, int packets,
+		       uint32_t cycles)
+{
+	uint64_t rate;
+
+	if (!cycles) {
+		cycles = 1;
+	}
+
+	rate = (uint64_t)bytes * sys_clock_hw_cycles_per_sec / cycles;
+
+	PRINT("%s: %d packets, %u bytes\n", name, packets, bytes);
+	PRINT("  throughput %u bytes/s\n", (uint32_t)rate);
+	PRINT("  %u cycles/packet\n", cycles / packets);
+}
+
+static int connect(uint32_t *cycles)
+{
+	uint32_t start;
+
+	start = sys_cycle_get_32();
+
+	central = bt_conn_create_le(&peer, BT_LE_CONN_PARAM_DEFAULT);
+	if (!central) {
+		PRINT("Cannot create connection\n");
+		return TC_FAIL;
+	}
+
+	/* Both ends of the link */
+	if (!nano_task_sem_take(&conn_sem, TIMEOUT) ||
+	    !nano_task_sem_take(&conn_sem, TIMEOUT)) {
+		PRINT("Connection timed out\n");
+		return TC_FAIL;
+	}
+
+	*cycles += sys_cycle_get_32() - start;
+
+	return TC_PASS;
+}
+
+static int disconnect(void)
+{
+	bt_conn_disconnect(central, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+	bt_conn_unref(central);
+	central = NULL;
+
+	if (!nano_task_sem_take(&disconn_sem, TIMEOUT) ||
+	    !nano_task_sem_take(&disconn_sem, TIMEOUT)) {
+		PRINT("Disconnection timed out\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static int conn_setup(void)
+{
+	uint32_t cycles = 0;
+	int err, i;
+
+	/* The peripheral keeps advertising, the stack restarts advertising
+	 * after every disconnection. Find the virtual peer.
+	 */
+	err = bt_le_adv_start(BT_LE_ADV(BT_LE_ADV_IND), ad, ARRAY_SIZE(ad),
+			      NULL, 0);
+	if (!err) {
+		err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
+	}
+
+	if (err) {
+		PRINT("Cannot start advertising and scanning (err %d)\n", err);
+		return TC_FAIL;
+	}
+
+	if (!nano_task_sem_take(&found_sem, TIMEOUT)) {
+		PRINT("Peer not found\n");
+		return TC_FAIL;
+	}
+
+	bt_le_scan_stop();
+
+	for (i = 0; i < CONN_ROUNDS; i++) {
+		if (connect(&cycles) != TC_PASS ||
+		    disconnect() != TC_PASS) {
+			return TC_FAIL;
+		}
+	}
+
+	PRINT("connection setup: %u cycles avg\n", cycles / CONN_ROUNDS);
+
+	/* Stay connected for the throughput tests */
+	return connect(&cycles);
+}
+
+static int notify_throughput(void)
+{
+	uint8_t data[NOTIFY_LEN];
+	uint32_t start;
+	int i;
+
+	subscribe_params.notify = notify_func;
+	subscribe_params.value = BT_GATT_CCC_NOTIFY;
+	subscribe_params.value_handle = bench_attrs[2].handle;
+	subscribe_params.ccc_handle = bench_attrs[3].handle;
+
+	if (bt_gatt_subscribe(central, &subscribe_params)) {
+		PRINT("Subscribe failed\n");
+		return TC_FAIL;
+	}
+
+	memset(data, 0xaa, sizeof(data));
+	received = 0;
+	expected = NOTIFICATIONS * NOTIFY_LEN;
+
+	start = sys_cycle_get_32();
+
+	for (i = 0; i < NOTIFICATIONS; i++) {
+		if (bt_gatt_notify(peripheral, &bench_attrs[2], data,
+				   sizeof(data))) {
+			PRINT("Notification %d failed\n", i);
+			return TC_FAIL;
+		}
+	}
+
+	if (!nano_task_sem_take(&done_sem, TIMEOUT)) {
+		PRINT("Received %u of %u bytes\n", received, expected);
+		return TC_FAIL;
+	}
+
+	print_rate("ATT notifications", expected, NOTIFICATIONS,
+		   sys_cycle_get_32() - start);
+
+	return TC_PASS;
+}
+
+#if defined(CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH)
+static struct bt_gatt_subscribe_params sensor_params[SENSORS];
+static uint32_t sensor_value[SENSORS];
+static int sensor_notifications;
+
+static uint8_t sensor_notify(struct bt_conn *conn,
+			     struct bt_gatt_subscribe_params *params,
+			     const void *data, uint16_t length)
+{
+	int i = params - sensor_params;
+	int done = 0;
+
+	if (!data || length != sizeof(sensor_value[i])) {
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	memcpy(&sensor_value[i], data, length);
+	sensor_notifications++;
+
+	for (i = 0; i < SENSORS; i++) {
+		if (sensor_value[i] == SENSOR_ROUNDS) {
+			done++;
+		}
+	}
+
+	if (done == SENSORS) {
+		nano_sem_give(&done_sem);
+	}
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
+/* Every round updates all sensors, only the latest values are notified */
+static int notify_batch(void)
+{
+	uint32_t start, value;
+	int i, round;
+
+	for (i = 0; i < SENSORS; i++) {
+		sensor_params[i].notify = sensor_notify;
+		sensor_params[i].value = BT_GATT_CCC_NOTIFY;
+		sensor_params[i].value_handle = SENSOR_ATTR(i)[1].handle;
+		sensor_params[i].ccc_handle = SENSOR_ATTR(i)[2].handle;
+
+		if (bt_gatt_subscribe(central, &sensor_params[i]) ||
+		    !nano_task_sem_take(&ccc_sem, TIMEOUT)) {
+			PRINT("Subscribe failed\n");
+			return TC_FAIL;
+		}
+	}
+
+	start = sys_cycle_get_32();
+
+	for (round = 1; round <= SENSOR_ROUNDS; round++) {
+		for (i = 0; i < SENSORS; i++) {
+			value = round;
+
+			if (bt_gatt_notify_queue(&SENSOR_ATTR(i)[1], &value,
+						 sizeof(value))) {
+				PRINT("Update %d of sensor %d failed\n",
+				      round, i);
+				return TC_FAIL;
+			}
+		}
+
+		/* Let some batches time out */
+		if (!(round % 20)) {
+			task_sleep(1);
+		}
+	}
+
+	bt_gatt_notify_flush();
+
+	if (!nano_task_sem_take(&done_sem, TIMEOUT)) {
+		PRINT("Latest sensor values not received\n");
+		return TC_FAIL;
+	}
+
+	PRINT("batched notifications: %d updates, %d notifications\n",
+	      SENSORS * SENSOR_ROUNDS, sensor_notifications);
+	PRINT("  %u cycles/update\n",
+	      (sys_cycle_get_32() - start) / (SENSORS * SENSOR_ROUNDS));
+
+	if (sensor_notifications >= SENSORS * SENSOR_ROUNDS) {
+		PRINT("Updates were not coalesced\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+#endif /* CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH */
+
+static int l2cap_throughput(void)
+{
+	struct net_buf *buf;
+	uint32_t start;
+	int i;
+
+	client_chan.ops = &chan_ops;
+
+	if (bt_l2cap_chan_connect(central, &client_chan, PSM) ||
+	    !nano_task_sem_take(&chan_sem, TIMEOUT)) {
+		PRINT("L2CAP channel connection failed\n");
+		return TC_FAIL;
+	}
+
+	received = 0;
+	expected = SDUS * SDU_LEN;
+
+	start = sys_cycle_get_32();
+
+	for (i = 0; i < SDUS; i++) {
+		buf = net_buf_get(&data_fifo, BT_L2CAP_CHAN_SEND_RESERVE);
+		memset(net_buf_add(buf, SDU_LEN), i, SDU_LEN);
+
+		if (bt_l2cap_chan_send(&client_chan, buf) < 0) {
+			PRINT("SDU %d failed\n", i);
+			net_buf_unref(buf);
+			return TC_FAIL;
+		}
+	}
+
+	if (!nano_task_sem_take(&done_sem, TIMEOUT)) {
+		PRINT("Received %u of %u bytes\n", received, expected);
+		return TC_FAIL;
+	}
+
+	print_rate("L2CAP CoC", expected, SDUS, sys_cycle_get_32() - start);
+
+	return TC_PASS;
+}
+
+/* SDUs bigger than the MPS are sent in segments */
+static int bulk_throughput(void)
+{
+	struct net_buf *buf;
+	uint32_t start;
+	int i;
+
+	bulk_client_chan.ops = &chan_ops;
+
+	if (bt_l2cap_chan_connect(central, &bulk_client_chan, BULK_PSM) ||
+	    !nano_task_sem_take(&chan_sem, TIMEOUT)) {
+		PRINT("L2CAP channel connection failed\n");
+		return TC_FAIL;
+	}
+
+	received = 0;
+	expected = BULK_SDUS * BULK_SDU_LEN;
+
+	start = sys_cycle_get_32();
+
+	for (i = 0; i < BULK_SDUS; i++) {
+		buf = net_buf_get(&bulk_fifo, BT_L2CAP_CHAN_SEND_RESERVE);
+		memset(net_buf_add(buf, BULK_SDU_LEN), i, BULK_SDU_LEN);
+
+		if (bt_l2cap_chan_send(&bulk_client_chan, buf) < 0) {
+			PRINT("SDU %d failed\n", i);
+			net_buf_unref(buf);
+			return TC_FAIL;
+		}
+	}
+
+	if (!nano_task_sem_take(&done_sem, TIMEOUT)) {
+		PRINT("Received %u of %u bytes\n", received, expected);
+		return TC_FAIL;
+	}
+
+	print_rate("L2CAP CoC bulk", expected, BULK_SDUS,
+		   sys_cycle_get_32() - start);
+	PRINT("  MPS %u, segment MTU %u\n", bulk_client_chan.tx.mps,
+	      CONFIG_BLUETOOTH_L2CAP_TX_MPS);
+
+	return TC_PASS;
+}
+
+/* Drop the link with SDUs queued, they must go back to their pool */
+static int bulk_disconnect(void)
+{
+	struct net_buf *bufs[BULK_BUFS];
+	int i, j;
+
+	/* Nothing left to count */
+	received = 0;
+	expected = 0;
+
+	for (i = 0; i < BULK_BUFS; i++) {
+		bufs[i] = net_buf_get(&bulk_fifo, BT_L2CAP_CHAN_SEND_RESERVE);
+		memset(net_buf_add(bufs[i], BULK_SDU_LEN), i, BULK_SDU_LEN);
+
+		if (bt_l2cap_chan_send(&bulk_client_chan, bufs[i]) < 0) {
+			PRINT("SDU %d failed\n", i);
+			net_buf_unref(bufs[i]);
+			return TC_FAIL;
+		}
+	}
+
+	if (disconnect() != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	for (i = 0; i < BULK_BUFS; i++) {
+		bufs[i] = net_buf_get_timeout(&bulk_fifo, 0, TIMEOUT);
+		if (!bufs[i]) {
+			PRINT("%d SDUs not released on disconnection\n",
+			      BULK_BUFS - i);
+			break;
+		}
+	}
+
+	for (j = 0; j < i; j++) {
+		net_buf_unref(bufs[j]);
+	}
+
+	return i == BULK_BUFS ? TC_PASS : TC_FAIL;
+}
+
+void main(void)
+{
+	int result = TC_FAIL;
+
+	TC_START("Bluetooth host benchmark");
+
+	nano_sem_init(&conn_sem);
+	nano_sem_init(&disconn_sem);
+	nano_sem_init(&found_sem);
+	nano_sem_init(&done_sem);
+	nano_sem_init(&chan_sem);
+#if defined(CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH)
+	nano_sem_init(&ccc_sem);
+#endif
+	net_buf_pool_init(data_pool);
+	net_buf_pool_init(bulk_pool);
+	net_buf_pool_init(bulk_rx_pool);
+
+	if (bt_enable(NULL)) {
+		PRINT("Bluetooth init failed\n");
+		goto done;
+	}
+
+	bt_gatt_register(bench_attrs, ARRAY_SIZE(bench_attrs));
+	bt_conn_cb_register(&conn_callbacks);
+	bt_l2cap_server_register(&server);
+	bt_l2cap_server_register(&bulk_server);
+
+	if (conn_setup() != TC_PASS || notify_throughput() != TC_PASS) {
+		goto done;
+	}
+
+#if defined(CONFIG_BLUETOOTH_GATT_NOTIFY_BATCH)
+	if (notify_batch() != TC_PASS) {
+		goto done;
+	}
+#endif
+
+	if (l2cap_throughput() == TC_PASS && bulk_throughput() == TC_PASS &&
+	    bulk_disconnect() == TC_PASS) {
+		result = TC_PASS;
+	}
+
+done:
+	TC_END_RESULT(result);
+	TC_END_REPORT(result);
+}
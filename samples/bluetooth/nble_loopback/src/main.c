@@ -0,0 +1,157 @@
+/* main.c - NBLE RPC loopback benchmark */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Serializes GATT write events the way the Nordic chip does and, with
+ * CONFIG_NBLE_RPC_LOOPBACK, receives them back through the deserializer
+ * as if the chip had sent them. The driver hands each of them to the
+ * write callback of a local attribute, which checks the value. The
+ * number of calls per second is printed for several value lengths.
+ */
+
+#include <zephyr.h>
+
+#if defined(CONFIG_STDOUT_CONSOLE)
+#include <stdio.h>
+#define PRINT           printf
+#else
+#include <misc/printk.h>
+#define PRINT           printk
+#endif
+
+#include <string.h>
+#include <tc_util.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/gatt.h>
+
+/* The following NBLE includes are for testing purposes only. Never
+ * ever use them in your application.
+ */
+#include "rpc.h"
+#include "gap_internal.h"
+#include "gatt_internal.h"
+#include "rpc_functions_to_quark.h"
+
+#define CALLS          1000
+
+/* Function indexes of the calls received from the chip */
+#define FN_SIG_NONE(__fn)				fn_index_##__fn,
+#define FN_SIG_S(__fn, __s)				FN_SIG_NONE(__fn)
+#define FN_SIG_P(__fn, __type)				FN_SIG_NONE(__fn)
+#define FN_SIG_S_B(__fn, __s, __type, __length)		FN_SIG_NONE(__fn)
+#define FN_SIG_B_B_P(__fn, __type1, __length1, __type2, __length2,	\
+		     __type3)				FN_SIG_NONE(__fn)
+#define FN_SIG_S_P(__fn, __s, __type)			FN_SIG_NONE(__fn)
+#define FN_SIG_S_B_P(__fn, __s, __type, __length, __type_ptr)		\
+							FN_SIG_NONE(__fn)
+#define FN_SIG_S_B_B_P(__fn, __s, __type1, __length1, __type2,		\
+		       __length2, __type3)		FN_SIG_NONE(__fn)
+
+enum { LIST_FN_SIG_S_B fn_s_b_index_max };
+
+static const uint16_t lengths[] = { 0, 20, 128, 250 };
+
+static uint8_t value[250];
+static int writes;
+static int errors;
+
+static ssize_t write_value(struct bt_conn *conn,
+			   const struct bt_gatt_attr *attr,
+			   const void *buf, uint16_t len, uint16_t offset)
+{
+	writes++;
+
+	if (len && memcmp(buf, value, len)) {
+		errors++;
+	}
+
+	return len;
+}
+
+static struct bt_gatt_attr attr = {
+	.uuid = BT_UUID_GATT_CHRC,
+	.perm = BT_GATT_PERM_WRITE,
+	.write = write_value,
+};
+
+/* What the chip sends when a peer writes the attribute */
+static void write_evt(uint16_t len)
+{
+	struct nble_gatt_wr_evt evt;
+
+	memset(&evt, 0, sizeof(evt));
+	evt.attr = &attr;
+
+	/* The RX fiber preempts us and handles the call right away */
+	rpc_serialize_s_b(fn_index_on_nble_gatts_write_evt, &evt, sizeof(evt),
+			  value, len);
+}
+
+static bool run(uint16_t len)
+{
+	uint32_t start, cycles;
+	int i;
+
+	writes = 0;
+	errors = 0;
+
+	start = sys_cycle_get_32();
+
+	for (i = 0; i < CALLS; i++) {
+		write_evt(len);
+	}
+
+	cycles = (sys_cycle_get_32() - start) / CALLS;
+
+	PRINT("  %3u bytes: %6u cycles/call, %6u calls/s%s\n", len, cycles,
+	      sys_clock_hw_cycles_per_sec / cycles,
+	      (writes != CALLS || errors) ? " (lost or corrupted)" : "");
+
+	return writes == CALLS && !errors;
+}
+
+void main(void)
+{
+	int err, i, result = TC_PASS;
+
+	TC_START("NBLE RPC loopback benchmark");
+
+	for (i = 0; i < sizeof(value); i++) {
+		value[i] = i;
+	}
+
+	err = bt_enable(NULL);
+	if (err) {
+		PRINT("Bluetooth init failed (err %d)\n", err);
+		result = TC_FAIL;
+		goto out;
+	}
+
+	PRINT("%d write events per length\n", CALLS);
+
+	for (i = 0; i < ARRAY_SIZE(lengths); i++) {
+		if (!run(lengths[i])) {
+			result = TC_FAIL;
+		}
+	}
+
+out:
+	TC_END_RESULT(result);
+	TC_END_REPORT(result);
+}
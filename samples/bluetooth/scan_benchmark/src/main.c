@@ -0,0 +1,325 @@
+/* main.c - Bluetooth scan benchmark */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Simulates a crowded radio environment while scanning: advertising
+ * reports of bonded devices and of unknown devices, all using resolvable
+ * private addresses, are fed to the host as if they came from the
+ * controller. Every round each device advertises once in a pseudo random
+ * order, and half way through all devices change their RPA. The benchmark
+ * checks that exactly the reports of the bonded devices are resolved to
+ * their identity and measures the cycles spent per report, separately for
+ * the rounds with new RPAs (cold) and the others (warm). Build with
+ * prj_nocache.conf to compare without CONFIG_BLUETOOTH_RPA_CACHE.
+ */
+
+#include <zephyr.h>
+
+#if defined(CONFIG_STDOUT_CONSOLE)
+#include <stdio.h>
+#define PRINT           printf
+#else
+#include <misc/printk.h>
+#define PRINT           printk
+#endif
+
+#include <string.h>
+#include <atomic.h>
+#include <tc_util.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/driver.h>
+
+#include <tinycrypt/aes.h>
+#include <tinycrypt/constants.h>
+
+/* The following Bluetooth includes are for testing purposes only. Never
+ * ever use them in your application.
+ */
+#include "hci_core.h"
+#include "keys.h"
+
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE)
+#define RPA_CACHE      "on"
+#else
+#define RPA_CACHE      "off"
+#endif
+
+#define BONDED         CONFIG_BLUETOOTH_MAX_PAIRED
+#define STRANGERS      24
+#define DEVICES        (BONDED + STRANGERS)
+
+#if defined(CONFIG_BLUETOOTH_RPA_CACHE) && \
+	(CONFIG_BLUETOOTH_RPA_NEG_CACHE_SIZE < STRANGERS)
+#error "The negative RPA cache must be able to hold all the strangers"
+#endif
+
+#define ROUNDS         40
+#define ROTATE_ROUND   (ROUNDS / 2)
+
+#define RSSI           -60
+#define TIMEOUT        (5 * sys_clock_ticks_per_sec)
+
+struct device {
+	uint8_t irk[16];
+	bt_addr_le_t id;
+	bt_addr_le_t rpa;
+};
+
+static struct device devices[DEVICES];
+static uint8_t order[DEVICES];
+
+/* Flags and manufacturer specific data */
+static const uint8_t ad[] = { 0x02, 0x01, 0x06,
+			      0x05, 0xff, 0x59, 0x00, 0xbe, 0xef };
+
+static uint32_t seed = 0x5eed;
+
+static int reports, resolved, unresolved;
+static struct nano_sem done_sem;
+
+/* Same sequence on every run */
+static uint8_t next_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return seed >> 16;
+}
+
+/* Identity addresses are static random ones with the device index in the
+ * first octet.
+ */
+static bool is_bonded_id(const bt_addr_le_t *addr)
+{
+	return addr->type == BT_ADDR_LE_RANDOM && addr->val[0] < BONDED &&
+	       addr->val[1] == 0xbe && addr->val[2] == 0xef &&
+	       addr->val[5] == 0xc0;
+}
+
+/* RPA = hash || prand with hash = ah(IRK, prand), see Core Specification
+ * Vol 3, Part H, 2.2.2. TinyCrypt takes big endian values.
+ */
+static void rpa_create(struct device *dev)
+{
+	struct tc_aes_key_sched_struct sched;
+	uint8_t key[16], res[16];
+	int i;
+
+	dev->rpa.type = BT_ADDR_LE_RANDOM;
+	dev->rpa.val[3] = next_rand();
+	dev->rpa.val[4] = next_rand();
+	dev->rpa.val[5] = (next_rand() & 0x3f) | 0x40;
+
+	for (i = 0; i < 16; i++) {
+		key[i] = dev->irk[15 - i];
+	}
+
+	memset(res, 0, 13);
+	res[13] = dev->rpa.val[5];
+	res[14] = dev->rpa.val[4];
+	res[15] = dev->rpa.val[3];
+
+	tc_aes128_set_encrypt_key(&sched, key);
+	tc_aes_encrypt(res, res, &sched);
+
+	dev->rpa.val[0] = res[15];
+	dev->rpa.val[1] = res[14];
+	dev->rpa.val[2] = res[13];
+}
+
+static void devices_init(void)
+{
+	struct bt_keys *keys;
+	int i, j;
+
+	for (i = 0; i < DEVICES; i++) {
+		struct device *dev = &devices[i];
+
+		for (j = 0; j < sizeof(dev->irk); j++) {
+			dev->irk[j] = next_rand();
+		}
+
+		dev->id.type = BT_ADDR_LE_RANDOM;
+		dev->id.val[0] = i;
+		dev->id.val[1] = 0xbe;
+		dev->id.val[2] = 0xef;
+		dev->id.val[5] = 0xc0;
+
+		rpa_create(dev);
+
+		if (i >= BONDED) {
+			continue;
+		}
+
+		keys = bt_keys_get_type(BT_KEYS_IRK, &dev->id);
+		bt_keys_set_irk(keys, dev->irk);
+	}
+}
+
+static void shuffle(void)
+{
+	int i, j;
+	uint8_t tmp;
+
+	for (i = 0; i < DEVICES; i++) {
+		order[i] = i;
+	}
+
+	for (i = DEVICES - 1; i > 0; i--) {
+		j = next_rand() % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+}
+
+/* Pretend to be the controller */
+static int report(const bt_addr_le_t *addr)
+{
+	struct bt_hci_ev_le_advertising_info *info;
+	struct bt_hci_evt_le_meta_event *meta;
+	struct bt_hci_evt_hdr *hdr;
+	struct net_buf *buf;
+
+	buf = bt_buf_get_evt();
+	if (!buf) {
+		return TC_FAIL;
+	}
+
+	hdr = net_buf_add(buf, sizeof(*hdr));
+	hdr->evt = BT_HCI_EVT_LE_META_EVENT;
+	hdr->len = sizeof(*meta) + 1 + sizeof(*info) + sizeof(ad) + 1;
+
+	meta = net_buf_add(buf, sizeof(*meta));
+	meta->subevent = BT_HCI_EVT_LE_ADVERTISING_REPORT;
+
+	/* Number of reports */
+	net_buf_add_u8(buf, 1);
+
+	info = net_buf_add(buf, sizeof(*info));
+	info->evt_type = BT_LE_ADV_NONCONN_IND;
+	bt_addr_le_copy(&info->addr, addr);
+	info->length = sizeof(ad);
+	memcpy(net_buf_add(buf, sizeof(ad)), ad, sizeof(ad));
+
+	net_buf_add_u8(buf, (uint8_t)RSSI);
+
+	bt_recv(buf);
+
+	return TC_PASS;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi,
+			 uint8_t type, const uint8_t *data, uint8_t len)
+{
+	if (is_bonded_id(addr)) {
+		resolved++;
+	} else if (bt_addr_le_is_rpa(addr)) {
+		unresolved++;
+	}
+
+	if (++reports == ROUNDS * DEVICES) {
+		nano_sem_give(&done_sem);
+	}
+}
+
+static int run(void)
+{
+	uint32_t cold = 0, warm = 0, start;
+	int round, i;
+
+	for (round = 0; round < ROUNDS; round++) {
+		if (round == ROTATE_ROUND) {
+			for (i = 0; i < DEVICES; i++) {
+				rpa_create(&devices[i]);
+			}
+		}
+
+		shuffle();
+
+		/* The reports are processed by the host fibers, which
+		 * preempt us as soon as they are queued.
+		 */
+		start = sys_cycle_get_32();
+
+		for (i = 0; i < DEVICES; i++) {
+			if (report(&devices[order[i]].rpa) != TC_PASS) {
+				PRINT("Cannot get event buffer\n");
+				return TC_FAIL;
+			}
+		}
+
+		if (round == 0 || round == ROTATE_ROUND) {
+			cold += sys_cycle_get_32() - start;
+		} else {
+			warm += sys_cycle_get_32() - start;
+		}
+	}
+
+	if (!nano_task_sem_take(&done_sem, TIMEOUT)) {
+		PRINT("Only %d of %d reports seen\n", reports,
+		      ROUNDS * DEVICES);
+		return TC_FAIL;
+	}
+
+	PRINT("%d bonded, %d unknown devices, %d rounds, RPA cache %s\n",
+	      BONDED, STRANGERS, ROUNDS, RPA_CACHE);
+	PRINT("  resolved %d, unresolved %d\n", resolved, unresolved);
+	PRINT("  cold: %u cycles/report\n", cold / (2 * DEVICES));
+	PRINT("  warm: %u cycles/report\n", warm / ((ROUNDS - 2) * DEVICES));
+
+	if (resolved != ROUNDS * BONDED || unresolved != ROUNDS * STRANGERS) {
+		PRINT("Expected %d resolved and %d unresolved reports\n",
+		      ROUNDS * BONDED, ROUNDS * STRANGERS);
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+void main(void)
+{
+	int err, result = TC_FAIL;
+
+	TC_START("Bluetooth scan benchmark");
+
+	nano_sem_init(&done_sem);
+
+	err = bt_enable(NULL);
+	if (err) {
+		PRINT("Bluetooth init failed (err %d)\n", err);
+		goto out;
+	}
+
+	devices_init();
+
+	err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
+	if (err) {
+		PRINT("Scanning failed to start (err %d)\n", err);
+		goto out;
+	}
+
+	result = run();
+
+	bt_le_scan_stop();
+
+out:
+	TC_END_RESULT(result);
+	TC_END_REPORT(result);
+}
@@ -0,0 +1,294 @@
+/* main.c - Bluetooth scan filter test */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Feeds bursts of advertising reports to the host as if they came from
+ * the controller, with every advertiser repeating the same data several
+ * times as a controller without duplicate filtering does. Each step sets
+ * a different scan filter and checks how many reports reach the scan
+ * callback. The cycles spent per report are printed without filter and
+ * with duplicate suppression.
+ */
+
+#include <zephyr.h>
+
+#if defined(CONFIG_STDOUT_CONSOLE)
+#include <stdio.h>
+#define PRINT           printf
+#else
+#include <misc/printk.h>
+#define PRINT           printk
+#endif
+
+#include <string.h>
+#include <tc_util.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/driver.h>
+
+#define DEVICES        16
+#define REPEAT         10
+
+/* RSSI of device i is RSSI_BASE - i * RSSI_STEP dBm */
+#define RSSI_BASE      -40
+#define RSSI_STEP      2
+
+#define RSSI_MIN       -55
+#define RSSI_DELTA     10
+
+/* Devices above RSSI_MIN */
+#define STRONG         ((RSSI_BASE - RSSI_MIN) / RSSI_STEP + 1)
+
+#define LONG_WINDOW    60000
+#define SHORT_WINDOW   1000
+
+struct device {
+	bt_addr_le_t addr;
+	int8_t rssi;
+	uint8_t ad[7];
+};
+
+static struct device devices[DEVICES];
+static int found;
+
+static const uint8_t mfg_type = BT_DATA_MANUFACTURER_DATA;
+
+static bt_addr_le_t allowed[2];
+
+/* Even devices send manufacturer data, odd ones service data */
+static void devices_init(void)
+{
+	int i;
+
+	for (i = 0; i < DEVICES; i++) {
+		struct device *dev = &devices[i];
+
+		dev->addr.type = BT_ADDR_LE_PUBLIC;
+		dev->addr.val[0] = i;
+		dev->addr.val[1] = 0xbe;
+		dev->addr.val[2] = 0xef;
+
+		dev->rssi = RSSI_BASE - i * RSSI_STEP;
+
+		dev->ad[0] = 0x02;
+		dev->ad[1] = BT_DATA_FLAGS;
+		dev->ad[2] = BT_LE_AD_NO_BREDR;
+		dev->ad[3] = 0x03;
+		dev->ad[4] = (i & 1) ? BT_DATA_SVC_DATA16 :
+				       BT_DATA_MANUFACTURER_DATA;
+		dev->ad[5] = i;
+		dev->ad[6] = 0;
+	}
+}
+
+/* Pretend to be the controller */
+static void report(const struct device *dev)
+{
+	struct bt_hci_ev_le_advertising_info *info;
+	struct bt_hci_evt_le_meta_event *meta;
+	struct bt_hci_evt_hdr *hdr;
+	struct net_buf *buf;
+
+	buf = bt_buf_get_evt();
+	if (!buf) {
+		PRINT("Cannot get event buffer\n");
+		return;
+	}
+
+	hdr = net_buf_add(buf, sizeof(*hdr));
+	hdr->evt = BT_HCI_EVT_LE_META_EVENT;
+	hdr->len = sizeof(*meta) + 1 + sizeof(*info) + sizeof(dev->ad) + 1;
+
+	meta = net_buf_add(buf, sizeof(*meta));
+	meta->subevent = BT_HCI_EVT_LE_ADVERTISING_REPORT;
+
+	net_buf_add_u8(buf, 1);
+
+	info = net_buf_add(buf, sizeof(*info));
+	info->evt_type = BT_LE_ADV_NONCONN_IND;
+	bt_addr_le_copy(&info->addr, &dev->addr);
+	info->length = sizeof(dev->ad);
+	memcpy(net_buf_add(buf, sizeof(dev->ad)), dev->ad, sizeof(dev->ad));
+
+	net_buf_add_u8(buf, dev->rssi);
+
+	/* The host fibers preempt us and process the report right away */
+	bt_recv(buf);
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi,
+			 uint8_t type, const uint8_t *data, uint8_t len)
+{
+	found++;
+}
+
+/* Every device advertises REPEAT times, returns the cycles per report */
+static uint32_t burst(void)
+{
+	uint32_t start;
+	int i, j;
+
+	start = sys_cycle_get_32();
+
+	for (i = 0; i < REPEAT; i++) {
+		for (j = 0; j < DEVICES; j++) {
+			report(&devices[j]);
+		}
+	}
+
+	return (sys_cycle_get_32() - start) / (REPEAT * DEVICES);
+}
+
+static bool check(const char *step, int expected)
+{
+	bool ok = (found == expected);
+
+	PRINT("  %-24s %3d of %3d reports %s\n", step, found,
+	      REPEAT * DEVICES, ok ? "" : "(unexpected)");
+
+	found = 0;
+
+	return ok;
+}
+
+static int run(void)
+{
+	struct bt_le_scan_filter filter;
+	uint32_t plain, dedup;
+	bool ok = true;
+
+	/* No filter */
+	plain = burst();
+	ok &= check("no filter", REPEAT * DEVICES);
+
+	/* Duplicates are dropped until the data changes */
+	memset(&filter, 0, sizeof(filter));
+	filter.rssi_min = BT_LE_SCAN_RSSI_ANY;
+	filter.dup_window = LONG_WINDOW;
+	bt_le_scan_filter_set(&filter);
+
+	dedup = burst();
+	ok &= check("duplicates", DEVICES);
+
+	devices[0].ad[6]++;
+	burst();
+	ok &= check("data change", 1);
+
+	/* Duplicates are reported again on big RSSI changes */
+	filter.rssi_delta = RSSI_DELTA;
+	bt_le_scan_filter_set(&filter);
+
+	burst();
+	devices[1].rssi += RSSI_DELTA / 2;
+	burst();
+	devices[1].rssi += RSSI_DELTA;
+	burst();
+	devices[1].rssi = RSSI_BASE - RSSI_STEP;
+	ok &= check("RSSI change", DEVICES + 1);
+
+	/* The window expires */
+	filter.rssi_delta = 0;
+	filter.dup_window = SHORT_WINDOW;
+	bt_le_scan_filter_set(&filter);
+
+	burst();
+	task_sleep(2 * SHORT_WINDOW * sys_clock_ticks_per_sec / 1000 + 1);
+	burst();
+	ok &= check("window expiry", 2 * DEVICES);
+
+	/* RSSI threshold */
+	memset(&filter, 0, sizeof(filter));
+	filter.rssi_min = RSSI_MIN;
+	bt_le_scan_filter_set(&filter);
+
+	burst();
+	ok &= check("RSSI threshold", REPEAT * STRONG);
+
+	/* AD type allow-list */
+	memset(&filter, 0, sizeof(filter));
+	filter.rssi_min = BT_LE_SCAN_RSSI_ANY;
+	filter.ad_type_count = 1;
+	filter.ad_types = &mfg_type;
+	bt_le_scan_filter_set(&filter);
+
+	burst();
+	ok &= check("AD type", REPEAT * DEVICES / 2);
+
+	/* Address allow-list */
+	memset(&filter, 0, sizeof(filter));
+	filter.rssi_min = BT_LE_SCAN_RSSI_ANY;
+	filter.addr_count = ARRAY_SIZE(allowed);
+	filter.addrs = allowed;
+	bt_le_scan_filter_set(&filter);
+
+	burst();
+	ok &= check("address", REPEAT * ARRAY_SIZE(allowed));
+
+	/* Everything together */
+	memset(&filter, 0, sizeof(filter));
+	filter.rssi_min = RSSI_MIN;
+	filter.ad_type_count = 1;
+	filter.ad_types = &mfg_type;
+	filter.dup_window = LONG_WINDOW;
+	bt_le_scan_filter_set(&filter);
+
+	burst();
+	ok &= check("combined", (STRONG + 1) / 2);
+
+	bt_le_scan_filter_set(NULL);
+
+	PRINT("  no filter:  %u cycles/report\n", plain);
+	PRINT("  duplicates: %u cycles/report\n", dedup);
+
+	return ok ? TC_PASS : TC_FAIL;
+}
+
+void main(void)
+{
+	int err, result = TC_FAIL;
+
+	TC_START("Bluetooth scan filter test");
+
+	devices_init();
+	bt_addr_le_copy(&allowed[0], &devices[3].addr);
+	bt_addr_le_copy(&allowed[1], &devices[DEVICES - 1].addr);
+
+	err = bt_enable(NULL);
+	if (err) {
+		PRINT("Bluetooth init failed (err %d)\n", err);
+		goto out;
+	}
+
+	err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
+	if (err) {
+		PRINT("Scanning failed to start (err %d)\n", err);
+		goto out;
+	}
+
+	PRINT("%d devices, %d reports per burst\n", DEVICES,
+	      REPEAT * DEVICES);
+
+	result = run();
+
+	bt_le_scan_stop();
+
+out:
+	TC_END_RESULT(result);
+	TC_END_REPORT(result);
+}
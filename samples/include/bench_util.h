@@ -0,0 +1,177 @@
+/* bench_util.h - benchmark utilities header file */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * DESCRIPTION
+ * A benchmark collects the duration of a number of runs of the operation it
+ * measures, in hardware clock cycles, after discarding a few warmup runs
+ * during which caches and branch predictors settle. It then reports the
+ * minimum, median, 99th percentile and maximum durations on a single line
+ * that scripts/sanitycheck --benchmarks parses and compares with a baseline:
+ *
+ * BENCH <name> iterations=<n> min=<cycles> median=<cycles> p99=<cycles> ...
+ *
+ * Results measured once, such as boot times, and averages computed by the
+ * benchmarks themselves are reported as:
+ *
+ * BENCH <name> value=<cycles>
+ *
+ * Benchmark names must not contain spaces.
+ */
+
+#ifndef __BENCH_UTIL_H__
+#define __BENCH_UTIL_H__
+
+#include <zephyr.h>
+
+#include <misc/printk.h>
+
+/* default number of runs discarded before collecting samples */
+#define BENCH_WARMUP_ITERATIONS 10
+
+struct bench {
+	const char *name;
+	uint32_t *samples;
+	int max_samples;
+	int num_samples;
+	int warmup;
+};
+
+struct bench_stats {
+	uint32_t min;
+	uint32_t median;
+	uint32_t p99;
+	uint32_t max;
+};
+
+/**
+ * @brief Statically define a benchmark
+ *
+ * @param var Name of the benchmark variable.
+ * @param bench_name Name the results are reported under.
+ * @param iterations Number of samples to collect after the warmup runs.
+ */
+#define BENCH_DEFINE(var, bench_name, iterations) \
+	static uint32_t _bench_samples_##var[iterations]; \
+	static struct bench var = { \
+		.name = bench_name, \
+		.samples = _bench_samples_##var, \
+		.max_samples = iterations, \
+		.num_samples = 0, \
+		.warmup = BENCH_WARMUP_ITERATIONS, \
+	}
+
+/* read the hardware clock used by the system clock */
+static inline uint32_t bench_cycles_get(void)
+{
+	return sys_cycle_get_32();
+}
+
+/**
+ * @brief Start collecting samples again
+ *
+ * @param b Benchmark to reset.
+ * @param warmup Number of samples to discard first.
+ */
+static inline void bench_reset(struct bench *b, int warmup)
+{
+	b->num_samples = 0;
+	b->warmup = warmup;
+}
+
+/**
+ * @brief Add the duration of one run to a benchmark
+ *
+ * Samples are discarded during the warmup runs, and once the benchmark has
+ * collected all its samples.
+ */
+static inline void bench_sample_add(struct bench *b, uint32_t cycles)
+{
+	if (b->warmup > 0) {
+		b->warmup--;
+	} else if (b->num_samples < b->max_samples) {
+		b->samples[b->num_samples++] = cycles;
+	}
+}
+
+/* evaluates to non-zero once a benchmark has collected all its samples */
+static inline int bench_done(struct bench *b)
+{
+	return b->num_samples == b->max_samples;
+}
+
+/**
+ * @brief Compute the statistics of a benchmark
+ *
+ * The samples are sorted in place. The percentiles use the nearest-rank
+ * method.
+ *
+ * @return Number of samples the statistics are computed from
+ */
+static inline int bench_stats_get(struct bench *b, struct bench_stats *stats)
+{
+	uint32_t *s = b->samples;
+	int n = b->num_samples;
+	int i;
+	int j;
+
+	if (n == 0) {
+		stats->min = stats->median = stats->p99 = stats->max = 0;
+		return 0;
+	}
+
+	/* insertion sort: the samples are few and mostly equal */
+	for (i = 1; i < n; i++) {
+		uint32_t v = s[i];
+
+		for (j = i; j > 0 && s[j - 1] > v; j--) {
+			s[j] = s[j - 1];
+		}
+		s[j] = v;
+	}
+
+	stats->min = s[0];
+	stats->median = s[(n - 1) / 2];
+	stats->p99 = s[(n * 99 + 99) / 100 - 1];
+	stats->max = s[n - 1];
+
+	return n;
+}
+
+/**
+ * @brief Report the statistics of a benchmark
+ *
+ * @return Number of samples the statistics are computed from
+ */
+static inline int bench_report(struct bench *b, struct bench_stats *stats)
+{
+	int n = bench_stats_get(b, stats);
+
+	printk("BENCH %s iterations=%d min=%u median=%u p99=%u max=%u\n",
+	       b->name, n, stats->min, stats->median, stats->p99, stats->max);
+
+	return n;
+}
+
+/* report a result measured once, or an average */
+static inline void bench_report_value(const char *name, uint32_t cycles)
+{
+	printk("BENCH %s value=%u\n", name, cycles);
+}
+
+#endif /* __BENCH_UTIL_H__ */
@@ -67,6 +67,7 @@ void event_test(void)
 
 	PRINT_F(output_file, FORMAT, "Signal enabled event",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_EVENT_RUNS));
+	bench_result_add("event_send", et / NR_OF_EVENT_RUNS);
 
 	et = BENCH_START();
 	for (nCounter = 0; nCounter < NR_OF_EVENT_RUNS; nCounter++) {
@@ -92,6 +93,7 @@ void event_test(void)
 
 	PRINT_F(output_file, FORMAT, "Signal event & Test event",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_EVENT_RUNS));
+	bench_result_add("event_send_recv", et / NR_OF_EVENT_RUNS);
 
 	et = BENCH_START();
 	for (nCounter = 0; nCounter < NR_OF_EVENT_RUNS; nCounter++) {
@@ -115,6 +117,7 @@ void event_test(void)
 
 	PRINT_F(output_file, FORMAT, "Signal event & TestW event",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_EVENT_RUNS));
+	bench_result_add("event_send_recv_wait", et / NR_OF_EVENT_RUNS);
 
 	PRINT_STRING("| Signal event with installed handler"
 				 "                                         |\n", output_file);
@@ -40,6 +40,7 @@ void queue_test(void)
 
 	PRINT_F(output_file, FORMAT, "enqueue 1 byte msg in FIFO",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_FIFO_RUNS));
+	bench_result_add("fifo_put_1", et / NR_OF_FIFO_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_FIFO_RUNS; i++) {
@@ -50,6 +51,7 @@ void queue_test(void)
 
 	PRINT_F(output_file, FORMAT, "dequeue 1 byte msg in FIFO",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_FIFO_RUNS));
+	bench_result_add("fifo_get_1", et / NR_OF_FIFO_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_FIFO_RUNS; i++) {
@@ -60,6 +62,7 @@ void queue_test(void)
 
 	PRINT_F(output_file, FORMAT, "enqueue 4 bytes msg in FIFO",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_FIFO_RUNS));
+	bench_result_add("fifo_put_4", et / NR_OF_FIFO_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_FIFO_RUNS; i++) {
@@ -70,6 +73,7 @@ void queue_test(void)
 
 	PRINT_F(output_file, FORMAT, "dequeue 4 bytes msg in FIFO",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_FIFO_RUNS));
+	bench_result_add("fifo_get_4", et / NR_OF_FIFO_RUNS);
 
 	task_sem_give(STARTRCV);
 
@@ -83,6 +87,7 @@ void queue_test(void)
 	PRINT_F(output_file, FORMAT,
 			"enqueue 1 byte msg in FIFO to a waiting higher priority task",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_FIFO_RUNS));
+	bench_result_add("fifo_put_1_to_waiter", et / NR_OF_FIFO_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_FIFO_RUNS; i++) {
@@ -94,6 +99,7 @@ void queue_test(void)
 	PRINT_F(output_file, FORMAT,
 			"enqueue 4 bytes in FIFO to a waiting higher priority task",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_FIFO_RUNS));
+	bench_result_add("fifo_put_4_to_waiter", et / NR_OF_FIFO_RUNS);
 }
 
 #endif /* FIFO_BENCH */
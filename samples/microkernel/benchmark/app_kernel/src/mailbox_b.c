@@ -140,6 +140,7 @@ void mailbox_put(uint32_t size, int count, uint32_t *time)
 {
 	int i;
 	unsigned int t;
+	char name[BENCH_NAME_LEN];
 
 	Message.rx_task = ANYTASK;
 	Message.tx_data = data_bench;
@@ -154,6 +155,9 @@ void mailbox_put(uint32_t size, int count, uint32_t *time)
 	t = TIME_STAMP_DELTA_GET(t);
 	*time = SYS_CLOCK_HW_CYCLES_TO_NS_AVG(t, count);
 	check_result();
+
+	snprintf(name, sizeof(name), "mbox_put_%lu", size);
+	bench_result_add(name, t / count);
 }
 
 #endif /* MAILBOX_BENCH */
@@ -26,6 +26,7 @@
  */
 
 #include "master.h"
+#include <bench_util.h>
 
 char Msg[MAX_MSG];
 char data_bench[OCTET_TO_SIZEOFUNIT(MESSAGE_SIZE)];
@@ -41,6 +42,16 @@ const char newline[] = "\n";
 
 FILE * output_file;
 
+/*
+ * Average durations of the operations, in cycles. They are reported once the
+ * tables are complete, so that the BENCH lines do not break them.
+ */
+static struct {
+	char name[BENCH_NAME_LEN];
+	uint32_t cycles;
+} bench_results[MAX_BENCH_RESULTS];
+static int num_bench_results;
+
 /*
  * Time in timer cycles necessary to read time.
  * Used for correction in time measurements.
@@ -89,6 +100,27 @@ void output_close(void)
 {
 }
 
+/**
+ *
+ * @brief Add the average duration of an operation to the results
+ *
+ * @param name     Name the result is reported under.
+ * @param cycles   Average duration of the operation, in cycles.
+ *
+ * @return N/A
+ */
+void bench_result_add(const char *name, uint32_t cycles)
+{
+	if (num_bench_results == MAX_BENCH_RESULTS) {
+		return;
+	}
+
+	strncpy(bench_results[num_bench_results].name, name,
+		BENCH_NAME_LEN - 1);
+	bench_results[num_bench_results].cycles = cycles;
+	num_bench_results++;
+}
+
 /* no need to wait for user key press when using console */
 #define WAIT_FOR_USER() {}
 
@@ -103,12 +135,14 @@ void output_close(void)
 void BenchTask(void)
 {
 	int autorun = 0, continuously = 0;
+	int i;
 
 	init_output(&continuously, &autorun);
 	bench_test_init();
 
 	PRINT_STRING(newline, output_file);
 	do {
+		num_bench_results = 0;
 		PRINT_STRING(dashline, output_file);
 		PRINT_STRING("|          S I M P L E   S E R V I C E    "
 					 "M E A S U R E M E N T S  |  nsec    |\n",
@@ -128,6 +162,10 @@ void BenchTask(void)
 					 "                                   |\n",
 					 output_file);
 		PRINT_STRING(dashline, output_file);
+		for (i = 0; i < num_bench_results; i++) {
+			bench_report_value(bench_results[i].name,
+					   bench_results[i].cycles);
+		}
 		PRINT_STRING("PROJECT EXECUTION SUCCESSFUL\n",output_file);
 	} while (continuously && !kbhit());
 
@@ -145,6 +145,12 @@ extern void event_test(void);
 #define PRINT_OVERFLOW_ERROR()						\
 	PRINT_F(output_file, __FILE__":%d Error: tick occurred\n", __LINE__)
 
+/* results reported on BENCH lines, see samples/include/bench_util.h */
+#define MAX_BENCH_RESULTS 128
+#define BENCH_NAME_LEN 32
+
+extern void bench_result_add(const char *name, uint32_t cycles);
+
 static inline uint32_t BENCH_START(void)
 {
 	uint32_t et;
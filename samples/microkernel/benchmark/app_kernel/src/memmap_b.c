@@ -45,6 +45,7 @@ void memorymap_test(void)
 
 	PRINT_F(output_file, FORMAT, "average alloc and dealloc memory page",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, (2 * NR_OF_MAP_RUNS)));
+	bench_result_add("mem_map_alloc_free", et / (2 * NR_OF_MAP_RUNS));
 }
 
 #endif /* MEMMAP_BENCH */
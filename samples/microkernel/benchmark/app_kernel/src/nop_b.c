@@ -44,6 +44,7 @@ void call_test(void)
 
 	PRINT_F(output_file, FORMAT, "kernel service request overhead",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_NOP_RUNS));
+	bench_result_add("task_nop", et / NR_OF_NOP_RUNS);
 }
 
 #endif /* MICROKERNEL_CALL_BENCH */
@@ -87,7 +87,13 @@
  * Function prototypes.
  */
 int pipeput(kpipe_t pipe, K_PIPE_OPTION
-		 option, int size, int count, uint32_t *time);
+		 option, int size, int count, uint32_t *time,
+		 const char *name);
+
+/* names of the TestPipes buffers in the benchmark results */
+static const char * const pipe_buf_names[] = {
+	"nobuf", "smallbuf", "bigbuf"
+};
 
 /*
  * Function declarations.
@@ -109,6 +115,7 @@ void pipe_test(void)
 	kpriority_t	TaskPrio;
 	int		prio;
 	GetInfo	getinfo;
+	char name[BENCH_NAME_LEN];
 
 	task_sem_reset(SEM0);
 	task_sem_give(STARTRCV);
@@ -138,8 +145,10 @@ void pipe_test(void)
 	for (putsize = 8; putsize <= MESSAGE_SIZE_PIPE; putsize <<= 1) {
 		for (pipe = 0; pipe < 3; pipe++) {
 			putcount = NR_OF_PIPE_RUNS;
+			snprintf(name, sizeof(name), "pipe_all_n_%s_%lu",
+				 pipe_buf_names[pipe], putsize);
 			pipeput(TestPipes[pipe], _ALL_N, putsize, putcount,
-				 &puttime[pipe]);
+				 &puttime[pipe], name);
 
 			/* waiting for ack */
 			task_fifo_get(CH_COMM, &getinfo, TICKS_UNLIMITED);
@@ -172,8 +181,12 @@ void pipe_test(void)
 		for (putsize = 8; putsize <= (MESSAGE_SIZE_PIPE); putsize <<= 1) {
 			putcount = MESSAGE_SIZE_PIPE / putsize;
 			for (pipe = 0; pipe < 3; pipe++) {
+				snprintf(name, sizeof(name),
+					 "pipe_1_to_n_%s_%s_%lu",
+					 prio ? "lo" : "hi", pipe_buf_names[pipe],
+					 putsize);
 				pipeput(TestPipes[pipe], _1_TO_N, putsize,
-						 putcount, &puttime[pipe]);
+						 putcount, &puttime[pipe], name);
 				/* size*count == MESSAGE_SIZE_PIPE */
 				/* waiting for ack */
 				task_fifo_get(CH_COMM, &getinfo, TICKS_UNLIMITED);
@@ -198,10 +211,13 @@ void pipe_test(void)
  * @param size     Data chunk size.
  * @param count    Number of data chunks.
  * @param time     Total write time.
+ * @param name     Name the write time is reported under.
  */
-int pipeput(kpipe_t pipe, K_PIPE_OPTION option, int size, int count, uint32_t *time)
+int pipeput(kpipe_t pipe, K_PIPE_OPTION option, int size, int count, uint32_t *time,
+	    const char *name)
 {
 	int i;
+	int valid = 1;
 	unsigned int t;
 	int sizexferd_total = 0;
 	int size2xfer_total = size * count;
@@ -239,12 +255,16 @@ int pipeput(kpipe_t pipe, K_PIPE_OPTION option, int size, int count, uint32_t *t
 		if (high_timer_overflow()) {
 			PRINT_STRING("| Timer overflow. Results are invalid            ",
 						 output_file);
+			valid = 0;
 		} else {
 			PRINT_STRING("| Tick occurred. Results may be inaccurate       ",
 						 output_file);
 		}
 		PRINT_STRING("                             |\n", output_file);
 	}
+	if (valid) {
+		bench_result_add(name, t / count);
+	}
 	return 0;
 }
 
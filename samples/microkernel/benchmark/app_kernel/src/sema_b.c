@@ -42,6 +42,7 @@ void sema_test(void)
 
 	PRINT_F(output_file, FORMAT, "signal semaphore",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_SEMA_RUNS));
+	bench_result_add("sem_give", et / NR_OF_SEMA_RUNS);
 
 	task_sem_reset(SEM1);
 	task_sem_give(STARTRCV);
@@ -55,6 +56,7 @@ void sema_test(void)
 
 	PRINT_F(output_file, FORMAT, "signal to waiting high pri task",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_SEMA_RUNS));
+	bench_result_add("sem_give_to_waiter", et / NR_OF_SEMA_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_SEMA_RUNS; i++) {
@@ -66,6 +68,7 @@ void sema_test(void)
 	PRINT_F(output_file, FORMAT,
 			"signal to waiting high pri task, with timeout",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_SEMA_RUNS));
+	bench_result_add("sem_give_to_waiter_timeout", et / NR_OF_SEMA_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_SEMA_RUNS; i++) {
@@ -76,6 +79,7 @@ void sema_test(void)
 
 	PRINT_F(output_file, FORMAT, "signal to waitm (2)",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_SEMA_RUNS));
+	bench_result_add("sem_give_to_group_2", et / NR_OF_SEMA_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_SEMA_RUNS; i++) {
@@ -86,6 +90,7 @@ void sema_test(void)
 
 	PRINT_F(output_file, FORMAT, "signal to waitm (2), with timeout",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_SEMA_RUNS));
+	bench_result_add("sem_give_to_group_2_timeout", et / NR_OF_SEMA_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_SEMA_RUNS; i++) {
@@ -96,6 +101,7 @@ void sema_test(void)
 
 	PRINT_F(output_file, FORMAT, "signal to waitm (3)",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_SEMA_RUNS));
+	bench_result_add("sem_give_to_group_3", et / NR_OF_SEMA_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_SEMA_RUNS; i++) {
@@ -106,6 +112,7 @@ void sema_test(void)
 
 	PRINT_F(output_file, FORMAT, "signal to waitm (3), with timeout",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_SEMA_RUNS));
+	bench_result_add("sem_give_to_group_3_timeout", et / NR_OF_SEMA_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_SEMA_RUNS; i++) {
@@ -116,6 +123,7 @@ void sema_test(void)
 
 	PRINT_F(output_file, FORMAT, "signal to waitm (4)",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_SEMA_RUNS));
+	bench_result_add("sem_give_to_group_4", et / NR_OF_SEMA_RUNS);
 
 	et = BENCH_START();
 	for (i = 0; i < NR_OF_SEMA_RUNS; i++) {
@@ -126,6 +134,7 @@ void sema_test(void)
 
 	PRINT_F(output_file, FORMAT, "signal to waitm (4), with timeout",
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(et, NR_OF_SEMA_RUNS));
+	bench_result_add("sem_give_to_group_4_timeout", et / NR_OF_SEMA_RUNS);
 }
 
 #endif /* SEMA_BENCH */
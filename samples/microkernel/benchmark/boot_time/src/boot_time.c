@@ -23,16 +23,101 @@ Measure boot time for both nanokernel and microkernel project which includes
 - from _start to main()
 - from _start to task
 - from _start to idle (for microkernel)
+- spent in the init function of each device
+- to look a device up by name
  */
 
 #include <zephyr.h>
 #include <tc_util.h>
+#include <bench_util.h>
+#include <device.h>
 
 /* externs */
 extern uint64_t __start_tsc; /* timestamp when kernel begins executing */
 extern uint64_t __main_tsc;  /* timestamp when main() begins executing */
 extern uint64_t __idle_tsc;  /* timestamp when CPU went idle */
 
+/**
+ *
+ * @brief Print the time spent initializing each device
+ *
+ * Devices declared with SYS_INIT() have no name: they are identified by the
+ * address of their init function.
+ *
+ * @return N/A
+ */
+
+static void deviceInitTimePrint(void)
+{
+	struct device *devices;
+	int count;
+	int i;
+
+	device_list_get(&devices, &count);
+
+	TC_PRINT("Device init   : %d devices\n", count);
+
+	for (i = 0; i < count; i++) {
+		struct device *dev = &devices[i];
+
+		if (dev->config->name[0] != '\0') {
+			TC_PRINT("  %s", dev->config->name);
+		} else {
+			TC_PRINT("  init 0x%x", (uint32_t)dev->config->init);
+		}
+		TC_PRINT(": %d cycles, %d us",
+			 dev->init_cycles,
+			 dev->init_cycles / CONFIG_CPU_CLOCK_FREQ_MHZ);
+#ifdef CONFIG_DEVICE_DEFERRED_INIT
+		if (dev->deferred && dev->deferred->done) {
+			TC_PRINT(" + deferred %d cycles, %d us",
+				 dev->deferred->cycles,
+				 dev->deferred->cycles / CONFIG_CPU_CLOCK_FREQ_MHZ);
+		} else if (dev->deferred) {
+			TC_PRINT(" + deferred (pending)");
+		}
+#endif
+		TC_PRINT("\n");
+	}
+}
+
+/**
+ *
+ * @brief Print the time taken to look a device up by name
+ *
+ * The last named device is the worst case for a linear search. The lookup
+ * is done twice, so that the time of a hash table build is not counted.
+ *
+ * @return N/A
+ */
+
+static void deviceLookupTimePrint(void)
+{
+	struct device *devices;
+	uint32_t start;
+	uint32_t cycles;
+	int i;
+
+	device_list_get(&devices, &i);
+
+	while (--i >= 0 && devices[i].config->name[0] == '\0') {
+		/* skip the unnamed devices */
+	}
+	if (i < 0) {
+		return;
+	}
+
+	device_get_binding(devices[i].config->name);
+
+	start = (uint32_t)_NanoTscRead();
+	device_get_binding(devices[i].config->name);
+	cycles = (uint32_t)_NanoTscRead() - start;
+
+	TC_PRINT("Device lookup : %d cycles, %d us\n",
+		 cycles, cycles / CONFIG_CPU_CLOCK_FREQ_MHZ);
+	bench_report_value("boot_device_lookup", cycles);
+}
+
 void bootTimeTask(void)
 {
 	uint64_t task_tsc;  /* timestamp at beginning of first task  */
@@ -88,6 +173,14 @@ void bootTimeTask(void)
 			 (uint32_t)  (idle_us  & 0xFFFFFFFFULL));
 
 #endif
+	bench_report_value("boot_start", (uint32_t)__start_tsc);
+	bench_report_value("boot_start_to_main", (uint32_t)s_main_tsc);
+	bench_report_value("boot_start_to_task", (uint32_t)s_task_tsc);
+#ifndef  CONFIG_NANOKERNEL
+	bench_report_value("boot_start_to_idle", (uint32_t)s_idle_tsc);
+#endif
+	deviceInitTimePrint();
+	deviceLookupTimePrint();
 
 	TC_PRINT("Boot Time Measurement finished\n");
 
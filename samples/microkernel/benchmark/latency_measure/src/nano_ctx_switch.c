@@ -30,6 +30,7 @@
 #include "utils.h"
 
 #include <arch/cpu.h>
+#include <bench_util.h>
 
 /* number of context switches */
 #define NCTXSWITCH   10000
@@ -119,6 +120,8 @@ int nanoCtxSwitch(void)
 		PRINT_FORMAT(" Average context switch time is %lu tcs = %lu nsec",
 					 timestamp / ctxSwitchCounter,
 					 SYS_CLOCK_HW_CYCLES_TO_NS_AVG(timestamp, ctxSwitchCounter));
+		bench_report_value("nano_ctx_switch",
+				   timestamp / ctxSwitchCounter);
 	}
 	return 0;
 }
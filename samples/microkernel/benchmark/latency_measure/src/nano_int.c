@@ -27,6 +27,7 @@
 
 #include <arch/cpu.h>
 #include <irq_offload.h>
+#include <bench_util.h>
 
 #ifndef STACKSIZE
 #define STACKSIZE 2000
@@ -37,6 +38,11 @@ static char __stack fiberStack[STACKSIZE];
 
 static uint32_t timestamp;
 
+/* number of interrupts the latency statistics are computed from */
+#define NSAMPLES 100
+
+BENCH_DEFINE(latencyBench, NULL, NSAMPLES);
+
 /**
  *
  * @brief Test ISR used to measure best case interrupt latency
@@ -52,6 +58,23 @@ static void latencyTestIsr(void *unused)
 	timestamp = TIME_STAMP_DELTA_GET(timestamp);
 }
 
+#ifdef CONFIG_X86
+/**
+ *
+ * @brief Direct ISR used to measure best case interrupt latency
+ *
+ * The interrupt handler gets the second timestamp.
+ *
+ * @return 0, no rescheduling needed
+ */
+static int latencyTestDirectIsr(void)
+{
+	timestamp = TIME_STAMP_DELTA_GET(timestamp);
+
+	return 0;
+}
+#endif
+
 /**
  *
  * @brief Interrupt preparation fiber
@@ -67,6 +90,64 @@ static void fiberInt(void)
 	irq_offload(latencyTestIsr, NULL);
 }
 
+#ifdef CONFIG_X86
+/**
+ *
+ * @brief Direct interrupt preparation fiber
+ *
+ * Fiber gets the first timestamp and invokes the software interrupt connected
+ * to the direct ISR.
+ *
+ * @return N/A
+ */
+static void fiberDirectInt(void)
+{
+	timestamp = TIME_STAMP_DELTA_GET(0);
+	__asm__ volatile("int %[vector]" : :
+			 [vector] "i" (NANO_INT_DIRECT_VECTOR));
+}
+#endif
+
+/**
+ *
+ * @brief Interrupt latency statistics fiber
+ *
+ * Fiber invokes the software interrupt as many times as the latency
+ * benchmark needs samples, using the given interrupt preparation routine.
+ *
+ * @return N/A
+ */
+static void fiberIntBench(int genInt, int unused)
+{
+	ARG_UNUSED(unused);
+
+	while (!bench_done(&latencyBench)) {
+		((void (*)(void))genInt)();
+		bench_sample_add(&latencyBench, timestamp);
+	}
+}
+
+/**
+ *
+ * @brief Compute and print interrupt latency statistics
+ *
+ * @return N/A
+ */
+static void intLatencyBench(const char *name, void (*genInt)(void))
+{
+	struct bench_stats stats;
+
+	latencyBench.name = name;
+	bench_reset(&latencyBench, BENCH_WARMUP_ITERATIONS);
+
+	TICK_SYNCH();
+	task_fiber_start(&fiberStack[0], STACKSIZE, fiberIntBench,
+			 (int)genInt, 0, 6, 0);
+	bench_report(&latencyBench, &stats);
+	PRINT_FORMAT(" over %d interrupts: median %lu tcs, p99 %lu tcs",
+		     NSAMPLES, stats.median, stats.p99);
+}
+
 /**
  *
  * @brief The test main function
@@ -81,5 +162,18 @@ int nanoIntLatency(void)
 					 (nano_fiber_entry_t) fiberInt, 0, 0, 6, 0);
 	PRINT_FORMAT(" switching time is %lu tcs = %lu nsec",
 				 timestamp, SYS_CLOCK_HW_CYCLES_TO_NS(timestamp));
+	intLatencyBench("nano_int_latency", fiberInt);
+
+#ifdef CONFIG_X86
+	NANO_CPU_INT_CONNECT_DIRECT(NANO_INT_DIRECT_VECTOR,
+				    latencyTestDirectIsr);
+
+	TICK_SYNCH();
+	task_fiber_start(&fiberStack[0], STACKSIZE,
+					 (nano_fiber_entry_t) fiberDirectInt, 0, 0, 6, 0);
+	PRINT_FORMAT(" direct ISR: switching time is %lu tcs = %lu nsec",
+				 timestamp, SYS_CLOCK_HW_CYCLES_TO_NS(timestamp));
+	intLatencyBench("nano_int_direct_latency", fiberDirectInt);
+#endif
 	return 0;
 }
@@ -29,12 +29,22 @@
 #include "utils.h"
 
 #include <arch/cpu.h>
+#include <bench_util.h>
+
+/* number of batches of interrupt lock/unlock cycles */
+#define NBATCHES 100
+
+/* number of interrupt lock/unlock cycles per batch */
+#define BATCH_SIZE 1000
 
 /* total number of interrupt lock/unlock cycles */
-#define NTESTS 100000
+#define NTESTS (NBATCHES * BATCH_SIZE)
 
 static uint32_t timestamp = 0;
 
+/* average time of a lock/unlock cycle in each batch */
+BENCH_DEFINE(lockUnlockBench, "nano_int_lock_unlock", NBATCHES);
+
 /**
  *
  * @brief The test main function
@@ -43,21 +53,31 @@ static uint32_t timestamp = 0;
  */
 int nanoIntLockUnlock(void)
 {
+	struct bench_stats stats;
+	uint32_t total = 0;
+	uint32_t batch;
 	int i;
 	unsigned int mask;
 
 	PRINT_FORMAT(" 5- Measure average time to lock then unlock interrupts");
+	bench_reset(&lockUnlockBench, 0);
 	bench_test_start();
-	timestamp = TIME_STAMP_DELTA_GET(0);
-	for (i = 0; i < NTESTS; i++) {
-		mask = irq_lock();
-		irq_unlock(mask);
+	while (!bench_done(&lockUnlockBench)) {
+		batch = TIME_STAMP_DELTA_GET(0);
+		for (i = 0; i < BATCH_SIZE; i++) {
+			mask = irq_lock();
+			irq_unlock(mask);
+		}
+		batch = TIME_STAMP_DELTA_GET(batch);
+		total += batch;
+		bench_sample_add(&lockUnlockBench, batch / BATCH_SIZE);
 	}
-	timestamp = TIME_STAMP_DELTA_GET(timestamp);
+	timestamp = total;
 	if (bench_test_end() == 0) {
 		PRINT_FORMAT(" Average time for lock then unlock "
 			"is %lu tcs = %lu nsec",
 			timestamp / NTESTS, SYS_CLOCK_HW_CYCLES_TO_NS_AVG(timestamp, NTESTS));
+		bench_report(&lockUnlockBench, &stats);
 	} else {
 		errorCount++;
 		PRINT_OVERFLOW_ERROR();
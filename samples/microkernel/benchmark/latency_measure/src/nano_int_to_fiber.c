@@ -26,6 +26,7 @@
 #include "utils.h"
 
 #include <arch/cpu.h>
+#include <bench_util.h>
 #include <irq_offload.h>
 
 #ifndef STACKSIZE
@@ -55,6 +56,25 @@ static void latencyTestIsr(void *unused)
 	timestamp = TIME_STAMP_DELTA_GET(0);
 }
 
+#ifdef CONFIG_X86
+/**
+ *
+ * @brief Direct ISR used to measure best case interrupt latency
+ *
+ * The interrupt handler gets the first timestamp, the interrupted fiber gets
+ * the second one once the handler returns.
+ *
+ * @return 0, no rescheduling needed
+ */
+static int latencyTestDirectIsr(void)
+{
+	flagVar = 1;
+	timestamp = TIME_STAMP_DELTA_GET(0);
+
+	return 0;
+}
+#endif
+
 /**
  *
  * @brief Interrupt preparation fiber
@@ -75,6 +95,28 @@ static void fiberInt(void)
 	}
 }
 
+#ifdef CONFIG_X86
+/**
+ *
+ * @brief Direct interrupt preparation fiber
+ *
+ * Fiber invokes the software interrupt connected to the direct ISR.
+ *
+ * @return N/A
+ */
+static void fiberDirectInt(void)
+{
+	flagVar = 0;
+	__asm__ volatile("int %[vector]" : :
+			 [vector] "i" (NANO_INT_TO_FIBER_DIRECT_VECTOR));
+	if (flagVar != 1) {
+		PRINT_FORMAT(" Flag variable has not changed. FAILED");
+	} else {
+		timestamp = TIME_STAMP_DELTA_GET(timestamp);
+	}
+}
+#endif
+
 /**
  *
  * @brief The test main function
@@ -91,6 +133,21 @@ int nanoIntToFiber(void)
 	if (flagVar == 1) {
 		PRINT_FORMAT(" switching time is %lu tcs = %lu nsec",
 					 timestamp, SYS_CLOCK_HW_CYCLES_TO_NS(timestamp));
+		bench_report_value("nano_int_to_fiber", timestamp);
 	}
+
+#ifdef CONFIG_X86
+	NANO_CPU_INT_CONNECT_DIRECT(NANO_INT_TO_FIBER_DIRECT_VECTOR,
+				    latencyTestDirectIsr);
+
+	TICK_SYNCH();
+	task_fiber_start(&fiberStack[0], STACKSIZE,
+					 (nano_fiber_entry_t) fiberDirectInt, 0, 0, 6, 0);
+	if (flagVar == 1) {
+		PRINT_FORMAT(" direct ISR: switching time is %lu tcs = %lu nsec",
+					 timestamp, SYS_CLOCK_HW_CYCLES_TO_NS(timestamp));
+		bench_report_value("nano_int_direct_to_fiber", timestamp);
+	}
+#endif
 	return 0;
 }
@@ -35,6 +35,7 @@
 #include "utils.h"
 
 #include <arch/cpu.h>
+#include <bench_util.h>
 #include <irq_offload.h>
 
 #ifndef STACKSIZE
@@ -116,5 +117,6 @@ int nanoIntToFiberSem(void)
 
 	PRINT_FORMAT(" switching time is %lu tcs = %lu nsec",
 				 timestamp, SYS_CLOCK_HW_CYCLES_TO_NS(timestamp));
+	bench_report_value("nano_int_to_fiber_sem", timestamp);
 	return 0;
 }
@@ -25,6 +25,12 @@
 #define INT_IMM8_OFFSET   1
 #define IRQ_PRIORITY      3
 
+#ifdef CONFIG_X86
+/* software interrupt vectors of the direct ISRs, next to irq_offload()'s */
+#define NANO_INT_DIRECT_VECTOR           (CONFIG_IRQ_OFFLOAD_VECTOR + 1)
+#define NANO_INT_TO_FIBER_DIRECT_VECTOR  (CONFIG_IRQ_OFFLOAD_VECTOR + 2)
+#endif
+
 #ifdef CONFIG_PRINTK
 #include <misc/printk.h>
 #include <stdio.h>
@@ -15,10 +15,13 @@
  */
 
 #include <zephyr.h>
+#include <string.h>
 #include <misc/printk.h>
 #include <misc/shell.h>
 #define DEVICE_NAME "test shell"
 
+#define TOP_MAX_THREADS 16
+
 static void shell_cmd_ping(int argc, char *argv[])
 {
 	printk("pong\n");
@@ -34,11 +37,80 @@ static void shell_cmd_highticks(int argc, char *argv[])
 	printk("highticks: %d\n", sys_cycle_get_32());
 }
 
+#ifdef CONFIG_THREAD_CPU_ACCOUNTING
+static struct sys_cpu_usage top_prev;
+static struct sys_thread_cpu_usage top_prev_threads[TOP_MAX_THREADS];
+static int top_prev_num;
+
+/* ratio in 1/1000th, keeping the division on 32 bits */
+static unsigned int per_mille(uint64_t part, uint64_t total)
+{
+	while (total >= (1 << 22)) {
+		part >>= 1;
+		total >>= 1;
+	}
+
+	return total ? (uint32_t)part * 1000 / (uint32_t)total : 0;
+}
+
+static uint64_t top_prev_cycles(nano_thread_id_t thread)
+{
+	int i;
+
+	for (i = 0; i < top_prev_num; i++) {
+		if (top_prev_threads[i].thread == thread) {
+			return top_prev_threads[i].cycles;
+		}
+	}
+
+	return 0;
+}
+
+/* CPU usage since the previous invocation, or since boot the first time */
+static void shell_cmd_top(int argc, char *argv[])
+{
+	struct sys_thread_cpu_usage threads[TOP_MAX_THREADS];
+	struct sys_cpu_usage usage;
+	uint64_t total;
+	unsigned int pm;
+	int num, i;
+
+	num = sys_thread_cpu_usage_get(&usage, threads, TOP_MAX_THREADS);
+	if (num > TOP_MAX_THREADS) {
+		num = TOP_MAX_THREADS;
+	}
+
+	total = usage.total - top_prev.total;
+
+	printk("  THREAD      TYPE   CPU\n");
+	for (i = 0; i < num; i++) {
+		pm = per_mille(threads[i].cycles -
+			       top_prev_cycles(threads[i].thread), total);
+		printk("  %p  %s  %3u.%u%%%s\n", threads[i].thread,
+		       threads[i].type == NANO_CTX_TASK ? "task " : "fiber",
+		       pm / 10, pm % 10,
+		       threads[i].thread == sys_thread_self_get() ?
+		       " (shell)" : "");
+	}
+
+	pm = per_mille(usage.isr - top_prev.isr, total);
+	printk("  isr: %u.%u%%", pm / 10, pm % 10);
+	pm = per_mille(usage.idle - top_prev.idle, total);
+	printk("  idle: %u.%u%%\n", pm / 10, pm % 10);
+
+	top_prev = usage;
+	memcpy(top_prev_threads, threads, num * sizeof(threads[0]));
+	top_prev_num = num;
+}
+#endif
 
 struct shell_cmd commands[] = {
 	{ "ping", shell_cmd_ping },
 	{ "ticks", shell_cmd_ticks },
 	{ "highticks", shell_cmd_highticks },
+#ifdef CONFIG_THREAD_CPU_ACCOUNTING
+	{ "top", shell_cmd_top },
+#endif
 	{ NULL, NULL }
 };
 
@@ -170,7 +170,7 @@ int lifo_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i, t);
+	return_value += check_result("lifo_1", i, t);
 
 	/* fibers have done their job, they can stop now safely: */
 	for (j = 0; j < 2; j++) {
@@ -200,7 +200,7 @@ int lifo_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i, t);
+	return_value += check_result("lifo_2", i, t);
 
 	/* fibers have done their job, they can stop now safely: */
 	for (j = 0; j < 2; j++) {
@@ -244,7 +244,7 @@ int lifo_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i * 2, t);
+	return_value += check_result("lifo_3", i * 2, t);
 
 	/* fibers have done their job, they can stop now safely: */
 	for (j = 0; j < 2; j++) {
@@ -0,0 +1,298 @@
+/* mem_slab.c */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "syskernel.h"
+
+/*
+ * The memory slab is compared with the pattern it replaces: a FIFO holding
+ * the free buffers of a pool.
+ */
+
+#define NUM_BLOCKS 2
+#define BLOCK_SIZE 32
+
+NANO_MEM_SLAB_DEFINE(nanoSlab, BLOCK_SIZE, NUM_BLOCKS);
+
+static struct nano_fifo nanoPool;
+static char __aligned(4) poolBuffer[NUM_BLOCKS][BLOCK_SIZE];
+
+static struct nano_fifo nanoFifo_data; /* from the producer to the consumer */
+static struct nano_fifo nanoFifo_sync; /* for synchronization */
+
+
+/**
+ *
+ * @brief Initialize the FIFO-based pool for the test
+ *
+ * @param num_blocks   Number of free buffers to put in the pool.
+ *
+ * @return N/A
+ */
+static void pool_test_init(int num_blocks)
+{
+	int i;
+
+	nano_fifo_init(&nanoPool);
+	for (i = 0; i < num_blocks; i++) {
+		nano_task_fifo_put(&nanoPool, poolBuffer[i]);
+	}
+
+	nano_fifo_init(&nanoFifo_data);
+}
+
+
+/**
+ *
+ * @brief Memory slab test fiber, allocating blocks and sending them out
+ *
+ * @param par1   Ignored parameter.
+ * @param par2   Number of test loops.
+ *
+ * @return N/A
+ */
+void mem_slab_fiber1(int par1, int par2)
+{
+	int i;
+	int *block;
+
+	ARG_UNUSED(par1);
+
+	for (i = 0; i < par2; i++) {
+		block = nano_fiber_mem_slab_alloc(&nanoSlab, TICKS_UNLIMITED);
+		block[1] = i;
+		nano_fiber_fifo_put(&nanoFifo_data, block);
+	}
+	/* wait till it is safe to end: */
+	nano_fiber_fifo_get(&nanoFifo_sync, TICKS_UNLIMITED);
+}
+
+
+/**
+ *
+ * @brief Memory slab test fiber, receiving blocks and freeing them
+ *
+ * @param par1   Address of the counter.
+ * @param par2   Number of test loops.
+ *
+ * @return N/A
+ */
+void mem_slab_fiber2(int par1, int par2)
+{
+	int i;
+	int *block;
+	int *pcounter = (int *) par1;
+
+	for (i = 0; i < par2; i++) {
+		block = nano_fiber_fifo_get(&nanoFifo_data, TICKS_UNLIMITED);
+		if (block[1] != i) {
+			break;
+		}
+		nano_fiber_mem_slab_free(&nanoSlab, block);
+		(*pcounter)++;
+	}
+	/* wait till it is safe to end: */
+	nano_fiber_fifo_get(&nanoFifo_sync, TICKS_UNLIMITED);
+}
+
+
+/**
+ *
+ * @brief FIFO-based pool test fiber, allocating buffers and sending them out
+ *
+ * @param par1   Ignored parameter.
+ * @param par2   Number of test loops.
+ *
+ * @return N/A
+ */
+void pool_fiber1(int par1, int par2)
+{
+	int i;
+	int *block;
+
+	ARG_UNUSED(par1);
+
+	for (i = 0; i < par2; i++) {
+		block = nano_fiber_fifo_get(&nanoPool, TICKS_UNLIMITED);
+		block[1] = i;
+		nano_fiber_fifo_put(&nanoFifo_data, block);
+	}
+	/* wait till it is safe to end: */
+	nano_fiber_fifo_get(&nanoFifo_sync, TICKS_UNLIMITED);
+}
+
+
+/**
+ *
+ * @brief FIFO-based pool test fiber, receiving buffers and freeing them
+ *
+ * @param par1   Address of the counter.
+ * @param par2   Number of test loops.
+ *
+ * @return N/A
+ */
+void pool_fiber2(int par1, int par2)
+{
+	int i;
+	int *block;
+	int *pcounter = (int *) par1;
+
+	for (i = 0; i < par2; i++) {
+		block = nano_fiber_fifo_get(&nanoFifo_data, TICKS_UNLIMITED);
+		if (block[1] != i) {
+			break;
+		}
+		nano_fiber_fifo_put(&nanoPool, block);
+		(*pcounter)++;
+	}
+	/* wait till it is safe to end: */
+	nano_fiber_fifo_get(&nanoFifo_sync, TICKS_UNLIMITED);
+}
+
+
+/**
+ *
+ * @brief The main test entry
+ *
+ * @return 1 if success and 0 on failure
+ *
+ */
+int mem_slab_test(void)
+{
+	uint32_t t;
+	int i = 0;
+	int return_value = 0;
+	int element[2];
+	int j;
+
+	nano_fifo_init(&nanoFifo_sync);
+
+	/* test alloc & free task functions, blocks always available */
+	fprintf(output_file, sz_test_case_fmt,
+			"Memory slab #1");
+	fprintf(output_file, sz_description,
+			"\n\tNANO_MEM_SLAB_DEFINE"
+			"\n\tnano_task_mem_slab_alloc(TICKS_NONE)"
+			"\n\tnano_task_mem_slab_free");
+	printf(sz_test_start_fmt);
+
+	t = BENCH_START();
+
+	for (i = 0; i < NUMBER_OF_LOOPS; i++) {
+		void *block1 = nano_task_mem_slab_alloc(&nanoSlab, TICKS_NONE);
+		void *block2 = nano_task_mem_slab_alloc(&nanoSlab, TICKS_NONE);
+
+		if (!block1 || !block2) {
+			break;
+		}
+		nano_task_mem_slab_free(&nanoSlab, block2);
+		nano_task_mem_slab_free(&nanoSlab, block1);
+	}
+
+	t = TIME_STAMP_DELTA_GET(t);
+
+	return_value += check_result("mem_slab_1", i, t);
+
+	/* same with the FIFO-based pool */
+	fprintf(output_file, sz_test_case_fmt,
+			"Memory slab #2 (FIFO-based pool)");
+	fprintf(output_file, sz_description,
+			"\n\tnano_task_fifo_get(TICKS_NONE)"
+			"\n\tnano_task_fifo_put");
+	printf(sz_test_start_fmt);
+
+	pool_test_init(NUM_BLOCKS);
+
+	t = BENCH_START();
+
+	for (i = 0; i < NUMBER_OF_LOOPS; i++) {
+		void *block1 = nano_task_fifo_get(&nanoPool, TICKS_NONE);
+		void *block2 = nano_task_fifo_get(&nanoPool, TICKS_NONE);
+
+		if (!block1 || !block2) {
+			break;
+		}
+		nano_task_fifo_put(&nanoPool, block2);
+		nano_task_fifo_put(&nanoPool, block1);
+	}
+
+	t = TIME_STAMP_DELTA_GET(t);
+
+	return_value += check_result("mem_slab_2", i, t);
+
+	/* test alloc wait & free fiber functions, one block handed over */
+	fprintf(output_file, sz_test_case_fmt,
+			"Memory slab #3");
+	fprintf(output_file, sz_description,
+			"\n\tnano_fiber_mem_slab_alloc(TICKS_UNLIMITED)"
+			"\n\tnano_fiber_mem_slab_free"
+			"\n\tnano_fiber_fifo_get(TICKS_UNLIMITED)"
+			"\n\tnano_fiber_fifo_put");
+	printf(sz_test_start_fmt);
+
+	/* leave a single block so that the producer waits for it */
+	nano_fifo_init(&nanoFifo_data);
+	element[0] = (int)nano_task_mem_slab_alloc(&nanoSlab, TICKS_NONE);
+
+	t = BENCH_START();
+
+	i = 0;
+	task_fiber_start(fiber_stack1, STACK_SIZE, mem_slab_fiber1, 0,
+					 NUMBER_OF_LOOPS, 3, 0);
+	task_fiber_start(fiber_stack2, STACK_SIZE, mem_slab_fiber2, (int) &i,
+					 NUMBER_OF_LOOPS, 3, 0);
+
+	t = TIME_STAMP_DELTA_GET(t);
+
+	return_value += check_result("mem_slab_3", i, t);
+
+	nano_task_mem_slab_free(&nanoSlab, (void *)element[0]);
+
+	/* fibers have done their job, they can stop now safely: */
+	for (j = 0; j < 2; j++) {
+		nano_task_fifo_put(&nanoFifo_sync, (void *) element);
+	}
+
+	/* same with the FIFO-based pool */
+	fprintf(output_file, sz_test_case_fmt,
+			"Memory slab #4 (FIFO-based pool)");
+	fprintf(output_file, sz_description,
+			"\n\tnano_fiber_fifo_get(TICKS_UNLIMITED)"
+			"\n\tnano_fiber_fifo_put");
+	printf(sz_test_start_fmt);
+
+	pool_test_init(1);
+
+	t = BENCH_START();
+
+	i = 0;
+	task_fiber_start(fiber_stack1, STACK_SIZE, pool_fiber1, 0,
+					 NUMBER_OF_LOOPS, 3, 0);
+	task_fiber_start(fiber_stack2, STACK_SIZE, pool_fiber2, (int) &i,
+					 NUMBER_OF_LOOPS, 3, 0);
+
+	t = TIME_STAMP_DELTA_GET(t);
+
+	return_value += check_result("mem_slab_4", i, t);
+
+	/* fibers have done their job, they can stop now safely: */
+	for (j = 0; j < 2; j++) {
+		nano_task_fifo_put(&nanoFifo_sync, (void *) element);
+	}
+
+	return return_value;
+}
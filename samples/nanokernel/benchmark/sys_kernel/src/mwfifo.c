@@ -165,7 +165,7 @@ int fifo_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i, t);
+	return_value += check_result("fifo_1", i, t);
 
 	/* fibers have done their job, they can stop now safely: */
 	for (j = 0; j < 2; j++) {
@@ -195,7 +195,7 @@ int fifo_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i, t);
+	return_value += check_result("fifo_2", i, t);
 
 	/* fibers have done their job, they can stop now safely: */
 	for (j = 0; j < 2; j++) {
@@ -240,7 +240,7 @@ int fifo_test(void)
 	}
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i * 2, t);
+	return_value += check_result("fifo_3", i * 2, t);
 
 	/* fibers have done their job, they can stop now safely: */
 	for (j = 0; j < 2; j++) {
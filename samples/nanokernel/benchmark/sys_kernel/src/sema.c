@@ -132,7 +132,7 @@ int sema_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i, t);
+	return_value += check_result("sema_1", i, t);
 
 	fprintf(output_file, sz_test_case_fmt,
 			"Semaphore #2");
@@ -155,7 +155,7 @@ int sema_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i, t);
+	return_value += check_result("sema_2", i, t);
 
 	fprintf(output_file, sz_test_case_fmt,
 			"Semaphore #3");
@@ -180,7 +180,7 @@ int sema_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i, t);
+	return_value += check_result("sema_3", i, t);
 
 	return return_value;
 }
@@ -164,7 +164,7 @@ int stack_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i, t);
+	return_value += check_result("stack_1", i, t);
 
 	/* test get/yield & put fiber functions */
 	fprintf(output_file, sz_test_case_fmt,
@@ -189,7 +189,7 @@ int stack_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i, t);
+	return_value += check_result("stack_2", i, t);
 
 	/* test get wait & put fiber/task functions */
 	fprintf(output_file, sz_test_case_fmt,
@@ -227,7 +227,7 @@ int stack_test(void)
 
 	t = TIME_STAMP_DELTA_GET(t);
 
-	return_value += check_result(i * 2, t);
+	return_value += check_result("stack_3", i * 2, t);
 
 	return return_value;
 }
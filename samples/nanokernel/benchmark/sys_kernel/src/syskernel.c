@@ -21,6 +21,7 @@
 #include "syskernel.h"
 
 #include <string.h>
+#include <bench_util.h>
 
 /* #define FLOAT */
 
@@ -78,12 +79,15 @@ void begin_test(void)
  *
  * @brief Checks number of tests and calculate average time
  *
+ * The average time is also reported on a BENCH line, in cycles.
+ *
  * @return 1 if success and 0 on failure
  *
+ * @param name   Name the average time is reported under.
  * @param i   Number of tests.
  * @param t   Time in ticks for the whole test.
  */
-int check_result(int i, uint32_t t)
+int check_result(const char *name, int i, uint32_t t)
 {
 	/*
 	 * bench_test_end checks tCheck static variable.
@@ -110,6 +114,9 @@ int check_result(int i, uint32_t t)
 			SYS_CLOCK_HW_CYCLES_TO_NS_AVG(t, NUMBER_OF_LOOPS));
 
 	fprintf(output_file, sz_case_end_fmt);
+	/* the free-form output does not end its lines */
+	fprintf(output_file, "\n");
+	bench_report_value(name, t / NUMBER_OF_LOOPS);
 	return 1;
 }
 
@@ -187,10 +194,14 @@ void main(void)
 		test_result += lifo_test();
 		test_result += fifo_test();
 		test_result += stack_test();
+		test_result += mem_slab_test();
 
 		if (test_result) {
-			/* sema, lifo, fifo, stack account for twelve tests in total */
-			if (test_result == 12) {
+			/*
+			 * sema, lifo, fifo, stack and memory slab account for
+			 * sixteen tests in total
+			 */
+			if (test_result == 16) {
 				fprintf(output_file, sz_module_result_fmt, sz_success);
 			} else {
 				fprintf(output_file, sz_module_result_fmt, sz_partial);
@@ -51,12 +51,13 @@ extern const char sz_case_details_fmt[];
 extern const char sz_case_end_fmt[];
 extern const char sz_case_timing_fmt[];
 
-int check_result(int i, uint32_t ticks);
+int check_result(const char *name, int i, uint32_t ticks);
 
 int sema_test(void);
 int lifo_test(void);
 int fifo_test(void);
 int stack_test(void);
+int mem_slab_test(void);
 void begin_test(void);
 
 static inline uint32_t BENCH_START(void)
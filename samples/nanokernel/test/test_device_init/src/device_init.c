@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @file
+ * @brief Test deferred device initialization
+ *
+ * This module tests the following device routines:
+ *
+ * DEVICE_INIT_DEFERRED, device_wait_ready
+ * DEVICE_BINDING, device_get_binding
+ *
+ * The deferred part of the initialization of a device must run after all the
+ * devices of its level have been initialized, must not hold the boot
+ * sequence while it waits, and must wake up all the waiters for the device
+ * when it completes. The deferred part of a device whose init function
+ * fails must not run.
+ */
+
+#include <tc_util.h>
+#include <device.h>
+#include <init.h>
+#include <misc/util.h>
+
+/* the deferred part of the slow device takes 100ms */
+#define SLOW_INIT_WAIT          (sys_clock_ticks_per_sec / 10)
+
+#define FIBER_STACK_SIZE        1024
+#define FIBER_PRIORITY          10
+
+/* sequence numbers of the initialization steps */
+static int init_seq;
+static int slow_init_seq;
+static int slow_deferred_seq;
+static int last_in_level_seq;
+static int broken_deferred_seq;
+
+static int fiber_result = TC_FAIL;
+static char __stack fiber_stack[FIBER_STACK_SIZE];
+
+static int slow_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	slow_init_seq = ++init_seq;
+
+	return DEV_OK;
+}
+
+static int slow_deferred_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	fiber_sleep(SLOW_INIT_WAIT);
+	slow_deferred_seq = ++init_seq;
+
+	return DEV_OK;
+}
+
+DEVICE_INIT_DEFERRED(slow_dev, "SLOW", slow_init, slow_deferred_init,
+		     NULL, NULL, NANOKERNEL, 0);
+
+static int last_in_level_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	last_in_level_seq = ++init_seq;
+
+	return DEV_OK;
+}
+
+SYS_INIT(last_in_level_init, NANOKERNEL, 99);
+
+static int broken_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return DEV_NO_ACCESS;
+}
+
+static int broken_deferred_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	broken_deferred_seq = ++init_seq;
+
+	return DEV_OK;
+}
+
+DEVICE_INIT_DEFERRED(broken_dev, "BROKEN", broken_init, broken_deferred_init,
+		     NULL, NULL, APPLICATION, 0);
+
+static void waiter_fiber(int arg1, int arg2)
+{
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	if (device_wait_ready(DEVICE_GET(slow_dev), TICKS_UNLIMITED) == DEV_OK) {
+		fiber_result = TC_PASS;
+	}
+}
+
+static int test_deferred(void)
+{
+	struct device *slow = device_get_binding("SLOW");
+	int rv;
+
+	TC_PRINT("Starting deferred init test\n");
+
+	if (slow != DEVICE_BINDING(slow_dev)) {
+		TC_ERROR("*** could not bind to the slow device\n");
+		return TC_FAIL;
+	}
+
+	TC_PRINT(" - Checking the boot was not held\n");
+	rv = device_wait_ready(slow, TICKS_NONE);
+	if (rv != DEV_NOT_CONFIG || slow_deferred_seq != 0) {
+		TC_ERROR("*** deferred init already done (%d)\n", rv);
+		return TC_FAIL;
+	}
+
+	TC_PRINT(" - Waiting from a fiber and the task\n");
+	task_fiber_start(fiber_stack, FIBER_STACK_SIZE, waiter_fiber, 0, 0,
+			 FIBER_PRIORITY, 0);
+
+	rv = device_wait_ready(slow, TICKS_UNLIMITED);
+	if (rv != DEV_OK) {
+		TC_ERROR("*** device_wait_ready() returned %d\n", rv);
+		return TC_FAIL;
+	}
+
+	/* let the waiter fiber run */
+	task_sleep(1);
+	if (fiber_result != TC_PASS) {
+		TC_ERROR("*** the waiter fiber was not woken up\n");
+		return TC_FAIL;
+	}
+
+	TC_PRINT(" - Checking results\n");
+	if (!(slow_init_seq < last_in_level_seq &&
+	      last_in_level_seq < slow_deferred_seq)) {
+		TC_ERROR("*** init order: %d %d %d\n", slow_init_seq,
+			 last_in_level_seq, slow_deferred_seq);
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static int test_failed_init(void)
+{
+	int rv;
+
+	TC_PRINT("Starting failed init test\n");
+
+	rv = device_wait_ready(DEVICE_GET(broken_dev), TICKS_UNLIMITED);
+	if (rv != DEV_NO_ACCESS) {
+		TC_ERROR("*** device_wait_ready() returned %d\n", rv);
+		return TC_FAIL;
+	}
+
+	if (broken_deferred_seq != 0) {
+		TC_ERROR("*** deferred init ran after a failed init\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+void main(void)
+{
+	int rv;
+
+	TC_START("Test Deferred Device Initialization");
+
+	rv = test_deferred();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_failed_init();
+
+done:
+	TC_END_RESULT(rv);
+	TC_END_REPORT(rv);
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @file
+ * @brief Test nanokernel memory slab APIs
+ *
+ * This module tests the following memory slab routines:
+ *
+ * NANO_MEM_SLAB_DEFINE, nano_mem_slab_init
+ * nano_isr_mem_slab_alloc, nano_fiber_mem_slab_alloc, nano_task_mem_slab_alloc
+ * nano_isr_mem_slab_free, nano_fiber_mem_slab_free, nano_task_mem_slab_free
+ * nano_mem_slab_num_used_get, nano_mem_slab_max_used_get
+ */
+
+#include <tc_util.h>
+#include <string.h>
+#include <arch/cpu.h>
+#include <misc/util.h>
+#include <irq_offload.h>
+
+#define FIBER_STACK_SIZE        1024
+#define FIBER_PRIORITY          5
+
+#define NUM_BLOCKS              4
+/* not a multiple of the pointer size on purpose */
+#define BLOCK_SIZE              13
+
+#define TIMEOUT                 10
+
+NANO_MEM_SLAB_DEFINE(static_slab, BLOCK_SIZE, NUM_BLOCKS);
+
+static struct nano_mem_slab slab;
+static char __aligned(4) slab_buffer[NUM_BLOCKS * 16];
+
+static void *blocks[NUM_BLOCKS];
+
+static char __stack fiber_stack[FIBER_STACK_SIZE];
+
+static void *fiber_block;
+
+static int alloc_all(struct nano_mem_slab *s)
+{
+	int i;
+
+	for (i = 0; i < NUM_BLOCKS; i++) {
+		blocks[i] = nano_task_mem_slab_alloc(s, TICKS_NONE);
+		if (!blocks[i]) {
+			TC_ERROR(" *** could not allocate block %d\n", i);
+			return TC_FAIL;
+		}
+
+		/* blocks must not overlap */
+		memset(blocks[i], i, BLOCK_SIZE);
+	}
+
+	for (i = 0; i < NUM_BLOCKS; i++) {
+		if (((char *)blocks[i])[BLOCK_SIZE - 1] != i) {
+			TC_ERROR(" *** block %d was overwritten\n", i);
+			return TC_FAIL;
+		}
+	}
+
+	if (nano_task_mem_slab_alloc(s, TICKS_NONE)) {
+		TC_ERROR(" *** allocated more blocks than available\n");
+		return TC_FAIL;
+	}
+
+	if (nano_mem_slab_num_used_get(s) != NUM_BLOCKS) {
+		TC_ERROR(" *** %u blocks used (expected %u)\n",
+			 nano_mem_slab_num_used_get(s), NUM_BLOCKS);
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void free_all(struct nano_mem_slab *s)
+{
+	int i;
+
+	for (i = 0; i < NUM_BLOCKS; i++) {
+		nano_task_mem_slab_free(s, blocks[i]);
+	}
+}
+
+static int test_task(void)
+{
+	TC_PRINT("Allocating all blocks from the task\n");
+
+	if (alloc_all(&static_slab) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	free_all(&static_slab);
+
+	/* freed blocks are reused */
+	if (alloc_all(&static_slab) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	free_all(&static_slab);
+
+	if (nano_mem_slab_num_used_get(&static_slab) != 0 ||
+	    nano_mem_slab_max_used_get(&static_slab) != NUM_BLOCKS) {
+		TC_ERROR(" *** wrong statistics: used %u, max used %u\n",
+			 nano_mem_slab_num_used_get(&static_slab),
+			 nano_mem_slab_max_used_get(&static_slab));
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void isr_alloc_free(void *arg)
+{
+	void *block = nano_isr_mem_slab_alloc(&slab, TICKS_NONE);
+
+	if (block) {
+		nano_isr_mem_slab_free(&slab, block);
+	}
+
+	*(void **)arg = block;
+}
+
+static int test_isr(void)
+{
+	void *block;
+
+	TC_PRINT("Allocating and freeing blocks from an ISR\n");
+
+	irq_offload(isr_alloc_free, &block);
+	if (!block || nano_mem_slab_num_used_get(&slab) != 0) {
+		TC_ERROR(" *** ISR could not allocate and free a block\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void fiber_alloc(int timeout, int arg2)
+{
+	ARG_UNUSED(arg2);
+
+	fiber_block = nano_fiber_mem_slab_alloc(&slab, timeout);
+}
+
+static int test_fiber_wait(void)
+{
+	TC_PRINT("Fiber waiting for a block\n");
+
+	if (alloc_all(&slab) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	fiber_block = NULL;
+	task_fiber_start(fiber_stack, sizeof(fiber_stack), fiber_alloc,
+			 TICKS_UNLIMITED, 0, FIBER_PRIORITY, 0);
+
+	/* the block goes straight to the waiting fiber */
+	nano_task_mem_slab_free(&slab, blocks[1]);
+	if (fiber_block != blocks[1] ||
+	    nano_mem_slab_num_used_get(&slab) != NUM_BLOCKS) {
+		TC_ERROR(" *** fiber did not get the freed block\n");
+		return TC_FAIL;
+	}
+
+	TC_PRINT("Fiber timing out waiting for a block\n");
+
+	fiber_block = blocks[1];
+	task_fiber_start(fiber_stack, sizeof(fiber_stack), fiber_alloc,
+			 TIMEOUT, 0, FIBER_PRIORITY, 0);
+
+	task_sleep(TIMEOUT * 2);
+	if (fiber_block) {
+		TC_ERROR(" *** fiber got a block from an empty slab\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void fiber_free_later(int arg1, int arg2)
+{
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	fiber_sleep(TIMEOUT);
+	nano_fiber_mem_slab_free(&slab, blocks[2]);
+}
+
+static int test_task_wait(void)
+{
+	void *block;
+
+	TC_PRINT("Task waiting for a block\n");
+
+	if (nano_task_mem_slab_alloc(&slab, TIMEOUT)) {
+		TC_ERROR(" *** task got a block from an empty slab\n");
+		return TC_FAIL;
+	}
+
+	task_fiber_start(fiber_stack, sizeof(fiber_stack), fiber_free_later,
+			 0, 0, FIBER_PRIORITY, 0);
+
+	block = nano_task_mem_slab_alloc(&slab, TIMEOUT * 2);
+	if (block != blocks[2]) {
+		TC_ERROR(" *** task did not get the freed block\n");
+		return TC_FAIL;
+	}
+
+	free_all(&slab);
+
+	return TC_PASS;
+}
+
+void main(void)
+{
+	int rv;
+
+	TC_START("Test Nanokernel Memory Slabs");
+
+	nano_mem_slab_init(&slab, slab_buffer, BLOCK_SIZE, NUM_BLOCKS);
+
+	rv = test_task();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_isr();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_fiber_wait();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_task_wait();
+
+done:
+	TC_END_RESULT(rv);
+	TC_END_REPORT(rv);
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @file
+ * @brief Test nanokernel message queue APIs
+ *
+ * This module tests the following message queue routines:
+ *
+ * NANO_MSGQ_DEFINE, nano_msgq_init
+ * nano_isr_msgq_put, nano_fiber_msgq_put, nano_task_msgq_put
+ * nano_fiber_msgq_get, nano_task_msgq_get
+ * nano_msgq_num_used_get
+ */
+
+#include <tc_util.h>
+#include <string.h>
+#include <arch/cpu.h>
+#include <misc/util.h>
+#include <irq_offload.h>
+
+#define FIBER_STACK_SIZE        1024
+#define FIBER_PRIORITY          5
+
+#define MAX_MSGS                4
+
+#define TIMEOUT                 10
+
+/* not a multiple of the word size on purpose */
+struct sample {
+	uint32_t value;
+	uint8_t channel;
+	uint8_t flags;
+	uint8_t seq;
+} __packed;
+
+NANO_MSGQ_DEFINE(static_msgq, sizeof(struct sample), MAX_MSGS);
+
+static struct nano_msgq msgq;
+static char msgq_buffer[MAX_MSGS * sizeof(struct sample)];
+
+static char __stack fiber_stack[FIBER_STACK_SIZE];
+
+static struct sample fiber_msgs[MAX_MSGS];
+static int fiber_num_msgs;
+
+static void sample_set(struct sample *msg, int seq)
+{
+	msg->value = 0x1000 * seq;
+	msg->channel = seq % 3;
+	msg->flags = ~seq;
+	msg->seq = seq;
+}
+
+static int sample_check(struct sample *msg, int seq)
+{
+	struct sample expected;
+
+	sample_set(&expected, seq);
+	if (memcmp(msg, &expected, sizeof(expected))) {
+		TC_ERROR(" *** got message %d (expected %d)\n", msg->seq, seq);
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static int test_burst(struct nano_msgq *q)
+{
+	struct sample msgs[MAX_MSGS + 1];
+	int seq = 0;
+	int round;
+	int i;
+
+	TC_PRINT("Putting and getting bursts from the task\n");
+
+	/* move the ring pointers around so that the bursts wrap */
+	for (round = 0; round < MAX_MSGS; round++) {
+		for (i = 0; i < MAX_MSGS + 1; i++) {
+			sample_set(&msgs[i], seq + i);
+		}
+
+		if (nano_task_msgq_put(q, msgs, MAX_MSGS + 1) != MAX_MSGS ||
+		    nano_msgq_num_used_get(q) != MAX_MSGS) {
+			TC_ERROR(" *** put more messages than room for\n");
+			return TC_FAIL;
+		}
+
+		if (nano_task_msgq_put(q, msgs, 1) != 0) {
+			TC_ERROR(" *** put a message in a full queue\n");
+			return TC_FAIL;
+		}
+
+		/* get a single message, then the rest as a burst */
+		memset(msgs, 0, sizeof(msgs));
+		if (nano_task_msgq_get(q, msgs, 1, TICKS_NONE) != 1 ||
+		    sample_check(&msgs[0], seq) != TC_PASS) {
+			return TC_FAIL;
+		}
+
+		if (nano_task_msgq_get(q, msgs, MAX_MSGS + 1, TICKS_NONE) !=
+		    MAX_MSGS - 1) {
+			TC_ERROR(" *** did not get all the messages\n");
+			return TC_FAIL;
+		}
+
+		for (i = 0; i < MAX_MSGS - 1; i++) {
+			if (sample_check(&msgs[i], seq + 1 + i) != TC_PASS) {
+				return TC_FAIL;
+			}
+		}
+
+		/* leave one message behind to shift the ring */
+		sample_set(&msgs[0], seq + MAX_MSGS);
+		nano_task_msgq_put(q, msgs, 1);
+		if (nano_task_msgq_get(q, msgs, 1, TICKS_NONE) != 1 ||
+		    sample_check(&msgs[0], seq + MAX_MSGS) != TC_PASS) {
+			return TC_FAIL;
+		}
+
+		seq += MAX_MSGS + 1;
+	}
+
+	if (nano_task_msgq_get(q, msgs, 1, TICKS_NONE) != 0) {
+		TC_ERROR(" *** got a message from an empty queue\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void fiber_get(int timeout, int max_msgs)
+{
+	fiber_num_msgs = nano_fiber_msgq_get(&msgq, fiber_msgs, max_msgs,
+					     timeout);
+}
+
+static void isr_put(void *arg)
+{
+	struct sample msgs[2];
+
+	sample_set(&msgs[0], 100);
+	sample_set(&msgs[1], 101);
+
+	*(int *)arg = nano_isr_msgq_put(&msgq, msgs, ARRAY_SIZE(msgs));
+}
+
+static int test_isr_to_fiber(void)
+{
+	int num_put;
+
+	TC_PRINT("Fiber waiting for messages from an ISR\n");
+
+	fiber_num_msgs = -1;
+	task_fiber_start(fiber_stack, sizeof(fiber_stack), fiber_get,
+			 TICKS_UNLIMITED, MAX_MSGS, FIBER_PRIORITY, 0);
+
+	irq_offload(isr_put, &num_put);
+	if (num_put != 2) {
+		TC_ERROR(" *** ISR put %d messages\n", num_put);
+		return TC_FAIL;
+	}
+
+	/* the fiber runs when the ISR returns and gets both messages */
+	if (fiber_num_msgs != 2 ||
+	    sample_check(&fiber_msgs[0], 100) != TC_PASS ||
+	    sample_check(&fiber_msgs[1], 101) != TC_PASS) {
+		TC_ERROR(" *** fiber got %d messages\n", fiber_num_msgs);
+		return TC_FAIL;
+	}
+
+	TC_PRINT("Fiber timing out waiting for messages\n");
+
+	fiber_num_msgs = -1;
+	task_fiber_start(fiber_stack, sizeof(fiber_stack), fiber_get,
+			 TIMEOUT, MAX_MSGS, FIBER_PRIORITY, 0);
+
+	task_sleep(TIMEOUT * 2);
+	if (fiber_num_msgs != 0) {
+		TC_ERROR(" *** fiber got messages from an empty queue\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void fiber_put_later(int arg1, int arg2)
+{
+	struct sample msg;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	fiber_sleep(TIMEOUT);
+
+	sample_set(&msg, 200);
+	nano_fiber_msgq_put(&msgq, &msg, 1);
+}
+
+static int test_task_wait(void)
+{
+	struct sample msg;
+
+	TC_PRINT("Task waiting for a message\n");
+
+	if (nano_task_msgq_get(&msgq, &msg, 1, TIMEOUT) != 0) {
+		TC_ERROR(" *** task got a message from an empty queue\n");
+		return TC_FAIL;
+	}
+
+	task_fiber_start(fiber_stack, sizeof(fiber_stack), fiber_put_later,
+			 0, 0, FIBER_PRIORITY, 0);
+
+	if (nano_task_msgq_get(&msgq, &msg, 1, TIMEOUT * 2) != 1 ||
+	    sample_check(&msg, 200) != TC_PASS) {
+		TC_ERROR(" *** task did not get the message\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+void main(void)
+{
+	int rv;
+
+	TC_START("Test Nanokernel Message Queues");
+
+	nano_msgq_init(&msgq, msgq_buffer, sizeof(struct sample), MAX_MSGS);
+
+	rv = test_burst(&static_msgq);
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_burst(&msgq);
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_isr_to_fiber();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_task_wait();
+
+done:
+	TC_END_RESULT(rv);
+	TC_END_REPORT(rv);
+}
@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @file
+ * @brief Test nanokernel polling APIs
+ *
+ * This module tests the following polling routines:
+ *
+ * nano_poll_event_init
+ * nano_isr_poll, nano_fiber_poll, nano_task_poll
+ *
+ * A single fiber polls a FIFO, a LIFO, a semaphore and a timer, which are
+ * made ready from the task, an ISR and by the timer expiring. The fiber
+ * reports which objects were ready back to the task.
+ *
+ * Another fiber lets its poll time out, and has the semaphore it polls given
+ * from an ISR before it gets to run.
+ */
+
+#include <tc_util.h>
+#include <errno.h>
+#include <arch/cpu.h>
+#include <misc/util.h>
+#include <irq_offload.h>
+
+#define FIBER_STACK_SIZE        1024
+#define FIBER_PRIORITY          5
+
+#define TIMEOUT                 10
+
+enum {
+	EV_FIFO,
+	EV_LIFO,
+	EV_SEM,
+	EV_TIMER,
+	NUM_EVENTS
+};
+
+struct test_data {
+	void *link_in_fifo_or_lifo;
+	int value;
+};
+
+static char __stack fiber_stack[FIBER_STACK_SIZE];
+static char __stack fiber2_stack[FIBER_STACK_SIZE];
+static char __stack fiber3_stack[FIBER_STACK_SIZE];
+
+static struct nano_fifo fifo;
+static struct nano_lifo lifo;
+static struct nano_sem sem;
+static struct nano_timer timer;
+
+static struct nano_lifo task_lifo;
+static struct nano_sem task_sem;
+
+static struct test_data fifo_data = { NULL, 1 };
+static struct test_data lifo_data = { NULL, 2 };
+static struct test_data timer_data = { NULL, 3 };
+
+static struct nano_poll_event events[NUM_EVENTS];
+
+/* results of the polling fiber */
+static struct nano_sem reply;
+static int poll_ret;
+static int ready_mask;
+static int32_t poll_timeout;
+
+static void events_init(struct nano_poll_event *ev)
+{
+	nano_poll_event_init(&ev[EV_FIFO], NANO_POLL_TYPE_FIFO, &fifo);
+	nano_poll_event_init(&ev[EV_LIFO], NANO_POLL_TYPE_LIFO, &lifo);
+	nano_poll_event_init(&ev[EV_SEM], NANO_POLL_TYPE_SEM, &sem);
+	nano_poll_event_init(&ev[EV_TIMER], NANO_POLL_TYPE_TIMER, &timer);
+}
+
+static int get_ready_mask(struct nano_poll_event *ev)
+{
+	int mask = 0;
+	int i;
+
+	for (i = 0; i < NUM_EVENTS; i++) {
+		if (ev[i].state == NANO_POLL_STATE_READY) {
+			mask |= BIT(i);
+		}
+	}
+
+	return mask;
+}
+
+/* take whatever the ready objects hold, so the next poll starts clean */
+static void consume_ready(struct nano_poll_event *ev)
+{
+	if (ev[EV_FIFO].state == NANO_POLL_STATE_READY) {
+		nano_fifo_get(&fifo, TICKS_NONE);
+	}
+
+	if (ev[EV_LIFO].state == NANO_POLL_STATE_READY) {
+		nano_lifo_get(&lifo, TICKS_NONE);
+	}
+
+	if (ev[EV_SEM].state == NANO_POLL_STATE_READY) {
+		nano_sem_take(&sem, TICKS_NONE);
+	}
+
+	if (ev[EV_TIMER].state == NANO_POLL_STATE_READY) {
+		nano_timer_test(&timer, TICKS_NONE);
+	}
+}
+
+static void poll_fiber(int arg1, int arg2)
+{
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	while (1) {
+		poll_ret = nano_fiber_poll(events, NUM_EVENTS, poll_timeout);
+		ready_mask = get_ready_mask(events);
+		consume_ready(events);
+
+		nano_fiber_sem_give(&reply);
+	}
+}
+
+static int check_reply(int expected_ret, int expected_mask)
+{
+	if (!nano_task_sem_take(&reply, TIMEOUT * 2)) {
+		TC_ERROR(" *** polling fiber did not wake up\n");
+		return TC_FAIL;
+	}
+
+	if (poll_ret != expected_ret || ready_mask != expected_mask) {
+		TC_ERROR(" *** poll returned %d, mask 0x%x (expected %d, 0x%x)\n",
+			 poll_ret, ready_mask, expected_ret, expected_mask);
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static int test_no_wait(void)
+{
+	struct nano_poll_event ev[NUM_EVENTS];
+	int ret;
+
+	TC_PRINT("Polling without waiting from the task\n");
+
+	events_init(ev);
+
+	ret = nano_task_poll(ev, NUM_EVENTS, TICKS_NONE);
+	if (ret != 0 || get_ready_mask(ev)) {
+		TC_ERROR(" *** poll returned %d with no object ready\n", ret);
+		return TC_FAIL;
+	}
+
+	nano_task_sem_give(&sem);
+	nano_task_fifo_put(&fifo, &fifo_data);
+
+	ret = nano_task_poll(ev, NUM_EVENTS, TICKS_NONE);
+	if (ret != 2 ||
+	    get_ready_mask(ev) != (BIT(EV_FIFO) | BIT(EV_SEM))) {
+		TC_ERROR(" *** poll returned %d, mask 0x%x\n", ret,
+			 get_ready_mask(ev));
+		return TC_FAIL;
+	}
+
+	consume_ready(ev);
+
+	return TC_PASS;
+}
+
+static void isr_sem_give(void *arg)
+{
+	ARG_UNUSED(arg);
+
+	nano_isr_sem_give(&sem);
+}
+
+static int test_fiber_wakeup(void)
+{
+	TC_PRINT("Waking up a fiber polling several objects\n");
+
+	poll_timeout = TICKS_UNLIMITED;
+	task_fiber_start(fiber_stack, sizeof(fiber_stack), poll_fiber,
+			 0, 0, FIBER_PRIORITY, 0);
+
+	nano_task_fifo_put(&fifo, &fifo_data);
+	if (check_reply(1, BIT(EV_FIFO)) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	nano_task_lifo_put(&lifo, &lifo_data);
+	if (check_reply(1, BIT(EV_LIFO)) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	TC_PRINT("Waking up the polling fiber from an ISR\n");
+	irq_offload(isr_sem_give, NULL);
+	if (check_reply(1, BIT(EV_SEM)) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	TC_PRINT("Waking up the polling fiber with a timer\n");
+	nano_task_timer_start(&timer, TIMEOUT);
+	if (check_reply(1, BIT(EV_TIMER)) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void fiber_poll_busy(int arg1, int arg2)
+{
+	struct nano_poll_event ev;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	nano_poll_event_init(&ev, NANO_POLL_TYPE_SEM, &sem);
+	poll_ret = nano_fiber_poll(&ev, 1, TICKS_UNLIMITED);
+}
+
+static int test_busy(void)
+{
+	TC_PRINT("Polling an object another fiber is polling\n");
+
+	poll_ret = 0;
+	task_fiber_start(fiber2_stack, sizeof(fiber2_stack), fiber_poll_busy,
+			 0, 0, FIBER_PRIORITY, 0);
+
+	if (poll_ret != -EADDRINUSE) {
+		TC_ERROR(" *** poll returned %d (expected %d)\n", poll_ret,
+			 -EADDRINUSE);
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static int test_timeout(void)
+{
+	TC_PRINT("Polling fiber timing out\n");
+
+	/* the fiber picks up the new timeout after its next wakeup */
+	poll_timeout = TIMEOUT;
+	nano_task_sem_give(&sem);
+	if (check_reply(1, BIT(EV_SEM)) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	if (check_reply(0, 0) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	/* park the fiber */
+	poll_timeout = TICKS_UNLIMITED;
+	if (check_reply(0, 0) != TC_PASS) {
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void fiber_poll_short(int arg1, int arg2)
+{
+	struct nano_poll_event ev;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	nano_poll_event_init(&ev, NANO_POLL_TYPE_SEM, &task_sem);
+	poll_ret = nano_fiber_poll(&ev, 1, 1);
+	if (ev.state == NANO_POLL_STATE_READY) {
+		nano_fiber_sem_take(&task_sem, TICKS_NONE);
+	}
+
+	nano_fiber_sem_give(&reply);
+}
+
+static void isr_task_sem_give(void *arg)
+{
+	ARG_UNUSED(arg);
+
+	nano_isr_sem_give(&task_sem);
+}
+
+static void fiber_give_late(int arg1, int arg2)
+{
+	uint32_t end = sys_tick_get_32() + 2;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	/* fibers are not preempted: the polling fiber cannot run yet */
+	while ((int32_t)(sys_tick_get_32() - end) < 0) {
+	}
+
+	irq_offload(isr_task_sem_give, NULL);
+}
+
+static int test_timeout_then_signal(void)
+{
+	TC_PRINT("Signaling a fiber whose poll has timed out\n");
+
+	poll_ret = -1;
+	task_fiber_start(fiber2_stack, sizeof(fiber2_stack), fiber_poll_short,
+			 0, 0, FIBER_PRIORITY, 0);
+	task_fiber_start(fiber3_stack, sizeof(fiber3_stack), fiber_give_late,
+			 0, 0, FIBER_PRIORITY, 0);
+
+	if (!nano_task_sem_take(&reply, TIMEOUT * 2)) {
+		TC_ERROR(" *** polling fiber did not wake up\n");
+		return TC_FAIL;
+	}
+
+	/* the fiber must have been readied only once */
+	if (nano_task_sem_take(&reply, TIMEOUT)) {
+		TC_ERROR(" *** polling fiber ran twice\n");
+		return TC_FAIL;
+	}
+
+	if (poll_ret != 1) {
+		TC_ERROR(" *** poll returned %d (expected 1)\n", poll_ret);
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void fiber_put_later(int arg1, int arg2)
+{
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	fiber_sleep(TIMEOUT);
+	nano_fiber_lifo_put(&task_lifo, &lifo_data);
+}
+
+static int test_task_wait(void)
+{
+	struct nano_poll_event ev[2];
+	int ret;
+
+	TC_PRINT("Task polling with a timeout\n");
+
+	/* the polling fiber is still parked on the other objects */
+	nano_poll_event_init(&ev[0], NANO_POLL_TYPE_SEM, &task_sem);
+	nano_poll_event_init(&ev[1], NANO_POLL_TYPE_LIFO, &task_lifo);
+
+	ret = nano_task_poll(ev, 2, TIMEOUT);
+	if (ret != 0) {
+		TC_ERROR(" *** task poll returned %d (expected 0)\n", ret);
+		return TC_FAIL;
+	}
+
+	task_fiber_start(fiber2_stack, sizeof(fiber2_stack), fiber_put_later,
+			 0, 0, FIBER_PRIORITY, 0);
+
+	ret = nano_task_poll(ev, 2, TIMEOUT * 2);
+	if (ret != 1 || ev[0].state != NANO_POLL_STATE_NOT_READY ||
+	    ev[1].state != NANO_POLL_STATE_READY) {
+		TC_ERROR(" *** task poll returned %d\n", ret);
+		return TC_FAIL;
+	}
+
+	if (nano_task_lifo_get(&task_lifo, TICKS_NONE) != &lifo_data) {
+		TC_ERROR(" *** did not get the LIFO data\n");
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+void main(void)
+{
+	int rv;
+
+	TC_START("Test Nanokernel Polling");
+
+	nano_fifo_init(&fifo);
+	nano_lifo_init(&lifo);
+	nano_sem_init(&sem);
+	nano_timer_init(&timer, &timer_data);
+	nano_sem_init(&reply);
+	nano_lifo_init(&task_lifo);
+	nano_sem_init(&task_sem);
+	events_init(events);
+
+	rv = test_no_wait();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_fiber_wakeup();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_busy();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_timeout();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_timeout_then_signal();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_task_wait();
+
+done:
+	TC_END_RESULT(rv);
+	TC_END_REPORT(rv);
+}
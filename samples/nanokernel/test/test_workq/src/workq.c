@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * @file
+ * @brief Test nanokernel workqueue APIs
+ *
+ * This module tests the following workqueue routines:
+ *
+ * fiber_workqueue_start
+ * nano_work_init, nano_work_submit_to_queue
+ * nano_delayed_work_init, nano_delayed_work_submit_to_queue
+ * nano_delayed_work_cancel
+ *
+ * Work items are submitted from a fiber, the task and an ISR, and are
+ * expected to be processed in submission (or expiry) order. Cancelled work
+ * items must not be processed.
+ */
+
+#include <tc_util.h>
+#include <errno.h>
+#include <arch/cpu.h>
+#include <misc/util.h>
+#include <misc/nano_work.h>
+#include <irq_offload.h>
+
+#define NUM_TEST_ITEMS          6
+/* Each work item takes 100ms */
+#define WORK_ITEM_WAIT          (sys_clock_ticks_per_sec / 10)
+
+/*
+ * Wait 50ms between work submissions, to ensure fiber and task submit
+ * alternately.
+ */
+#define SUBMIT_WAIT             (sys_clock_ticks_per_sec / 20)
+
+#define FIBER_STACK_SIZE        1024
+#define FIBER_PRIORITY          10
+#define WORKQ_STACK_SIZE        1024
+#define WORKQ_PRIORITY          5
+
+struct test_item {
+	int key;
+	struct nano_delayed_work work;
+};
+
+static char __stack fiber_stack[FIBER_STACK_SIZE];
+static char __stack workq_stack[WORKQ_STACK_SIZE];
+
+static struct nano_workqueue workq;
+static struct test_item tests[NUM_TEST_ITEMS];
+
+static int results[NUM_TEST_ITEMS];
+static int num_results;
+
+static void work_handler(struct nano_work *work)
+{
+	struct test_item *ti = CONTAINER_OF(work, struct test_item, work.work);
+
+	TC_PRINT(" - Running test item %d\n", ti->key);
+	fiber_sleep(WORK_ITEM_WAIT);
+
+	results[num_results++] = ti->key;
+}
+
+static void test_items_init(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_TEST_ITEMS; i++) {
+		tests[i].key = i + 1;
+		nano_work_init(&tests[i].work.work, work_handler);
+	}
+}
+
+static void fiber_submit(int arg1, int arg2)
+{
+	int i;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	for (i = 0; i < NUM_TEST_ITEMS; i += 2) {
+		TC_PRINT(" - Submitting work %d from fiber\n", i + 1);
+		nano_work_submit_to_queue(&workq, &tests[i].work.work);
+		fiber_sleep(SUBMIT_WAIT);
+	}
+}
+
+static int check_results(int num_tests)
+{
+	int i;
+
+	if (num_results != num_tests) {
+		TC_ERROR("*** work items finished: %d (expected: %d)\n",
+			 num_results, num_tests);
+		return TC_FAIL;
+	}
+
+	for (i = 0; i < num_tests; i++) {
+		if (results[i] != i + 1) {
+			TC_ERROR("*** got result %d in position %d (expected %d)\n",
+				 results[i], i, i + 1);
+			return TC_FAIL;
+		}
+	}
+
+	return TC_PASS;
+}
+
+static int test_sequence(void)
+{
+	int i;
+
+	TC_PRINT("Starting sequence test\n");
+
+	TC_PRINT(" - Initializing test items\n");
+	test_items_init();
+
+	TC_PRINT(" - Submitting test items\n");
+	task_fiber_start(fiber_stack, sizeof(fiber_stack), fiber_submit,
+			 0, 0, FIBER_PRIORITY, 0);
+
+	/* Let the fiber submit the first item */
+	task_sleep(SUBMIT_WAIT / 2);
+
+	for (i = 1; i < NUM_TEST_ITEMS; i += 2) {
+		TC_PRINT(" - Submitting work %d from task\n", i + 1);
+		nano_work_submit_to_queue(&workq, &tests[i].work.work);
+		task_sleep(SUBMIT_WAIT);
+	}
+
+	TC_PRINT(" - Waiting for work to finish\n");
+	task_sleep((NUM_TEST_ITEMS + 1) * WORK_ITEM_WAIT);
+
+	TC_PRINT(" - Checking results\n");
+	return check_results(NUM_TEST_ITEMS);
+}
+
+static void reset_results(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_TEST_ITEMS; i++) {
+		results[i] = 0;
+	}
+
+	num_results = 0;
+}
+
+static void delayed_test_items_init(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_TEST_ITEMS; i++) {
+		tests[i].key = i + 1;
+		nano_delayed_work_init(&tests[i].work, work_handler);
+	}
+}
+
+static void fiber_submit_delayed(int arg1, int arg2)
+{
+	int i;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	for (i = 0; i < NUM_TEST_ITEMS; i += 2) {
+		TC_PRINT(" - Submitting delayed work %d from fiber\n", i + 1);
+		nano_delayed_work_submit_to_queue(&workq, &tests[i].work,
+						  (i + 1) * WORK_ITEM_WAIT);
+	}
+}
+
+static void submit_delayed_from_task(void)
+{
+	int i;
+
+	/* Delays are chosen so that items expire in key order */
+	task_fiber_start(fiber_stack, sizeof(fiber_stack),
+			 fiber_submit_delayed, 0, 0, FIBER_PRIORITY, 0);
+
+	for (i = 1; i < NUM_TEST_ITEMS; i += 2) {
+		TC_PRINT(" - Submitting delayed work %d from task\n", i + 1);
+		nano_delayed_work_submit_to_queue(&workq, &tests[i].work,
+						  (i + 1) * WORK_ITEM_WAIT);
+	}
+}
+
+static int test_delayed(void)
+{
+	TC_PRINT("Starting delayed test\n");
+
+	TC_PRINT(" - Initializing delayed test items\n");
+	delayed_test_items_init();
+
+	TC_PRINT(" - Submitting delayed test items\n");
+	submit_delayed_from_task();
+
+	TC_PRINT(" - Waiting for delayed work to finish\n");
+	task_sleep((NUM_TEST_ITEMS + 2) * WORK_ITEM_WAIT);
+
+	TC_PRINT(" - Checking results\n");
+	return check_results(NUM_TEST_ITEMS);
+}
+
+static void fiber_cancel_delayed(int arg1, int arg2)
+{
+	int i;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	for (i = 1; i < NUM_TEST_ITEMS; i += 4) {
+		TC_PRINT(" - Cancel delayed work %d from fiber\n", i + 1);
+		nano_delayed_work_cancel(&tests[i].work);
+	}
+}
+
+static int test_delayed_cancel(void)
+{
+	int i;
+
+	TC_PRINT("Starting delayed cancel test\n");
+
+	TC_PRINT(" - Initializing delayed test items\n");
+	delayed_test_items_init();
+
+	TC_PRINT(" - Submitting delayed test items\n");
+	submit_delayed_from_task();
+
+	/* Cancel every even key, half of them from a fiber */
+	task_fiber_start(fiber_stack, sizeof(fiber_stack),
+			 fiber_cancel_delayed, 0, 0, FIBER_PRIORITY, 0);
+
+	for (i = 3; i < NUM_TEST_ITEMS; i += 4) {
+		TC_PRINT(" - Cancel delayed work %d from task\n", i + 1);
+		nano_delayed_work_cancel(&tests[i].work);
+	}
+
+	/* Cancelling an item that is not scheduled must fail */
+	if (nano_delayed_work_cancel(&tests[1].work) != -EINVAL) {
+		TC_ERROR("*** cancelled a work item twice\n");
+		return TC_FAIL;
+	}
+
+	TC_PRINT(" - Waiting for delayed work to finish\n");
+	task_sleep((NUM_TEST_ITEMS + 2) * WORK_ITEM_WAIT);
+
+	TC_PRINT(" - Checking results\n");
+	for (i = 0; i < NUM_TEST_ITEMS / 2; i++) {
+		if (results[i] != 2 * i + 1) {
+			TC_ERROR("*** got result %d in position %d (expected %d)\n",
+				 results[i], i, 2 * i + 1);
+			return TC_FAIL;
+		}
+	}
+
+	if (num_results != NUM_TEST_ITEMS / 2) {
+		TC_ERROR("*** work items finished: %d (expected: %d)\n",
+			 num_results, NUM_TEST_ITEMS / 2);
+		return TC_FAIL;
+	}
+
+	return TC_PASS;
+}
+
+static void delayed_resubmit_handler(struct nano_work *work)
+{
+	struct test_item *ti = CONTAINER_OF(work, struct test_item, work.work);
+
+	results[num_results++] = ti->key;
+
+	if (ti->key < NUM_TEST_ITEMS) {
+		ti->key++;
+		TC_PRINT(" - Resubmitting delayed work\n");
+		nano_delayed_work_submit_to_queue(&workq, &ti->work,
+						  WORK_ITEM_WAIT);
+	}
+}
+
+static int test_delayed_resubmit(void)
+{
+	TC_PRINT("Starting delayed resubmit test\n");
+
+	tests[0].key = 1;
+	nano_delayed_work_init(&tests[0].work, delayed_resubmit_handler);
+
+	TC_PRINT(" - Submitting delayed work\n");
+	nano_delayed_work_submit_to_queue(&workq, &tests[0].work,
+					  WORK_ITEM_WAIT);
+
+	TC_PRINT(" - Waiting for work to finish\n");
+	task_sleep((NUM_TEST_ITEMS + 1) * WORK_ITEM_WAIT);
+
+	TC_PRINT(" - Checking results\n");
+	return check_results(NUM_TEST_ITEMS);
+}
+
+static void isr_submit(void *arg)
+{
+	int i;
+
+	ARG_UNUSED(arg);
+
+	for (i = 0; i < NUM_TEST_ITEMS; i++) {
+		nano_work_submit_to_queue(&workq, &tests[i].work.work);
+	}
+
+	/* Submitting a pending work item again has no effect */
+	nano_work_submit_to_queue(&workq, &tests[0].work.work);
+}
+
+static int test_isr_submit(void)
+{
+	TC_PRINT("Starting ISR submit test\n");
+
+	test_items_init();
+
+	TC_PRINT(" - Submitting test items from ISR\n");
+	irq_offload(isr_submit, NULL);
+
+	TC_PRINT(" - Waiting for work to finish\n");
+	task_sleep((NUM_TEST_ITEMS + 1) * WORK_ITEM_WAIT);
+
+	TC_PRINT(" - Checking results\n");
+	return check_results(NUM_TEST_ITEMS);
+}
+
+static uint32_t start_stamp;
+static uint32_t end_stamp;
+
+static void latency_handler(struct nano_work *work)
+{
+	ARG_UNUSED(work);
+
+	end_stamp = sys_cycle_get_32();
+}
+
+static void latency_fiber(int arg1, int arg2)
+{
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+
+	end_stamp = sys_cycle_get_32();
+}
+
+static int test_latency(void)
+{
+	struct nano_work work;
+
+	TC_PRINT("Starting latency test\n");
+
+	nano_work_init(&work, latency_handler);
+
+	/* The workqueue fiber preempts the task as soon as work is queued */
+	start_stamp = sys_cycle_get_32();
+	nano_work_submit_to_queue(&workq, &work);
+	TC_PRINT(" - workqueue submit to handler: %u cycles\n",
+		 end_stamp - start_stamp);
+
+	start_stamp = sys_cycle_get_32();
+	task_fiber_start(fiber_stack, sizeof(fiber_stack), latency_fiber,
+			 0, 0, WORKQ_PRIORITY, 0);
+	TC_PRINT(" - fiber start to entry: %u cycles\n",
+		 end_stamp - start_stamp);
+
+	TC_PRINT(" - delayed work item: %u bytes, fiber stack: %u bytes\n",
+		 (unsigned)sizeof(struct nano_delayed_work),
+		 (unsigned)sizeof(fiber_stack));
+
+	return TC_PASS;
+}
+
+void main(void)
+{
+	int rv;
+
+	TC_START("Test Nanokernel Workqueues");
+
+	fiber_workqueue_start(&workq, workq_stack, sizeof(workq_stack),
+			      WORKQ_PRIORITY);
+
+	rv = test_sequence();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	reset_results();
+
+	rv = test_delayed();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	reset_results();
+
+	rv = test_delayed_cancel();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	reset_results();
+
+	rv = test_delayed_resubmit();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	reset_results();
+
+	rv = test_isr_submit();
+	if (rv != TC_PASS) {
+		goto done;
+	}
+
+	rv = test_latency();
+
+done:
+	TC_END_RESULT(rv);
+	TC_END_REPORT(rv);
+}
@@ -0,0 +1,191 @@
+/* main.c - 6LoWPAN IPHC compression benchmark */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the cycles spent in IPHC header compression and decompression
+ * of IPv6/UDP packets. The packets either all belong to the same flow, or
+ * are spread over more flows than CONFIG_6LOWPAN_IPHC_CACHE_SIZE so that
+ * every packet misses the compression cache.
+ */
+
+#include <zephyr.h>
+
+#if defined(CONFIG_STDOUT_CONSOLE)
+#include <stdio.h>
+#define PRINT           printf
+#else
+#include <misc/printk.h>
+#define PRINT           printk
+#endif
+
+#include <string.h>
+#include <tc_util.h>
+
+#include <net/ip_buf.h>
+#include <net/net_core.h>
+
+/* The following uIP includes are for testing purposes only. Never
+ * ever use them in your application.
+ */
+#include "contiki/ip/uip.h"
+#include "contiki/netstack.h"
+
+#ifndef CONFIG_6LOWPAN_IPHC_CACHE_SIZE
+#define CONFIG_6LOWPAN_IPHC_CACHE_SIZE 0
+#endif
+
+#define ITERATIONS     1000
+#define PAYLOAD_LEN    64
+
+/* More flows than the cache can hold */
+#define FLOWS          (CONFIG_6LOWPAN_IPHC_CACHE_SIZE + 4)
+
+#define IP_HDR         ((struct uip_ip_hdr *)packet)
+#define UDP_HDR        ((struct uip_udp_hdr *)&packet[UIP_IPH_LEN])
+
+static uint8_t src_mac[] = { 0x0a, 0xbe, 0xef, 0x2d, 0xbc, 0x15, 0xf0, 0x0d };
+
+/* Address context 0 prefix, see sicslowpan_compression.c */
+static const uint8_t ctx_prefix[] = { 0xaa, 0xaa, 0, 0, 0, 0, 0, 0 };
+
+static uint8_t packet[UIP_IPUDPH_LEN + PAYLOAD_LEN];
+
+/*
+ * Even flows use link local addresses, odd flows use the address
+ * context. Both addresses can be derived from the link addresses.
+ */
+static void flow_addr(int flow, uip_ipaddr_t *src, uip_ipaddr_t *dst,
+		      linkaddr_t *lldst)
+{
+	memset(src, 0, sizeof(*src));
+	memset(dst, 0, sizeof(*dst));
+	memset(lldst, 0, sizeof(*lldst));
+
+	if (flow & 1) {
+		memcpy(src->u8, ctx_prefix, sizeof(ctx_prefix));
+		memcpy(dst->u8, ctx_prefix, sizeof(ctx_prefix));
+	} else {
+		src->u8[0] = dst->u8[0] = 0xfe;
+		src->u8[1] = dst->u8[1] = 0x80;
+	}
+
+	memcpy(&src->u8[8], src_mac, sizeof(src_mac));
+	src->u8[8] ^= 0x02;
+
+	lldst->u8[0] = 0x02;
+	lldst->u8[7] = flow + 1;
+	memcpy(&dst->u8[8], lldst->u8, 8);
+	dst->u8[8] ^= 0x02;
+}
+
+static void build_packet(struct net_buf *buf, int flow)
+{
+	uint16_t len = UIP_UDPH_LEN + PAYLOAD_LEN;
+	linkaddr_t lldst;
+	int i;
+
+	memset(packet, 0, UIP_IPUDPH_LEN);
+
+	IP_HDR->vtc = 0x60;
+	IP_HDR->len[0] = len >> 8;
+	IP_HDR->len[1] = len & 0xff;
+	IP_HDR->proto = UIP_PROTO_UDP;
+	IP_HDR->ttl = 64;
+	flow_addr(flow, &IP_HDR->srcipaddr,
+		  &IP_HDR->destipaddr, &lldst);
+
+	UDP_HDR->srcport = uip_htons(0xf0b1);
+	UDP_HDR->destport = uip_htons(0xf0b2);
+	UDP_HDR->udplen = uip_htons(len);
+	UDP_HDR->udpchksum = uip_htons(0x1234 + flow);
+
+	for (i = 0; i < PAYLOAD_LEN; i++) {
+		packet[UIP_IPUDPH_LEN + i] = i;
+	}
+
+	buf->len = 0;
+	memcpy(net_buf_add(buf, sizeof(packet)), packet, sizeof(packet));
+	uip_len(buf) = sizeof(packet);
+
+	linkaddr_copy(&ip_buf_ll_dest(buf), &lldst);
+	linkaddr_copy(&ip_buf_ll_src(buf), (linkaddr_t *)src_mac);
+}
+
+static int run(const char *name, int flows)
+{
+	uint32_t compress = 0, uncompress = 0, start, mid;
+	struct net_buf *buf;
+	int comp_len = 0;
+	int i;
+
+	buf = ip_buf_get_reserve_tx(0);
+	if (!buf) {
+		PRINT("Cannot get buffer\n");
+		return TC_FAIL;
+	}
+
+	for (i = 0; i < ITERATIONS; i++) {
+		build_packet(buf, i % flows);
+
+		start = sys_cycle_get_32();
+		NETSTACK_COMPRESS.compress(buf);
+		mid = sys_cycle_get_32();
+		comp_len = uip_len(buf);
+		NETSTACK_COMPRESS.uncompress(buf);
+		uncompress += sys_cycle_get_32() - mid;
+		compress += mid - start;
+
+		if (uip_len(buf) != sizeof(packet) ||
+		    memcmp(uip_buf(buf), packet, sizeof(packet))) {
+			PRINT("%s: packet %d does not match after "
+			      "uncompression\n", name, i);
+			ip_buf_unref(buf);
+			return TC_FAIL;
+		}
+	}
+
+	ip_buf_unref(buf);
+
+	PRINT("%s: %d flows, header %d -> %d bytes\n", name, flows,
+	      UIP_IPUDPH_LEN, comp_len - PAYLOAD_LEN);
+	PRINT("  compress:   %u cycles/packet\n", compress / ITERATIONS);
+	PRINT("  uncompress: %u cycles/packet\n", uncompress / ITERATIONS);
+
+	return TC_PASS;
+}
+
+void main(void)
+{
+	int result;
+
+	TC_START("6LoWPAN IPHC compression benchmark");
+
+	net_init();
+	net_set_mac(src_mac, sizeof(src_mac));
+
+	PRINT("IPHC cache size %d, %d packets per run\n",
+	      CONFIG_6LOWPAN_IPHC_CACHE_SIZE, ITERATIONS);
+
+	result = run("single flow", 1);
+	if (result == TC_PASS) {
+		result = run("round robin", FLOWS);
+	}
+
+	TC_END_RESULT(result);
+	TC_END_REPORT(result);
+}
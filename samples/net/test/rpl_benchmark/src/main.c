@@ -0,0 +1,288 @@
+/* main.c - RPL DIO processing benchmark */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Feeds synthetic DIO messages from simulated neighbors to the RPL ICMPv6
+ * input handler. The neighbors first advertise a DAG that we join, then
+ * every round one of them becomes the best parent while the others move
+ * to worse ranks, and each neighbor sends one DIO in a pseudo random
+ * order. The benchmark measures the cycles spent per DIO and the number
+ * of DIOs needed until the best neighbor is the preferred parent. The
+ * rank changes are deterministic so that runs can be compared.
+ */
+
+#include <zephyr.h>
+
+#if defined(CONFIG_STDOUT_CONSOLE)
+#include <stdio.h>
+#define PRINT           printf
+#else
+#include <misc/printk.h>
+#define PRINT           printk
+#endif
+
+#include <string.h>
+#include <tc_util.h>
+
+#include <net/ip_buf.h>
+#include <net/net_core.h>
+
+/* The following uIP includes are for testing purposes only. Never
+ * ever use them in your application.
+ */
+#include "contiki/ip/uip.h"
+#include "contiki/ipv6/uip-icmp6.h"
+#include "contiki/rpl/rpl-private.h"
+
+/* The parents share the neighbor table with the IPv6 neighbor cache */
+#define NEIGHBORS      6
+#define ROUNDS         50
+
+#define BEST_RANK      (2 * RPL_MIN_HOPRANKINC)
+#define OTHER_RANK     (3 * RPL_MIN_HOPRANKINC)
+
+/* DIO base object: instance, version, rank, flags, DTSN, reserved and
+ * DODAG id. See RFC 6550 ch. 6.3.1.
+ */
+#define DIO_LEN        24
+#define DIO_GROUNDED   0x80
+#define DIO_MOP_SHIFT  3
+
+#define STACKSIZE      2000
+
+static uint8_t src_mac[] = { 0x0a, 0xbe, 0xef, 0x2d, 0xbc, 0x15, 0xf0, 0x0d };
+static const uint8_t dag_id[16] = { 0xaa, 0xaa, [15] = 0x01 };
+
+static linkaddr_t nbr_ll[NEIGHBORS];
+static uip_ipaddr_t nbr_ip[NEIGHBORS];
+static uint16_t nbr_rank[NEIGHBORS];
+
+static uint32_t seed = 0x2b1d;
+static uint32_t cycles;
+static int dios;
+
+static char test_stack[STACKSIZE];
+static struct nano_sem test_done;
+static int result = TC_FAIL;
+
+/* Same sequence on every run */
+static uint32_t next_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return seed >> 16;
+}
+
+static void build_dio(struct net_buf *buf, int nbr)
+{
+	uint16_t len = UIP_ICMPH_LEN + DIO_LEN;
+	struct uip_icmp_hdr *icmp;
+	struct uip_ip_hdr *ip;
+	uint8_t *dio;
+
+	buf->len = 0;
+
+	ip = net_buf_add(buf, UIP_IPH_LEN);
+	memset(ip, 0, UIP_IPH_LEN);
+	ip->vtc = 0x60;
+	ip->len[0] = len >> 8;
+	ip->len[1] = len & 0xff;
+	ip->proto = UIP_PROTO_ICMP6;
+	ip->ttl = 255;
+	uip_ipaddr_copy(&ip->srcipaddr, &nbr_ip[nbr]);
+	uip_create_linklocal_rplnodes_mcast(&ip->destipaddr);
+
+	icmp = net_buf_add(buf, UIP_ICMPH_LEN);
+	icmp->type = ICMP6_RPL;
+	icmp->icode = RPL_CODE_DIO;
+	icmp->icmpchksum = 0;
+
+	dio = net_buf_add(buf, DIO_LEN);
+	memset(dio, 0, DIO_LEN);
+	dio[0] = RPL_DEFAULT_INSTANCE;
+	dio[1] = RPL_LOLLIPOP_INIT;
+	dio[2] = nbr_rank[nbr] >> 8;
+	dio[3] = nbr_rank[nbr] & 0xff;
+	dio[4] = DIO_GROUNDED | (RPL_MOP_DEFAULT << DIO_MOP_SHIFT);
+	memcpy(&dio[8], dag_id, sizeof(dag_id));
+
+	uip_len(buf) = buf->len;
+	uip_ext_len(buf) = 0;
+	linkaddr_copy(&ip_buf_ll_src(buf), &nbr_ll[nbr]);
+}
+
+static void send_dio(struct net_buf *buf, int nbr)
+{
+	uint32_t start;
+
+	build_dio(buf, nbr);
+
+	start = sys_cycle_get_32();
+	uip_icmp6_input(buf, ICMP6_RPL, RPL_CODE_DIO);
+	cycles += sys_cycle_get_32() - start;
+	dios++;
+}
+
+static bool converged(int best)
+{
+	rpl_dag_t *dag = rpl_get_any_dag();
+
+	if (!dag || !dag->preferred_parent) {
+		return false;
+	}
+
+	return uip_ipaddr_cmp(rpl_get_parent_ipaddr(dag->preferred_parent),
+			      &nbr_ip[best]);
+}
+
+/* The best neighbor is at least one hop better than any other, which
+ * is above the hysteresis of the objective functions.
+ */
+static void set_ranks(int best)
+{
+	int i;
+
+	for (i = 0; i < NEIGHBORS; i++) {
+		if (i == best) {
+			nbr_rank[i] = BEST_RANK;
+		} else {
+			nbr_rank[i] = OTHER_RANK +
+				(next_rand() % 3) * RPL_MIN_HOPRANKINC;
+		}
+	}
+}
+
+/* Every neighbor sends one DIO, returns the number of DIOs needed until
+ * the best one is selected or -1.
+ */
+static int sweep(struct net_buf *buf, int best)
+{
+	int first = next_rand() % NEIGHBORS;
+	int i;
+
+	for (i = 0; i < NEIGHBORS; i++) {
+		send_dio(buf, (first + i) % NEIGHBORS);
+
+		if (converged(best)) {
+			return i + 1;
+		}
+	}
+
+	return -1;
+}
+
+void fiber_test(void)
+{
+	uint32_t join_cycles, total = 0;
+	int join_dios, best, round, n, max = 0;
+	struct net_buf *buf;
+
+	buf = ip_buf_get_reserve_tx(0);
+	if (!buf) {
+		PRINT("Cannot get buffer\n");
+		goto out;
+	}
+
+	best = next_rand() % NEIGHBORS;
+	set_ranks(best);
+
+	for (n = 0; n < NEIGHBORS; n++) {
+		send_dio(buf, n);
+	}
+
+	if (!converged(best)) {
+		PRINT("Did not join the DAG\n");
+		goto unref;
+	}
+
+	join_dios = dios;
+	join_cycles = cycles;
+	dios = 0;
+	cycles = 0;
+
+	for (round = 0; round < ROUNDS; round++) {
+		best = next_rand() % NEIGHBORS;
+		set_ranks(best);
+
+		n = sweep(buf, best);
+		if (n < 0) {
+			PRINT("round %d: neighbor %d not selected\n",
+			      round, best);
+			goto unref;
+		}
+
+		total += n;
+		if (n > max) {
+			max = n;
+		}
+
+		/* Let the stack send the DAOs */
+		fiber_sleep(1);
+	}
+
+	PRINT("%d neighbors, %d rounds\n", NEIGHBORS, ROUNDS);
+	PRINT("  join:   %u cycles/DIO\n", join_cycles / join_dios);
+	PRINT("  repair: %u cycles/DIO\n", cycles / dios);
+	PRINT("  converged after %u.%02u DIOs avg, %d max\n",
+	      total / ROUNDS, total * 100 / ROUNDS % 100, max);
+#if RPL_CONF_STATS
+	PRINT("  parent switches %u, parent rescans %u\n",
+	      rpl_stats.parent_switch, rpl_stats.parent_rescans);
+#endif
+
+	result = TC_PASS;
+
+unref:
+	ip_buf_unref(buf);
+out:
+	nano_fiber_sem_give(&test_done);
+}
+
+void main(void)
+{
+	int i;
+
+	TC_START("RPL DIO processing benchmark");
+
+	net_init();
+	net_set_mac(src_mac, sizeof(src_mac));
+
+	/* Link local addresses of the neighbors are derived from their
+	 * link addresses.
+	 */
+	for (i = 0; i < NEIGHBORS; i++) {
+		memset(&nbr_ll[i], 0, sizeof(nbr_ll[i]));
+		nbr_ll[i].u8[0] = 0x02;
+		nbr_ll[i].u8[7] = i + 1;
+
+		uip_create_linklocal_prefix(&nbr_ip[i]);
+		memcpy(&nbr_ip[i].u8[8], nbr_ll[i].u8, 8);
+		nbr_ip[i].u8[8] ^= 0x02;
+	}
+
+	nano_sem_init(&test_done);
+
+	/* RPL runs in the context of the network fibers */
+	task_fiber_start(test_stack, STACKSIZE,
+			 (nano_fiber_entry_t)fiber_test, 0, 0, 7, 0);
+
+	nano_task_sem_take(&test_done, TICKS_UNLIMITED);
+
+	TC_END_RESULT(result);
+	TC_END_REPORT(result);
+}
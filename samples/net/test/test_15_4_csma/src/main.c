@@ -0,0 +1,268 @@
+/* main.c - 802.15.4 CSMA simulation test */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Queues frames for several neighbors at once on the CSMA MAC layer. The
+ * loopback radio simulates the other nodes of the network by reporting
+ * collisions (CONFIG_NET_15_4_LOOPBACK_COLLISION_RATE), so frames have to
+ * back off and be retransmitted. The test checks that every frame is
+ * reported to its sender and prints the goodput and the latency between
+ * queueing a frame and its transmission result.
+ */
+
+#include <zephyr.h>
+
+#if defined(CONFIG_STDOUT_CONSOLE)
+#include <stdio.h>
+#define PRINT           printf
+#else
+#include <misc/printk.h>
+#define PRINT           printk
+#endif
+
+#include <string.h>
+#include <tc_util.h>
+
+#include <net/l2_buf.h>
+#include <net/net_core.h>
+
+/* The following uIP includes are for testing purposes only. Never
+ * ever use them in your application.
+ */
+#include "contiki/netstack.h"
+#include "contiki/packetbuf.h"
+
+#ifndef CONFIG_NET_15_4_LOOPBACK_COLLISION_RATE
+#define CONFIG_NET_15_4_LOOPBACK_COLLISION_RATE 0
+#endif
+
+#ifdef CONFIG_CSMA_BURST
+#define BURST          "on"
+#else
+#define BURST          "off"
+#endif
+
+#ifdef CONFIG_CSMA_ADAPTIVE_BACKOFF
+#define ADAPTIVE       "on"
+#else
+#define ADAPTIVE       "off"
+#endif
+
+#define NODES          4
+#define FRAMES         4     /* Frames queued per node and round */
+#define ROUNDS         25
+#define PAYLOAD_LEN    80
+
+/* Minimum percentage of frames that must get through */
+#define MIN_DELIVERY   80
+
+#define STACKSIZE      2000
+#define ROUND_TIMEOUT  (10 * sys_clock_ticks_per_sec)
+
+struct frame {
+	uint32_t queued;
+	uint32_t done;
+	int status;
+	bool reported;
+};
+
+static uint8_t src_mac[] = { 0x0a, 0xbe, 0xef, 0x2d, 0xbc, 0x15, 0xf0, 0x0d };
+static linkaddr_t node_addr[NODES];
+
+static struct frame frames[NODES * FRAMES];
+static int pending;
+
+static int delivered, failed;
+static uint32_t total_bytes, total_latency, max_latency;
+
+static char test_stack[STACKSIZE];
+static struct nano_sem test_done;
+static int result = TC_FAIL;
+
+static void frame_sent(struct net_buf *buf, void *ptr, int status,
+		       int transmissions)
+{
+	struct frame *f = ptr;
+	uint32_t latency;
+
+	ARG_UNUSED(buf);
+	ARG_UNUSED(transmissions);
+
+	if (f->reported) {
+		PRINT("frame %d reported twice\n", (int)(f - frames));
+		failed++;
+		return;
+	}
+
+	f->reported = true;
+	f->done = sys_tick_get_32();
+	f->status = status;
+	pending--;
+
+	if (status != MAC_TX_OK) {
+		return;
+	}
+
+	latency = f->done - f->queued;
+	total_latency += latency;
+	if (latency > max_latency) {
+		max_latency = latency;
+	}
+
+	total_bytes += PAYLOAD_LEN;
+	delivered++;
+}
+
+static struct net_buf *get_buf(void)
+{
+	struct net_buf *buf;
+	int tries = 100;
+
+	/* The loopback radio uses L2 buffers to feed the frames back,
+	 * let the Rx fiber release them.
+	 */
+	while (!(buf = l2_buf_get_reserve(0)) && --tries) {
+		fiber_sleep(1);
+	}
+
+	return buf;
+}
+
+/* Queue FRAMES frames for a node, the last one starts the transmission */
+static int queue_frames(int node, int round)
+{
+	uint8_t payload[PAYLOAD_LEN];
+	struct net_buf *buf;
+	int i, j;
+
+	buf = get_buf();
+	if (!buf) {
+		PRINT("Cannot get L2 buffer\n");
+		return TC_FAIL;
+	}
+
+	for (i = 0; i < FRAMES; i++) {
+		struct frame *f = &frames[node * FRAMES + i];
+
+		for (j = 0; j < PAYLOAD_LEN; j++) {
+			payload[j] = node + round + i + j;
+		}
+
+		memset(f, 0, sizeof(*f));
+		f->queued = sys_tick_get_32();
+		pending++;
+
+		packetbuf_clear(buf);
+		packetbuf_copyfrom(buf, payload, sizeof(payload));
+		packetbuf_set_addr(buf, PACKETBUF_ADDR_RECEIVER,
+				   &node_addr[node]);
+
+		if (!NETSTACK_LLSEC.send(buf, frame_sent, i == FRAMES - 1, f)) {
+			PRINT("node %d: cannot queue frame %d\n", node, i);
+			return TC_FAIL;
+		}
+	}
+
+	return TC_PASS;
+}
+
+void fiber_test(void)
+{
+	uint32_t start, elapsed, end;
+	int round, node;
+
+	start = sys_tick_get_32();
+
+	for (round = 0; round < ROUNDS; round++) {
+		for (node = 0; node < NODES; node++) {
+			if (queue_frames(node, round) != TC_PASS) {
+				goto out;
+			}
+		}
+
+		end = sys_tick_get_32() + ROUND_TIMEOUT;
+		while (pending > 0 && (int32_t)(end - sys_tick_get_32()) > 0) {
+			fiber_sleep(1);
+		}
+
+		if (pending > 0) {
+			PRINT("round %d: %d frames not reported\n",
+			      round, pending);
+			goto out;
+		}
+	}
+
+	elapsed = sys_tick_get_32() - start;
+	if (!elapsed) {
+		elapsed = 1;
+	}
+
+	PRINT("%d nodes, %d frames, %d%% collisions, burst %s, "
+	      "adaptive backoff %s\n", NODES, ROUNDS * NODES * FRAMES,
+	      CONFIG_NET_15_4_LOOPBACK_COLLISION_RATE, BURST, ADAPTIVE);
+	PRINT("  delivered %d, dropped %d\n", delivered,
+	      ROUNDS * NODES * FRAMES - delivered);
+	PRINT("  goodput %u bytes/s\n",
+	      total_bytes * sys_clock_ticks_per_sec / elapsed);
+	if (delivered) {
+		PRINT("  latency avg %u ms, max %u ms\n",
+		      total_latency * 1000 / sys_clock_ticks_per_sec /
+		      delivered,
+		      max_latency * 1000 / sys_clock_ticks_per_sec);
+	}
+
+	if (!failed &&
+	    delivered * 100 >= ROUNDS * NODES * FRAMES * MIN_DELIVERY) {
+		result = TC_PASS;
+	}
+
+out:
+	nano_fiber_sem_give(&test_done);
+}
+
+void main(void)
+{
+	int i;
+
+	TC_START("802.15.4 CSMA simulation test");
+
+	net_init();
+	net_set_mac(src_mac, sizeof(src_mac));
+
+	/* The simulated nodes, their frames are looped back by the radio
+	 * and dropped by the MAC as they are not for us.
+	 */
+	for (i = 0; i < NODES; i++) {
+		memset(&node_addr[i], 0, sizeof(node_addr[i]));
+		node_addr[i].u8[0] = 0x02;
+		node_addr[i].u8[7] = i + 1;
+	}
+
+	nano_sem_init(&test_done);
+
+	/* The MAC layer is not reentrant, use it from a fiber like the
+	 * rest of the stack.
+	 */
+	task_fiber_start(test_stack, STACKSIZE,
+			 (nano_fiber_entry_t)fiber_test, 0, 0, 7, 0);
+
+	nano_task_sem_take(&test_done, TICKS_UNLIMITED);
+
+	TC_END_RESULT(result);
+	TC_END_REPORT(result);
+}
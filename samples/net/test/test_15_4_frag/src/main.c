@@ -0,0 +1,289 @@
+/* main.c - 6LoWPAN fragmentation stress test */
+
+/*
+ * Copyright (c) 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Several fibers send UDP datagrams of varying sizes over the 802.15.4
+ * loopback radio. With CONFIG_NET_15_4_LOOPBACK_REORDER the radio swaps
+ * consecutive frames, so the fragments of a datagram arrive out of order
+ * and interleaved with the fragments of the next one. The receiver checks
+ * that every datagram is reassembled with the correct content.
+ */
+
+#include <zephyr.h>
+
+#if defined(CONFIG_STDOUT_CONSOLE)
+#include <stdio.h>
+#define PRINT           printf
+#else
+#include <misc/printk.h>
+#define PRINT           printk
+#endif
+
+#include <errno.h>
+#include <tc_util.h>
+
+#include <net/ip_buf.h>
+#include <net/net_core.h>
+#include <net/net_socket.h>
+
+/* The following uIP includes are for testing purposes only. Never
+ * ever use them in your application.
+ */
+#include "contiki/ipv6/uip-ds6-route.h"  /* to set the route */
+#include "contiki/ipv6/uip-ds6-nbr.h"    /* to set the neighbor cache */
+
+#define SRC_PORT       0
+#define DEST_PORT      4242
+
+#define SENDERS        3
+#define ROUNDS         14
+
+/* Datagram header: sender id, sequence number and length */
+#define HDR_LEN        4
+
+#define STACKSIZE      2000
+#define SLEEPTICKS     (10 * sys_clock_ticks_per_sec / 1000)
+#define TIMEOUT        (20 * sys_clock_ticks_per_sec)
+
+static const struct in6_addr in6addr_src = IN6ADDR_ANY_INIT;
+static const struct in6_addr in6addr_dest = IN6ADDR_LOOPBACK_INIT;
+static uint8_t src_mac[] = { 0x0a, 0xbe, 0xef, 0x2d, 0xbc, 0x15, 0xf0, 0x0d };
+static const uip_lladdr_t dest_mac = { };
+
+static struct net_addr loopback_addr;
+static struct net_addr any_addr;
+
+/* Payload sizes, the biggest ones need about ten 802.15.4 frames */
+static const uint16_t sizes[] = { 40, 90, 200, 333, 512, 700, 1000 };
+
+static char sender_stack[SENDERS][STACKSIZE];
+static char receiver_stack[STACKSIZE];
+
+static struct net_context *recv_ctx[SENDERS];
+static int received[SENDERS];
+static struct nano_sem senders_done;
+
+static inline uint8_t pattern(int id, int seq, int i)
+{
+	return (uint8_t)(id * 73 + seq * 29 + i);
+}
+
+static struct net_context *get_context(const struct net_addr *remote,
+				       uint16_t remote_port,
+				       const struct net_addr *local,
+				       uint16_t local_port)
+{
+	struct net_context *ctx;
+
+	ctx = net_context_get(IPPROTO_UDP,
+			      remote, remote_port,
+			      local, local_port);
+	if (!ctx) {
+		PRINT("%s: Cannot get network context\n", __func__);
+	}
+
+	return ctx;
+}
+
+static int send_datagram(struct net_context *ctx, int id, int seq, int len)
+{
+	struct net_buf *buf;
+	uint8_t *ptr;
+	int i;
+
+	buf = ip_buf_get_tx(ctx);
+	if (!buf) {
+		return -ENOMEM;
+	}
+
+	ptr = net_buf_add(buf, len);
+	ptr[0] = id;
+	ptr[1] = seq;
+	ptr[2] = len >> 8;
+	ptr[3] = len;
+
+	for (i = HDR_LEN; i < len; i++) {
+		ptr[i] = pattern(id, seq, i);
+	}
+
+	if (net_send(buf) < 0) {
+		ip_buf_unref(buf);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int check_datagram(int id, struct net_buf *buf)
+{
+	uint8_t *ptr = ip_buf_appdata(buf);
+	int len = ip_buf_appdatalen(buf);
+	int i;
+
+	if (len < HDR_LEN || ptr[0] != id ||
+	    len != ((ptr[2] << 8) | ptr[3])) {
+		PRINT("sender %d: invalid datagram, %d bytes\n", id, len);
+		return TC_FAIL;
+	}
+
+	for (i = HDR_LEN; i < len; i++) {
+		if (ptr[i] != pattern(id, ptr[1], i)) {
+			PRINT("sender %d: seq %d corrupted at %d\n",
+			      id, ptr[1], i);
+			return TC_FAIL;
+		}
+	}
+
+	return TC_PASS;
+}
+
+void fiber_sending(int id, int unused)
+{
+	struct nano_timer timer;
+	uint32_t data[2] = {0, 0};
+	struct net_context *ctx;
+	int seq = 0;
+
+	ARG_UNUSED(unused);
+
+	ctx = get_context(&loopback_addr, DEST_PORT + id, &any_addr, SRC_PORT);
+
+	nano_timer_init(&timer, data);
+
+	while (ctx && seq < ROUNDS) {
+		int len = sizes[(seq + id * 2) % ARRAY_SIZE(sizes)];
+
+		if (!send_datagram(ctx, id, seq, len)) {
+			seq++;
+		}
+
+		nano_fiber_timer_start(&timer, SLEEPTICKS * (id + 1));
+		nano_fiber_timer_test(&timer, TICKS_UNLIMITED);
+	}
+
+	nano_fiber_sem_give(&senders_done);
+}
+
+void fiber_receiving(void)
+{
+	struct nano_timer timer;
+	uint32_t data[2] = {0, 0};
+	int64_t end = sys_tick_get() + TIMEOUT;
+	int result = TC_PASS;
+	int done, i;
+
+	nano_timer_init(&timer, data);
+
+	do {
+		done = 0;
+
+		for (i = 0; i < SENDERS; i++) {
+			struct net_buf *buf;
+
+			buf = net_receive(recv_ctx[i], TICKS_NONE);
+			if (buf) {
+				if (check_datagram(i, buf) != TC_PASS) {
+					result = TC_FAIL;
+				}
+
+				received[i]++;
+				ip_buf_unref(buf);
+			}
+
+			if (received[i] >= ROUNDS) {
+				done++;
+			}
+		}
+
+		nano_fiber_timer_start(&timer, 1);
+		nano_fiber_timer_test(&timer, TICKS_UNLIMITED);
+	} while (done < SENDERS && sys_tick_get() < end);
+
+	for (i = 0; i < SENDERS; i++) {
+		PRINT("sender %d: received %d/%d datagrams\n",
+		      i, received[i], ROUNDS);
+		if (received[i] != ROUNDS) {
+			result = TC_FAIL;
+		}
+	}
+
+	TC_END_RESULT(result);
+	TC_END_REPORT(result);
+}
+
+void main(void)
+{
+	struct net_context *ctx;
+	int i;
+
+	TC_START("6LoWPAN fragmentation stress test");
+
+	net_init();
+	net_set_mac(src_mac, sizeof(src_mac));
+
+	any_addr.in6_addr = in6addr_src;
+	any_addr.family = AF_INET6;
+
+	loopback_addr.in6_addr = in6addr_dest;
+	loopback_addr.family = AF_INET6;
+
+	/* Workaround to get packets from this task to listening fiber.
+	 * Do not attempt to do anything like this in live environment.
+	 */
+	if (!uip_ds6_nbr_add((uip_ipaddr_t *)&in6addr_dest,
+			     &dest_mac, 0, NBR_REACHABLE)) {
+		PRINT("Cannot add neighbor cache\n");
+	}
+
+	if (!uip_ds6_route_add((uip_ipaddr_t *)&in6addr_dest, 128,
+			       (uip_ipaddr_t *)&in6addr_dest)) {
+		PRINT("Cannot add localhost route\n");
+	}
+
+	for (i = 0; i < SENDERS; i++) {
+		recv_ctx[i] = get_context(&any_addr, SRC_PORT,
+					  &loopback_addr, DEST_PORT + i);
+		if (!recv_ctx[i]) {
+			TC_END_REPORT(TC_FAIL);
+			return;
+		}
+	}
+
+	nano_sem_init(&senders_done);
+
+	task_fiber_start(receiver_stack, STACKSIZE,
+			 (nano_fiber_entry_t)fiber_receiving, 0, 0, 7, 0);
+
+	for (i = 0; i < SENDERS; i++) {
+		task_fiber_start(sender_stack[i], STACKSIZE,
+				 (nano_fiber_entry_t)fiber_sending, i, 0, 7, 0);
+	}
+
+	for (i = 0; i < SENDERS; i++) {
+		nano_task_sem_take(&senders_done, TICKS_UNLIMITED);
+	}
+
+	/* The loopback radio may still hold the last frame back waiting
+	 * for a following one, push it out with an extra datagram.
+	 */
+	ctx = get_context(&loopback_addr, DEST_PORT + SENDERS, &any_addr,
+			  SRC_PORT);
+	if (ctx) {
+		send_datagram(ctx, SENDERS, 0, HDR_LEN);
+	}
+}